@@ -7,10 +7,55 @@ QT += concurrent
 CONFIG += c++17
 
 HEADERS += \
-    include/PhotoProcessing/PhotoProcessing.h
+    include/PhotoProcessing/Banding.h \
+    include/PhotoProcessing/Batch.h \
+    include/PhotoProcessing/Blur.h \
+    include/PhotoProcessing/Convolution.h \
+    include/PhotoProcessing/EditStack.h \
+    include/PhotoProcessing/Exporter.h \
+    include/PhotoProcessing/Geometry.h \
+    include/PhotoProcessing/Histogram.h \
+    include/PhotoProcessing/ImageDocument.h \
+    include/PhotoProcessing/ImageLoader.h \
+    include/PhotoProcessing/ImageProvider.h \
+    include/PhotoProcessing/ImageView.h \
+    include/PhotoProcessing/JobScheduler.h \
+    include/PhotoProcessing/PhotoProcessing.h \
+    include/PhotoProcessing/PointOperations.h \
+    include/PhotoProcessing/Pyramid.h \
+    include/PhotoProcessing/Region.h \
+    include/PhotoProcessing/Resample.h \
+    include/PhotoProcessing/ResultCache.h \
+    include/PhotoProcessing/ScratchImage.h \
+    include/PhotoProcessing/Simd.h \
+    include/PhotoProcessing/TiledImage.h \
+    include/PhotoProcessing/Tiling.h \
+    include/PhotoProcessing/Trace.h
 
 SOURCES += \
+        sources/PhotoProcessing/Banding.cpp \
+        sources/PhotoProcessing/Batch.cpp \
+        sources/PhotoProcessing/Blur.cpp \
+        sources/PhotoProcessing/Convolution.cpp \
+        sources/PhotoProcessing/EditStack.cpp \
+        sources/PhotoProcessing/Exporter.cpp \
+        sources/PhotoProcessing/Geometry.cpp \
+        sources/PhotoProcessing/Histogram.cpp \
+        sources/PhotoProcessing/ImageDocument.cpp \
+        sources/PhotoProcessing/ImageLoader.cpp \
+        sources/PhotoProcessing/ImageProvider.cpp \
+        sources/PhotoProcessing/ImageView.cpp \
+        sources/PhotoProcessing/JobScheduler.cpp \
         sources/PhotoProcessing/PhotoProcessing.cpp \
+        sources/PhotoProcessing/PointOperations.cpp \
+        sources/PhotoProcessing/Pyramid.cpp \
+        sources/PhotoProcessing/Region.cpp \
+        sources/PhotoProcessing/Resample.cpp \
+        sources/PhotoProcessing/ResultCache.cpp \
+        sources/PhotoProcessing/ScratchImage.cpp \
+        sources/PhotoProcessing/TiledImage.cpp \
+        sources/PhotoProcessing/Tiling.cpp \
+        sources/PhotoProcessing/Trace.cpp \
         sources/main.cpp
 
 RESOURCES += ui/qml.qrc \
@@ -0,0 +1,373 @@
+#include "include/PhotoProcessing/Batch.h"
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/Simd.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTextStream>
+#include <QThread>
+
+///
+/// Замеры операций PhotoProcessing на синтетических изображениях.
+/// Каждая операция слота process* выполняется так же, как в пакетном режиме (Batch::process), для всех сочетаний размера
+/// и количества потоков Tiling. Операции работают с изображением, уже приведенным к формату ядер, поэтому по всем исходным форматам
+/// замеряется только приведение (normalize), остальные операции - по первому выбранному формату. Результат - медиана времени и мегапиксели в секунду, таблица в stdout
+/// и JSON файл для сравнения версий.
+///
+namespace {
+///
+/// \brief The Format struct - Исходный формат синтетического изображения.
+///
+struct Format {
+    QString name;
+    QImage::Format format;
+};
+
+///
+/// \brief The Case struct - Замеряемая операция.
+///
+struct Case {
+    QString name; ///< Имя операции.
+    QString slot; ///< Слот PhotoProcessing, которому соответствует операция.
+    std::function<QImage(const QImage& source, const QImage& normalized)> run;
+    bool perFormat = false; ///< Время зависит от исходного формата, операция замеряется для каждого формата.
+};
+
+///
+/// \brief The Timing struct - Итог замера.
+///
+struct Timing {
+    int iterations = 0;
+    double median = 0.0; ///< Медиана в миллисекундах.
+    double minimum = 0.0; ///< Минимум в миллисекундах.
+};
+
+///
+/// \brief formats - Функция возвращает исходные форматы, которые умеет открывать приложение.
+///
+QVector<Format> formats()
+{
+    return {
+        { QStringLiteral("ARGB32"), QImage::Format_ARGB32 },
+        { QStringLiteral("RGB32"), QImage::Format_RGB32 },
+        { QStringLiteral("RGB888"), QImage::Format_RGB888 },
+        { QStringLiteral("Indexed8"), QImage::Format_Indexed8 },
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        { QStringLiteral("RGBA64"), QImage::Format_RGBA64 },
+#endif
+    };
+}
+
+///
+/// \brief step - Функция разбирает шаг пакетного режима, описание шага задано в коде и всегда верно.
+///
+Batch::Step step(const QString& text)
+{
+    Batch::Step result;
+    const QString error = Batch::parseStep(text, result);
+
+    Q_ASSERT(error.isEmpty());
+
+    return result;
+}
+
+///
+/// \brief cases - Функция возвращает операции: открытие изображения и все операции слотов process*.
+///
+QVector<Case> cases()
+{
+    QVector<Case> result;
+
+    /* Открытие: приведение декодированного изображения к формату ядер */
+    result.append({ QStringLiteral("normalize"), QStringLiteral("openImage"), [](const QImage& source, const QImage&) {
+                       return PointOperations::normalized(source);
+                   },
+        true });
+
+    const QVector<QPair<QString, QString>> steps {
+        { QStringLiteral("gray"), QStringLiteral("processRgbToGray") },
+        { QStringLiteral("sepia"), QStringLiteral("processToSepia") },
+        { QStringLiteral("hue:value=120"), QStringLiteral("processHue") },
+        { QStringLiteral("brightness:value=1.3"), QStringLiteral("processBrightness") },
+        { QStringLiteral("contrast:value=40"), QStringLiteral("processContrast") },
+        { QStringLiteral("rotate"), QStringLiteral("processRotate") },
+        { QStringLiteral("rotate-cw"), QStringLiteral("processRotateClockwise") },
+        { QStringLiteral("rotate180"), QStringLiteral("processRotate180") },
+        { QStringLiteral("flip-h"), QStringLiteral("processFlipHorizontal") },
+        { QStringLiteral("flip-v"), QStringLiteral("processFlipVertical") },
+        { QStringLiteral("scale-up:filter=bicubic"), QStringLiteral("processIncreaseScaling") },
+        { QStringLiteral("scale-down:filter=area"), QStringLiteral("processDecreaseScaling") },
+        { QStringLiteral("scale-down:filter=lanczos"), QStringLiteral("processDecreaseScaling") },
+        { QStringLiteral("blur:radius=3,mode=box"), QStringLiteral("processBoxBlur") },
+        { QStringLiteral("blur:radius=3,mode=gaussian"), QStringLiteral("processBoxBlur") },
+        { QStringLiteral("sharpen:amount=1"), QStringLiteral("processConvolution") },
+        { QStringLiteral("unsharp:sigma=2,amount=1"), QStringLiteral("processConvolution") },
+        { QStringLiteral("gaussian:sigma=8"), QStringLiteral("processConvolution") },
+        { QStringLiteral("edges"), QStringLiteral("processConvolution") },
+        { QStringLiteral("convolve:width=5,weights=1 1 1 1 1 1 2 2 2 1 1 2 4 2 1 1 2 2 2 1 1 1 1 1 1,border=mirror"), QStringLiteral("processConvolution") },
+        { QStringLiteral("auto-levels"), QStringLiteral("processAutoLevels") },
+        { QStringLiteral("auto-contrast"), QStringLiteral("processAutoContrast") }
+    };
+
+    for (const auto& pair : steps) {
+        const QVector<Batch::Step> operation { step(pair.first) };
+
+        result.append({ pair.first, pair.second, [operation](const QImage&, const QImage& normalized) {
+                           return Batch::process(normalized, operation);
+                       } });
+    }
+
+    return result;
+}
+
+///
+/// \brief synthetic - Функция строит детерминированное изображение: градиенты с шумом и полупрозрачными областями.
+/// \param megapixels - Размер в мегапикселях, стороны в пропорции 4:3.
+/// \param format - Формат результата.
+///
+QImage synthetic(const double megapixels, const QImage::Format format)
+{
+    const int width = qMax(1, qRound(std::sqrt(megapixels * 1e6 * 4.0 / 3.0)));
+    const int height = qMax(1, qRound(megapixels * 1e6 / width));
+
+    if (format == QImage::Format_Indexed8) {
+        QImage image(width, height, QImage::Format_Indexed8);
+        QVector<QRgb> palette(256);
+
+        for (int i = 0; i < palette.size(); ++i) {
+            palette[i] = qRgb(i, (i * 7) & 0xff, 255 - i);
+        }
+
+        image.setColorTable(palette);
+
+        for (int y = 0; y < height; ++y) {
+            uchar* row = image.scanLine(y);
+
+            for (int x = 0; x < width; ++x) {
+                row[x] = static_cast<uchar>((x + y * 3 + ((x * y) >> 5)) & 0xff);
+            }
+        }
+
+        return image;
+    }
+
+    QImage image(width, height, QImage::Format_ARGB32);
+    quint32 state = 2463534242u;
+
+    for (int y = 0; y < height; ++y) {
+        QRgb* row = reinterpret_cast<QRgb*>(image.scanLine(y));
+
+        for (int x = 0; x < width; ++x) {
+            /* xorshift: шум, чтобы таблицы и ветвления не попадали в один и тот же элемент */
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+
+            const int noise = static_cast<int>(state & 0x1f);
+            const int alpha = ((x / 64 + y / 64) & 1) ? 255 : 96 + (noise << 2);
+
+            row[x] = qRgba((x * 255 / width + noise) & 0xff, (y * 255 / height + noise) & 0xff, ((x + y) + noise) & 0xff, alpha);
+        }
+    }
+
+    return image.convertToFormat(format);
+}
+
+///
+/// \brief measure - Функция выполняет операцию, пока не наберется minimumTime и minimumIterations повторов.
+///
+Timing measure(const Case& operation, const QImage& source, const QImage& normalized, const double minimumTime, const int minimumIterations)
+{
+    /* Прогрев: таблицы, страницы памяти и потоки пула */
+    static_cast<void>(operation.run(source, normalized));
+
+    QVector<double> samples;
+    double total = 0.0;
+
+    while (samples.size() < minimumIterations || total < minimumTime) {
+        QElapsedTimer timer;
+        timer.start();
+
+        const QImage result = operation.run(source, normalized);
+
+        const double elapsed = timer.nsecsElapsed() / 1e6;
+
+        Q_ASSERT(!result.isNull());
+
+        samples.append(elapsed);
+        total += elapsed;
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    Timing timing;
+    timing.iterations = samples.size();
+    timing.median = samples.at(samples.size() / 2);
+    timing.minimum = samples.first();
+
+    return timing;
+}
+
+///
+/// \brief numbers - Функция разбирает список положительных чисел через запятую.
+///
+QVector<double> numbers(const QString& text)
+{
+    QVector<double> result;
+
+    for (const QString& part : text.split(QLatin1Char(','))) {
+        bool ok = false;
+        const double value = part.trimmed().toDouble(&ok);
+
+        if (ok && value > 0.0) {
+            result.append(value);
+        }
+    }
+
+    return result;
+}
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Замеры операций PhotoProcessing."));
+    parser.addHelpOption();
+
+    const QString defaultThreads = QStringLiteral("1,%1").arg(QThread::idealThreadCount());
+
+    const QCommandLineOption sizesOption(QStringLiteral("sizes"), QStringLiteral("Размеры в мегапикселях через запятую."), QStringLiteral("список"), QStringLiteral("1,16,100"));
+    const QCommandLineOption formatsOption(QStringLiteral("formats"), QStringLiteral("Исходные форматы через запятую: ARGB32, RGB32, RGB888, Indexed8, RGBA64. "
+                                                                        "Остальные операции, кроме normalize, замеряются по первому из них."), QStringLiteral("список"));
+    const QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("Количество потоков Tiling через запятую."), QStringLiteral("список"), defaultThreads);
+    const QCommandLineOption filterOption(QStringLiteral("filter"), QStringLiteral("Замерять только операции, имя которых содержит строку."), QStringLiteral("строка"));
+    const QCommandLineOption timeOption(QStringLiteral("min-time"), QStringLiteral("Минимальное время замера одного случая в миллисекундах."), QStringLiteral("мс"), QStringLiteral("500"));
+    const QCommandLineOption iterationsOption(QStringLiteral("min-iterations"), QStringLiteral("Минимальное количество повторов."), QStringLiteral("количество"), QStringLiteral("3"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("Файл JSON с результатами."), QStringLiteral("файл"), QStringLiteral("benchmark.json"));
+
+    parser.addOptions({ sizesOption, formatsOption, threadsOption, filterOption, timeOption, iterationsOption, outputOption });
+    parser.process(app);
+
+    const QVector<double> sizes = numbers(parser.value(sizesOption));
+    const QVector<double> threads = numbers(parser.value(threadsOption));
+    const QStringList formatNames = parser.value(formatsOption).split(QLatin1Char(','));
+    const double minimumTime = parser.value(timeOption).toDouble();
+    const int minimumIterations = qMax(1, parser.value(iterationsOption).toInt());
+
+    QVector<Format> selectedFormats;
+
+    for (const Format& format : formats()) {
+        if (parser.value(formatsOption).isEmpty() || formatNames.contains(format.name, Qt::CaseInsensitive)) {
+            selectedFormats.append(format);
+        }
+    }
+
+    QVector<Case> selectedCases;
+
+    for (const Case& operation : cases()) {
+        if (operation.name.contains(parser.value(filterOption))) {
+            selectedCases.append(operation);
+        }
+    }
+
+    if (sizes.isEmpty() || threads.isEmpty() || selectedFormats.isEmpty() || selectedCases.isEmpty()) {
+        err << QStringLiteral("Нечего замерять") << '\n';
+
+        return 2;
+    }
+
+    QJsonArray results;
+
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+               .arg(QStringLiteral("operation"), -28)
+               .arg(QStringLiteral("format"), -9)
+               .arg(QStringLiteral("MP"), 6)
+               .arg(QStringLiteral("threads"), 8)
+               .arg(QStringLiteral("median ms"), 11)
+               .arg(QStringLiteral("MP/s"), 10);
+    out.flush();
+
+    for (const double size : sizes) {
+        for (int formatIndex = 0; formatIndex < selectedFormats.size(); ++formatIndex) {
+            const Format& format = selectedFormats.at(formatIndex);
+
+            /* Исходное изображение строится один раз для всех операций и количеств потоков */
+            const QImage source = synthetic(size, format.format);
+            const QImage normalized = PointOperations::normalized(source);
+            const double megapixels = source.width() * double(source.height()) / 1e6;
+
+            for (const double threadValue : threads) {
+                const int threadCount = qRound(threadValue);
+
+                Tiling::setThreadCount(threadCount);
+
+                for (const Case& operation : selectedCases) {
+                    /* После приведения операции получают изображение в формате ядер при любом исходном формате, повтор по форматам замерял бы то же */
+                    if (!operation.perFormat && formatIndex > 0) {
+                        continue;
+                    }
+
+                    const Timing timing = measure(operation, source, normalized, minimumTime, minimumIterations);
+                    const double throughput = megapixels / (timing.median / 1000.0);
+
+                    out << QStringLiteral("%1 %2 %3 %4 %5 %6\n")
+                               .arg(operation.name, -28)
+                               .arg(format.name, -9)
+                               .arg(megapixels, 6, 'f', 1)
+                               .arg(threadCount, 8)
+                               .arg(timing.median, 11, 'f', 2)
+                               .arg(throughput, 10, 'f', 1);
+                    out.flush();
+
+                    results.append(QJsonObject {
+                        { QStringLiteral("operation"), operation.name },
+                        { QStringLiteral("slot"), operation.slot },
+                        { QStringLiteral("format"), format.name },
+                        { QStringLiteral("width"), source.width() },
+                        { QStringLiteral("height"), source.height() },
+                        { QStringLiteral("megapixels"), megapixels },
+                        { QStringLiteral("threads"), threadCount },
+                        { QStringLiteral("iterations"), timing.iterations },
+                        { QStringLiteral("medianMs"), timing.median },
+                        { QStringLiteral("minMs"), timing.minimum },
+                        { QStringLiteral("megapixelsPerSecond"), throughput } });
+                }
+            }
+        }
+    }
+
+    const QJsonObject report {
+        { QStringLiteral("qtVersion"), QString::fromLatin1(qVersion()) },
+        { QStringLiteral("cpuArchitecture"), QSysInfo::currentCpuArchitecture() },
+        { QStringLiteral("kernel"), QSysInfo::prettyProductName() },
+        { QStringLiteral("idealThreadCount"), QThread::idealThreadCount() },
+        { QStringLiteral("avx2"), Simd::hasAvx2() },
+        { QStringLiteral("results"), results }
+    };
+
+    QFile file(parser.value(outputOption));
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(QJsonDocument(report).toJson()) < 0) {
+        err << QStringLiteral("Не удалось записать \"%1\": %2").arg(file.fileName(), file.errorString()) << '\n';
+
+        return 1;
+    }
+
+    return 0;
+}
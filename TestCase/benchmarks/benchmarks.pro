@@ -0,0 +1,53 @@
+# Замеры операций PhotoProcessing: qmake benchmarks/benchmarks.pro && make && ./PhotoProcessingBenchmark --output benchmark.json
+QT += gui
+QT += concurrent
+
+CONFIG += c++17
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = PhotoProcessingBenchmark
+
+INCLUDEPATH += $$PWD/..
+
+HEADERS += \
+    ../include/PhotoProcessing/Banding.h \
+    ../include/PhotoProcessing/Batch.h \
+    ../include/PhotoProcessing/Blur.h \
+    ../include/PhotoProcessing/Convolution.h \
+    ../include/PhotoProcessing/EditStack.h \
+    ../include/PhotoProcessing/Exporter.h \
+    ../include/PhotoProcessing/Geometry.h \
+    ../include/PhotoProcessing/Histogram.h \
+    ../include/PhotoProcessing/ImageLoader.h \
+    ../include/PhotoProcessing/PointOperations.h \
+    ../include/PhotoProcessing/Pyramid.h \
+    ../include/PhotoProcessing/Resample.h \
+    ../include/PhotoProcessing/ScratchImage.h \
+    ../include/PhotoProcessing/Simd.h \
+    ../include/PhotoProcessing/TiledImage.h \
+    ../include/PhotoProcessing/Tiling.h \
+    ../include/PhotoProcessing/Trace.h
+
+SOURCES += \
+        ../sources/PhotoProcessing/Banding.cpp \
+        ../sources/PhotoProcessing/Batch.cpp \
+        ../sources/PhotoProcessing/Blur.cpp \
+        ../sources/PhotoProcessing/Convolution.cpp \
+        ../sources/PhotoProcessing/EditStack.cpp \
+        ../sources/PhotoProcessing/Exporter.cpp \
+        ../sources/PhotoProcessing/Geometry.cpp \
+        ../sources/PhotoProcessing/Histogram.cpp \
+        ../sources/PhotoProcessing/ImageLoader.cpp \
+        ../sources/PhotoProcessing/PointOperations.cpp \
+        ../sources/PhotoProcessing/Pyramid.cpp \
+        ../sources/PhotoProcessing/Resample.cpp \
+        ../sources/PhotoProcessing/ScratchImage.cpp \
+        ../sources/PhotoProcessing/TiledImage.cpp \
+        ../sources/PhotoProcessing/Tiling.cpp \
+        ../sources/PhotoProcessing/Trace.cpp \
+        PhotoProcessingBenchmark.cpp
+
+unix {
+    QMAKE_CXXFLAGS += "-fno-sized-deallocation"
+}
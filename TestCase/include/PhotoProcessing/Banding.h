@@ -0,0 +1,45 @@
+#ifndef BANDING_H
+#define BANDING_H
+
+#include <QString>
+#include <QVector>
+
+#include "include/PhotoProcessing/Batch.h"
+#include "include/PhotoProcessing/Exporter.h"
+
+///
+/// Обработка файлов, которые не помещаются в оперативную память.
+/// Изображение декодируется горизонтальными полосами (QImageReader::setClipRect), каждая полоса вместе с ореолом из соседних рядов
+/// проходит шаги Batch::process(), а ряды полосы без ореола пишутся в результат. Ореол равен суммарному радиусу размытий,
+/// поэтому результат совпадает с обработкой целого изображения. Повороты и отражения только меняют место полосы в результате.
+/// Результат собирается в рабочем файле, отображенном в память (ScratchImage::create), и кодируется из него:
+/// записанные страницы принадлежат файлу, и ОС сбрасывает их на диск, поэтому в памяти одновременно живет только полоса.
+///
+namespace Banding {
+///
+/// \brief unsupportedStep - Функция проверяет, что все шаги можно выполнить по полосам.
+/// \param steps - Шаги обработки.
+/// \return Пустая строка или описание шага, которому нужно все изображение.
+///
+[[nodiscard]] QString unsupportedStep(const QVector<Batch::Step>& steps);
+
+///
+/// \brief haloRows - Функция возвращает количество соседних рядов, которые нужны полосе сверху и снизу.
+/// \param steps - Шаги обработки.
+///
+[[nodiscard]] int haloRows(const QVector<Batch::Step>& steps);
+
+///
+/// \brief process - Функция обрабатывает файл по полосам и записывает результат.
+/// \param inputPath - Входной файл.
+/// \param outputPath - Файл результата. Рабочие файлы создаются рядом с ним.
+/// \param steps - Шаги обработки.
+/// \param options - Параметры кодировщика.
+/// \param budget - Бюджет памяти полосы в байтах.
+/// \return Пустая строка при успехе, иначе описание ошибки.
+///
+[[nodiscard]] QString process(const QString& inputPath, const QString& outputPath, const QVector<Batch::Step>& steps, const Exporter::Options& options,
+    const qint64 budget);
+}
+
+#endif // BANDING_H
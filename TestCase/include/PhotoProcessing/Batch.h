@@ -0,0 +1,106 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <QImage>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "include/PhotoProcessing/Convolution.h"
+#include "include/PhotoProcessing/EditStack.h"
+#include "include/PhotoProcessing/Exporter.h"
+
+///
+/// Пакетная обработка файлов без QML: TestCase --batch --op gray --op blur:radius=3 --out dir/ inputs...
+/// Файлы проходят конвейер декодирование - обработка - кодирование. Рабочих потоков столько же, сколько ядер: пока один файл
+/// декодируется, другие обрабатываются и кодируются. Каждый рабочий держит не больше одного изображения, поэтому количество
+/// изображений в памяти ограничено количеством рабочих. Сами операции, как и в интерфейсе, распараллеливаются по полосам Tiling.
+/// Файлы, которые не помещаются в бюджет памяти, обрабатываются по полосам (Banding).
+///
+namespace Batch {
+///
+/// \brief The Step struct - Шаг обработки.
+///
+struct Step {
+    ///
+    /// \brief The Type enum - Тип шага.
+    ///
+    enum class Type {
+        Operation, ///< Операция стека правок, подряд идущие операции считаются одним проходом EditStack::render().
+        BoxBlur, ///< Размытие box фильтром.
+        FastGaussianBlur, ///< Быстрое гауссово размытие.
+        AutoLevels, ///< Автоуровни по гистограммам каналов изображения после предыдущих шагов.
+        AutoContrast, ///< Автоконтраст по гистограмме яркости изображения после предыдущих шагов.
+        Convolution, ///< Свертка с ядром.
+        UnsharpMask ///< Нерезкая маска.
+    };
+
+    Type type = Type::Operation;
+    EditStack::Operation operation; ///< Операция для Type::Operation.
+    int radius = 1; ///< Радиус размытия.
+    int samples = 1; ///< Количество повторов размытия.
+    qreal clip = 0.001; ///< Доля самых темных и самых светлых пикселей, которые обрезают автоуровни и автоконтраст.
+    Convolution::Kernel kernel; ///< Ядро свертки.
+    Convolution::Border border = Convolution::Border::Clamp; ///< Чем продолжается изображение за краем при свертке.
+    qreal sigma = 1.0; ///< Стандартное отклонение нерезкой маски.
+    qreal amount = 1.0; ///< Сила нерезкой маски.
+};
+
+///
+/// \brief The Job struct - Пакетное задание.
+///
+struct Job {
+    QStringList inputs; ///< Входные файлы.
+    QString outputDirectory; ///< Каталог результатов, имена файлов сохраняются. Совпадающие имена получают суффикс -2, -3, ...
+    QVector<Step> steps; ///< Шаги обработки.
+    Exporter::Options options; ///< Параметры кодировщика. Пустой формат берется из расширения входного файла.
+    int workers = 0; ///< Количество рабочих потоков, 0 - по количеству ядер.
+    qint64 bandBudget = 0; ///< Бюджет памяти на файл в байтах. Файлы больше бюджета обрабатываются по полосам, если все шаги это позволяют (Banding::unsupportedStep()), 0 - всегда целиком.
+};
+
+///
+/// \brief The Report struct - Итог пакетной обработки.
+///
+struct Report {
+    int processed = 0; ///< Количество записанных файлов.
+    int failed = 0; ///< Количество файлов с ошибками.
+    qint64 pixels = 0; ///< Количество пикселей записанных изображений.
+    qint64 elapsed = 0; ///< Время обработки в миллисекундах.
+};
+
+///
+/// \brief isBatchMode - Функция проверяет, запрошен ли пакетный режим в аргументах командной строки.
+///
+[[nodiscard]] bool isBatchMode(const int argc, char* argv[]);
+
+///
+/// \brief parseStep - Функция разбирает шаг вида name[:key=value[,key=value]].
+/// \param text - Описание шага.
+/// \param step - Разобранный шаг.
+/// \return Пустая строка при успехе, иначе описание ошибки.
+///
+[[nodiscard]] QString parseStep(const QString& text, Step& step);
+
+///
+/// \brief process - Функция применяет шаги к изображению.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param steps - Шаги обработки.
+///
+[[nodiscard]] QImage process(const QImage& image, const QVector<Step>& steps);
+
+///
+/// \brief run - Функция обрабатывает все файлы задания и ждет окончания.
+/// \param job - Задание.
+/// \param errors - Ошибки по файлам в порядке входных файлов.
+///
+Report run(const Job& job, QStringList& errors);
+
+///
+/// \brief exec - Функция разбирает аргументы, выполняет задание и печатает ошибки и пропускную способность.
+/// \param arguments - Аргументы командной строки.
+/// \return Код завершения процесса.
+///
+int exec(const QStringList& arguments);
+}
+
+#endif // BATCH_H
@@ -0,0 +1,40 @@
+#ifndef BLUR_H
+#define BLUR_H
+
+#include <QImage>
+#include <QVector>
+
+///
+/// Размытие бегущими суммами: горизонтальный проход по рядам и вертикальный проход по столбцам.
+/// Стоимость на пиксель не зависит от радиуса, края изображения продолжаются крайними пикселями.
+/// Для небольших радиусов оба прохода делаются внутри одной полосы с ореолом, для больших - двумя проходами по всему изображению.
+/// Если операция текущего потока отменена через Tiling::CancellationScope, возвращается пустое изображение.
+///
+namespace Blur {
+///
+/// \brief gaussianRadii - Функция подбирает радиусы box проходов, которые вместе приближают гауссиан.
+/// \param sigma - Стандартное отклонение гауссиана в пикселях.
+/// \param passes - Количество box проходов.
+///
+[[nodiscard]] QVector<int> gaussianRadii(const double sigma, const int passes = 3);
+
+///
+/// \brief boxBlur - Функция размывает изображение box фильтром.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param radius - Радиус окна.
+/// \param samples - Количество повторов размытия.
+/// \return Новое изображение в том же формате.
+///
+[[nodiscard]] QImage boxBlur(const QImage& image, const int radius, const int samples);
+
+///
+/// \brief fastGaussianBlur - Функция приближает гауссово размытие тремя box проходами.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param radius - Стандартное отклонение гауссиана в пикселях.
+/// \param samples - Количество повторов размытия.
+/// \return Новое изображение в том же формате.
+///
+[[nodiscard]] QImage fastGaussianBlur(const QImage& image, const int radius, const int samples);
+}
+
+#endif // BLUR_H
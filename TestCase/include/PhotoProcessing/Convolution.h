@@ -0,0 +1,113 @@
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include <QImage>
+#include <QVector>
+
+///
+/// Свертка изображения с произвольным ядром NxM.
+/// Ядро ранга 1 (произведение столбца на ряд) определяется автоматически и считается двумя одномерными проходами: N + M умножений
+/// на пиксель вместо N * M. Веса переводятся в целые числа с фиксированной точкой, каналы пикселя расширяются до 16 бит, и пары
+/// произведений складываются SIMD инструкцией madd (SSE2 или AVX2). Изображение делится на полосы Tiling с ореолом в половину ядра.
+/// Альфа учитывается в premultiplied формате, как и в Blur. Если операция текущего потока отменена, возвращается пустое изображение.
+///
+namespace Convolution {
+///
+/// \brief The Border enum - Чем продолжается изображение за краем.
+///
+enum class Border {
+    Clamp, ///< Крайним пикселем.
+    Mirror, ///< Отражением без повтора крайнего пикселя.
+    Wrap, ///< Противоположным краем.
+    Transparent ///< Прозрачными пикселями.
+};
+
+///
+/// \brief The Kernel class - Ядро свертки: веса по рядам, якорь в центре ядра.
+///
+class Kernel {
+public:
+    Kernel() = default;
+
+    ///
+    /// \brief Kernel - Конструктор ядра из весов по рядам.
+    /// \param width - Ширина ядра.
+    /// \param height - Высота ядра.
+    /// \param weights - width * height весов, иначе ядро пустое.
+    ///
+    Kernel(const int width, const int height, const QVector<float>& weights);
+
+    ///
+    /// \brief gaussian - Функция строит гауссово ядро радиуса 3 * sigma.
+    /// \param sigma - Стандартное отклонение в пикселях.
+    ///
+    [[nodiscard]] static Kernel gaussian(const double sigma);
+
+    ///
+    /// \brief sharpen - Функция строит ядро резкости 3x3: пиксель минус amount соседей по кресту.
+    /// \param amount - Сила резкости.
+    ///
+    [[nodiscard]] static Kernel sharpen(const double amount);
+
+    ///
+    /// \brief edgeDetect - Функция строит ядро Лапласа 3x3: однотонные области становятся черными, остаются контуры.
+    ///
+    [[nodiscard]] static Kernel edgeDetect();
+
+    ///
+    /// \brief emboss - Функция строит ядро тиснения 3x3 со светом слева сверху.
+    ///
+    [[nodiscard]] static Kernel emboss();
+
+    [[nodiscard]] bool isNull() const;
+    [[nodiscard]] int width() const;
+    [[nodiscard]] int height() const;
+    [[nodiscard]] float at(const int x, const int y) const;
+
+    ///
+    /// \brief sum - Функция возвращает сумму весов. Ядро с суммой 1 сохраняет среднюю яркость.
+    ///
+    [[nodiscard]] double sum() const;
+
+    ///
+    /// \brief separate - Функция проверяет, что ядро ранга 1, и раскладывает его на столбец и ряд.
+    /// \param row - Веса горизонтального прохода.
+    /// \param column - Веса вертикального прохода.
+    /// \return Возвращает 'true', если at(x, y) == column[y] * row[x] для всех весов.
+    ///
+    bool separate(QVector<float>& row, QVector<float>& column) const;
+
+private:
+    int kernelWidth = 0;
+    int kernelHeight = 0;
+    QVector<float> kernelWeights;
+};
+
+///
+/// \brief convolve - Функция сворачивает изображение с ядром.
+/// Если сумма весов не равна 1 (контуры), альфа канал не сворачивается и берется из исходного пикселя.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param kernel - Ядро.
+/// \param border - Чем продолжается изображение за краем.
+/// \return Новое изображение в том же формате.
+///
+[[nodiscard]] QImage convolve(const QImage& image, const Kernel& kernel, const Border border = Border::Clamp);
+
+///
+/// \brief unsharpMask - Функция повышает резкость нерезким маскированием: image + amount * (image - gaussian(image)).
+/// Гауссиан разделим, поэтому даже большой радиус считается двумя одномерными проходами.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param sigma - Стандартное отклонение гауссиана в пикселях.
+/// \param amount - Сила резкости.
+/// \param border - Чем продолжается изображение за краем.
+/// \return Новое изображение в том же формате.
+///
+[[nodiscard]] QImage unsharpMask(const QImage& image, const double sigma, const double amount, const Border border = Border::Clamp);
+
+///
+/// \brief haloRows - Функция возвращает количество соседних рядов, которые ядро читает сверху и снизу.
+///
+[[nodiscard]] int haloRows(const Kernel& kernel);
+}
+
+#endif // CONVOLUTION_H
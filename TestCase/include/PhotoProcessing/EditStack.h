@@ -0,0 +1,84 @@
+#ifndef EDITSTACK_H
+#define EDITSTACK_H
+
+#include <QImage>
+#include <QSize>
+#include <QVector>
+
+#include "include/PhotoProcessing/PointOperations.h"
+
+///
+/// Ленивый стек правок: список операций поверх материализованного изображения, который считается только тогда,
+/// когда результат нужен для экрана или для сохранения.
+/// Поточечные операции не зависят от положения пикселя, а повороты и отражения только переставляют пиксели. Поэтому участок стека
+/// считается как изменение размера (Resample), один проход выборки по таблицам поворотов и отражений и поточечные операции,
+/// которые применяются к ряду сразу после выборки. Фильтр масштабирования не перестановочен с поточечными операциями
+/// и с другим масштабированием, поэтому стек делится на участки перед каждым масштабированием и каждый участок начинается с него.
+///
+namespace EditStack {
+///
+/// \brief The Operation struct - Операция стека правок.
+///
+struct Operation {
+    ///
+    /// \brief The Type enum - Тип операции.
+    ///
+    enum class Type {
+        Gray, ///< Перевод в grayScale.
+        Sepia, ///< Фильтр сепии.
+        Hue, ///< Новый тон, value - тон.
+        Brightness, ///< Яркость, value - от 0.0 до 2.0.
+        Contrast, ///< Контраст, value - от -127 до 127.
+        Rotate, ///< Разворот на 90 градусов против часовой стрелки.
+        RotateClockwise, ///< Разворот на 90 градусов по часовой стрелке.
+        Rotate180, ///< Разворот на 180 градусов.
+        FlipHorizontal, ///< Отражение слева направо.
+        FlipVertical, ///< Отражение сверху вниз.
+        IncreaseScaling, ///< Увеличение в 2 раза, value - фильтр Resample::Filter.
+        DecreaseScaling, ///< Уменьшение в 2 раза, value - фильтр Resample::Filter.
+        Levels ///< Уровни, levels - черные и белые точки каналов (автоуровни и автоконтраст).
+    };
+
+    Type type = Type::Gray;
+    float value = 0.0f;
+    PointOperations::Levels levels; ///< Черные и белые точки для Type::Levels.
+};
+
+///
+/// \brief isGeometry - Функция проверяет, что операция переставляет или масштабирует пиксели, а не меняет их цвет.
+///
+[[nodiscard]] bool isGeometry(const Operation& operation);
+
+///
+/// \brief isPointwise - Функция проверяет, что в стеке только поточечные операции: стек можно считать по любому прямоугольнику изображения.
+/// \param operations - Операции стека.
+///
+[[nodiscard]] bool isPointwise(const QVector<Operation>& operations);
+
+///
+/// \brief outputSize - Функция возвращает размер результата стека.
+/// \param size - Размер исходного изображения.
+/// \param operations - Операции стека.
+///
+[[nodiscard]] QSize outputSize(const QSize& size, const QVector<Operation>& operations);
+
+///
+/// \brief render - Функция считает стек правок: один проход на каждое масштабирование и на операции до первого из них.
+/// Результат совпадает с последовательным применением операций.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param operations - Операции стека.
+/// \return Новое изображение. Если операций нет, возвращается исходное изображение без копирования.
+///
+[[nodiscard]] QImage render(const QImage& image, const QVector<Operation>& operations);
+
+///
+/// \brief renderView - Функция считает стек правок для экрана по наименьшему уровню пирамиды, которого хватает для target.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param levels - Уровни пирамиды изображения (Pyramid::build()).
+/// \param operations - Операции стека.
+/// \param target - Размер области, в которую вписывается результат на экране.
+///
+[[nodiscard]] QImage renderView(const QImage& image, const QVector<QImage>& levels, const QVector<Operation>& operations, const QSize& target);
+}
+
+#endif // EDITSTACK_H
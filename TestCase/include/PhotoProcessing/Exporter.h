@@ -0,0 +1,154 @@
+#ifndef EXPORTER_H
+#define EXPORTER_H
+
+#include <optional>
+
+#include <QFuture>
+#include <QImage>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "include/PhotoProcessing/EditStack.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+///
+/// \brief The Exporter class - Фоновая запись изображения на диск.
+/// Промежуточные результаты никогда не кодируются: стек правок считается и кодируется только здесь, в отдельном потоке.
+/// Файл пишется через QSaveFile, поэтому при ошибке или отмене существующий файл не портится.
+/// Отмена останавливает расчет стека на следующей полосе, а кодирование - на следующей записи в файл.
+/// Все методы вызываются из главного потока.
+///
+class Exporter : public QObject {
+    Q_OBJECT
+
+public:
+    ///
+    /// \brief The Options struct - Параметры кодировщика.
+    ///
+    struct Options {
+        QString format; ///< Формат (png, jpg, webp...). Пустой формат берется из расширения файла.
+        int quality = -1; ///< Качество от 0 до 100 для форматов с потерями, -1 - по умолчанию.
+        int compression = -1; ///< Уровень сжатия без потерь (для PNG от 0 до 9), -1 - по умолчанию.
+    };
+
+    explicit Exporter(QObject* parent = nullptr);
+
+    ///
+    /// \brief ~Exporter - Деструктор отменяет запись и ждет ее остановки, так как она ссылается на объект.
+    ///
+    ~Exporter() override;
+
+    ///
+    /// \brief start - Функция запускает запись. Выполняемая запись отменяется, новая начнется после ее остановки.
+    /// \param filePath - Путь файла.
+    /// \param image - Материализованное изображение ревизии.
+    /// \param operations - Ленивые операции поверх него.
+    /// \param options - Параметры кодировщика.
+    ///
+    void start(const QString& filePath, const QImage& image, const QVector<EditStack::Operation>& operations, const Options& options);
+
+    ///
+    /// \brief cancel - Функция отменяет выполняемую и ожидающую запись.
+    ///
+    void cancel();
+
+    ///
+    /// \brief isRunning - Функция проверяет, идет ли запись.
+    ///
+    [[nodiscard]] bool isRunning() const;
+
+    ///
+    /// \brief progress - Функция возвращает долю выполненной записи от 0.0 до 1.0.
+    ///
+    [[nodiscard]] qreal progress() const;
+
+    ///
+    /// \brief supportedFormats - Функция возвращает форматы, которые можно записать.
+    ///
+    [[nodiscard]] static QStringList supportedFormats();
+
+    ///
+    /// \brief encode - Функция кодирует изображение и записывает файл через QSaveFile. Вызывается из любого потока.
+    /// \param image - Готовое изображение.
+    /// \param filePath - Путь файла.
+    /// \param options - Параметры кодировщика.
+    /// \param token - Признак отмены: кодирование прерывается на следующей записи в файл, существующий файл не изменяется.
+    /// \return Пустая строка, если файл записан или запись отменена, иначе описание ошибки.
+    ///
+    [[nodiscard]] static QString encode(const QImage& image, const QString& filePath, const Options& options,
+        const Tiling::CancellationToken& token = Tiling::CancellationToken());
+
+signals:
+    ///
+    /// \brief runningChanged - Сигнал передается, когда запись начинается или заканчивается.
+    ///
+    void runningChanged();
+
+    ///
+    /// \brief progressChanged - Сигнал передается, когда меняется доля выполненной записи.
+    ///
+    void progressChanged();
+
+    ///
+    /// \brief finished - Сигнал передается, когда запись завершена. После отмены сигнал не передается.
+    /// \param success - Записан ли файл.
+    /// \param filePath - Путь файла.
+    /// \param error - Описание ошибки, если файл не записан.
+    ///
+    void finished(bool success, const QString& filePath, const QString& error);
+
+private:
+    ///
+    /// \brief The Request struct - Запрос на запись и поколение, в котором он был создан.
+    ///
+    struct Request {
+        QString filePath;
+        QImage image;
+        QVector<EditStack::Operation> operations;
+        Options options;
+        quint64 generation = 0;
+    };
+
+    ///
+    /// \brief The Result struct - Результат записи.
+    ///
+    struct Result {
+        bool success = false;
+        QString error;
+    };
+
+    ///
+    /// \brief write - Функция считает стек правок и кодирует результат. Выполняется в рабочем потоке.
+    /// \param request - Запрос.
+    /// \param token - Признак отмены запроса.
+    ///
+    Result write(const Request& request, const Tiling::CancellationToken& token);
+
+    ///
+    /// \brief launch - Функция запускает запрос в рабочем потоке.
+    ///
+    void launch(const Request& request);
+
+    ///
+    /// \brief finish - Функция обрабатывает завершение записи в главном потоке и запускает ожидающий запрос.
+    ///
+    void finish(const Request& request, const Result& result);
+
+    ///
+    /// \brief reportProgress - Функция передает долю выполненной записи в главный поток, если запрос не устарел.
+    ///
+    void reportProgress(const quint64 requestGeneration, const qreal value);
+
+    QSharedPointer<QAtomicInteger<quint64>> generation;
+
+    std::optional<Request> pending;
+    bool running = false;
+    qreal currentProgress = 0.0;
+
+    QFuture<void> future;
+};
+
+#endif // EXPORTER_H
@@ -0,0 +1,53 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <QImage>
+
+///
+/// Повороты и отражения 32-битных изображений.
+/// Повороты на 90 и 270 градусов - это транспонирование с отражением. Оно выполняется блоками 64x64, чтобы и чтение, и запись
+/// оставались в кэше, а внутри блока - транспонированием 4x4 в регистрах SSE2. Блоки выполняются параллельно через Tiling.
+/// Поворот на 180 градусов и отражения не меняют размер и выполняются на месте.
+///
+namespace Geometry {
+///
+/// \brief transpose - Функция транспонирует изображение с отражением: result(x, y) = image(mirrorRows ? w - 1 - y : y, mirrorColumns ? h - 1 - x : x).
+/// \param image - 32-битное изображение размером w x h.
+/// \param mirrorColumns - Отразить столбцы результата.
+/// \param mirrorRows - Отразить ряды результата.
+/// \return Изображение размером h x w.
+///
+[[nodiscard]] QImage transpose(const QImage& image, const bool mirrorColumns, const bool mirrorRows);
+
+///
+/// \brief rotate90 - Функция поворачивает изображение на 90 градусов по часовой стрелке.
+/// \param image - 32-битное изображение.
+///
+[[nodiscard]] QImage rotate90(const QImage& image);
+
+///
+/// \brief rotate270 - Функция поворачивает изображение на 90 градусов против часовой стрелки.
+/// \param image - 32-битное изображение.
+///
+[[nodiscard]] QImage rotate270(const QImage& image);
+
+///
+/// \brief rotate180 - Функция поворачивает изображение на 180 градусов на месте.
+/// \param image - 32-битное изображение.
+///
+void rotate180(QImage& image);
+
+///
+/// \brief flipHorizontal - Функция отражает изображение слева направо на месте.
+/// \param image - 32-битное изображение.
+///
+void flipHorizontal(QImage& image);
+
+///
+/// \brief flipVertical - Функция отражает изображение сверху вниз на месте.
+/// \param image - 32-битное изображение.
+///
+void flipVertical(QImage& image);
+}
+
+#endif // GEOMETRY_H
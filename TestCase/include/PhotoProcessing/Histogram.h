@@ -0,0 +1,117 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <array>
+
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QVector>
+
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/TiledImage.h"
+
+///
+/// Статистика изображения: гистограммы каналов red, green, blue и яркости, минимум, максимум и перцентили.
+/// Гистограммы считаются за один параллельный проход: каждая полоса Tiling заполняет свою гистограмму, в конце они складываются.
+/// Для ревизии документа гистограммы считаются по тайлам (TiledImage) и запоминаются в TileCache: после правки
+/// пересчитываются только тайлы, которые изменились. Прозрачные пиксели не учитываются, как и в поточечных операциях.
+///
+namespace Histogram {
+///
+/// \brief The Channel enum - Канал гистограммы.
+///
+enum class Channel {
+    Red,
+    Green,
+    Blue,
+    Luma ///< Яркость по той же формуле, что и PointOperations::grayRow().
+};
+
+/* Количество каналов гистограммы */
+constexpr int channelCount = 4;
+
+///
+/// \brief The Statistics struct - Гистограммы каналов на 256 уровней.
+///
+struct Statistics {
+    std::array<std::array<qint64, 256>, channelCount> bins {};
+    qint64 count = 0; ///< Количество учтенных пикселей.
+
+    ///
+    /// \brief merge - Функция добавляет гистограммы other к этим.
+    ///
+    void merge(const Statistics& other);
+
+    ///
+    /// \brief minimum - Функция возвращает наименьший уровень канала, 0 для пустой гистограммы.
+    ///
+    [[nodiscard]] int minimum(const Channel channel) const;
+
+    ///
+    /// \brief maximum - Функция возвращает наибольший уровень канала, 0 для пустой гистограммы.
+    ///
+    [[nodiscard]] int maximum(const Channel channel) const;
+
+    ///
+    /// \brief percentile - Функция возвращает наименьший уровень канала, не выше которого лежит доля fraction пикселей.
+    /// \param channel - Канал.
+    /// \param fraction - Доля от 0.0 до 1.0.
+    ///
+    [[nodiscard]] int percentile(const Channel channel, const qreal fraction) const;
+
+    ///
+    /// \brief mean - Функция возвращает средний уровень канала.
+    ///
+    [[nodiscard]] qreal mean(const Channel channel) const;
+};
+
+///
+/// \brief The TileCache class - Гистограммы тайлов последней посчитанной ревизии.
+/// Тайлы, которые новая ревизия разделяет с предыдущей (TiledImage::isTileSharedWith()), не пересчитываются. Вызывается из любого потока.
+///
+class TileCache {
+public:
+    ///
+    /// \brief compute - Функция считает гистограммы изображения по тайлам, пересчитывая только измененные тайлы.
+    /// \param image - Изображение в формате, полученном из PointOperations::normalized().
+    /// \param tiles - Тайлы image.
+    ///
+    [[nodiscard]] Statistics compute(const QImage& image, const TiledImage& tiles);
+
+private:
+    QMutex mutex;
+    TiledImage cachedTiles;
+    QVector<Statistics> cachedStatistics;
+};
+
+///
+/// \brief compute - Функция считает гистограммы изображения за один параллельный проход.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+///
+[[nodiscard]] Statistics compute(const QImage& image);
+
+///
+/// \brief compute - Функция считает гистограммы прямоугольника изображения в текущем потоке.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param rect - Прямоугольник внутри изображения.
+///
+[[nodiscard]] Statistics compute(const QImage& image, const QRect& rect);
+
+///
+/// \brief autoLevels - Функция выбирает черную и белую точки каждого канала отдельно: каждый канал растягивается на весь диапазон.
+/// Убирает цветовой оттенок вместе с недостатком контраста.
+/// \param statistics - Гистограммы изображения.
+/// \param clip - Доля самых темных и самых светлых пикселей канала, которые обрезаются.
+///
+[[nodiscard]] PointOperations::Levels autoLevels(const Statistics& statistics, const qreal clip);
+
+///
+/// \brief autoContrast - Функция выбирает общие черную и белую точки по яркости: все каналы растягиваются одинаково, поэтому цветовой баланс сохраняется.
+/// \param statistics - Гистограммы изображения.
+/// \param clip - Доля самых темных и самых светлых пикселей, которые обрезаются.
+///
+[[nodiscard]] PointOperations::Levels autoContrast(const Statistics& statistics, const qreal clip);
+}
+
+#endif // HISTOGRAM_H
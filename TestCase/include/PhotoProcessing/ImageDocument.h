@@ -0,0 +1,194 @@
+#ifndef IMAGEDOCUMENT_H
+#define IMAGEDOCUMENT_H
+
+#include <limits>
+
+#include <QImage>
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QTemporaryDir>
+#include <QVector>
+
+#include "include/PhotoProcessing/EditStack.h"
+#include "include/PhotoProcessing/TiledImage.h"
+
+///
+/// \brief The ImageDocument class - Рабочий документ: текущее изображение, его ревизии и предпросмотр.
+/// Изменяется только из главного потока, читается также из рабочих потоков и из ImageProvider, поэтому доступ защищен мьютексом.
+/// Каждое изображение получает уникальную версию, по которой оно запрашивается через image:// URL.
+/// Ревизия хранит материализованное изображение и ленивые операции поверх него (EditStack), полный результат считается только при необходимости.
+/// Материализованные изображения истории хранятся тайлами (TiledImage), целиком в памяти держится только изображение текущей ревизии.
+/// Undo и redo переписывают в нем только тайлы, которые отличаются между ревизиями.
+/// Объем истории ограничен бюджетом: сначала сжимаются тайлы старых ревизий, затем они вытесняются в рабочие файлы (ScratchImage),
+/// затем удаляются пирамиды старых ревизий, а в последнюю очередь сами старые ревизии.
+///
+class ImageDocument {
+public:
+    ///
+    /// \brief The Revision struct - Ревизия документа: EditStack::render(image, operations).
+    /// levels - уменьшенные копии image (Pyramid::build()), view - результат для экрана (EditStack::renderView()).
+    /// tiles - тайлы image. У ревизий, которые не текущие и не делят материализованное изображение с текущей, image пустое.
+    /// dirty - прямоугольник результата, который изменился относительно предыдущей ревизии. Пустой прямоугольник - изменилось все изображение.
+    ///
+    struct Revision {
+        quint64 version = 0;
+        QImage image;
+        TiledImage tiles;
+        QVector<QImage> levels;
+        QVector<EditStack::Operation> operations;
+        QImage view;
+        QRect dirty;
+
+        ///
+        /// \brief viewImage - Функция возвращает изображение для экрана.
+        ///
+        [[nodiscard]] inline QImage viewImage() const
+        {
+            return view.isNull() ? image : view;
+        }
+    };
+
+    ///
+    /// \brief reset - Функция открывает новое изображение и очищает историю.
+    /// \param revision - Исходная ревизия. Версия назначается документом.
+    /// \return Версия исходного изображения.
+    ///
+    quint64 reset(Revision revision);
+
+    ///
+    /// \brief restore - Функция возвращает документ к исходному изображению и очищает историю.
+    /// \return Версия исходного изображения.
+    ///
+    quint64 restore();
+
+    ///
+    /// \brief addRevision - Функция добавляет новую ревизию после текущей, ревизии для redo удаляются.
+    /// \param revision - Новая ревизия. Версия назначается документом.
+    /// \return Версия новой ревизии.
+    ///
+    quint64 addRevision(Revision revision);
+
+    ///
+    /// \brief setPreview - Функция устанавливает изображение предпросмотра поверх текущей ревизии.
+    /// \param image - Изображение предпросмотра для экрана, в историю оно не попадает.
+    /// \return Версия предпросмотра.
+    ///
+    quint64 setPreview(const QImage& image);
+
+    ///
+    /// \brief undo - Функция делает текущей предыдущую ревизию.
+    /// \return Возвращает 'true' в случае успеха, в ином случае 'false'.
+    ///
+    bool undo();
+
+    ///
+    /// \brief redo - Функция делает текущей следующую ревизию.
+    /// \return Возвращает 'true' в случае успеха, в ином случае 'false'.
+    ///
+    bool redo();
+
+    ///
+    /// \brief canUndo - Функция проверяет, есть ли ревизия для undo.
+    ///
+    [[nodiscard]] bool canUndo() const;
+
+    ///
+    /// \brief canRedo - Функция проверяет, есть ли ревизия для redo.
+    ///
+    [[nodiscard]] bool canRedo() const;
+
+    ///
+    /// \brief current - Функция возвращает текущую ревизию без предпросмотра.
+    ///
+    [[nodiscard]] Revision current() const;
+
+    ///
+    /// \brief displayed - Функция возвращает то, что видит пользователь: предпросмотр, если он есть, иначе текущую ревизию.
+    ///
+    [[nodiscard]] Revision displayed() const;
+
+    ///
+    /// \brief image - Функция ищет изображение для экрана по версии.
+    /// \param version - Версия изображения.
+    /// \return Найденное изображение или пустое изображение, если версия уже удалена.
+    ///
+    [[nodiscard]] QImage image(const quint64 version) const;
+
+    ///
+    /// \brief setLevels - Функция задает пирамиду всем ревизиям с материализованным изображением base.
+    /// \param base - Тайлы материализованного изображения.
+    /// \param levels - Уровни пирамиды (Pyramid::build()).
+    ///
+    void setLevels(const TiledImage& base, const QVector<QImage>& levels);
+
+    ///
+    /// \brief setMemoryBudget - Функция задает бюджет памяти истории: тайлы и пирамиды всех ревизий.
+    /// \param bytes - Бюджет в байтах.
+    ///
+    void setMemoryBudget(const qsizetype bytes);
+
+    ///
+    /// \brief memoryUsage - Функция возвращает, сколько байт занимают тайлы и пирамиды всех ревизий.
+    ///
+    [[nodiscard]] qsizetype memoryUsage() const;
+
+    ///
+    /// \brief compress - Функция сжимает тайлы старых ревизий, пока история не уложится в бюджет. Тайлы текущей ревизии не сжимаются.
+    /// Сжатие долгое, поэтому функция вызывается из рабочего потока, мьютекс на время сжатия не удерживается.
+    ///
+    void compress();
+
+    ///
+    /// \brief spill - Функция вытесняет тайлы старых ревизий в рабочие файлы, пока история не уложится в бюджет. Тайлы текущей ревизии остаются в памяти.
+    /// Запись долгая, поэтому функция вызывается из рабочего потока, мьютекс на время записи не удерживается.
+    ///
+    void spill();
+
+    ///
+    /// \brief trim - Функция удаляет пирамиды старых ревизий, а затем сами старые ревизии, пока история не уложится в бюджет.
+    /// Исходная и текущая ревизии не удаляются.
+    /// \return Возвращает 'true', если история изменилась.
+    ///
+    bool trim();
+
+private:
+    ///
+    /// \brief clearPreview - Функция удаляет предпросмотр. Вызывается под мьютексом.
+    ///
+    void clearPreview();
+
+    ///
+    /// \brief activate - Функция делает ревизию текущей: собирает ее изображение из изображения предыдущей текущей ревизии
+    /// и отличающихся тайлов и освобождает изображения остальных ревизий. Вызывается под мьютексом.
+    /// \param index - Номер новой текущей ревизии.
+    /// \param previous - Предыдущая текущая ревизия. Ее изображение переиспользуется, поэтому она передается по значению.
+    ///
+    void activate(const int index, Revision previous);
+
+    ///
+    /// \brief usage - Функция считает память истории. Вызывается под мьютексом.
+    ///
+    [[nodiscard]] qsizetype usage() const;
+
+    ///
+    /// \brief oldBases - Функция возвращает тайлы всех ревизий от старых к новым и тайлы текущей ревизии. Вызывается под мьютексом.
+    /// \param currentBase - Тайлы текущей ревизии.
+    ///
+    [[nodiscard]] QVector<TiledImage> oldBases(TiledImage& currentBase) const;
+
+    mutable QMutex mutex;
+
+    QVector<Revision> revisions;
+    int currentRevision = -1;
+
+    Revision preview;
+
+    quint64 lastVersion = 0;
+
+    qsizetype memoryBudget = std::numeric_limits<qsizetype>::max();
+
+    QTemporaryDir scratchDir;
+    QAtomicInteger<quint64> scratchCounter;
+};
+
+#endif // IMAGEDOCUMENT_H
@@ -0,0 +1,51 @@
+#ifndef IMAGELOADER_H
+#define IMAGELOADER_H
+
+#include <functional>
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+///
+/// Загрузка изображений через QImageReader.
+/// Размер и формат читаются только из заголовка. Для быстрого первого кадра декодер уменьшает изображение сам (для JPEG - масштабированием DCT),
+/// если он это умеет, иначе уменьшенная копия не строится. Полное изображение декодируется один раз и сразу приводится к формату ядер
+/// (PointOperations::normalized()). Декодирование сообщает долю прочитанного файла и останавливается, если операция текущего потока
+/// отменена через Tiling::CancellationScope.
+///
+namespace ImageLoader {
+///
+/// \brief The Info struct - Сведения из заголовка файла.
+///
+struct Info {
+    QSize size; ///< Размер изображения, пустой, если заголовок не прочитан.
+    QImage::Format format = QImage::Format_Invalid; ///< Формат, в который декодируется изображение, если декодер сообщает его заранее.
+    QByteArray type; ///< Формат файла (jpeg, png...).
+};
+
+///
+/// \brief probe - Функция читает сведения из заголовка файла без декодирования пикселей.
+/// \param filePath - Путь к изображению.
+///
+[[nodiscard]] Info probe(const QString& filePath);
+
+///
+/// \brief decodeScaled - Функция декодирует уменьшенную копию изображения, которая вписывается в target.
+/// \param filePath - Путь к изображению.
+/// \param target - Размер области на экране.
+/// \return Изображение в формате ядер или пустое изображение, если декодер не умеет уменьшать сам или изображение не больше target.
+///
+[[nodiscard]] QImage decodeScaled(const QString& filePath, const QSize& target);
+
+///
+/// \brief decode - Функция декодирует изображение целиком и приводит его к формату ядер.
+/// \param filePath - Путь к изображению.
+/// \param progress - Обработчик доли прочитанного файла от 0.0 до 1.0, вызывается в потоке декодирования.
+/// \return Изображение в формате ядер или пустое изображение при ошибке и отмене.
+///
+[[nodiscard]] QImage decode(const QString& filePath, const std::function<void(qreal)>& progress = {});
+}
+
+#endif // IMAGELOADER_H
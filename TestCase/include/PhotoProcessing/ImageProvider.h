@@ -0,0 +1,29 @@
+#ifndef IMAGEPROVIDER_H
+#define IMAGEPROVIDER_H
+
+#include <QQuickImageProvider>
+#include <QSharedPointer>
+
+#include "include/PhotoProcessing/ImageDocument.h"
+
+///
+/// \brief The ImageProvider class - Отдает изображения рабочего документа в qml по адресу image://<id>/<версия>.
+/// Изображения не кодируются и не пишутся на диск. При asynchronous: true у Image запросы приходят из потока загрузчика qml.
+///
+class ImageProvider : public QQuickImageProvider {
+public:
+    explicit ImageProvider(const QSharedPointer<ImageDocument>& document);
+
+    ///
+    /// \brief requestImage - Функция возвращает изображение по версии из id.
+    /// \param id - Версия изображения.
+    /// \param size - Исходный размер изображения.
+    /// \param requestedSize - Размер, заданный через sourceSize в qml.
+    ///
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+
+private:
+    QSharedPointer<ImageDocument> document;
+};
+
+#endif // IMAGEPROVIDER_H
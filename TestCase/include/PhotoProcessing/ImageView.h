@@ -0,0 +1,201 @@
+#ifndef IMAGEVIEW_H
+#define IMAGEVIEW_H
+
+#include <QHash>
+#include <QImage>
+#include <QPointF>
+#include <QPointer>
+#include <QQuickItem>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+
+#include "include/PhotoProcessing/ImageDocument.h"
+#include "include/PhotoProcessing/PhotoProcessing.h"
+
+class QSGSimpleTextureNode;
+
+///
+/// \brief The ImageView class - Элемент qml, который показывает изображение PhotoProcessing тайлами с масштабированием и прокруткой.
+/// В видеопамять загружаются только тайлы, видимые в текущем масштабе: при уменьшении они берутся с нижних уровней пирамиды,
+/// поэтому изображение любого размера не упирается в максимальный размер текстуры.
+/// Поточечный стек правок считается для каждого тайла отдельно, после правки заменяются только тайлы под измененным прямоугольником (dirtyRect).
+/// За кадр загружается не больше tilesPerFrame тайлов, остальные показываются старыми, пока не будут заменены в следующих кадрах.
+///
+class ImageView : public QQuickItem {
+    Q_OBJECT
+
+    Q_PROPERTY(PhotoProcessing* processing READ processing WRITE setProcessing NOTIFY processingChanged)
+    Q_PROPERTY(qreal zoom READ zoom WRITE setZoom NOTIFY zoomChanged)
+    Q_PROPERTY(QPointF center READ center WRITE setCenter NOTIFY centerChanged)
+    Q_PROPERTY(QRectF paintedRect READ paintedRect NOTIFY paintedRectChanged)
+    Q_PROPERTY(bool hasImage READ hasImage NOTIFY hasImageChanged)
+
+public:
+    /* Сколько тайлов загружается в видеопамять за один кадр */
+    static constexpr int tilesPerFrame = 8;
+
+    explicit ImageView(QQuickItem* parent = nullptr);
+
+    ///
+    /// \brief processing - Функция возвращает объект, изображение которого показывается.
+    ///
+    [[nodiscard]] PhotoProcessing* processing() const;
+
+    ///
+    /// \brief setProcessing - Функция задает объект, изображение которого показывается.
+    /// \param processing - Объект PhotoProcessing.
+    ///
+    void setProcessing(PhotoProcessing* processing);
+
+    ///
+    /// \brief zoom - Функция возвращает масштаб: пикселей элемента на пиксель изображения. 0 - изображение вписано в элемент.
+    ///
+    [[nodiscard]] qreal zoom() const;
+
+    ///
+    /// \brief setZoom - Функция задает масштаб. Значение не больше 0 вписывает изображение в элемент.
+    /// \param zoom - Пикселей элемента на пиксель изображения.
+    ///
+    void setZoom(const qreal zoom);
+
+    ///
+    /// \brief center - Функция возвращает точку изображения в центре элемента в долях от 0.0 до 1.0.
+    ///
+    [[nodiscard]] QPointF center() const;
+
+    ///
+    /// \brief setCenter - Функция задает точку изображения в центре элемента.
+    /// \param center - Точка в долях изображения от 0.0 до 1.0.
+    ///
+    void setCenter(const QPointF& center);
+
+    ///
+    /// \brief paintedRect - Функция возвращает прямоугольник изображения в координатах элемента.
+    ///
+    [[nodiscard]] QRectF paintedRect() const;
+
+    ///
+    /// \brief hasImage - Функция проверяет, что есть изображение для показа.
+    ///
+    [[nodiscard]] bool hasImage() const;
+
+    ///
+    /// \brief zoomAt - Функция меняет масштаб так, что точка элемента point остается над той же точкой изображения.
+    /// \param factor - Во сколько раз меняется масштаб.
+    /// \param point - Точка в координатах элемента.
+    ///
+    Q_INVOKABLE void zoomAt(const qreal factor, const QPointF& point);
+
+    ///
+    /// \brief pan - Функция сдвигает изображение.
+    /// \param delta - Сдвиг в пикселях элемента.
+    ///
+    Q_INVOKABLE void pan(const QPointF& delta);
+
+signals:
+    ///
+    /// \brief processingChanged - Сигнал передается в qml, когда меняется объект PhotoProcessing.
+    ///
+    void processingChanged();
+
+    ///
+    /// \brief zoomChanged - Сигнал передается в qml, когда меняется масштаб.
+    ///
+    void zoomChanged();
+
+    ///
+    /// \brief centerChanged - Сигнал передается в qml, когда меняется точка в центре элемента.
+    ///
+    void centerChanged();
+
+    ///
+    /// \brief paintedRectChanged - Сигнал передается в qml, когда изображение сдвигается, масштабируется или меняет размер.
+    ///
+    void paintedRectChanged();
+
+    ///
+    /// \brief hasImageChanged - Сигнал передается в qml, когда появляется первое изображение.
+    ///
+    void hasImageChanged();
+
+    ///
+    /// \brief frameReady - Сигнал передается в qml, когда все видимые тайлы нового изображения загружены.
+    ///
+    void frameReady();
+
+protected:
+    ///
+    /// \brief updatePaintNode - Функция в потоке отрисовки загружает недостающие и устаревшие видимые тайлы и расставляет узлы тайлов.
+    ///
+    QSGNode* updatePaintNode(QSGNode* node, UpdatePaintNodeData* data) override;
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    void geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+#else
+    void geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry) override;
+#endif
+
+private:
+    ///
+    /// \brief The Tile struct - Загруженный тайл: узел с текстурой, его прямоугольник в долях изображения и уровень пирамиды.
+    ///
+    struct Tile {
+        QSGSimpleTextureNode* node = nullptr;
+        QRectF rect;
+        int level = 0;
+        bool stale = false;
+    };
+
+    ///
+    /// \brief refresh - Функция забирает у PhotoProcessing новое показанное изображение и помечает тайлы под измененным прямоугольником.
+    /// \param dirty - Измененный прямоугольник в долях изображения.
+    ///
+    void refresh(const QRectF& dirty);
+
+    ///
+    /// \brief updatePaintedRect - Функция пересчитывает прямоугольник изображения в координатах элемента.
+    ///
+    void updatePaintedRect();
+
+    ///
+    /// \brief currentScale - Функция возвращает текущий масштаб, для вписанного изображения - масштаб вписывания.
+    ///
+    [[nodiscard]] qreal currentScale() const;
+
+    ///
+    /// \brief fitScale - Функция возвращает масштаб, при котором изображение вписано в элемент.
+    ///
+    [[nodiscard]] qreal fitScale() const;
+
+    ///
+    /// \brief levels - Функция возвращает уровни, из которых режутся тайлы: полное изображение и пирамиду или только изображение для экрана.
+    ///
+    [[nodiscard]] QVector<QImage> levels() const;
+
+    ///
+    /// \brief renderTile - Функция вырезает тайл из уровня и применяет к нему поточечный стек правок.
+    /// \param level - Уровень.
+    /// \param rect - Прямоугольник тайла в пикселях уровня.
+    ///
+    [[nodiscard]] QImage renderTile(const QImage& level, const QRect& rect) const;
+
+    QPointer<PhotoProcessing> source;
+
+    /* Пишутся в главном потоке, читаются в updatePaintNode, пока главный поток заблокирован */
+    ImageDocument::Revision revision;
+    bool tiled = false;
+    QSize outputSize;
+    QVector<QRectF> pendingDirty;
+    bool resetTiles = false;
+
+    qreal zoomFactor = 0.0;
+    QPointF viewCenter = QPointF(0.5, 0.5);
+    QRectF currentPaintedRect;
+
+    /* Только поток отрисовки */
+    QHash<quint64, Tile> tiles;
+    quint64 reportedVersion = 0;
+};
+
+#endif // IMAGEVIEW_H
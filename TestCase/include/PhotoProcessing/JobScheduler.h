@@ -0,0 +1,116 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <functional>
+#include <optional>
+#include <type_traits>
+
+#include <QFuture>
+#include <QObject>
+#include <QSharedPointer>
+
+#include "include/PhotoProcessing/Tiling.h"
+
+///
+/// \brief The JobScheduler class - Планировщик фоновых операций, в котором побеждает последний запрос.
+/// Одновременно выполняется не больше одной операции. Новый запрос увеличивает поколение: выполняемая операция
+/// останавливается на следующей полосе, а ожидающий запрос заменяется новым. Результат передается в главный поток
+/// только если за время выполнения не появилось более нового запроса, иначе вызывается обработчик отмены запроса.
+/// Ожидание в очереди, выполнение и обработка результата записываются как фазы Trace.
+/// Все методы вызываются из главного потока.
+///
+class JobScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit JobScheduler(QObject* parent = nullptr);
+
+    ///
+    /// \brief ~JobScheduler - Деструктор отменяет операцию и ждет ее остановки, так как она ссылается на планировщик.
+    ///
+    ~JobScheduler() override;
+
+    ///
+    /// \brief schedule - Функция ставит операцию в очередь вместо всех предыдущих запросов.
+    /// \param name - Имя операции для Trace, строковый литерал.
+    /// \param job - Операция, которая выполняется в рабочем потоке и возвращает результат.
+    /// \param handler - Обработчик результата, вызывается в главном потоке с const Result&.
+    /// \param dropped - Обработчик отмены, вызывается в главном потоке вместо handler, если запрос заменен новым или отменен.
+    ///
+    template <typename Job, typename Handler>
+    void schedule(const char* name, Job job, Handler handler, const std::function<void()>& dropped = {})
+    {
+        using Result = std::invoke_result_t<Job>;
+
+        /* Результат передается из рабочего потока в главный через общий объект, запись и чтение разделены очередью событий */
+        const auto result = QSharedPointer<Result>::create();
+
+        scheduleTask(name, [job, result]() { *result = job(); }, [handler, result]() { handler(*result); }, dropped);
+    }
+
+    ///
+    /// \brief cancel - Функция отменяет выполняемую операцию и удаляет ожидающий запрос.
+    ///
+    void cancel();
+
+    ///
+    /// \brief isIdle - Функция проверяет, что нет ни выполняемой операции, ни ожидающего запроса.
+    ///
+    [[nodiscard]] bool isIdle() const;
+
+signals:
+    ///
+    /// \brief handled - Сигнал передается после обработки результата в главном потоке.
+    /// \param queued - Время постановки запроса в очередь (Trace::now()).
+    ///
+    void handled(const qint64 queued);
+
+private:
+    ///
+    /// \brief The Request struct - Запрос и поколение, в котором он был создан.
+    ///
+    struct Request {
+        const char* name = "";
+        std::function<void()> job;
+        std::function<void()> handler;
+        std::function<void()> dropped;
+        quint64 generation = 0;
+        qint64 queued = 0;
+    };
+
+    ///
+    /// \brief scheduleTask - Функция ставит запрос в очередь вместо всех предыдущих запросов.
+    /// \param name - Имя операции для Trace.
+    /// \param job - Операция, которая выполняется в рабочем потоке.
+    /// \param handler - Обработчик, вызывается в главном потоке, если запрос не устарел.
+    /// \param dropped - Обработчик отмены, вызывается в главном потоке, если запрос устарел.
+    ///
+    void scheduleTask(const char* name, const std::function<void()>& job, const std::function<void()>& handler, const std::function<void()>& dropped);
+
+    ///
+    /// \brief drop - Функция вызывает обработчик отмены запроса, который удален из очереди.
+    /// \param request - Удаленный запрос.
+    ///
+    static void drop(const std::optional<Request>& request);
+
+    ///
+    /// \brief start - Функция запускает запрос в рабочем потоке.
+    /// \param request - Запрос.
+    ///
+    void start(const Request& request);
+
+    ///
+    /// \brief finish - Функция обрабатывает завершение операции в главном потоке и запускает ожидающий запрос.
+    /// \param request - Завершенный запрос.
+    ///
+    void finish(const Request& request);
+
+    QSharedPointer<QAtomicInteger<quint64>> generation;
+
+    std::optional<Request> pending;
+    bool running = false;
+
+    QFuture<void> future;
+};
+
+#endif // JOBSCHEDULER_H
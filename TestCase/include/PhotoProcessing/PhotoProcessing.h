@@ -2,144 +2,454 @@
 #define PHOTOPROCESSING_H
 
 #include <cmath>
+#include <optional>
 
 #include <QImage>
 #include <QObject>
-#include <QRandomGenerator>
+#include <QQmlEngine>
+#include <QQmlParserStatus>
+#include <QRectF>
+#include <QSharedPointer>
+#include <QSize>
 #include <QStringBuilder>
-#include <QTemporaryDir>
 #include <QUrl>
 #include <QtConcurrent>
 
+#include "include/PhotoProcessing/Blur.h"
+#include "include/PhotoProcessing/Convolution.h"
+#include "include/PhotoProcessing/EditStack.h"
+#include "include/PhotoProcessing/Exporter.h"
+#include "include/PhotoProcessing/Histogram.h"
+#include "include/PhotoProcessing/ImageDocument.h"
+#include "include/PhotoProcessing/ImageLoader.h"
+#include "include/PhotoProcessing/ImageProvider.h"
+#include "include/PhotoProcessing/JobScheduler.h"
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/Pyramid.h"
+#include "include/PhotoProcessing/Region.h"
+#include "include/PhotoProcessing/Resample.h"
+#include "include/PhotoProcessing/ResultCache.h"
+#include "include/PhotoProcessing/TiledImage.h"
+#include "include/PhotoProcessing/Tiling.h"
+#include "include/PhotoProcessing/Trace.h"
+
 ///
 /// \brief The PhotoProcessing class - Класс служит для простой обработки изображений и отправки данных в qml.
+/// Рабочее изображение и его ревизии хранятся в памяти (ImageDocument) и отдаются в qml через ImageProvider.
+/// Операции выполняются через JobScheduler: новый запрос отменяет устаревшие, в qml попадает только последний результат.
+/// Поточечные и геометрические правки добавляются в ленивый стек (EditStack) и считаются для экрана по уменьшенной копии из пирамиды,
+/// полное изображение считается только для размытия и при сохранении.
+/// Изображение декодируется один раз (ImageLoader): пока оно декодируется, на экране показывается уменьшенная декодером копия,
+/// а файл, выбранный в диалоге, начинает декодироваться в фоне еще до открытия (prefetchImage).
+/// Гистограммы показанного изображения считаются в фоне после каждого изменения (Histogram) и передаются в qml через histogram.
+/// При включенных замерах (tracing) фазы каждой операции записываются в Trace и передаются в qml через timings.
+/// Если задано выделение (selection или setSelectionMask), операции считаются только внутри него (Region) и смешиваются по мягкому краю,
+/// а прямоугольник, который изменила последняя операция, передается в qml через dirtyRect.
+/// Посчитанные предпросмотры, изображения для экрана и результаты размытия и свертки хранятся в ResultCache и при повторном запросе не пересчитываются.
 ///
-class PhotoProcessing : public QObject {
+class PhotoProcessing : public QObject, public QQmlParserStatus {
     Q_OBJECT
-
-#define blurMatrixLength 9
+    Q_INTERFACES(QQmlParserStatus)
+
+    Q_PROPERTY(bool canUndo READ canUndo NOTIFY historyChanged)
+    Q_PROPERTY(bool canRedo READ canRedo NOTIFY historyChanged)
+    Q_PROPERTY(int threadCount READ threadCount WRITE setThreadCount NOTIFY threadCountChanged)
+    Q_PROPERTY(QSize previewSize READ previewSize WRITE setPreviewSize NOTIFY previewSizeChanged)
+    Q_PROPERTY(int historyBudget READ historyBudget WRITE setHistoryBudget NOTIFY historyBudgetChanged)
+    Q_PROPERTY(bool historyCompression READ historyCompression WRITE setHistoryCompression NOTIFY historyCompressionChanged)
+    Q_PROPERTY(bool exporting READ exporting NOTIFY exportingChanged)
+    Q_PROPERTY(qreal exportProgress READ exportProgress NOTIFY exportProgressChanged)
+    Q_PROPERTY(qreal loadProgress READ loadProgress NOTIFY loadProgressChanged)
+    Q_PROPERTY(bool tracing READ tracing WRITE setTracing NOTIFY tracingChanged)
+    Q_PROPERTY(QVariantList timings READ timings NOTIFY timingsChanged)
+    Q_PROPERTY(QVariantMap histogram READ histogram NOTIFY histogramChanged)
+    Q_PROPERTY(QRectF selection READ selection WRITE setSelection NOTIFY selectionChanged)
+    Q_PROPERTY(int selectionFeather READ selectionFeather WRITE setSelectionFeather NOTIFY selectionFeatherChanged)
+    Q_PROPERTY(QRectF dirtyRect READ dirtyRect NOTIFY dirtyRectChanged)
+    Q_PROPERTY(int cacheBudget READ cacheBudget WRITE setCacheBudget NOTIFY cacheBudgetChanged)
+    Q_PROPERTY(QVariantMap cacheStatistics READ cacheStatistics NOTIFY cacheStatisticsChanged)
 
 public:
     explicit PhotoProcessing(QObject* parent = nullptr);
+    ~PhotoProcessing() override;
+
+    ///
+    /// \brief The BlurMode enum - Тип размытия.
+    ///
+    enum BlurMode {
+        Box,
+        FastGaussian
+    };
+    Q_ENUM(BlurMode)
+
+    ///
+    /// \brief The ScalingFilter enum - Фильтр масштабирования. Значения совпадают с Resample::Filter.
+    ///
+    enum ScalingFilter {
+        Area,
+        Bilinear,
+        Bicubic,
+        Lanczos
+    };
+    Q_ENUM(ScalingFilter)
+
+    ///
+    /// \brief The ConvolutionFilter enum - Фильтр свертки.
+    ///
+    enum ConvolutionFilter {
+        Sharpen,
+        UnsharpMask,
+        Gaussian,
+        EdgeDetect,
+        Emboss
+    };
+    Q_ENUM(ConvolutionFilter)
 
     ///
-    /// \brief The ImageEditType enum - Тип того, как будет обработано изображение.
+    /// \brief The BorderMode enum - Чем продолжается изображение за краем при свертке. Значения совпадают с Convolution::Border.
     ///
-    enum ImageEditType {
-        AddWithHistory,
-        AddWithoutHistory
+    enum BorderMode {
+        Clamp,
+        Mirror,
+        Wrap,
+        Transparent
     };
-    Q_ENUM(ImageEditType)
+    Q_ENUM(BorderMode)
+
+    ///
+    /// \brief classBegin - Функция пустая: ее требует QQmlParserStatus, а движок qml доступен только в componentComplete().
+    ///
+    void classBegin() override;
+
+    ///
+    /// \brief componentComplete - Функция регистрирует ImageProvider документа в движке qml, который создал объект.
+    ///
+    void componentComplete() override;
+
+    ///
+    /// \brief canUndo - Функция проверяет, есть ли ревизия для undo.
+    ///
+    [[nodiscard]] bool canUndo() const;
+
+    ///
+    /// \brief canRedo - Функция проверяет, есть ли ревизия для redo.
+    ///
+    [[nodiscard]] bool canRedo() const;
+
+    ///
+    /// \brief threadCount - Функция возвращает количество потоков, на которые делится одна операция.
+    ///
+    [[nodiscard]] int threadCount() const;
+
+    ///
+    /// \brief setThreadCount - Функция задает количество потоков. Значение меньше 1 возвращает количество ядер.
+    /// \param count - Количество потоков.
+    ///
+    void setThreadCount(const int count);
+
+    ///
+    /// \brief previewSize - Функция возвращает размер области, в которую вписывается изображение на экране.
+    ///
+    [[nodiscard]] QSize previewSize() const;
+
+    ///
+    /// \brief setPreviewSize - Функция задает размер области, в которую вписывается изображение на экране.
+    /// По нему выбирается уровень пирамиды для предпросмотра.
+    /// \param size - Размер в пикселях.
+    ///
+    void setPreviewSize(const QSize& size);
+
+    ///
+    /// \brief historyBudget - Функция возвращает бюджет памяти истории в мегабайтах.
+    ///
+    [[nodiscard]] int historyBudget() const;
+
+    ///
+    /// \brief setHistoryBudget - Функция задает бюджет памяти истории. При превышении старые ревизии сжимаются, вытесняются на диск, а затем удаляются.
+    /// \param megabytes - Бюджет в мегабайтах.
+    ///
+    void setHistoryBudget(const int megabytes);
+
+    ///
+    /// \brief historyCompression - Функция проверяет, сжимаются ли тайлы старых ревизий при превышении бюджета.
+    ///
+    [[nodiscard]] bool historyCompression() const;
+
+    ///
+    /// \brief setHistoryCompression - Функция включает сжатие тайлов старых ревизий. Без сжатия тайлы сразу вытесняются на диск.
+    /// \param enabled - Включено ли сжатие.
+    ///
+    void setHistoryCompression(const bool enabled);
+
+    ///
+    /// \brief exporting - Функция проверяет, идет ли запись файла.
+    ///
+    [[nodiscard]] bool exporting() const;
+
+    ///
+    /// \brief exportProgress - Функция возвращает долю выполненной записи файла от 0.0 до 1.0.
+    ///
+    [[nodiscard]] qreal exportProgress() const;
+
+    ///
+    /// \brief loadProgress - Функция возвращает долю прочитанного файла открываемого изображения от 0.0 до 1.0.
+    ///
+    [[nodiscard]] qreal loadProgress() const;
+
+    ///
+    /// \brief tracing - Функция проверяет, включены ли замеры фаз операций.
+    ///
+    [[nodiscard]] bool tracing() const;
+
+    ///
+    /// \brief setTracing - Функция включает замеры фаз операций. Выключенные замеры почти ничего не стоят.
+    /// \param enabled - Включены ли замеры.
+    ///
+    void setTracing(const bool enabled);
+
+    ///
+    /// \brief timings - Функция возвращает фазы последней операции: name, category, start и duration в миллисекундах от постановки в очередь, thread.
+    ///
+    [[nodiscard]] QVariantList timings() const;
+
+    ///
+    /// \brief histogram - Функция возвращает гистограммы показанного изображения: red, green, blue и luma - по 256 высот от 0.0 до 1.0
+    /// относительно самого частого уровня, minimum, maximum и mean - яркость, count - количество учтенных пикселей.
+    ///
+    [[nodiscard]] QVariantMap histogram() const;
+
+    ///
+    /// \brief selection - Функция возвращает прямоугольник выделения в долях показанного изображения от 0.0 до 1.0.
+    /// Пустой прямоугольник - выделено все изображение.
+    ///
+    [[nodiscard]] QRectF selection() const;
+
+    ///
+    /// \brief setSelection - Функция задает прямоугольник выделения. Поточечные правки, размытие и свертка меняют только его.
+    /// \param rect - Прямоугольник в долях показанного изображения от 0.0 до 1.0. Пустой прямоугольник снимает выделение.
+    ///
+    void setSelection(const QRectF& rect);
+
+    ///
+    /// \brief selectionFeather - Функция возвращает ширину мягкого края выделения в пикселях изображения.
+    ///
+    [[nodiscard]] int selectionFeather() const;
+
+    ///
+    /// \brief setSelectionFeather - Функция задает ширину мягкого края выделения.
+    /// \param feather - Ширина в пикселях изображения, 0 - жесткий край.
+    ///
+    void setSelectionFeather(const int feather);
+
+    ///
+    /// \brief setSelectionMask - Функция задает выделение произвольной формы вместо прямоугольника.
+    /// \param mask - Маска в пикселях показанного изображения (EditStack::outputSize()).
+    ///
+    void setSelectionMask(const Region::Mask& mask);
+
+    ///
+    /// \brief dirtyRect - Функция возвращает прямоугольник, который изменился в последнем показанном изображении, в долях от 0.0 до 1.0.
+    ///
+    [[nodiscard]] QRectF dirtyRect() const;
+
+    ///
+    /// \brief cacheBudget - Функция возвращает бюджет памяти кэша результатов в мегабайтах.
+    ///
+    [[nodiscard]] int cacheBudget() const;
+
+    ///
+    /// \brief setCacheBudget - Функция задает бюджет памяти кэша результатов. 0 выключает кэш.
+    /// \param megabytes - Бюджет в мегабайтах.
+    ///
+    void setCacheBudget(const int megabytes);
+
+    ///
+    /// \brief cacheStatistics - Функция возвращает счетчики кэша результатов: hits, misses, bytes и entries.
+    ///
+    [[nodiscard]] QVariantMap cacheStatistics() const;
+
+    ///
+    /// \brief displayedRevision - Функция возвращает то, что видит пользователь, для ImageView.
+    /// Предпросмотр поточечной операции без выделения возвращается как текущая ревизия с этой операцией в стеке,
+    /// чтобы ImageView мог считать его по тайлам полного изображения, а не растягивать изображение для экрана.
+    ///
+    [[nodiscard]] ImageDocument::Revision displayedRevision() const;
+
+    ///
+    /// \brief supportedExportFormats - Функция возвращает форматы, в которые можно сохранить изображение.
+    ///
+    Q_INVOKABLE QStringList supportedExportFormats() const;
 
 public slots:
     ///
-    /// \brief processIncreaseScaling - Функция увеличивает изображение на 2.
+    /// \brief openImage - Функция загружает изображение с диска в рабочий документ.
     /// \param imagePath - Путь к изображению.
     ///
-    void processIncreaseScaling(const QString& imagePath);
+    void openImage(const QString& imagePath);
 
     ///
-    /// \brief processDecreaseScaling - Функция уменьшает изображение в 2 раза используя метод ближайшего соседа.
+    /// \brief prefetchImage - Функция начинает декодировать изображение в фоне, пока пользователь выбирает файл.
+    /// Если затем открывается этот же файл, то openImage дожидается уже начатого декодирования. Предыдущее фоновое декодирование отменяется.
     /// \param imagePath - Путь к изображению.
     ///
-    void processDecreaseScaling(const QString& imagePath);
+    void prefetchImage(const QString& imagePath);
 
     ///
-    /// \brief processBoxBlur - Функция обрабатывает блюрит изображение с помощью BoxBlur.
-    /// \param imagePath - Путь к изображению.
+    /// \brief processIncreaseScaling - Функция увеличивает изображение в 2 раза.
+    /// \param filter - Фильтр масштабирования.
+    ///
+    void processIncreaseScaling(const ScalingFilter filter = Bicubic);
+
+    ///
+    /// \brief processDecreaseScaling - Функция уменьшает изображение в 2 раза.
+    /// \param filter - Фильтр масштабирования. Area - среднее по площади, самое быстрое уменьшение.
+    ///
+    void processDecreaseScaling(const ScalingFilter filter = Area);
+
+    ///
+    /// \brief processBoxBlur - Функция блюрит изображение с помощью BoxBlur или быстрого гауссиана из трех BoxBlur.
+    /// \param samples - Количество проходов.
+    /// \param radius - Радиус окна для Box, стандартное отклонение для FastGaussian.
+    /// \param mode - Тип размытия.
     ///
-    void processBoxBlur(const QString& imagePath, const int samples);
+    void processBoxBlur(const int samples, const int radius, const BlurMode mode);
+
+    ///
+    /// \brief processConvolution - Функция сворачивает изображение с ядром фильтра.
+    /// \param filter - Фильтр свертки.
+    /// \param radius - Стандартное отклонение для Gaussian и UnsharpMask.
+    /// \param amount - Сила для Sharpen и UnsharpMask.
+    /// \param border - Чем продолжается изображение за краем.
+    ///
+    void processConvolution(const ConvolutionFilter filter, const double radius, const double amount, const BorderMode border);
 
     ///
     /// \brief procesRgbToGray - Функция переводит изображение в grayScale.
-    /// \param imagePath - Путь к изображению.
     ///
-    void processRgbToGray(const QString& imagePath);
+    void processRgbToGray();
 
     ///
     /// \brief processToSepia - Функция накладывает филтр сепии.
-    /// \param imagePath - Путь к изображению.
     ///
-    void processToSepia(const QString& imagePath);
+    void processToSepia();
 
     ///
-    /// \brief processHue - Устанавливает новый тон изображению.
-    /// \param imagePath - Путь к изображению.
+    /// \brief processHue - Устанавливает новый тон изображению. Результат становится предпросмотром.
     /// \param hue - Ноывй тон изображения.
     ///
-    void processHue(const QString& imagePath, const quint8 hue);
+    void processHue(const quint8 hue);
 
     ///
-    /// \brief processContrast - Функция изменяет контраст изображение.
-    /// \param tmpImagePath - Путь к изображению, которое будет изменено.
-    /// \param savePath - Путь по которому будет сохранено изменное изображение
+    /// \brief processContrast - Функция изменяет контраст изображение. Результат становится предпросмотром.
     /// \param contrast - Параметр контрастности, на которое будет увеличена сама яркость. От -127 до 127.
     ///
-    void processContrast(const QString& tmpImagePath, const QString& savePath, const qint8 contrast);
+    void processContrast(const qint8 contrast);
+
+    ///
+    /// \brief processAutoLevels - Функция растягивает каждый канал по его гистограмме: черная и белая точки выбираются отдельно для каждого канала.
+    ///
+    void processAutoLevels();
 
     ///
-    /// \brief processBrightness - Функция изменяет яркость изображение.
-    /// \param tmpImagePath - Путь к изображению, которое будет изменено.
-    /// \param savePath - Путь по которому будет сохранено изменное изображение.
+    /// \brief processAutoContrast - Функция растягивает контраст по гистограмме яркости одинаково для всех каналов.
+    ///
+    void processAutoContrast();
+
+    ///
+    /// \brief processBrightness - Функция изменяет яркость изображение. Результат становится предпросмотром.
     /// \param brightness - Параметр яркости, на которое будет увеличена сама яркость. От 0.0 до 2.0.
     ///
-    void processBrightness(const QString& tmpImagePath, const QString& savePath, const float brightness);
+    void processBrightness(const float brightness);
 
     ///
-    /// \brief processRotate - Функция делает разворот изображения на 90 градусов.
-    /// \param imagePath - Путь к изображению.
+    /// \brief processRotate - Функция делает разворот изображения на 90 градусов против часовой стрелки.
     ///
-    void processRotate(const QString& imagePath);
+    void processRotate();
 
     ///
-    /// \brief saveFile - Функция сохраняет файл по новому пути.
-    /// \param imagePath - Старый путь файла.
-    /// \param newImagePath - Новый путь файла.
-    /// \return Возвращает 'true' в случае успеха, в ином случае 'false'.
+    /// \brief processRotateClockwise - Функция делает разворот изображения на 90 градусов по часовой стрелке.
     ///
-    inline bool saveFile(const QString& imagePath, const QString& newImagePath)
-    {
-        const QString localFilePath = QUrl(imagePath).toLocalFile();
-        const QString newFilePath = QUrl(newImagePath).toLocalFile();
+    void processRotateClockwise();
 
-        /* Если файл уже существует */
-        if (QFile::exists(newFilePath)) {
-            QFile::remove(newFilePath);
-        }
+    ///
+    /// \brief processRotate180 - Функция делает разворот изображения на 180 градусов.
+    ///
+    void processRotate180();
 
-        return QFile::copy(localFilePath, newFilePath % "." % QFileInfo(localFilePath).suffix());
-    }
+    ///
+    /// \brief processFlipHorizontal - Функция отражает изображение слева направо.
+    ///
+    void processFlipHorizontal();
 
     ///
-    /// \brief createTempImage - Функция копирует изображение во временную папку, для операций над ним.
-    /// \param imagePath - Путь к изображению.
-    /// \return Путь к временному изображению.
+    /// \brief processFlipVertical - Функция отражает изображение сверху вниз.
     ///
-    [[nodiscard]] inline QString createTempImage(const QString& imagePath)
-    {
-        QFileInfo imageInfo(QUrl(imagePath).toLocalFile());
+    void processFlipVertical();
 
-        const QString newFileName = temporaryDir.path() % "/" % QString::number(QRandomGenerator::global()->bounded(100000, 999999)) % imageInfo.fileName();
+    ///
+    /// \brief clearSelection - Функция снимает выделение: операции снова меняют все изображение.
+    ///
+    void clearSelection();
 
-        if (QFile::copy(imageInfo.filePath(), newFileName)) {
-            return newFileName;
-        }
+    ///
+    /// \brief commitPreview - Функция добавляет последнюю операцию предпросмотра в стек правок текущей ревизии.
+    ///
+    void commitPreview();
 
-        return "";
-    }
+    ///
+    /// \brief undo - Функция показывает предыдущую ревизию.
+    ///
+    void undo();
+
+    ///
+    /// \brief redo - Функция показывает следующую ревизию.
+    ///
+    void redo();
+
+    ///
+    /// \brief restore - Функция возвращает исходное изображение и очищает историю.
+    ///
+    void restore();
+
+    ///
+    /// \brief exportImage - Функция в фоне сохраняет изображение вместе с предпросмотром по новому пути. Только здесь изображение кодируется и пишется на диск.
+    /// Результат передается сигналом exportFinished.
+    /// \param newImagePath - Новый путь файла. Если у него нет расширения, то берется расширение исходного файла.
+    /// \param format - Формат (png, jpg, webp...). Пустой формат берется из расширения файла.
+    /// \param quality - Качество от 0 до 100 для форматов с потерями, -1 - по умолчанию.
+    /// \param compression - Уровень сжатия без потерь (для PNG от 0 до 9, 1 - быстрое сжатие для черновиков), -1 - по умолчанию.
+    ///
+    void exportImage(const QString& newImagePath, const QString& format = QString(), const int quality = -1, const int compression = -1);
+
+    ///
+    /// \brief cancelExport - Функция отменяет запись файла. Существующий файл не изменяется.
+    ///
+    void cancelExport();
 
     ///
-    /// \brief getSourceImageSize - Функция возвращает размер изображения.
+    /// \brief saveTrace - Функция записывает все замеренные фазы в файл формата Chrome trace event (chrome://tracing, Perfetto).
+    /// \param tracePath - Путь файла.
+    /// \return Возвращает 'true', если файл записан.
+    ///
+    bool saveTrace(const QString& tracePath);
+
+    ///
+    /// \brief reportImageReady - Функция вызывается из qml по сигналу ImageView::frameReady, когда все видимые тайлы нового изображения загружены. Замеряет фазу reload.
+    ///
+    void reportImageReady();
+
+    ///
+    /// \brief getSourceImageSize - Функция возвращает размер изображения. Размер читается из заголовка файла, пиксели не декодируются.
     /// \param imagePath - Путь к изображению.
     /// \return Возвращает лист, где на первом месте стоит ширина, а на втором высота.
     ///
     [[nodiscard]] inline QVariantList getSourceImageSize(const QString& imagePath)
     {
-        QImage image(QUrl(imagePath).toLocalFile());
+        const QSize imageSize = ImageLoader::probe(QUrl(imagePath).toLocalFile()).size;
 
         QVariantList size;
-        size.append(image.width());
-        size.append(image.height());
+        size.append(imageSize.width());
+        size.append(imageSize.height());
 
         return size;
     }
@@ -147,13 +457,13 @@ public slots:
 signals:
     ///
     /// \brief imageEditChanged - Сигнал передается в qml с целью изменить изображение на новое и добавить в историю изображение.
-    /// \param newImagePath - Путь к новому изображению.
+    /// \param newImagePath - image:// адрес нового изображения.
     ///
     void imageEditChanged(const QString& newImagePath);
 
     ///
     /// \brief imageEditWithoutQueueChanged - Сигнал передается в qml с целью изменить изображение на новое, но не добавляет в историю изображение.
-    /// \param newImagePath - Путь к новому изображению.
+    /// \param newImagePath - image:// адрес нового изображения.
     ///
     void imageEditWithoutQueueChanged(const QString& newImagePath);
 
@@ -162,32 +472,295 @@ signals:
     ///
     void loadingStartedChanged();
 
+    ///
+    /// \brief historyChanged - Сигнал передается в qml, когда меняется возможность undo или redo.
+    ///
+    void historyChanged();
+
+    ///
+    /// \brief threadCountChanged - Сигнал передается в qml, когда меняется количество потоков.
+    ///
+    void threadCountChanged();
+
+    ///
+    /// \brief previewSizeChanged - Сигнал передается в qml, когда меняется размер области предпросмотра.
+    ///
+    void previewSizeChanged();
+
+    ///
+    /// \brief historyBudgetChanged - Сигнал передается в qml, когда меняется бюджет памяти истории.
+    ///
+    void historyBudgetChanged();
+
+    ///
+    /// \brief historyCompressionChanged - Сигнал передается в qml, когда включается или выключается сжатие истории.
+    ///
+    void historyCompressionChanged();
+
+    ///
+    /// \brief exportingChanged - Сигнал передается в qml, когда запись файла начинается или заканчивается.
+    ///
+    void exportingChanged();
+
+    ///
+    /// \brief exportProgressChanged - Сигнал передается в qml, когда меняется доля выполненной записи файла.
+    ///
+    void exportProgressChanged();
+
+    ///
+    /// \brief loadProgressChanged - Сигнал передается в qml, когда меняется доля прочитанного файла открываемого изображения.
+    ///
+    void loadProgressChanged();
+
+    ///
+    /// \brief loadPreviewChanged - Сигнал передается в qml, когда готова уменьшенная копия открываемого изображения.
+    /// Экран загрузки остается, пока не придет imageEditChanged.
+    /// \param newImagePath - image:// адрес уменьшенной копии.
+    ///
+    void loadPreviewChanged(const QString& newImagePath);
+
+    ///
+    /// \brief loadFailed - Сигнал передается в qml, когда открываемое изображение не удалось декодировать. Прежнее изображение и история остаются.
+    /// \param filePath - Путь файла.
+    ///
+    void loadFailed(const QString& filePath);
+
+    ///
+    /// \brief exportFinished - Сигнал передается в qml, когда запись файла завершена. После отмены сигнал не передается.
+    /// \param success - Записан ли файл.
+    /// \param filePath - Путь файла.
+    /// \param error - Описание ошибки, если файл не записан.
+    ///
+    void exportFinished(bool success, const QString& filePath, const QString& error);
+
+    ///
+    /// \brief tracingChanged - Сигнал передается в qml, когда замеры включаются или выключаются.
+    ///
+    void tracingChanged();
+
+    ///
+    /// \brief timingsChanged - Сигнал передается в qml, когда появляются фазы новой операции.
+    ///
+    void timingsChanged();
+
+    ///
+    /// \brief histogramChanged - Сигнал передается в qml, когда посчитаны гистограммы нового показанного изображения.
+    ///
+    void histogramChanged();
+
+    ///
+    /// \brief selectionChanged - Сигнал передается в qml, когда меняется или снимается выделение.
+    ///
+    void selectionChanged();
+
+    ///
+    /// \brief selectionFeatherChanged - Сигнал передается в qml, когда меняется ширина мягкого края выделения.
+    ///
+    void selectionFeatherChanged();
+
+    ///
+    /// \brief dirtyRectChanged - Сигнал передается в qml перед каждым новым показанным изображением.
+    ///
+    void dirtyRectChanged();
+
+    ///
+    /// \brief cacheBudgetChanged - Сигнал передается в qml, когда меняется бюджет памяти кэша результатов.
+    ///
+    void cacheBudgetChanged();
+
+    ///
+    /// \brief cacheStatisticsChanged - Сигнал передается в qml после каждой операции, счетчики кэша могли измениться.
+    ///
+    void cacheStatisticsChanged();
+
 private:
     ///
-    /// \brief setUpNewImage - Функция сохранять новое изображение в tmp папке и устанавливает новое изображение в UI.
-    /// \param image - Новое изображение.
-    /// \param imagePath - Путь к новому изображению.
-    /// \param imageEditType - Тип того, как будет обработано изображение в QML.
+    /// \brief materialize - Функция создает ревизию из готового изображения: разбивает его на тайлы, строит пирамиду и изображение для экрана.
+    /// \param image - Изображение в формате, полученном из PointOperations::normalized().
+    /// \param previous - Тайлы предыдущей ревизии, неизмененные тайлы берутся из нее.
+    /// \param targetSize - Размер области на экране.
+    /// \param changed - Прямоугольник, вне которого image совпадает с previous. Пустой прямоугольник - изменилось все изображение.
+    /// \param previousLevels - Пирамида previous. Если changed задан, на уровнях пересчитывается только он.
     ///
-    void setUpNewImage(const QImage& image, const QString& imagePath, const ImageEditType imageEditType);
+    [[nodiscard]] static ImageDocument::Revision materialize(const QImage& image, const TiledImage& previous, const QSize& targetSize,
+        const QRect& changed = QRect(), const QVector<QImage>& previousLevels = {});
 
     ///
-    /// \brief truncate - Функция обрабатывает максимальное значение RGB.
-    /// \param value - Значение RGB.
-    /// \return Если значение превышает максимальное значение одного из цветов, то функция вернет '255', если же значение меньше, то '0'.
+    /// \brief processRegion - Функция считает результат ревизии и применяет к нему операцию внутри маски.
+    /// Если у ревизии нет ленивых операций, тайлы и пирамида пересчитываются только под измененным прямоугольником.
+    /// \param revision - Текущая ревизия.
+    /// \param mask - Выделение в пикселях результата ревизии.
+    /// \param halo - Сколько соседних пикселей читает операция.
+    /// \param operation - Операция, которая не меняет размер изображения.
+    /// \param targetSize - Размер области на экране.
+    /// \param cache - Кэш результатов.
+    /// \param key - Ключ результата в кэше (regionKey()). Пустой ключ - результат не кэшируется.
     ///
-    [[nodiscard]] QRgb truncatePixelValue(const QRgb value)
-    {
-        if (value == 0) {
-            return 0;
-        } else if (value > 255) {
-            return 255;
-        }
+    [[nodiscard]] static ImageDocument::Revision processRegion(const ImageDocument::Revision& revision, const Region::Mask& mask, const int halo,
+        const std::function<QImage(const QImage&)>& operation, const QSize& targetSize, ResultCache& cache, const QByteArray& key);
 
-        return value;
-    }
+    ///
+    /// \brief regionKey - Функция возвращает ключ результата операции над ревизией с учетом выделения.
+    /// \param operation - Имя операции, строковый литерал.
+    /// \param revision - Ревизия.
+    /// \param operations - Стек правок, результат которого используется.
+    /// \param parameters - Параметры операции.
+    /// \return Ключ или пустой ключ, если выделение задано маской произвольной формы и результат не кэшируется.
+    ///
+    [[nodiscard]] QByteArray regionKey(const char* operation, const ImageDocument::Revision& revision, const QVector<EditStack::Operation>& operations,
+        const QVariantList& parameters) const;
+
+    ///
+    /// \brief selectionMask - Функция возвращает выделение в пикселях результата ревизии. Пустая маска - выделено все изображение.
+    /// \param revision - Ревизия.
+    ///
+    [[nodiscard]] Region::Mask selectionMask(const ImageDocument::Revision& revision) const;
+
+    ///
+    /// \brief setDirtyRect - Функция запоминает измененный прямоугольник нового показанного изображения и передает его в qml.
+    /// \param rect - Прямоугольник в пикселях. Пустой прямоугольник - изменилось все изображение.
+    /// \param size - Размер изображения.
+    ///
+    void setDirtyRect(const QRect& rect, const QSize& size);
+
+    ///
+    /// \brief appendOperation - Функция добавляет ревизию с новой ленивой операцией. Полное изображение не считается, только изображение для экрана.
+    /// \param operation - Новая операция.
+    ///
+    void appendOperation(const EditStack::Operation& operation);
+
+    ///
+    /// \brief schedulePreview - Функция запоминает операцию предпросмотра и считает ее поверх текущей ревизии в размере экрана.
+    /// \param operation - Операция предпросмотра.
+    ///
+    void schedulePreview(const EditStack::Operation& operation);
+
+    ///
+    /// \brief appendLevels - Функция добавляет ревизию с уровнями, посчитанными по гистограммам текущей ревизии.
+    /// \param perChannel - 'true' - автоуровни по каждому каналу, 'false' - автоконтраст по яркости.
+    ///
+    void appendLevels(const bool perChannel);
+
+    ///
+    /// \brief statistics - Функция считает гистограммы того, что показывает ревизия.
+    /// Если стек правок только переставляет пиксели, гистограммы считаются по тайлам полного изображения и пересчитываются только для измененных тайлов,
+    /// иначе - по изображению для экрана с уже примененным стеком.
+    /// \param revision - Ревизия или предпросмотр.
+    /// \param cache - Гистограммы тайлов предыдущего расчета.
+    ///
+    [[nodiscard]] static Histogram::Statistics statistics(const ImageDocument::Revision& revision, Histogram::TileCache& cache);
+
+    ///
+    /// \brief levelsStatistics - Функция считает гистограммы результата стека правок в полном размере, по ним выбираются точки автоуровней.
+    /// Уровни применяются к полному изображению, поэтому, как и в пакетном режиме, точки не зависят от размера окна.
+    /// \param revision - Ревизия.
+    /// \param cache - Гистограммы тайлов предыдущего расчета.
+    ///
+    [[nodiscard]] static Histogram::Statistics levelsStatistics(const ImageDocument::Revision& revision, Histogram::TileCache& cache);
+
+    ///
+    /// \brief updateHistogram - Функция в фоне считает гистограммы показанного изображения. Одновременно идет только один расчет.
+    ///
+    void updateHistogram();
+
+    ///
+    /// \brief operationsWithPreview - Функция возвращает стек правок ревизии вместе с несохраненной операцией предпросмотра.
+    /// \param revision - Ревизия.
+    ///
+    [[nodiscard]] QVector<EditStack::Operation> operationsWithPreview(const ImageDocument::Revision& revision) const;
+
+    ///
+    /// \brief cancelJobs - Функция отменяет выполняемую и ожидающую операции и сбрасывает предпросмотр.
+    ///
+    void cancelJobs();
+
+    ///
+    /// \brief addRevision - Функция добавляет ревизию в документ и устанавливает ее в UI. Вызывается в главном потоке.
+    /// \param revision - Новая ревизия.
+    ///
+    void addRevision(const ImageDocument::Revision& revision);
+
+    ///
+    /// \brief compactHistory - Функция укладывает историю в бюджет: в фоне сжимает старые тайлы, вытесняет их на диск, затем удаляет лишние ревизии.
+    ///
+    void compactHistory();
+
+    ///
+    /// \brief restoreLevels - Функция в фоне перестраивает пирамиду текущей ревизии, если она была удалена ради бюджета.
+    ///
+    void restoreLevels();
+
+    ///
+    /// \brief updateTimings - Функция собирает фазы, которые начались после постановки последней операции в очередь.
+    ///
+    void updateTimings();
+
+    ///
+    /// \brief loadProgressReporter - Функция возвращает обработчик доли прочитанного файла для ImageLoader::decode().
+    /// Обработчик вызывается в рабочем потоке и передает в главный поток только изменения на целый процент.
+    /// \param filePath - Путь к изображению. Доля показывается, только если этот файл сейчас открывается.
+    ///
+    [[nodiscard]] std::function<void(qreal)> loadProgressReporter(const QString& filePath);
+
+    ///
+    /// \brief cancelPrefetch - Функция отменяет фоновое декодирование. Отмененное декодирование останавливается на следующем чтении файла.
+    ///
+    void cancelPrefetch();
+
+    ///
+    /// \brief finishLoading - Функция сбрасывает состояние открытия: путь открываемого файла и долю прочитанного.
+    ///
+    void finishLoading();
+
+    ///
+    /// \brief imageUrl - Функция возвращает image:// адрес версии изображения.
+    /// \param version - Версия изображения в документе.
+    ///
+    [[nodiscard]] QString imageUrl(const quint64 version) const;
+
+    QSharedPointer<ImageDocument> document;
+    JobScheduler* scheduler;
+    Exporter* exporter;
+
+    std::optional<EditStack::Operation> previewOperation;
+    QSize displaySize;
+
+    int historyMegabytes = 1024;
+    bool compressHistory = true;
+
+    QFuture<void> compaction;
+    bool compactionRunning = false;
+    bool compactionPending = false;
+
+    QString providerId;
+    QString sourceSuffix;
+
+    QString loadingPath;
+    qreal currentLoadProgress = 0.0;
+    quint64 loadId = 0;
+
+    QSharedPointer<QAtomicInteger<quint64>> prefetchGeneration;
+    QString prefetchPath;
+    QFuture<QImage> prefetch;
+    QVector<QFuture<QImage>> cancelledPrefetches;
+
+    QSharedPointer<Histogram::TileCache> statisticsCache;
+
+    QSharedPointer<ResultCache> resultCache;
+    int cacheMegabytes = 256;
+    QVariantMap currentHistogram;
+    QFuture<void> histogramUpdate;
+    bool histogramRunning = false;
+    bool histogramPending = false;
+
+    QRectF selectionArea;
+    int selectionSoftness = 0;
+    Region::Mask customSelection;
+    QRectF currentDirtyRect = QRectF(0.0, 0.0, 1.0, 1.0);
 
-    QTemporaryDir temporaryDir;
+    QVariantList operationTimings;
+    qint64 operationQueued = -1;
+    qint64 operationHandled = -1;
 };
 
 #endif // PHOTOPROCESSING_H
@@ -0,0 +1,162 @@
+#ifndef POINTOPERATIONS_H
+#define POINTOPERATIONS_H
+
+#include <array>
+
+#include <QImage>
+#include <QVector>
+
+///
+/// Поточечные операции над изображением (серый, сепия, тон, LUT для яркости и контраста).
+/// Все ядра работают построчно по полосам Tiling над 32-битным буфером 0xAARRGGBB (Format_ARGB32 или Format_RGB32).
+///
+namespace PointOperations {
+///
+/// \brief The PixelCondition enum - Условие, при котором пиксель будет обработан.
+///
+enum class PixelCondition {
+    NotTransparent, ///< Альфа канал не равен нулю.
+    AllChannelsNonZero ///< Ни один из каналов (включая альфу) не равен нулю.
+};
+
+///
+/// \brief The Lut struct - Таблица преобразования каналов на 256 значений.
+/// Значения хранятся уже сдвинутыми на позицию канала в QRgb, чтобы пиксель собирался одной операцией OR.
+///
+struct Lut {
+    std::array<QRgb, 256> red;
+    std::array<QRgb, 256> green;
+    std::array<QRgb, 256> blue;
+
+    ///
+    /// \brief set - Функция записывает значение одного входного уровня во все каналы.
+    /// \param index - Входной уровень канала.
+    /// \param value - Новое значение канала.
+    ///
+    inline void set(const int index, const quint8 value)
+    {
+        red[index] = static_cast<QRgb>(value) << 16;
+        green[index] = static_cast<QRgb>(value) << 8;
+        blue[index] = value;
+    }
+};
+
+///
+/// \brief The Levels struct - Черная и белая точки каналов red, green, blue.
+/// Уровни от black до white растягиваются на весь диапазон, уровни за ними обрезаются.
+///
+struct Levels {
+    std::array<quint8, 3> black { { 0, 0, 0 } };
+    std::array<quint8, 3> white { { 255, 255, 255 } };
+};
+
+///
+/// \brief The HueLut struct - Таблица нового тона: цвет результата для каждой пары (насыщенность, значение) в HSV.
+/// Смена тона в QColor::setHsv() сохраняет насыщенность и значение, поэтому цвет результата зависит только от них.
+/// Таблица занимает 256 КБ и копируется без копирования данных.
+///
+struct HueLut {
+    /* RGB без альфы, индекс - saturation * 256 + value */
+    QVector<QRgb> colors;
+};
+
+///
+/// \brief normalized - Функция приводит изображение к 32-битному формату, с которым работают ядра.
+/// \param image - Исходное изображение.
+/// \return Изображение в Format_ARGB32, если у исходного есть альфа канал, иначе в Format_RGB32.
+///
+[[nodiscard]] QImage normalized(const QImage& image);
+
+///
+/// \brief brightnessLut - Функция строит таблицу для изменения яркости.
+/// \param brightness - Параметр яркости. От 0.0 до 2.0.
+///
+[[nodiscard]] Lut brightnessLut(const float brightness);
+
+///
+/// \brief contrastLut - Функция строит таблицу для изменения контраста.
+/// \param contrast - Параметр контрастности. От -127 до 127.
+///
+[[nodiscard]] Lut contrastLut(const qint8 contrast);
+
+///
+/// \brief levelsLut - Функция строит таблицу уровней.
+/// \param levels - Черная и белая точки каналов. Канал, у которого белая точка не выше черной, не меняется.
+///
+[[nodiscard]] Lut levelsLut(const Levels& levels);
+
+///
+/// \brief hueLut - Функция строит таблицу нового тона. Значения берутся из QColor, поэтому результат совпадает с QColor::setHsv().
+/// Последняя построенная таблица запоминается: предпросмотр, применение и сохранение используют один тон.
+/// \param hue - Новый тон.
+///
+[[nodiscard]] HueLut hueLut(const quint8 hue);
+
+///
+/// \brief composeLuts - Функция объединяет две таблицы в одну: результат равен применению first, а затем second.
+/// Объединение корректно, только если условие second не зависит от результата first (например, PixelCondition::NotTransparent).
+/// \param first - Таблица, которая применяется первой.
+/// \param second - Таблица, которая применяется второй.
+///
+[[nodiscard]] Lut composeLuts(const Lut& first, const Lut& second);
+
+///
+/// \brief grayRow - Функция переводит ряд пикселей в grayScale.
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+///
+void grayRow(QRgb* pixels, const int count);
+
+///
+/// \brief sepiaRow - Функция накладывает фильтр сепии на ряд пикселей.
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+///
+void sepiaRow(QRgb* pixels, const int count);
+
+///
+/// \brief hueRow - Функция устанавливает новый тон ряду пикселей так же, как QColor::setHsv().
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+/// \param lut - Таблица нового тона (hueLut()).
+///
+void hueRow(QRgb* pixels, const int count, const HueLut& lut);
+
+///
+/// \brief lutRow - Функция применяет таблицу преобразования к ряду пикселей.
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+/// \param lut - Таблица преобразования.
+/// \param condition - Условие, при котором пиксель будет обработан.
+///
+void lutRow(QRgb* pixels, const int count, const Lut& lut, const PixelCondition condition);
+
+///
+/// \brief toGray - Функция переводит изображение в grayScale.
+/// \param image - Изображение в формате, полученном из normalized().
+///
+void toGray(QImage& image);
+
+///
+/// \brief toSepia - Функция накладывает фильтр сепии.
+/// \param image - Изображение в формате, полученном из normalized().
+///
+void toSepia(QImage& image);
+
+///
+/// \brief setHue - Функция устанавливает новый тон изображению.
+/// \param image - Изображение в формате, полученном из normalized().
+/// \param hue - Новый тон.
+///
+void setHue(QImage& image, const quint8 hue);
+
+///
+/// \brief applyLut - Функция применяет таблицу преобразования ко всему изображению.
+/// \param image - Изображение в формате, полученном из normalized().
+/// \param lut - Таблица преобразования.
+/// \param condition - Условие, при котором пиксель будет обработан.
+///
+void applyLut(QImage& image, const Lut& lut, const PixelCondition condition);
+}
+
+#endif // POINTOPERATIONS_H
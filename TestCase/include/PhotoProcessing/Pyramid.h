@@ -0,0 +1,39 @@
+#ifndef PYRAMID_H
+#define PYRAMID_H
+
+#include <QImage>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+///
+/// Пирамида уменьшенных копий изображения для интерактивного предпросмотра.
+/// Каждый уровень в 2 раза меньше предыдущего, пиксель уровня - среднее четырех пикселей предыдущего с учетом альфы.
+///
+namespace Pyramid {
+///
+/// \brief build - Функция строит уменьшенные копии изображения.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \return Уровни в 2, 4, 8... раз меньше исходного. Сам исходный уровень в список не входит.
+///
+[[nodiscard]] QVector<QImage> build(const QImage& image);
+
+///
+/// \brief update - Функция обновляет уменьшенные копии после изменения прямоугольника изображения.
+/// На каждом уровне пересчитывается только прямоугольник под измененными пикселями, остальное копируется из levels.
+/// \param image - Новое изображение в формате, полученном из PointOperations::normalized().
+/// \param levels - Уровни предыдущего изображения того же размера и формата, полученные из build().
+/// \param changed - Прямоугольник, вне которого image совпадает с предыдущим изображением. Если он пустой, уровни строятся заново.
+///
+[[nodiscard]] QVector<QImage> update(const QImage& image, const QVector<QImage>& levels, const QRect& changed);
+
+///
+/// \brief level - Функция выбирает наименьший уровень, который при вписывании в target не будет растягиваться.
+/// \param image - Исходное изображение.
+/// \param levels - Уровни, полученные из build().
+/// \param target - Размер области, в которую вписывается изображение на экране. Если размер пустой, возвращается исходное изображение.
+///
+[[nodiscard]] QImage level(const QImage& image, const QVector<QImage>& levels, const QSize& target);
+}
+
+#endif // PYRAMID_H
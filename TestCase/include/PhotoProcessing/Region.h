@@ -0,0 +1,81 @@
+#ifndef REGION_H
+#define REGION_H
+
+#include <functional>
+
+#include <QImage>
+#include <QRect>
+#include <QRegion>
+#include <QSize>
+
+///
+/// Обработка части изображения: операция считается только внутри прямоугольника выделения с ореолом для соседних пикселей,
+/// а результат смешивается с исходным изображением по маске. Мягкий край маски (feather) плавно переходит от результата к исходным пикселям.
+/// Измененная область (dirty) передается дальше: тайлы истории и уровни пирамиды вне нее берутся из предыдущей ревизии без пересчета.
+///
+namespace Region {
+///
+/// \brief The Mask class - Выделение: область (QRegion) с мягким краем или 8-битная маска. Пустая маска выделяет все изображение.
+///
+class Mask {
+public:
+    Mask() = default;
+
+    ///
+    /// \brief fromRegion - Функция создает маску из области.
+    /// \param region - Область в пикселях изображения.
+    /// \param feather - Ширина мягкого края в пикселях, 0 - жесткий край.
+    ///
+    [[nodiscard]] static Mask fromRegion(const QRegion& region, const int feather = 0);
+
+    ///
+    /// \brief fromAlpha - Функция создает маску из 8-битного изображения: 0 - пиксель не меняется, 255 - заменяется результатом.
+    /// \param alpha - Маска в пикселях изображения. Цветное изображение переводится в оттенки серого.
+    ///
+    [[nodiscard]] static Mask fromAlpha(const QImage& alpha);
+
+    ///
+    /// \brief isNull - Функция проверяет, что маска выделяет все изображение.
+    ///
+    [[nodiscard]] bool isNull() const;
+
+    ///
+    /// \brief bounds - Функция возвращает прямоугольник пикселей, которые меняет маска, вместе с мягким краем.
+    /// \param size - Размер изображения.
+    ///
+    [[nodiscard]] QRect bounds(const QSize& size) const;
+
+    ///
+    /// \brief scaled - Функция возвращает маску для изображения, уменьшенного или увеличенного в sx и sy раз (изображение для экрана).
+    ///
+    [[nodiscard]] Mask scaled(const qreal sx, const qreal sy) const;
+
+    ///
+    /// \brief coverage - Функция возвращает доли результата для прямоугольника изображения.
+    /// \param rect - Прямоугольник в пикселях изображения.
+    /// \return Изображение QImage::Format_Alpha8 размера rect или пустое изображение при отмене.
+    ///
+    [[nodiscard]] QImage coverage(const QRect& rect) const;
+
+private:
+    QRegion area;
+    int featherWidth = 0;
+
+    QImage alpha;
+    QRect alphaBounds;
+};
+
+///
+/// \brief apply - Функция применяет операцию внутри маски и смешивает результат с исходным изображением.
+/// Операция получает только прямоугольник маски с ореолом: время зависит от размера выделения, а не изображения.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param mask - Маска в пикселях image.
+/// \param halo - Сколько соседних пикселей читает операция вокруг каждого пикселя (радиус размытия, половина ядра).
+/// \param operation - Операция, которая не меняет размер изображения.
+/// \param dirty - Прямоугольник измененных пикселей.
+/// \return Новое изображение или пустое изображение при отмене.
+///
+[[nodiscard]] QImage apply(const QImage& image, const Mask& mask, const int halo, const std::function<QImage(const QImage&)>& operation, QRect& dirty);
+}
+
+#endif // REGION_H
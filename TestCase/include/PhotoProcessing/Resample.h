@@ -0,0 +1,35 @@
+#ifndef RESAMPLE_H
+#define RESAMPLE_H
+
+#include <QImage>
+#include <QSize>
+
+///
+/// Изменение размера изображения в произвольное количество раз разделимыми фильтрами.
+/// Веса фильтра считаются один раз для каждой оси и хранятся в фиксированной точке, затем делаются горизонтальный и вертикальный проходы
+/// целочисленными ядрами SSE2 по полосам Tiling. При уменьшении носитель фильтра растягивается, поэтому уменьшение сглажено.
+/// Изображения с альфа каналом фильтруются с премультипликацией, чтобы цвет прозрачных пикселей не проступал на краях.
+/// Если операция текущего потока отменена через Tiling::CancellationScope, возвращается пустое изображение.
+///
+namespace Resample {
+///
+/// \brief The Filter enum - Фильтр изменения размера.
+///
+enum class Filter {
+    Area, ///< Среднее по площади пикселя: быстрое уменьшение для миниатюр и предпросмотра, при увеличении - повтор пикселей.
+    Bilinear, ///< Билинейный фильтр.
+    Bicubic, ///< Бикубический фильтр (a = -0.5).
+    Lanczos ///< Фильтр Ланцоша с тремя лепестками.
+};
+
+///
+/// \brief resize - Функция изменяет размер изображения.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param size - Новый размер. Пропорции не сохраняются.
+/// \param filter - Фильтр.
+/// \return Новое изображение в том же формате. Если размер не меняется, возвращается исходное изображение без копирования.
+///
+[[nodiscard]] QImage resize(const QImage& image, const QSize& size, const Filter filter);
+}
+
+#endif // RESAMPLE_H
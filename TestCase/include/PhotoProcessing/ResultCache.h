@@ -0,0 +1,73 @@
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+
+///
+/// \brief The ResultCache class - Кэш посчитанных изображений с вытеснением давно не использованных (LRU) в пределах бюджета памяти.
+/// Ключ описывает содержимое результата: исходное изображение (TiledImage::id()), стек правок, операцию и ее параметры,
+/// поэтому повторный запрос того же результата (ползунок вернулся назад, правка повторена после undo) не пересчитывается.
+/// Попадания и промахи считаются, чтобы подбирать бюджет. Методы вызываются из любого потока.
+///
+class ResultCache {
+public:
+    ///
+    /// \brief The Statistics struct - Счетчики кэша.
+    ///
+    struct Statistics {
+        qint64 hits = 0;
+        qint64 misses = 0;
+        qsizetype bytes = 0;
+        int entries = 0;
+    };
+
+    ///
+    /// \brief ResultCache - Конструктор создает пустой кэш.
+    /// \param budget - Бюджет памяти в байтах.
+    ///
+    explicit ResultCache(const qsizetype budget);
+
+    ///
+    /// \brief find - Функция ищет результат и делает его последним использованным.
+    /// \param key - Ключ результата. Пустой ключ ничего не находит и не считается промахом.
+    /// \return Найденное изображение или пустое изображение при промахе.
+    ///
+    [[nodiscard]] QImage find(const QByteArray& key);
+
+    ///
+    /// \brief insert - Функция добавляет результат, вытесняя давно не использованные. Результат больше бюджета не добавляется.
+    /// \param key - Ключ результата. С пустым ключом результат не добавляется.
+    /// \param image - Результат.
+    ///
+    void insert(const QByteArray& key, const QImage& image);
+
+    ///
+    /// \brief setBudget - Функция задает бюджет памяти, лишние результаты вытесняются сразу.
+    /// \param budget - Бюджет в байтах.
+    ///
+    void setBudget(const qsizetype budget);
+
+    ///
+    /// \brief clear - Функция удаляет все результаты. Счетчики попаданий и промахов сохраняются.
+    ///
+    void clear();
+
+    ///
+    /// \brief statistics - Функция возвращает счетчики кэша.
+    ///
+    [[nodiscard]] Statistics statistics() const;
+
+private:
+    mutable QMutex mutex;
+
+    /* Стоимость записи - размер изображения в килобайтах, чтобы бюджет больше 2 ГБ помещался в int */
+    QCache<QByteArray, QImage> images;
+
+    qint64 hits = 0;
+    qint64 misses = 0;
+};
+
+#endif // RESULTCACHE_H
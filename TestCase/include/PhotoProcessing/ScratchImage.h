@@ -0,0 +1,33 @@
+#ifndef SCRATCHIMAGE_H
+#define SCRATCHIMAGE_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+///
+/// Рабочий формат для вытеснения изображений на диск: небольшой заголовок и несжатые ряды в том формате, в котором изображение хранится в памяти.
+/// Файл отображается в память (QFile::map), а изображение оборачивает отображенные ряды без копирования и без декодирования,
+/// поэтому чтение стоит столько же, сколько чтение страниц из кэша ОС. Файл удаляется, когда удаляется последняя копия изображения.
+///
+namespace ScratchImage {
+///
+/// \brief write - Функция записывает изображение в рабочий файл и возвращает изображение, которое читает ряды прямо из файла.
+/// \param image - 32-битное изображение.
+/// \param filePath - Путь рабочего файла.
+/// \return Изображение только для чтения поверх отображенного файла или пустое изображение при ошибке.
+///
+[[nodiscard]] QImage write(const QImage& image, const QString& filePath);
+
+///
+/// \brief create - Функция создает рабочий файл под изображение и возвращает изображение, которое пишет ряды прямо в файл.
+/// Так собирается результат, который больше оперативной памяти: записанные страницы ОС может в любой момент сбросить на диск.
+/// \param size - Размер изображения.
+/// \param format - 32-битный формат.
+/// \param filePath - Путь рабочего файла.
+/// \return Изображение поверх отображенного файла или пустое изображение при ошибке. Ряды заполнены нулями.
+///
+[[nodiscard]] QImage create(const QSize& size, const QImage::Format format, const QString& filePath);
+}
+
+#endif // SCRATCHIMAGE_H
@@ -0,0 +1,62 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+///
+/// Общие макросы для SIMD ядер.
+/// PHOTOPROCESSING_SSE2 - SSE2 доступен на этапе компиляции (на x86-64 всегда).
+/// PHOTOPROCESSING_AVX2 - AVX2 ядра можно собрать, но вызывать их можно только после проверки Simd::hasAvx2().
+///
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PHOTOPROCESSING_SSE2
+#include <emmintrin.h>
+
+#if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#define PHOTOPROCESSING_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define PHOTOPROCESSING_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PHOTOPROCESSING_TARGET_AVX2
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Simd {
+///
+/// \brief hasAvx2 - Функция проверяет, поддерживает ли процессор и ОС набор инструкций AVX2.
+/// \return Возвращает 'true', если AVX2 ядра можно вызывать.
+///
+inline bool hasAvx2()
+{
+#if !defined(PHOTOPROCESSING_AVX2)
+    return false;
+#elif defined(__GNUC__) || defined(__clang__)
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    static const bool supported = []() {
+        int info[4] = {};
+
+        __cpuid(info, 1);
+
+        /* OSXSAVE и AVX, иначе ОС не сохраняет ymm регистры */
+        if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+
+        return (info[1] & (1 << 5)) != 0;
+    }();
+
+    return supported;
+#endif
+}
+}
+
+#endif // SIMD_H
@@ -0,0 +1,186 @@
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSet>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+///
+/// \brief The TiledImage class - Неизменяемая копия 32-битного изображения, разбитая на тайлы с общим владением.
+/// Тайлы, которые не изменились относительно предыдущей ревизии, хранятся один раз и разделяются между ревизиями.
+/// Тайлы можно сжать на месте или вытеснить в рабочий файл (ScratchImage): все ревизии, которые на них ссылаются, получают экономию сразу.
+/// Копирование объекта не копирует пиксели.
+///
+class TiledImage {
+public:
+    /* Сторона тайла в пикселях */
+    static constexpr int tileSize = 256;
+
+    TiledImage() = default;
+
+    ///
+    /// \brief fromImage - Функция разбивает изображение на тайлы. Тайлы, совпадающие с тайлами previous, берутся из previous.
+    /// \param image - Изображение в формате, полученном из PointOperations::normalized().
+    /// \param previous - Предыдущая ревизия. Сравниваются только несжатые тайлы того же размера.
+    /// \param changed - Прямоугольник, вне которого image совпадает с previous. Тайлы вне него берутся из previous без чтения.
+    /// Пустой прямоугольник - измененная область неизвестна.
+    ///
+    [[nodiscard]] static TiledImage fromImage(const QImage& image, const TiledImage& previous, const QRect& changed = QRect());
+
+    ///
+    /// \brief isNull - Функция проверяет, что в объекте нет изображения.
+    ///
+    [[nodiscard]] bool isNull() const;
+
+    ///
+    /// \brief id - Функция возвращает номер копии изображения, уникальный на время работы программы. У пустого объекта 0.
+    /// Копии объекта, в том числе в разных ревизиях, имеют один номер, поэтому по нему можно искать посчитанные из изображения результаты.
+    ///
+    [[nodiscard]] quint64 id() const;
+
+    ///
+    /// \brief isSharedWith - Функция проверяет, что оба объекта - одна и та же копия изображения.
+    ///
+    [[nodiscard]] bool isSharedWith(const TiledImage& other) const;
+
+    ///
+    /// \brief tileCount - Функция возвращает количество тайлов.
+    ///
+    [[nodiscard]] int tileCount() const;
+
+    ///
+    /// \brief tileRect - Функция возвращает прямоугольник тайла в пикселях.
+    /// \param index - Номер тайла.
+    ///
+    [[nodiscard]] QRect tileRect(const int index) const;
+
+    ///
+    /// \brief isTileSharedWith - Функция проверяет, что тайл index один и тот же в обоих изображениях, то есть не изменился между ревизиями.
+    /// \param index - Номер тайла.
+    /// \param other - Другая ревизия.
+    ///
+    [[nodiscard]] bool isTileSharedWith(const int index, const TiledImage& other) const;
+
+    ///
+    /// \brief changedRect - Функция возвращает прямоугольник тайлов, которые отличаются от тайлов other.
+    /// Если размеры не совпадают, возвращается все изображение.
+    /// \param other - Другая ревизия.
+    ///
+    [[nodiscard]] QRect changedRect(const TiledImage& other) const;
+
+    ///
+    /// \brief size - Функция возвращает размер изображения.
+    ///
+    [[nodiscard]] QSize size() const;
+
+    ///
+    /// \brief toImage - Функция собирает изображение из всех тайлов.
+    ///
+    [[nodiscard]] QImage toImage() const;
+
+    ///
+    /// \brief patch - Функция превращает image, собранное из from, в это изображение, записывая только отличающиеся тайлы.
+    /// Если размеры не совпадают, изображение собирается заново.
+    /// \param image - Изображение, которое было собрано из from. Изменяется на месте.
+    /// \param from - Копия, из которой было собрано image.
+    ///
+    void patch(QImage& image, const TiledImage& from) const;
+
+    ///
+    /// \brief compress - Функция сжимает тайлы, которых нет в except. Вызывается из любого потока.
+    /// \param except - Копия, тайлы которой должны остаться несжатыми.
+    /// \return Сколько байт освобождено.
+    ///
+    qsizetype compress(const TiledImage& except) const;
+
+    ///
+    /// \brief spill - Функция вытесняет тайлы, которых нет в except, в рабочий файл. Тайлы читаются из отображенного файла без декодирования.
+    /// Вызывается из любого потока.
+    /// \param filePath - Путь рабочего файла.
+    /// \param except - Копия, тайлы которой должны остаться в памяти.
+    /// \return Сколько байт освобождено.
+    ///
+    qsizetype spill(const QString& filePath, const TiledImage& except) const;
+
+    ///
+    /// \brief byteCount - Функция возвращает размер тайлов, которые еще не посчитаны в counted.
+    /// \param counted - Уже посчитанные тайлы. Дополняется тайлами этого изображения.
+    ///
+    [[nodiscard]] qsizetype byteCount(QSet<const void*>& counted) const;
+
+private:
+    ///
+    /// \brief The Tile class - Пиксели тайла: несжатые, сжатые qCompress или прямоугольник изображения в рабочем файле.
+    ///
+    class Tile {
+    public:
+        explicit Tile(const QByteArray& pixels);
+
+        [[nodiscard]] QByteArray pixels() const;
+        [[nodiscard]] bool isRaw() const;
+
+        ///
+        /// \brief byteCount - Функция возвращает, сколько байт тайл занимает в памяти. Вытесненный тайл памяти не занимает.
+        ///
+        [[nodiscard]] qsizetype byteCount() const;
+
+        ///
+        /// \brief compress - Функция сжимает тайл, если он несжатый.
+        /// \return Сколько байт освобождено.
+        ///
+        qsizetype compress();
+
+        ///
+        /// \brief spill - Функция заменяет пиксели тайла прямоугольником изображения из рабочего файла.
+        /// \param scratchImage - Изображение поверх отображенного рабочего файла (ScratchImage::write()).
+        /// \param rect - Прямоугольник тайла.
+        /// \return Сколько байт освобождено.
+        ///
+        qsizetype spill(const QImage& scratchImage, const QRect& rect);
+
+    private:
+        ///
+        /// \brief The Storage enum - Где хранятся пиксели тайла.
+        ///
+        enum class Storage {
+            Raw,
+            Compressed,
+            Spilled
+        };
+
+        mutable QMutex mutex;
+
+        QByteArray data;
+        Storage storage = Storage::Raw;
+
+        QImage scratch;
+        QRect scratchRect;
+    };
+
+    ///
+    /// \brief The Data struct - Общие данные всех копий одного изображения.
+    ///
+    struct Data {
+        quint64 id = 0;
+        QSize size;
+        QImage::Format format = QImage::Format_Invalid;
+        int columns = 0;
+        int rows = 0;
+
+        QVector<QSharedPointer<Tile>> tiles;
+    };
+
+    ///
+    /// \brief writeTile - Функция копирует пиксели тайла в изображение.
+    ///
+    void writeTile(const int index, uchar* bits, const qsizetype bytesPerLine) const;
+
+    QSharedPointer<const Data> d;
+};
+
+#endif // TILEDIMAGE_H
@@ -0,0 +1,247 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include <QAtomicInteger>
+#include <QImage>
+#include <QPair>
+#include <QSharedPointer>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent>
+
+///
+/// Общий слой параллельного выполнения: изображение делится на полосы рядов размером с кэш,
+/// полосы выполняются через QtConcurrent::blockingMap в пуле с настраиваемым количеством потоков.
+///
+namespace Tiling {
+///
+/// \brief The Stripe struct - Полоса рядов [firstRow, lastRow) и ряды [haloFirstRow, haloLastRow), которые нужно прочитать для ее расчета.
+///
+struct Stripe {
+    int firstRow = 0;
+    int lastRow = 0;
+    int haloFirstRow = 0;
+    int haloLastRow = 0;
+};
+
+///
+/// \brief The ImageRows class - Доступ к рядам 32-битного изображения из рабочих потоков.
+/// scanLine() делает detach() и меняет счетчик изображения, поэтому указатель на данные берется один раз в вызывающем потоке.
+///
+class ImageRows {
+public:
+    ///
+    /// \brief ImageRows - Конструктор для изображения, в которое будут писать рабочие потоки.
+    ///
+    explicit ImageRows(QImage& image)
+        : bits { image.bits() }
+        , bytesPerLine { image.bytesPerLine() }
+        , imageWidth { image.width() }
+        , imageHeight { image.height() }
+    {
+        Q_ASSERT(image.depth() == 32);
+    }
+
+    ///
+    /// \brief ImageRows - Конструктор для изображения, которое рабочие потоки только читают.
+    ///
+    explicit ImageRows(const QImage& image)
+        : bits { const_cast<uchar*>(image.constBits()) }
+        , bytesPerLine { image.bytesPerLine() }
+        , imageWidth { image.width() }
+        , imageHeight { image.height() }
+    {
+        Q_ASSERT(image.depth() == 32);
+    }
+
+    [[nodiscard]] inline QRgb* row(const int y) const
+    {
+        return reinterpret_cast<QRgb*>(bits + y * bytesPerLine);
+    }
+
+    [[nodiscard]] inline const QRgb* constRow(const int y) const
+    {
+        return reinterpret_cast<const QRgb*>(bits + y * bytesPerLine);
+    }
+
+    [[nodiscard]] inline int width() const
+    {
+        return imageWidth;
+    }
+
+    [[nodiscard]] inline int height() const
+    {
+        return imageHeight;
+    }
+
+private:
+    uchar* bits;
+    qsizetype bytesPerLine;
+
+    int imageWidth;
+    int imageHeight;
+};
+
+///
+/// \brief The CancellationToken class - Признак отмены операции. Операция отменена, когда общее поколение ушло вперед от ожидаемого.
+/// Пустой токен никогда не отменяется.
+///
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    CancellationToken(const QSharedPointer<QAtomicInteger<quint64>>& generation, const quint64 expectedGeneration)
+        : generation { generation }
+        , expectedGeneration { expectedGeneration }
+    {
+    }
+
+    [[nodiscard]] inline bool isCancelled() const
+    {
+        return !generation.isNull() && generation->loadAcquire() != expectedGeneration;
+    }
+
+private:
+    QSharedPointer<QAtomicInteger<quint64>> generation;
+    quint64 expectedGeneration = 0;
+};
+
+///
+/// \brief The CancellationScope class - Устанавливает токен отмены для операций, запущенных из текущего потока, на время жизни объекта.
+/// Полосы и диапазоны проверяют токен перед запуском и пропускаются, если операция уже отменена.
+///
+class CancellationScope {
+public:
+    explicit CancellationScope(const CancellationToken& token);
+    ~CancellationScope();
+
+    Q_DISABLE_COPY(CancellationScope)
+
+private:
+    const CancellationToken* previousToken;
+};
+
+///
+/// \brief currentCancellation - Функция возвращает токен отмены текущего потока.
+///
+[[nodiscard]] CancellationToken currentCancellation();
+
+///
+/// \brief isCancelled - Функция проверяет, отменена ли операция текущего потока.
+///
+[[nodiscard]] bool isCancelled();
+
+///
+/// \brief threadCount - Функция возвращает количество потоков, на которые делится одна операция.
+///
+[[nodiscard]] int threadCount();
+
+///
+/// \brief setThreadCount - Функция задает количество потоков. Значение меньше 1 возвращает QThread::idealThreadCount().
+/// \param count - Количество потоков.
+///
+void setThreadCount(const int count);
+
+///
+/// \brief threadPool - Функция возвращает пул, в котором выполняются полосы.
+/// В Qt 5 blockingMap не принимает пул, поэтому используется глобальный.
+///
+[[nodiscard]] QThreadPool* threadPool();
+
+///
+/// \brief stripeHeight - Функция подбирает высоту полосы: полоса помещается в кэш, и полос хватает на все потоки.
+/// \param height - Высота изображения.
+/// \param bytesPerLine - Размер одного ряда в байтах.
+///
+[[nodiscard]] int stripeHeight(const int height, const qsizetype bytesPerLine);
+
+///
+/// \brief stripes - Функция делит ряды изображения на полосы.
+/// \param height - Высота изображения.
+/// \param rowsPerStripe - Высота одной полосы.
+/// \param halo - Количество дополнительных рядов сверху и снизу, которые нужны фильтру для расчета полосы.
+///
+[[nodiscard]] QVector<Stripe> stripes(const int height, const int rowsPerStripe, const int halo = 0);
+
+///
+/// \brief blockingMap - Функция выполняет function для каждого элемента sequence в пуле threadPool() и ждет завершения.
+///
+template <typename Sequence, typename Function>
+void blockingMap(Sequence& sequence, Function function)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    QtConcurrent::blockingMap(threadPool(), sequence, function);
+#else
+    QtConcurrent::blockingMap(sequence, function);
+#endif
+}
+
+///
+/// \brief forEachStripe - Функция выполняет function(const Stripe&) для каждой полосы параллельно.
+/// Если операция текущего потока отменена, оставшиеся полосы пропускаются.
+/// \param height - Высота изображения.
+/// \param rowsPerStripe - Высота одной полосы.
+/// \param halo - Количество дополнительных рядов для соседних пикселей.
+///
+template <typename Function>
+void forEachStripe(const int height, const int rowsPerStripe, const int halo, Function function)
+{
+    QVector<Stripe> imageStripes = stripes(height, rowsPerStripe, halo);
+
+    /* Токен берется в вызывающем потоке, рабочие потоки пула его не наследуют */
+    const CancellationToken token = currentCancellation();
+
+    blockingMap(imageStripes, [&function, &token](const Stripe& stripe) {
+        if (!token.isCancelled()) {
+            function(stripe);
+        }
+    });
+}
+
+///
+/// \brief forEachStripe - Функция выполняет function(const Stripe&) для полос изображения с высотой по умолчанию.
+///
+template <typename Function>
+void forEachStripe(const QImage& image, Function function)
+{
+    forEachStripe(image.height(), stripeHeight(image.height(), image.bytesPerLine()), 0, function);
+}
+
+///
+/// \brief forEachRange - Функция делит [0, count) на порции по step и выполняет function(first, last) параллельно.
+///
+template <typename Function>
+void forEachRange(const int count, const int step, Function function)
+{
+    QVector<QPair<int, int>> ranges;
+
+    for (int first = 0; first < count; first += step) {
+        ranges.append({ first, qMin(first + step, count) });
+    }
+
+    const CancellationToken token = currentCancellation();
+
+    blockingMap(ranges, [&function, &token](const QPair<int, int>& range) {
+        if (!token.isCancelled()) {
+            function(range.first, range.second);
+        }
+    });
+}
+
+///
+/// \brief forEachRow - Функция выполняет function(QRgb* row, int width) для каждого ряда 32-битного изображения параллельно.
+///
+template <typename Function>
+void forEachRow(QImage& image, Function function)
+{
+    const ImageRows rows(image);
+
+    forEachStripe(image, [&](const Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            function(rows.row(y), rows.width());
+        }
+    });
+}
+}
+
+#endif // TILING_H
@@ -0,0 +1,90 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QVector>
+
+///
+/// Замеры фаз операций: декодирование, расчет, ожидание в очереди, передача в qml, кодирование.
+/// Фаза - интервал с именем, категорией, временем начала и потоком. Фазы хранятся в кольцевом буфере последних событий
+/// и записываются в формате Chrome trace event (chrome://tracing, Perfetto).
+/// Пока замеры выключены, Scope только читает атомарный флаг и ничего не записывает.
+///
+namespace Trace {
+///
+/// \brief The Event struct - Завершенная фаза.
+///
+struct Event {
+    const char* name = ""; ///< Имя фазы, строковый литерал.
+    const char* category = ""; ///< Категория фазы, строковый литерал.
+    qint64 start = 0; ///< Начало в микросекундах от первого замера.
+    qint64 duration = 0; ///< Длительность в микросекундах.
+    int thread = 0; ///< Номер потока, 1 - поток, который первым включил замеры.
+};
+
+///
+/// \brief The Scope class - Замеряет фазу от создания до удаления объекта.
+///
+class Scope {
+public:
+    ///
+    /// \brief Scope - Начинает фазу, если замеры включены.
+    /// \param name - Имя фазы, строковый литерал.
+    /// \param category - Категория фазы, строковый литерал.
+    ///
+    Scope(const char* name, const char* category);
+    ~Scope();
+
+    Q_DISABLE_COPY(Scope)
+
+private:
+    const char* name;
+    const char* category;
+    qint64 start;
+};
+
+///
+/// \brief isEnabled - Функция проверяет, включены ли замеры.
+///
+[[nodiscard]] bool isEnabled();
+
+///
+/// \brief setEnabled - Функция включает или выключает замеры. Записанные события сохраняются.
+/// \param enabled - Включены ли замеры.
+///
+void setEnabled(const bool enabled);
+
+///
+/// \brief now - Функция возвращает время в микросекундах от первого замера.
+///
+[[nodiscard]] qint64 now();
+
+///
+/// \brief record - Функция записывает фазу текущего потока, если замеры включены.
+/// \param name - Имя фазы, строковый литерал.
+/// \param category - Категория фазы, строковый литерал.
+/// \param start - Начало, полученное из now().
+/// \param end - Конец, полученный из now().
+///
+void record(const char* name, const char* category, const qint64 start, const qint64 end);
+
+///
+/// \brief events - Функция возвращает записанные фазы, которые начались не раньше since, в порядке записи.
+/// \param since - Время из now().
+///
+[[nodiscard]] QVector<Event> events(const qint64 since = 0);
+
+///
+/// \brief clear - Функция удаляет записанные фазы.
+///
+void clear();
+
+///
+/// \brief writeChromeTrace - Функция записывает фазы в JSON файл формата Chrome trace event.
+/// \param filePath - Путь файла.
+/// \return Пустая строка при успехе, иначе описание ошибки.
+///
+[[nodiscard]] QString writeChromeTrace(const QString& filePath);
+}
+
+#endif // TRACE_H
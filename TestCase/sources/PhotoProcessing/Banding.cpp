@@ -0,0 +1,293 @@
+#include "include/PhotoProcessing/Banding.h"
+#include "include/PhotoProcessing/Blur.h"
+#include "include/PhotoProcessing/Convolution.h"
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/ScratchImage.h"
+#include "include/PhotoProcessing/Trace.h"
+
+#include <cstring>
+#include <functional>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QRect>
+
+namespace {
+/* Одновременно живут декодированная полоса, ее 32-битная копия и два буфера шагов (стек правок, размытие) */
+constexpr int bandCopies = 4;
+
+///
+/// \brief The Placement struct - Положение полосы с ореолом (band) и без него (core) в изображении после уже выполненных шагов.
+///
+struct Placement {
+    QSize size;
+    QRect band;
+    QRect core;
+};
+
+///
+/// \brief flipHorizontal - Функция отражает прямоугольник слева направо внутри изображения ширины width.
+///
+QRect flipHorizontal(const QRect& rect, const int width)
+{
+    return QRect(width - rect.x() - rect.width(), rect.y(), rect.width(), rect.height());
+}
+
+///
+/// \brief flipVertical - Функция отражает прямоугольник сверху вниз внутри изображения высоты height.
+///
+QRect flipVertical(const QRect& rect, const int height)
+{
+    return QRect(rect.x(), height - rect.y() - rect.height(), rect.width(), rect.height());
+}
+
+///
+/// \brief rotateClockwise - Функция поворачивает прямоугольник по часовой стрелке: пиксель (x, y) переходит в (h - 1 - y, x).
+///
+QRect rotateClockwise(const QRect& rect, const QSize& size)
+{
+    return QRect(size.height() - rect.y() - rect.height(), rect.x(), rect.height(), rect.width());
+}
+
+///
+/// \brief rotateCounterClockwise - Функция поворачивает прямоугольник против часовой стрелки: пиксель (x, y) переходит в (y, w - 1 - x).
+///
+QRect rotateCounterClockwise(const QRect& rect, const QSize& size)
+{
+    return QRect(rect.y(), size.width() - rect.x() - rect.width(), rect.height(), rect.width());
+}
+
+///
+/// \brief place - Функция переносит положение полосы через шаги. Поточечные операции и размытие положение не меняют.
+///
+Placement place(Placement placement, const QVector<Batch::Step>& steps)
+{
+    using Type = EditStack::Operation::Type;
+
+    for (const Batch::Step& step : steps) {
+        if (step.type != Batch::Step::Type::Operation) {
+            continue;
+        }
+
+        const QSize size = placement.size;
+
+        switch (step.operation.type) {
+        case Type::FlipHorizontal:
+            placement.band = flipHorizontal(placement.band, size.width());
+            placement.core = flipHorizontal(placement.core, size.width());
+            break;
+        case Type::FlipVertical:
+            placement.band = flipVertical(placement.band, size.height());
+            placement.core = flipVertical(placement.core, size.height());
+            break;
+        case Type::Rotate180:
+            placement.band = flipVertical(flipHorizontal(placement.band, size.width()), size.height());
+            placement.core = flipVertical(flipHorizontal(placement.core, size.width()), size.height());
+            break;
+        case Type::RotateClockwise:
+            placement.band = rotateClockwise(placement.band, size);
+            placement.core = rotateClockwise(placement.core, size);
+            placement.size = size.transposed();
+            break;
+        case Type::Rotate:
+            placement.band = rotateCounterClockwise(placement.band, size);
+            placement.core = rotateCounterClockwise(placement.core, size);
+            placement.size = size.transposed();
+            break;
+        default:
+            break;
+        }
+    }
+
+    return placement;
+}
+
+///
+/// \brief scratchPath - Функция возвращает путь рабочего файла рядом с результатом.
+/// Временный каталог часто лежит в tmpfs, то есть в той же оперативной памяти, поэтому он не используется.
+///
+QString scratchPath(const QString& outputPath, const QString& suffix)
+{
+    const QFileInfo info(outputPath);
+
+    return info.absoluteDir().filePath(QStringLiteral(".%1.%2.scratch").arg(info.fileName(), suffix));
+}
+
+///
+/// \brief copyRows - Функция копирует прямоугольник source в destination по позиции target.
+///
+void copyRows(const QImage& source, const QRect& rect, QImage& destination, const QPoint& target)
+{
+    const qsizetype bytes = rect.width() * static_cast<qsizetype>(sizeof(QRgb));
+
+    for (int y = 0; y < rect.height(); ++y) {
+        const QRgb* from = reinterpret_cast<const QRgb*>(source.constScanLine(rect.y() + y)) + rect.x();
+        QRgb* to = reinterpret_cast<QRgb*>(destination.scanLine(target.y() + y)) + target.x();
+
+        std::memcpy(to, from, bytes);
+    }
+}
+}
+
+///
+/// \brief Banding::unsupportedStep - Функция проверяет, что все шаги можно выполнить по полосам.
+/// \param steps - Шаги обработки.
+/// \return Пустая строка или описание шага, которому нужно все изображение.
+///
+QString Banding::unsupportedStep(const QVector<Batch::Step>& steps)
+{
+    for (const Batch::Step& step : steps) {
+        /* Ряды результата масштабирования не совпадают с рядами исходных полос */
+        if (step.type == Batch::Step::Type::Operation
+            && (step.operation.type == EditStack::Operation::Type::IncreaseScaling || step.operation.type == EditStack::Operation::Type::DecreaseScaling)) {
+            return QStringLiteral("Масштабирование не выполняется по полосам");
+        }
+
+        /* Уровни зависят от гистограмм всего изображения, а не полосы */
+        if (step.type == Batch::Step::Type::AutoLevels || step.type == Batch::Step::Type::AutoContrast) {
+            return QStringLiteral("Автоуровни и автоконтраст не выполняются по полосам");
+        }
+
+        /* Верхний край полосы продолжается нижним краем всего изображения, которого в полосе нет */
+        if ((step.type == Batch::Step::Type::Convolution || step.type == Batch::Step::Type::UnsharpMask) && step.border == Convolution::Border::Wrap) {
+            return QStringLiteral("Свертка с краем wrap не выполняется по полосам");
+        }
+    }
+
+    return QString();
+}
+
+///
+/// \brief Banding::haloRows - Функция возвращает количество соседних рядов, которые нужны полосе сверху и снизу.
+/// \param steps - Шаги обработки.
+///
+int Banding::haloRows(const QVector<Batch::Step>& steps)
+{
+    int halo = 0;
+
+    /* Каждый box проход и каждая свертка сдвигают влияние края полосы на свой радиус */
+    for (const Batch::Step& step : steps) {
+        if (step.type == Batch::Step::Type::BoxBlur) {
+            halo += step.radius * step.samples;
+        } else if (step.type == Batch::Step::Type::FastGaussianBlur) {
+            for (const int radius : Blur::gaussianRadii(step.radius)) {
+                halo += qMax(radius, 0) * step.samples;
+            }
+        } else if (step.type == Batch::Step::Type::Convolution) {
+            halo += Convolution::haloRows(step.kernel);
+        } else if (step.type == Batch::Step::Type::UnsharpMask) {
+            halo += Convolution::haloRows(Convolution::Kernel::gaussian(step.sigma));
+        }
+    }
+
+    return halo;
+}
+
+///
+/// \brief Banding::process - Функция обрабатывает файл по полосам и записывает результат.
+/// \param inputPath - Входной файл.
+/// \param outputPath - Файл результата. Рабочие файлы создаются рядом с ним.
+/// \param steps - Шаги обработки.
+/// \param options - Параметры кодировщика.
+/// \param budget - Бюджет памяти полосы в байтах.
+/// \return Пустая строка при успехе, иначе описание ошибки.
+///
+QString Banding::process(const QString& inputPath, const QString& outputPath, const QVector<Batch::Step>& steps, const Exporter::Options& options,
+    const qint64 budget)
+{
+    const QString unsupported = unsupportedStep(steps);
+
+    if (!unsupported.isEmpty()) {
+        return unsupported;
+    }
+
+    QImageReader probe(inputPath);
+    const QSize size = probe.size();
+
+    std::function<QImage(const QRect&)> readBand;
+    QImage source;
+
+    if (size.isValid() && probe.supportsOption(QImageIOHandler::ClipRect)) {
+        /* Каждая полоса декодируется отдельным чтением, декодер пропускает ряды выше полосы */
+        readBand = [&inputPath](const QRect& rect) {
+            QImageReader reader(inputPath);
+            reader.setClipRect(rect);
+
+            return PointOperations::normalized(reader.read());
+        };
+    } else {
+        /* Декодер не умеет читать часть изображения: оно декодируется один раз и сразу уходит в рабочий файл */
+        QImageReader reader(inputPath);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        reader.setAllocationLimit(0);
+#endif
+
+        source = ScratchImage::write(PointOperations::normalized(reader.read()), scratchPath(outputPath, QStringLiteral("source")));
+
+        if (source.isNull()) {
+            return reader.error() != QImageReader::UnknownError ? reader.errorString() : QStringLiteral("Не удалось создать рабочий файл");
+        }
+
+        readBand = [&source](const QRect& rect) {
+            return source.copy(rect);
+        };
+    }
+
+    const QSize imageSize = size.isValid() ? size : source.size();
+
+    if (imageSize.isEmpty()) {
+        return probe.errorString();
+    }
+
+    const int halo = haloRows(steps);
+    const qint64 rowBytes = imageSize.width() * static_cast<qint64>(sizeof(QRgb));
+    const int coreRows = static_cast<int>(qBound<qint64>(1, budget / (rowBytes * bandCopies) - 2 * halo, imageSize.height()));
+
+    QImage result;
+
+    for (int top = 0; top < imageSize.height(); top += coreRows) {
+        Placement placement;
+        placement.size = imageSize;
+        placement.core = QRect(0, top, imageSize.width(), qMin(coreRows, imageSize.height() - top));
+        placement.band = QRect(0, qMax(0, top - halo), imageSize.width(), 0);
+        placement.band.setBottom(qMin(imageSize.height() - 1, placement.core.bottom() + halo));
+
+        QImage band;
+
+        {
+            const Trace::Scope trace("decode band", "io");
+
+            band = readBand(placement.band);
+        }
+
+        if (band.size() != placement.band.size()) {
+            return QStringLiteral("Не удалось декодировать ряды %1-%2").arg(placement.band.top()).arg(placement.band.bottom());
+        }
+
+        {
+            const Trace::Scope trace("process band", "pixels");
+
+            band = Batch::process(band, steps);
+        }
+
+        placement = place(placement, steps);
+
+        if (result.isNull()) {
+            result = ScratchImage::create(placement.size, band.format(), scratchPath(outputPath, QStringLiteral("result")));
+
+            if (result.isNull()) {
+                return QStringLiteral("Не удалось создать рабочий файл");
+            }
+        }
+
+        /* Ряды ореола отбрасываются, остальное ложится на свое место в результате */
+        copyRows(band, placement.core.translated(-placement.band.topLeft()), result, placement.core.topLeft());
+    }
+
+    /* Исходный рабочий файл больше не нужен, результат кодируется прямо из отображенного файла */
+    source = QImage();
+
+    return Exporter::encode(result, outputPath, options);
+}
@@ -0,0 +1,628 @@
+#include "include/PhotoProcessing/Batch.h"
+#include "include/PhotoProcessing/Banding.h"
+#include "include/PhotoProcessing/Blur.h"
+#include "include/PhotoProcessing/Convolution.h"
+#include "include/PhotoProcessing/Histogram.h"
+#include "include/PhotoProcessing/ImageLoader.h"
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/Resample.h"
+#include "include/PhotoProcessing/Trace.h"
+
+#include <cmath>
+#include <cstring>
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QFuture>
+#include <QHash>
+#include <QImageReader>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+namespace {
+/* Ограничения ядра из командной строки: веса помещаются в int16 с фиксированной точкой, а прямая свертка остается конечной по времени */
+constexpr int maximumKernelSize = 255;
+constexpr double maximumKernelWeight = 1000.0;
+
+///
+/// \brief The FileResult struct - Итог обработки одного файла.
+///
+struct FileResult {
+    qint64 pixels = 0;
+    QString error;
+};
+
+///
+/// \brief parameters - Функция разбирает параметры шага вида key=value,key=value.
+///
+bool parameters(const QString& text, QHash<QString, QString>& values)
+{
+    for (const QString& pair : text.split(QLatin1Char(','))) {
+        if (pair.trimmed().isEmpty()) {
+            continue;
+        }
+
+        const int separator = pair.indexOf(QLatin1Char('='));
+
+        if (separator <= 0) {
+            return false;
+        }
+
+        values.insert(pair.left(separator).trimmed().toLower(), pair.mid(separator + 1).trimmed());
+    }
+
+    return true;
+}
+
+///
+/// \brief number - Функция читает числовой параметр шага.
+/// \return false, если параметр задан, но не является числом.
+///
+bool number(const QHash<QString, QString>& values, const QString& key, double& value)
+{
+    if (!values.contains(key)) {
+        return true;
+    }
+
+    bool ok = false;
+    value = values.value(key).toDouble(&ok);
+
+    return ok;
+}
+
+///
+/// \brief filter - Функция читает фильтр масштабирования по имени.
+///
+bool filter(const QString& name, Resample::Filter& value)
+{
+    static const QHash<QString, Resample::Filter> filters {
+        { QStringLiteral("area"), Resample::Filter::Area },
+        { QStringLiteral("bilinear"), Resample::Filter::Bilinear },
+        { QStringLiteral("bicubic"), Resample::Filter::Bicubic },
+        { QStringLiteral("lanczos"), Resample::Filter::Lanczos }
+    };
+
+    if (!filters.contains(name.toLower())) {
+        return false;
+    }
+
+    value = filters.value(name.toLower());
+
+    return true;
+}
+
+///
+/// \brief border - Функция читает край свертки по имени.
+///
+bool border(const QString& name, Convolution::Border& value)
+{
+    static const QHash<QString, Convolution::Border> borders {
+        { QStringLiteral("clamp"), Convolution::Border::Clamp },
+        { QStringLiteral("mirror"), Convolution::Border::Mirror },
+        { QStringLiteral("wrap"), Convolution::Border::Wrap },
+        { QStringLiteral("transparent"), Convolution::Border::Transparent }
+    };
+
+    if (!borders.contains(name.toLower())) {
+        return false;
+    }
+
+    value = borders.value(name.toLower());
+
+    return true;
+}
+
+///
+/// \brief kernel - Функция читает ядро свертки: ширину и веса по рядам через пробел.
+///
+bool kernel(const QHash<QString, QString>& values, Convolution::Kernel& value)
+{
+    double width = 0.0;
+
+    if (!values.contains(QStringLiteral("width")) || !number(values, QStringLiteral("width"), width) || width < 1.0 || width > maximumKernelSize) {
+        return false;
+    }
+
+    QVector<float> weights;
+
+    for (const QString& item : values.value(QStringLiteral("weights")).split(QLatin1Char(' '))) {
+        if (item.isEmpty()) {
+            continue;
+        }
+
+        bool ok = false;
+        const float weight = item.toFloat(&ok);
+
+        if (!ok || std::abs(weight) > maximumKernelWeight) {
+            return false;
+        }
+
+        weights.append(weight);
+    }
+
+    const int columns = qRound(width);
+
+    if (weights.isEmpty() || weights.size() % columns != 0 || weights.size() / columns > maximumKernelSize) {
+        return false;
+    }
+
+    value = Convolution::Kernel(columns, weights.size() / columns, weights);
+
+    return true;
+}
+
+///
+/// \brief outputPaths - Функция возвращает пути результатов: имя входного файла в каталоге результатов, расширение - по формату.
+/// Совпадающие имена (одно имя из разных каталогов, a.png и a.jpg в одном формате) получают суффикс -2, -3, ... в порядке входных файлов.
+///
+QStringList outputPaths(const QStringList& inputs, const QString& directory, const Exporter::Options& options)
+{
+    QStringList paths;
+    paths.reserve(inputs.size());
+
+    /* Имена сравниваются без учета регистра: на Windows и macOS A.png и a.png - один файл */
+    QSet<QString> taken;
+
+    for (const QString& input : inputs) {
+        const QFileInfo info(input);
+        const QString suffix = options.format.isEmpty() ? info.suffix() : options.format.toLower();
+
+        QString name = info.completeBaseName() + QLatin1Char('.') + suffix;
+
+        for (int copy = 2; taken.contains(name.toLower()); ++copy) {
+            name = QStringLiteral("%1-%2.%3").arg(info.completeBaseName()).arg(copy).arg(suffix);
+        }
+
+        taken.insert(name.toLower());
+        paths.append(QDir(directory).filePath(name));
+    }
+
+    return paths;
+}
+
+///
+/// \brief processFile - Функция декодирует, обрабатывает и кодирует один файл. Выполняется в рабочем потоке.
+/// \param input - Входной файл.
+/// \param output - Файл результата (outputPaths()).
+///
+FileResult processFile(const QString& input, const QString& output, const Batch::Job& job)
+{
+    FileResult result;
+
+    /* Размер читается из заголовка без декодирования. Файлы с шагами, которым нужно все изображение, обрабатываются целиком */
+    if (job.bandBudget > 0 && Banding::unsupportedStep(job.steps).isEmpty()) {
+        const QSize size = ImageLoader::probe(input).size;
+
+        if (size.isValid() && qint64(size.width()) * size.height() * qint64(sizeof(QRgb)) > job.bandBudget) {
+            result.pixels = qint64(size.width()) * size.height();
+            result.error = Banding::process(input, output, job.steps, job.options, job.bandBudget);
+
+            return result;
+        }
+    }
+
+    QImage image;
+
+    {
+        const Trace::Scope trace("decode", "io");
+
+        QImageReader reader(input);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+        /* Как и в редакторе (ImageLoader::decode()), размер ограничен памятью, а не предупреждением Qt о больших изображениях */
+        reader.setAllocationLimit(0);
+#endif
+
+        image = reader.read();
+
+        if (image.isNull()) {
+            result.error = reader.errorString();
+
+            return result;
+        }
+    }
+
+    result.pixels = qint64(image.width()) * image.height();
+
+    {
+        const Trace::Scope trace("process", "pixels");
+
+        image = Batch::process(PointOperations::normalized(image), job.steps);
+    }
+
+    result.error = Exporter::encode(image, output, job.options);
+
+    return result;
+}
+}
+
+///
+/// \brief Batch::isBatchMode - Функция проверяет, запрошен ли пакетный режим в аргументах командной строки.
+///
+bool Batch::isBatchMode(const int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--batch") == 0) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+///
+/// \brief Batch::parseStep - Функция разбирает шаг вида name[:key=value[,key=value]].
+/// \param text - Описание шага.
+/// \param step - Разобранный шаг.
+/// \return Пустая строка при успехе, иначе описание ошибки.
+///
+QString Batch::parseStep(const QString& text, Step& step)
+{
+    using Type = EditStack::Operation::Type;
+
+    static const QHash<QString, Type> operations {
+        { QStringLiteral("gray"), Type::Gray },
+        { QStringLiteral("sepia"), Type::Sepia },
+        { QStringLiteral("hue"), Type::Hue },
+        { QStringLiteral("brightness"), Type::Brightness },
+        { QStringLiteral("contrast"), Type::Contrast },
+        { QStringLiteral("rotate"), Type::Rotate },
+        { QStringLiteral("rotate-cw"), Type::RotateClockwise },
+        { QStringLiteral("rotate180"), Type::Rotate180 },
+        { QStringLiteral("flip-h"), Type::FlipHorizontal },
+        { QStringLiteral("flip-v"), Type::FlipVertical },
+        { QStringLiteral("scale-up"), Type::IncreaseScaling },
+        { QStringLiteral("scale-down"), Type::DecreaseScaling }
+    };
+
+    const int colon = text.indexOf(QLatin1Char(':'));
+    const QString name = text.left(colon).trimmed().toLower();
+
+    QHash<QString, QString> values;
+
+    if (colon >= 0 && !parameters(text.mid(colon + 1), values)) {
+        return QStringLiteral("Неверные параметры операции \"%1\"").arg(text);
+    }
+
+    step = Step();
+
+    if (name == QLatin1String("blur")) {
+        double radius = 1.0;
+        double samples = 1.0;
+
+        if (!number(values, QStringLiteral("radius"), radius) || !number(values, QStringLiteral("samples"), samples) || radius < 0.0 || samples < 1.0) {
+            return QStringLiteral("Неверные параметры размытия \"%1\"").arg(text);
+        }
+
+        const QString mode = values.value(QStringLiteral("mode"), QStringLiteral("box")).toLower();
+
+        if (mode != QLatin1String("box") && mode != QLatin1String("gaussian")) {
+            return QStringLiteral("Неизвестный тип размытия \"%1\"").arg(mode);
+        }
+
+        step.type = (mode == QLatin1String("gaussian")) ? Step::Type::FastGaussianBlur : Step::Type::BoxBlur;
+        step.radius = qRound(radius);
+        step.samples = qRound(samples);
+
+        return QString();
+    }
+
+    if (name == QLatin1String("auto-levels") || name == QLatin1String("auto-contrast")) {
+        double clip = 0.1;
+
+        if (!number(values, QStringLiteral("clip"), clip) || clip < 0.0 || clip >= 50.0) {
+            return QStringLiteral("Неверные параметры операции \"%1\"").arg(text);
+        }
+
+        step.type = (name == QLatin1String("auto-levels")) ? Step::Type::AutoLevels : Step::Type::AutoContrast;
+        step.clip = clip / 100.0;
+
+        return QString();
+    }
+
+    if (name == QLatin1String("sharpen") || name == QLatin1String("unsharp") || name == QLatin1String("gaussian") || name == QLatin1String("edges")
+        || name == QLatin1String("emboss") || name == QLatin1String("convolve")) {
+        double amount = 1.0;
+        double sigma = 1.0;
+
+        if (!number(values, QStringLiteral("amount"), amount) || !number(values, QStringLiteral("sigma"), sigma) || amount < 0.0 || amount > 10.0
+            || sigma <= 0.0 || sigma > 100.0) {
+            return QStringLiteral("Неверные параметры свертки \"%1\"").arg(text);
+        }
+
+        if (values.contains(QStringLiteral("border")) && !border(values.value(QStringLiteral("border")), step.border)) {
+            return QStringLiteral("Неизвестный край \"%1\"").arg(values.value(QStringLiteral("border")));
+        }
+
+        step.type = Step::Type::Convolution;
+
+        if (name == QLatin1String("sharpen")) {
+            step.kernel = Convolution::Kernel::sharpen(amount);
+        } else if (name == QLatin1String("unsharp")) {
+            step.type = Step::Type::UnsharpMask;
+            step.sigma = sigma;
+            step.amount = amount;
+        } else if (name == QLatin1String("gaussian")) {
+            step.kernel = Convolution::Kernel::gaussian(sigma);
+        } else if (name == QLatin1String("edges")) {
+            step.kernel = Convolution::Kernel::edgeDetect();
+        } else if (name == QLatin1String("emboss")) {
+            step.kernel = Convolution::Kernel::emboss();
+        } else if (!kernel(values, step.kernel)) {
+            return QStringLiteral("Неверное ядро свертки \"%1\"").arg(text);
+        }
+
+        return QString();
+    }
+
+    if (!operations.contains(name)) {
+        return QStringLiteral("Неизвестная операция \"%1\"").arg(name);
+    }
+
+    step.operation.type = operations.value(name);
+
+    switch (step.operation.type) {
+    case Type::Hue:
+    case Type::Brightness:
+    case Type::Contrast: {
+        double value = 0.0;
+
+        if (!values.contains(QStringLiteral("value")) || !number(values, QStringLiteral("value"), value)) {
+            return QStringLiteral("Операции \"%1\" нужен параметр value").arg(name);
+        }
+
+        /* Те же диапазоны, что у ползунков интерфейса */
+        if (step.operation.type == Type::Hue) {
+            value = qBound(0.0, value, 255.0);
+        } else if (step.operation.type == Type::Brightness) {
+            value = qBound(0.0, value, 2.0);
+        } else {
+            value = qBound(-127.0, value, 127.0);
+        }
+
+        step.operation.value = static_cast<float>(value);
+        break;
+    }
+    case Type::IncreaseScaling:
+    case Type::DecreaseScaling: {
+        Resample::Filter scalingFilter = (step.operation.type == Type::IncreaseScaling) ? Resample::Filter::Bicubic : Resample::Filter::Area;
+
+        if (values.contains(QStringLiteral("filter")) && !filter(values.value(QStringLiteral("filter")), scalingFilter)) {
+            return QStringLiteral("Неизвестный фильтр \"%1\"").arg(values.value(QStringLiteral("filter")));
+        }
+
+        step.operation.value = static_cast<float>(scalingFilter);
+        break;
+    }
+    default:
+        break;
+    }
+
+    return QString();
+}
+
+///
+/// \brief Batch::process - Функция применяет шаги к изображению.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param steps - Шаги обработки.
+///
+QImage Batch::process(const QImage& image, const QVector<Step>& steps)
+{
+    QImage result = image;
+    QVector<EditStack::Operation> operations;
+
+    for (const Step& step : steps) {
+        if (step.type == Step::Type::Operation) {
+            operations.append(step.operation);
+            continue;
+        }
+
+        /* Размытию и свертке нужны соседние пиксели, а автоуровням - гистограммы всего изображения, поэтому накопленные операции считаются до них */
+        result = EditStack::render(result, operations);
+        operations.clear();
+
+        if (step.type == Step::Type::AutoLevels || step.type == Step::Type::AutoContrast) {
+            const Histogram::Statistics statistics = Histogram::compute(result);
+
+            /* Уровни - это таблица, она объединяется со следующими поточечными операциями в один проход */
+            EditStack::Operation levels { EditStack::Operation::Type::Levels, 0.0f };
+            levels.levels = (step.type == Step::Type::AutoLevels) ? Histogram::autoLevels(statistics, step.clip) : Histogram::autoContrast(statistics, step.clip);
+
+            operations.append(levels);
+            continue;
+        }
+
+        if (step.type == Step::Type::Convolution) {
+            result = Convolution::convolve(result, step.kernel, step.border);
+            continue;
+        }
+
+        if (step.type == Step::Type::UnsharpMask) {
+            result = Convolution::unsharpMask(result, step.sigma, step.amount, step.border);
+            continue;
+        }
+
+        result = (step.type == Step::Type::FastGaussianBlur) ? Blur::fastGaussianBlur(result, step.radius, step.samples) : Blur::boxBlur(result, step.radius, step.samples);
+    }
+
+    return EditStack::render(result, operations);
+}
+
+///
+/// \brief Batch::run - Функция обрабатывает все файлы задания и ждет окончания.
+/// \param job - Задание.
+/// \param errors - Ошибки по файлам в порядке входных файлов.
+///
+Batch::Report Batch::run(const Job& job, QStringList& errors)
+{
+    Report report;
+
+    /* Отдельный пул: в Qt 5 полосы Tiling выполняются в глобальном пуле, и файлы не должны занимать его потоки */
+    QThreadPool pool;
+    pool.setMaxThreadCount(job.workers > 0 ? job.workers : QThread::idealThreadCount());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    /* Задача файла не держит изображение, пока ждет в очереди, поэтому в памяти не больше maxThreadCount изображений */
+    QVector<QFuture<FileResult>> futures;
+    futures.reserve(job.inputs.size());
+
+    const QStringList outputs = outputPaths(job.inputs, job.outputDirectory, job.options);
+    const qint64 queued = Trace::now();
+
+    for (int i = 0; i < job.inputs.size(); ++i) {
+        const QString input = job.inputs.at(i);
+        const QString output = outputs.at(i);
+
+        futures.append(QtConcurrent::run(&pool, [input, output, &job, queued]() {
+            Trace::record("queue", "batch", queued, Trace::now());
+
+            return processFile(input, output, job);
+        }));
+    }
+
+    for (int i = 0; i < futures.size(); ++i) {
+        const FileResult result = futures[i].result();
+
+        /* Пропускная способность считается только по записанным файлам: ошибка декодирования заканчивается быстрее обработки */
+        if (result.error.isEmpty()) {
+            report.pixels += result.pixels;
+            ++report.processed;
+        } else {
+            ++report.failed;
+            errors.append(QStringLiteral("%1: %2").arg(job.inputs.at(i), result.error));
+        }
+    }
+
+    report.elapsed = timer.elapsed();
+
+    return report;
+}
+
+///
+/// \brief Batch::exec - Функция разбирает аргументы, выполняет задание и печатает ошибки и пропускную способность.
+/// \param arguments - Аргументы командной строки.
+/// \return Код завершения процесса.
+///
+int Batch::exec(const QStringList& arguments)
+{
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Пакетная обработка изображений без интерфейса."));
+    const QCommandLineOption helpOption = parser.addHelpOption();
+
+    const QCommandLineOption batchOption(QStringLiteral("batch"), QStringLiteral("Пакетный режим."));
+    const QCommandLineOption operationOption(QStringLiteral("op"),
+        QStringLiteral("Операция: gray, sepia, hue:value=, brightness:value=, contrast:value=, rotate, rotate-cw, rotate180, flip-h, flip-v, "
+                       "scale-up[:filter=], scale-down[:filter=] (area, bilinear, bicubic, lanczos), blur:radius=[,samples=][,mode=box|gaussian], "
+                       "auto-levels[:clip=], auto-contrast[:clip=] (clip - обрезаемый процент пикселей, по умолчанию 0.1), "
+                       "sharpen[:amount=], unsharp[:sigma=][,amount=], gaussian[:sigma=], edges, emboss, convolve:width=,weights=\"w w ...\" "
+                       "(у свертки есть параметр border=clamp|mirror|wrap|transparent). "
+                       "Операции выполняются в порядке перечисления."),
+        QStringLiteral("операция"));
+    const QCommandLineOption outputOption(QStringLiteral("out"), QStringLiteral("Каталог результатов."), QStringLiteral("каталог"));
+    const QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("Формат результатов, по умолчанию - формат входного файла."), QStringLiteral("формат"));
+    const QCommandLineOption qualityOption(QStringLiteral("quality"), QStringLiteral("Качество от 0 до 100 для форматов с потерями."), QStringLiteral("качество"));
+    const QCommandLineOption compressionOption(QStringLiteral("compression"), QStringLiteral("Уровень сжатия без потерь."), QStringLiteral("уровень"));
+    const QCommandLineOption bandOption(QStringLiteral("band-budget"),
+        QStringLiteral("Бюджет памяти на файл в мегабайтах: файлы, которые в него не помещаются, декодируются и обрабатываются по полосам."), QStringLiteral("мегабайты"));
+    const QCommandLineOption traceOption(QStringLiteral("trace"), QStringLiteral("Записать фазы обработки в файл формата Chrome trace event."), QStringLiteral("файл"));
+    const QCommandLineOption workersOption(QStringLiteral("jobs"), QStringLiteral("Количество одновременно обрабатываемых файлов, по умолчанию - по количеству ядер."), QStringLiteral("количество"));
+
+    parser.addOptions({ batchOption, operationOption, outputOption, formatOption, qualityOption, compressionOption, workersOption, bandOption, traceOption });
+    parser.addPositionalArgument(QStringLiteral("inputs"), QStringLiteral("Входные файлы."), QStringLiteral("inputs..."));
+
+    if (!parser.parse(arguments)) {
+        err << parser.errorText() << '\n';
+
+        return 2;
+    }
+
+    if (parser.isSet(helpOption)) {
+        out << parser.helpText();
+
+        return 0;
+    }
+
+    Job job;
+    job.inputs = parser.positionalArguments();
+    job.outputDirectory = parser.value(outputOption);
+    job.options.format = parser.value(formatOption);
+    job.options.quality = parser.isSet(qualityOption) ? parser.value(qualityOption).toInt() : -1;
+    job.options.compression = parser.isSet(compressionOption) ? parser.value(compressionOption).toInt() : -1;
+    job.workers = parser.value(workersOption).toInt();
+    job.bandBudget = parser.value(bandOption).toLongLong() * 1024 * 1024;
+
+    if (job.inputs.isEmpty() || job.outputDirectory.isEmpty()) {
+        err << QStringLiteral("Нужны каталог результатов (--out) и входные файлы") << '\n';
+
+        return 2;
+    }
+
+    for (const QString& text : parser.values(operationOption)) {
+        Step step;
+        const QString error = parseStep(text, step);
+
+        if (!error.isEmpty()) {
+            err << error << '\n';
+
+            return 2;
+        }
+
+        job.steps.append(step);
+    }
+
+    if (!QDir().mkpath(job.outputDirectory)) {
+        err << QStringLiteral("Не удалось создать каталог \"%1\"").arg(job.outputDirectory) << '\n';
+
+        return 1;
+    }
+
+    /* Бюджет не отменяет шаг, которому нужно все изображение: такие файлы обрабатываются целиком, о чем говорится один раз */
+    if (job.bandBudget > 0) {
+        const QString unsupported = Banding::unsupportedStep(job.steps);
+
+        if (!unsupported.isEmpty()) {
+            err << QStringLiteral("%1: файлы больше бюджета %2 МБ обрабатываются целиком").arg(unsupported).arg(job.bandBudget / (1024 * 1024)) << '\n';
+        }
+    }
+
+    Trace::setEnabled(parser.isSet(traceOption));
+
+    QStringList errors;
+    const Report report = run(job, errors);
+
+    for (const QString& error : errors) {
+        err << error << '\n';
+    }
+
+    const double seconds = qMax<qint64>(report.elapsed, 1) / 1000.0;
+
+    out << QStringLiteral("Обработано файлов: %1, ошибок: %2, время: %3 с, %4 изобр./с, %5 Мп/с")
+               .arg(report.processed)
+               .arg(report.failed)
+               .arg(seconds, 0, 'f', 2)
+               .arg(report.processed / seconds, 0, 'f', 2)
+               .arg(report.pixels / 1e6 / seconds, 0, 'f', 2)
+        << '\n';
+
+    out.flush();
+
+    if (parser.isSet(traceOption)) {
+        const QString error = Trace::writeChromeTrace(parser.value(traceOption));
+
+        if (!error.isEmpty()) {
+            err << QStringLiteral("Не удалось записать трассу: %1").arg(error) << '\n';
+        }
+    }
+
+    return report.failed == 0 ? 0 : 1;
+}
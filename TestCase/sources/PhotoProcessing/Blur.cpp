@@ -0,0 +1,258 @@
+#include "include/PhotoProcessing/Blur.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <cmath>
+
+namespace {
+/* Столбцы для вертикального прохода делятся между потоками такими порциями */
+constexpr int columnsPerTask = 256;
+
+/* Полоса с ореолом выгодна, пока ее высота хотя бы в 8 раз больше радиуса: лишних горизонтальных рядов не больше четверти */
+constexpr int fusedStripeRadiusFactor = 8;
+
+///
+/// \brief The ChannelSums struct - Бегущие суммы четырех каналов пикселя.
+///
+struct ChannelSums {
+    quint32 blue = 0;
+    quint32 green = 0;
+    quint32 red = 0;
+    quint32 alpha = 0;
+
+    inline void add(const QRgb pixel)
+    {
+        blue += qBlue(pixel);
+        green += qGreen(pixel);
+        red += qRed(pixel);
+        alpha += qAlpha(pixel);
+    }
+
+    inline void subtract(const QRgb pixel)
+    {
+        blue -= qBlue(pixel);
+        green -= qGreen(pixel);
+        red -= qRed(pixel);
+        alpha -= qAlpha(pixel);
+    }
+
+    ///
+    /// \brief average - Функция делит суммы на ширину окна с округлением.
+    /// \param multiplier - 2^32 / ширина окна, деление заменяется умножением.
+    ///
+    [[nodiscard]] inline QRgb average(const quint64 multiplier) const
+    {
+        constexpr quint64 half = quint64(1) << 31;
+
+        return qRgba(static_cast<int>((red * multiplier + half) >> 32), static_cast<int>((green * multiplier + half) >> 32),
+            static_cast<int>((blue * multiplier + half) >> 32), static_cast<int>((alpha * multiplier + half) >> 32));
+    }
+};
+
+///
+/// \brief windowMultiplier - Функция возвращает множитель для деления на ширину окна.
+/// \param radius - Радиус окна.
+///
+inline quint64 windowMultiplier(const int radius)
+{
+    const quint64 diameter = 2 * static_cast<quint64>(radius) + 1;
+
+    return ((quint64(1) << 32) + diameter / 2) / diameter;
+}
+
+///
+/// \brief blurRow - Функция размывает один ряд по горизонтали.
+///
+void blurRow(const QRgb* source, QRgb* destination, const int width, const int radius, const quint64 multiplier)
+{
+    const int lastColumn = width - 1;
+
+    ChannelSums sums;
+    for (int i = -radius; i <= radius; ++i) {
+        sums.add(source[qBound(0, i, lastColumn)]);
+    }
+
+    for (int x = 0; x <= lastColumn; ++x) {
+        destination[x] = sums.average(multiplier);
+
+        /* Сдвигаем окно: добавляем правый пиксель и убираем левый */
+        sums.add(source[qMin(x + radius + 1, lastColumn)]);
+        sums.subtract(source[qMax(x - radius, 0)]);
+    }
+}
+
+///
+/// \brief blurColumns - Функция размывает по вертикали ряды [firstRow, lastRow) в столбцах [firstColumn, lastColumn).
+/// Суммы хранятся для всей полосы столбцов, поэтому источник читается построчно.
+/// \param sourceRow - Функция, возвращающая указатель на ряд источника по номеру ряда изображения.
+/// \param destination - Ряды результата.
+///
+template <typename SourceRow>
+void blurColumns(SourceRow sourceRow, const Tiling::ImageRows& destination, const int radius, const quint64 multiplier,
+    const int firstRow, const int lastRow, const int firstColumn, const int lastColumn)
+{
+    const int lastImageRow = destination.height() - 1;
+    const int columns = lastColumn - firstColumn;
+
+    QVector<ChannelSums> sums(columns);
+
+    for (int i = firstRow - radius; i <= firstRow + radius; ++i) {
+        const QRgb* row = sourceRow(qBound(0, i, lastImageRow)) + firstColumn;
+
+        for (int x = 0; x < columns; ++x) {
+            sums[x].add(row[x]);
+        }
+    }
+
+    for (int y = firstRow; y < lastRow; ++y) {
+        QRgb* destinationRow = destination.row(y) + firstColumn;
+
+        for (int x = 0; x < columns; ++x) {
+            destinationRow[x] = sums[x].average(multiplier);
+        }
+
+        /* После последнего ряда окно не сдвигается, чтобы не читать ряды за пределами ореола */
+        if (y + 1 < lastRow) {
+            const QRgb* incoming = sourceRow(qMin(y + radius + 1, lastImageRow)) + firstColumn;
+            const QRgb* outgoing = sourceRow(qMax(y - radius, 0)) + firstColumn;
+
+            for (int x = 0; x < columns; ++x) {
+                sums[x].add(incoming[x]);
+                sums[x].subtract(outgoing[x]);
+            }
+        }
+    }
+}
+
+///
+/// \brief fusedPass - Функция делает двумерный box проход по полосам с ореолом: source -> destination.
+/// Горизонтальный проход полосы и ее ореола пишется во временный буфер потока, вертикальный сразу в destination.
+///
+void fusedPass(const QImage& source, QImage& destination, const int radius, const int rowsPerStripe)
+{
+    const quint64 multiplier = windowMultiplier(radius);
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows destinationRows(destination);
+    const int width = source.width();
+
+    Tiling::forEachStripe(source.height(), rowsPerStripe, radius, [&](const Tiling::Stripe& stripe) {
+        QVector<QRgb> horizontal(width * (stripe.haloLastRow - stripe.haloFirstRow));
+
+        for (int y = stripe.haloFirstRow; y < stripe.haloLastRow; ++y) {
+            blurRow(sourceRows.constRow(y), horizontal.data() + (y - stripe.haloFirstRow) * width, width, radius, multiplier);
+        }
+
+        blurColumns([&](const int y) { return horizontal.constData() + (y - stripe.haloFirstRow) * width; },
+            destinationRows, radius, multiplier, stripe.firstRow, stripe.lastRow, 0, width);
+    });
+}
+
+///
+/// \brief separablePass - Функция делает двумерный box проход двумя проходами по всему изображению: image -> buffer по рядам, buffer -> image по столбцам.
+///
+void separablePass(QImage& image, QImage& buffer, const int radius)
+{
+    const quint64 multiplier = windowMultiplier(radius);
+    const Tiling::ImageRows imageRows(image);
+    const Tiling::ImageRows bufferRows(buffer);
+
+    Tiling::forEachStripe(image, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            blurRow(imageRows.constRow(y), bufferRows.row(y), imageRows.width(), radius, multiplier);
+        }
+    });
+
+    Tiling::forEachRange(image.width(), columnsPerTask, [&](const int first, const int last) {
+        blurColumns([&](const int y) { return bufferRows.constRow(y); }, imageRows, radius, multiplier, 0, imageRows.height(), first, last);
+    });
+}
+
+///
+/// \brief blurWithRadii - Функция последовательно применяет box проходы с заданными радиусами.
+///
+QImage blurWithRadii(const QImage& image, const QVector<int>& radii, const int samples)
+{
+    /* Альфа учитывается корректно только в premultiplied формате */
+    const QImage::Format format = image.format();
+    QImage result = image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+
+    /* Новые значения всегда пишутся в отдельный буфер, а не поверх уже размытых пикселей */
+    QImage buffer(result.size(), result.format());
+
+    for (int sample = 0; sample < samples; ++sample) {
+        for (const int radius : radii) {
+            /* Результат отмененной операции все равно будет отброшен, оставшиеся проходы не нужны */
+            if (Tiling::isCancelled()) {
+                return QImage();
+            }
+
+            if (radius <= 0) {
+                continue;
+            }
+
+            const int rowsPerStripe = qMax(Tiling::stripeHeight(result.height(), result.bytesPerLine()), radius * fusedStripeRadiusFactor);
+
+            if ((result.height() + rowsPerStripe - 1) / rowsPerStripe >= Tiling::threadCount()) {
+                fusedPass(result, buffer, radius, rowsPerStripe);
+                result.swap(buffer);
+            } else {
+                separablePass(result, buffer, radius);
+            }
+        }
+    }
+
+    return result.convertToFormat(format);
+}
+}
+
+///
+/// \brief Blur::gaussianRadii - Функция подбирает радиусы box проходов, которые вместе приближают гауссиан.
+/// \param sigma - Стандартное отклонение гауссиана в пикселях.
+/// \param passes - Количество box проходов.
+///
+QVector<int> Blur::gaussianRadii(const double sigma, const int passes)
+{
+    /* Идеальная ширина окна, при которой дисперсия passes box фильтров равна sigma^2 */
+    const double idealWidth = std::sqrt(12.0 * sigma * sigma / passes + 1.0);
+
+    int lowerWidth = static_cast<int>(std::floor(idealWidth));
+    if (lowerWidth % 2 == 0) {
+        --lowerWidth;
+    }
+
+    const int upperWidth = lowerWidth + 2;
+
+    /* Сколько проходов взять с меньшей шириной, чтобы суммарная дисперсия была ближе всего к sigma^2 */
+    const double idealLowerCount = (12.0 * sigma * sigma - passes * lowerWidth * lowerWidth - 4.0 * passes * lowerWidth - 3.0 * passes) / (-4.0 * lowerWidth - 4.0);
+    const int lowerCount = static_cast<int>(std::round(idealLowerCount));
+
+    QVector<int> radii;
+    for (int i = 0; i < passes; ++i) {
+        radii.append(((i < lowerCount ? lowerWidth : upperWidth) - 1) / 2);
+    }
+
+    return radii;
+}
+
+///
+/// \brief Blur::boxBlur - Функция размывает изображение box фильтром.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param radius - Радиус окна.
+/// \param samples - Количество повторов размытия.
+/// \return Новое изображение в том же формате.
+///
+QImage Blur::boxBlur(const QImage& image, const int radius, const int samples)
+{
+    return blurWithRadii(image, { radius }, samples);
+}
+
+///
+/// \brief Blur::fastGaussianBlur - Функция приближает гауссово размытие тремя box проходами.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param radius - Стандартное отклонение гауссиана в пикселях.
+/// \param samples - Количество повторов размытия.
+/// \return Новое изображение в том же формате.
+///
+QImage Blur::fastGaussianBlur(const QImage& image, const int radius, const int samples)
+{
+    return blurWithRadii(image, gaussianRadii(radius), samples);
+}
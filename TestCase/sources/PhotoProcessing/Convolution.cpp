@@ -0,0 +1,751 @@
+#include "include/PhotoProcessing/Convolution.h"
+#include "include/PhotoProcessing/Simd.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <cmath>
+
+namespace {
+/* Каналы пикселя B, G, R, A расширяются до 16 бит и считаются независимо */
+constexpr int lanesPerPixel = 4;
+
+/* Веса хранятся в фиксированной точке не больше чем с 14 битами дробной части, как и в Resample */
+constexpr int maximumShift = 14;
+
+/* Сумма произведений не должна выходить за int32 с запасом на округление */
+constexpr double accumulatorLimit = 1073741824.0;
+
+/* Результат горизонтального прохода хранит 7 бит дробной части: 255 * 2^7 помещается в int16 */
+constexpr int intermediateBits = 7;
+
+/* Полоса выгодна, пока ее высота хотя бы в 8 раз больше ореола, как и в Blur */
+constexpr int stripeHaloFactor = 8;
+
+/* Допуск проверки ранга 1 и суммы весов относительно наибольшего веса */
+constexpr double separableTolerance = 1e-4;
+constexpr double sumTolerance = 1e-3;
+
+///
+/// \brief The FixedKernel struct - Веса в фиксированной точке и те же веса парами для _mm_madd_epi16.
+///
+struct FixedKernel {
+    QVector<qint16> weights;
+    QVector<qint32> pairs;
+    int shift = 0;
+};
+
+///
+/// \brief quantize - Функция переводит веса в 16-битные числа с фиксированной точкой.
+/// Количество бит дробной части подбирается так, чтобы наибольший вес поместился в int16, а сумма произведений - в int32.
+/// \param weights - Веса.
+/// \param inputMaximum - Наибольшее по модулю значение входа.
+///
+FixedKernel quantize(const QVector<float>& weights, const int inputMaximum)
+{
+    double largest = 0.0;
+    double absoluteSum = 0.0;
+    double sum = 0.0;
+
+    for (const float weight : weights) {
+        largest = qMax(largest, static_cast<double>(std::abs(weight)));
+        absoluteSum += std::abs(weight);
+        sum += weight;
+    }
+
+    FixedKernel kernel;
+    kernel.shift = maximumShift;
+
+    while (kernel.shift > 0
+        && (std::ldexp(largest, kernel.shift) > 32767.0 || std::ldexp(absoluteSum * inputMaximum, kernel.shift) >= accumulatorLimit)) {
+        --kernel.shift;
+    }
+
+    kernel.weights.resize(weights.size());
+
+    int largestIndex = 0;
+    qint64 quantizedSum = 0;
+
+    for (int i = 0; i < weights.size(); ++i) {
+        kernel.weights[i] = static_cast<qint16>(qBound<qint64>(-32767, std::llround(std::ldexp(weights[i], kernel.shift)), 32767));
+        quantizedSum += kernel.weights[i];
+
+        if (std::abs(weights[i]) > std::abs(weights[largestIndex])) {
+            largestIndex = i;
+        }
+    }
+
+    /* Ошибка округления переносится на наибольший вес, чтобы сумма весов сохранилась: однотонная область не меняет цвет */
+    if (!weights.isEmpty()) {
+        const qint64 target = std::llround(std::ldexp(sum, kernel.shift));
+
+        kernel.weights[largestIndex] = static_cast<qint16>(qBound<qint64>(-32767, kernel.weights[largestIndex] + target - quantizedSum, 32767));
+    }
+
+    return kernel;
+}
+
+///
+/// \brief pairWeights - Функция складывает веса парами в 32-битные ячейки, нечетный последний вес идет в пару с нулем.
+///
+void pairWeights(FixedKernel& kernel)
+{
+    kernel.pairs.clear();
+
+    for (int k = 0; k < kernel.weights.size(); k += 2) {
+        const qint16 first = kernel.weights[k];
+        const qint16 second = k + 1 < kernel.weights.size() ? kernel.weights[k + 1] : 0;
+
+        kernel.pairs.append(static_cast<qint32>(static_cast<quint16>(first) | (static_cast<quint32>(static_cast<quint16>(second)) << 16)));
+    }
+}
+
+///
+/// \brief borderIndex - Функция переводит координату за краем в координату внутри [0, size).
+/// \return Координата или -1 для прозрачного края.
+///
+int borderIndex(const int index, const int size, const Convolution::Border border)
+{
+    if (index >= 0 && index < size) {
+        return index;
+    }
+
+    switch (border) {
+    case Convolution::Border::Clamp:
+        return qBound(0, index, size - 1);
+    case Convolution::Border::Mirror: {
+        if (size == 1) {
+            return 0;
+        }
+
+        const int period = 2 * (size - 1);
+        const int folded = ((index % period) + period) % period;
+
+        return folded < size ? folded : period - folded;
+    }
+    case Convolution::Border::Wrap:
+        return ((index % size) + size) % size;
+    case Convolution::Border::Transparent:
+        break;
+    }
+
+    return -1;
+}
+
+///
+/// \brief storeLane - Функция записывает сумму в 16-битный канал промежуточного ряда с насыщением.
+///
+inline void storeLane(qint16* output, const int value)
+{
+    *output = static_cast<qint16>(qBound(-32768, value, 32767));
+}
+
+///
+/// \brief storeLane - Функция записывает сумму в байт пикселя с насыщением.
+///
+inline void storeLane(quint8* output, const int value)
+{
+    *output = static_cast<quint8>(qBound(0, value, 255));
+}
+
+///
+/// \brief weightedSumScalar - Функция считает взвешенную сумму входов для каналов [first, lanes).
+///
+template <typename Output>
+void weightedSumScalar(const qint16* const* inputs, const FixedKernel& kernel, const int shift, Output* output, const int first, const int lanes)
+{
+    const int half = shift > 0 ? 1 << (shift - 1) : 0;
+    const int count = kernel.weights.size();
+
+    for (int i = first; i < lanes; ++i) {
+        int sum = half;
+
+        for (int k = 0; k < count; ++k) {
+            sum += inputs[k][i] * kernel.weights[k];
+        }
+
+        storeLane(output + i, sum >> shift);
+    }
+}
+
+#if defined(PHOTOPROCESSING_SSE2)
+inline void storeSse2(qint16* output, const __m128i low, const __m128i high)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_packs_epi32(low, high));
+}
+
+inline void storeSse2(quint8* output, const __m128i low, const __m128i high)
+{
+    const __m128i words = _mm_packs_epi32(low, high);
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(output), _mm_packus_epi16(words, words));
+}
+
+///
+/// \brief weightedSumSse2 - Функция считает взвешенную сумму по восемь каналов: каналы двух входов чередуются,
+/// и _mm_madd_epi16 сразу складывает оба произведения.
+/// \return Первый канал, который остался не посчитан.
+///
+template <typename Output>
+int weightedSumSse2(const qint16* const* inputs, const FixedKernel& kernel, const int shift, Output* output, const int first, const int lanes)
+{
+    const __m128i half = _mm_set1_epi32(shift > 0 ? 1 << (shift - 1) : 0);
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    const int count = kernel.weights.size();
+
+    int i = first;
+    for (; i + 8 <= lanes; i += 8) {
+        __m128i low = half;
+        __m128i high = half;
+
+        for (int k = 0; k < count; k += 2) {
+            const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[k] + i));
+            const __m128i bottom = k + 1 < count ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(inputs[k + 1] + i)) : _mm_setzero_si128();
+            const __m128i weights = _mm_set1_epi32(kernel.pairs[k / 2]);
+
+            low = _mm_add_epi32(low, _mm_madd_epi16(_mm_unpacklo_epi16(top, bottom), weights));
+            high = _mm_add_epi32(high, _mm_madd_epi16(_mm_unpackhi_epi16(top, bottom), weights));
+        }
+
+        storeSse2(output + i, _mm_sra_epi32(low, shiftCount), _mm_sra_epi32(high, shiftCount));
+    }
+
+    return i;
+}
+#endif
+
+#if defined(PHOTOPROCESSING_AVX2)
+PHOTOPROCESSING_TARGET_AVX2 inline void storeAvx2(qint16* output, const __m256i low, const __m256i high)
+{
+    /* Упаковка идет внутри 128-битных половин, а распаковка делила входы так же, поэтому порядок каналов сохраняется */
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(output), _mm256_packs_epi32(low, high));
+}
+
+PHOTOPROCESSING_TARGET_AVX2 inline void storeAvx2(quint8* output, const __m256i low, const __m256i high)
+{
+    const __m256i words = _mm256_packs_epi32(low, high);
+    const __m256i bytes = _mm256_packus_epi16(words, words);
+
+    /* Младшие 8 байт каждой половины собираются в младшие 16 байт */
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm256_castsi256_si128(_mm256_permute4x64_epi64(bytes, 0x08)));
+}
+
+///
+/// \brief weightedSumAvx2 - AVX2 версия weightedSumSse2 по шестнадцать каналов.
+///
+template <typename Output>
+PHOTOPROCESSING_TARGET_AVX2 int weightedSumAvx2(const qint16* const* inputs, const FixedKernel& kernel, const int shift, Output* output, const int first,
+    const int lanes)
+{
+    const __m256i half = _mm256_set1_epi32(shift > 0 ? 1 << (shift - 1) : 0);
+    const __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    const int count = kernel.weights.size();
+
+    int i = first;
+    for (; i + 16 <= lanes; i += 16) {
+        __m256i low = half;
+        __m256i high = half;
+
+        for (int k = 0; k < count; k += 2) {
+            const __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[k] + i));
+            const __m256i bottom = k + 1 < count ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(inputs[k + 1] + i)) : _mm256_setzero_si256();
+            const __m256i weights = _mm256_set1_epi32(kernel.pairs[k / 2]);
+
+            low = _mm256_add_epi32(low, _mm256_madd_epi16(_mm256_unpacklo_epi16(top, bottom), weights));
+            high = _mm256_add_epi32(high, _mm256_madd_epi16(_mm256_unpackhi_epi16(top, bottom), weights));
+        }
+
+        storeAvx2(output + i, _mm256_sra_epi32(low, shiftCount), _mm256_sra_epi32(high, shiftCount));
+    }
+
+    return i;
+}
+#endif
+
+///
+/// \brief weightedSum - Функция считает для каждого канала i сумму inputs[k][i] * weights[k], округляет и сдвигает на shift бит.
+/// \param inputs - Входы, по одному на вес.
+/// \param kernel - Веса.
+/// \param shift - Сдвиг результата вправо.
+/// \param output - Результат: 16-битные каналы промежуточного ряда или байты пикселей.
+/// \param lanes - Количество каналов.
+///
+template <typename Output>
+void weightedSum(const qint16* const* inputs, const FixedKernel& kernel, const int shift, Output* output, const int lanes)
+{
+    int i = 0;
+
+#if defined(PHOTOPROCESSING_AVX2)
+    if (Simd::hasAvx2()) {
+        i = weightedSumAvx2(inputs, kernel, shift, output, i, lanes);
+    }
+#endif
+#if defined(PHOTOPROCESSING_SSE2)
+    i = weightedSumSse2(inputs, kernel, shift, output, i, lanes);
+#endif
+
+    weightedSumScalar(inputs, kernel, shift, output, i, lanes);
+}
+
+///
+/// \brief expandRow - Функция расширяет каналы ряда до 16 бит и добавляет слева anchor, а справа kernelWidth - 1 - anchor пикселей за краем.
+/// \param source - Ряд источника или nullptr для прозрачного ряда.
+/// \param destination - (width + kernelWidth - 1) * 4 каналов.
+///
+void expandRow(const QRgb* source, qint16* destination, const int width, const int anchor, const int kernelWidth, const Convolution::Border border)
+{
+    const int paddedWidth = width + kernelWidth - 1;
+    const uchar* bytes = reinterpret_cast<const uchar*>(source);
+
+    for (int p = 0; p < paddedWidth; ++p) {
+        const int x = source != nullptr ? borderIndex(p - anchor, width, border) : -1;
+        qint16* lanes = destination + p * lanesPerPixel;
+
+        for (int lane = 0; lane < lanesPerPixel; ++lane) {
+            lanes[lane] = x >= 0 ? bytes[x * lanesPerPixel + lane] : 0;
+        }
+    }
+}
+
+///
+/// \brief sourceRow - Функция возвращает ряд источника для ряда за краем или nullptr для прозрачного края.
+///
+const QRgb* sourceRow(const Tiling::ImageRows& rows, const int y, const Convolution::Border border)
+{
+    const int index = borderIndex(y, rows.height(), border);
+
+    return index >= 0 ? rows.constRow(index) : nullptr;
+}
+
+///
+/// \brief stripeRows - Функция подбирает высоту полосы: ореол не больше восьмой части полосы, пока полос хватает на все потоки.
+///
+int stripeRows(const QImage& image, const int halo)
+{
+    const int rowsPerThread = (image.height() + Tiling::threadCount() - 1) / Tiling::threadCount();
+
+    return qMax(Tiling::stripeHeight(image.height(), image.bytesPerLine()), qMin(halo * stripeHaloFactor, rowsPerThread));
+}
+
+///
+/// \brief directPass - Функция сворачивает изображение с ядром напрямую: width * height умножений на канал, нулевые веса пропускаются.
+///
+void directPass(const QImage& source, QImage& destination, const Convolution::Kernel& kernel, const Convolution::Border border)
+{
+    QVector<float> weights;
+    QVector<int> offsetsX;
+    QVector<int> offsetsY;
+
+    for (int y = 0; y < kernel.height(); ++y) {
+        for (int x = 0; x < kernel.width(); ++x) {
+            weights.append(kernel.at(x, y));
+        }
+    }
+
+    const FixedKernel quantized = quantize(weights, 255);
+
+    FixedKernel taps;
+    taps.shift = quantized.shift;
+
+    for (int i = 0; i < quantized.weights.size(); ++i) {
+        if (quantized.weights[i] != 0) {
+            taps.weights.append(quantized.weights[i]);
+            offsetsX.append(i % kernel.width());
+            offsetsY.append(i / kernel.width());
+        }
+    }
+
+    pairWeights(taps);
+
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows destinationRows(destination);
+    const int width = source.width();
+    const int anchorX = kernel.width() / 2;
+    const int anchorY = kernel.height() / 2;
+    const int paddedLanes = (width + kernel.width() - 1) * lanesPerPixel;
+
+    Tiling::forEachStripe(source.height(), stripeRows(source, anchorY), anchorY, [&](const Tiling::Stripe& stripe) {
+        /* Ряды полосы и ореола расширяются один раз, каждый вес читает их со своим смещением */
+        const int rowCount = stripe.lastRow - stripe.firstRow + kernel.height() - 1;
+        QVector<qint16> expanded(rowCount * paddedLanes);
+
+        for (int r = 0; r < rowCount; ++r) {
+            expandRow(sourceRow(sourceRows, stripe.firstRow - anchorY + r, border), expanded.data() + r * paddedLanes, width, anchorX, kernel.width(),
+                border);
+        }
+
+        QVector<const qint16*> inputs(taps.weights.size());
+
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            for (int t = 0; t < inputs.size(); ++t) {
+                inputs[t] = expanded.constData() + (y - stripe.firstRow + offsetsY[t]) * paddedLanes + offsetsX[t] * lanesPerPixel;
+            }
+
+            weightedSum(inputs.constData(), taps, taps.shift, reinterpret_cast<quint8*>(destinationRows.row(y)), width * lanesPerPixel);
+        }
+    });
+}
+
+///
+/// \brief separablePass - Функция сворачивает изображение с ядром ранга 1 двумя проходами внутри полосы: width + height умножений на канал.
+/// Горизонтальный проход пишет 16-битные ряды с intermediateBits битами дробной части, вертикальный читает их и пишет байты.
+///
+void separablePass(const QImage& source, QImage& destination, const QVector<float>& row, const QVector<float>& column, const Convolution::Border border)
+{
+    FixedKernel horizontal = quantize(row, 255);
+    const int fractionBits = qMin(intermediateBits, horizontal.shift);
+    FixedKernel vertical = quantize(column, 255 << fractionBits);
+
+    pairWeights(horizontal);
+    pairWeights(vertical);
+
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows destinationRows(destination);
+    const int width = source.width();
+    const int lanes = width * lanesPerPixel;
+    const int anchorX = row.size() / 2;
+    const int anchorY = column.size() / 2;
+
+    Tiling::forEachStripe(source.height(), stripeRows(source, anchorY), anchorY, [&](const Tiling::Stripe& stripe) {
+        const int rowCount = stripe.lastRow - stripe.firstRow + column.size() - 1;
+        QVector<qint16> padded((width + row.size() - 1) * lanesPerPixel);
+        QVector<qint16> intermediate(rowCount * lanes);
+        QVector<const qint16*> inputs(qMax(row.size(), column.size()));
+
+        for (int x = 0; x < row.size(); ++x) {
+            inputs[x] = padded.constData() + x * lanesPerPixel;
+        }
+
+        for (int r = 0; r < rowCount; ++r) {
+            expandRow(sourceRow(sourceRows, stripe.firstRow - anchorY + r, border), padded.data(), width, anchorX, row.size(), border);
+            weightedSum(inputs.constData(), horizontal, horizontal.shift - fractionBits, intermediate.data() + r * lanes, lanes);
+        }
+
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            for (int k = 0; k < column.size(); ++k) {
+                inputs[k] = intermediate.constData() + (y - stripe.firstRow + k) * lanes;
+            }
+
+            weightedSum(inputs.constData(), vertical, vertical.shift + fractionBits, reinterpret_cast<quint8*>(destinationRows.row(y)), lanes);
+        }
+    });
+}
+
+///
+/// \brief workingImage - Функция переводит изображение в формат, в котором считаются все каналы: альфа учитывается только в premultiplied формате.
+///
+QImage workingImage(const QImage& image)
+{
+    return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32);
+}
+
+///
+/// \brief filter - Функция сворачивает изображение в рабочем формате, выбирая раздельный проход для ядра ранга 1.
+/// \return Новое изображение или пустое изображение при отмене.
+///
+QImage filter(const QImage& source, const Convolution::Kernel& kernel, const Convolution::Border border)
+{
+    QImage destination(source.size(), source.format());
+    QVector<float> row;
+    QVector<float> column;
+
+    if (kernel.separate(row, column)) {
+        separablePass(source, destination, row, column, border);
+    } else {
+        directPass(source, destination, kernel, border);
+    }
+
+    return Tiling::isCancelled() ? QImage() : destination;
+}
+
+///
+/// \brief finishRows - Функция восстанавливает альфу и ограничивает каналы цвета альфой.
+/// Отрицательные веса дают цвет ярче альфы, а такой пиксель нельзя вернуть из премультипликации.
+/// \param source - Изображение до свертки.
+/// \param result - Результат свертки.
+/// \param sourceAlpha - Альфа берется из source, а не из свертки.
+///
+void finishRows(const QImage& source, QImage& result, const bool sourceAlpha)
+{
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows resultRows(result);
+    const bool premultiplied = source.format() == QImage::Format_ARGB32_Premultiplied;
+
+    Tiling::forEachStripe(result, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            const QRgb* sourceRow = sourceRows.constRow(y);
+            QRgb* resultRow = resultRows.row(y);
+
+            for (int x = 0; x < resultRows.width(); ++x) {
+                const QRgb pixel = resultRow[x];
+                const int alpha = sourceAlpha ? qAlpha(sourceRow[x]) : qAlpha(pixel);
+                const int limit = premultiplied ? alpha : 255;
+
+                resultRow[x] = qRgba(qMin(qRed(pixel), limit), qMin(qGreen(pixel), limit), qMin(qBlue(pixel), limit), alpha);
+            }
+        }
+    });
+}
+}
+
+///
+/// \brief Convolution::Kernel::Kernel - Конструктор ядра из весов по рядам.
+/// \param width - Ширина ядра.
+/// \param height - Высота ядра.
+/// \param weights - width * height весов, иначе ядро пустое.
+///
+Convolution::Kernel::Kernel(const int width, const int height, const QVector<float>& weights)
+{
+    if (width > 0 && height > 0 && weights.size() == width * height) {
+        kernelWidth = width;
+        kernelHeight = height;
+        kernelWeights = weights;
+    }
+}
+
+///
+/// \brief Convolution::Kernel::gaussian - Функция строит гауссово ядро радиуса 3 * sigma.
+/// \param sigma - Стандартное отклонение в пикселях.
+///
+Convolution::Kernel Convolution::Kernel::gaussian(const double sigma)
+{
+    if (sigma <= 0.0) {
+        return Kernel(1, 1, { 1.0f });
+    }
+
+    const int radius = qMax(1, static_cast<int>(std::ceil(3.0 * sigma)));
+    const int size = 2 * radius + 1;
+
+    QVector<double> profile(size);
+    double sum = 0.0;
+
+    for (int i = 0; i < size; ++i) {
+        const double distance = i - radius;
+
+        profile[i] = std::exp(-distance * distance / (2.0 * sigma * sigma));
+        sum += profile[i];
+    }
+
+    QVector<float> weights(size * size);
+
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            weights[y * size + x] = static_cast<float>(profile[y] * profile[x] / (sum * sum));
+        }
+    }
+
+    return Kernel(size, size, weights);
+}
+
+///
+/// \brief Convolution::Kernel::sharpen - Функция строит ядро резкости 3x3: пиксель минус amount соседей по кресту.
+/// \param amount - Сила резкости.
+///
+Convolution::Kernel Convolution::Kernel::sharpen(const double amount)
+{
+    const float side = static_cast<float>(-amount);
+    const float center = static_cast<float>(1.0 + 4.0 * amount);
+
+    return Kernel(3, 3, { 0.0f, side, 0.0f, side, center, side, 0.0f, side, 0.0f });
+}
+
+///
+/// \brief Convolution::Kernel::edgeDetect - Функция строит ядро Лапласа 3x3: однотонные области становятся черными, остаются контуры.
+///
+Convolution::Kernel Convolution::Kernel::edgeDetect()
+{
+    return Kernel(3, 3, { -1.0f, -1.0f, -1.0f, -1.0f, 8.0f, -1.0f, -1.0f, -1.0f, -1.0f });
+}
+
+///
+/// \brief Convolution::Kernel::emboss - Функция строит ядро тиснения 3x3 со светом слева сверху.
+///
+Convolution::Kernel Convolution::Kernel::emboss()
+{
+    return Kernel(3, 3, { -2.0f, -1.0f, 0.0f, -1.0f, 1.0f, 1.0f, 0.0f, 1.0f, 2.0f });
+}
+
+bool Convolution::Kernel::isNull() const
+{
+    return kernelWeights.isEmpty();
+}
+
+int Convolution::Kernel::width() const
+{
+    return kernelWidth;
+}
+
+int Convolution::Kernel::height() const
+{
+    return kernelHeight;
+}
+
+float Convolution::Kernel::at(const int x, const int y) const
+{
+    return kernelWeights[y * kernelWidth + x];
+}
+
+///
+/// \brief Convolution::Kernel::sum - Функция возвращает сумму весов. Ядро с суммой 1 сохраняет среднюю яркость.
+///
+double Convolution::Kernel::sum() const
+{
+    double total = 0.0;
+
+    for (const float weight : kernelWeights) {
+        total += weight;
+    }
+
+    return total;
+}
+
+///
+/// \brief Convolution::Kernel::separate - Функция проверяет, что ядро ранга 1, и раскладывает его на столбец и ряд.
+/// Ряд и столбец проходят через наибольший вес, ряд нормируется на сумму модулей: результат горизонтального прохода не выходит за int16.
+/// \param row - Веса горизонтального прохода.
+/// \param column - Веса вертикального прохода.
+/// \return Возвращает 'true', если at(x, y) == column[y] * row[x] для всех весов.
+///
+bool Convolution::Kernel::separate(QVector<float>& row, QVector<float>& column) const
+{
+    if (isNull()) {
+        return false;
+    }
+
+    int pivot = 0;
+
+    for (int i = 1; i < kernelWeights.size(); ++i) {
+        if (std::abs(kernelWeights[i]) > std::abs(kernelWeights[pivot])) {
+            pivot = i;
+        }
+    }
+
+    const double pivotWeight = kernelWeights[pivot];
+
+    if (pivotWeight == 0.0) {
+        return false;
+    }
+
+    const int pivotX = pivot % kernelWidth;
+    const int pivotY = pivot / kernelWidth;
+
+    QVector<double> rowWeights(kernelWidth);
+    QVector<double> columnWeights(kernelHeight);
+    double rowSum = 0.0;
+
+    for (int x = 0; x < kernelWidth; ++x) {
+        rowWeights[x] = at(x, pivotY);
+        rowSum += std::abs(rowWeights[x]);
+    }
+
+    for (int y = 0; y < kernelHeight; ++y) {
+        columnWeights[y] = at(pivotX, y) / pivotWeight;
+    }
+
+    for (int y = 0; y < kernelHeight; ++y) {
+        for (int x = 0; x < kernelWidth; ++x) {
+            if (std::abs(columnWeights[y] * rowWeights[x] - at(x, y)) > separableTolerance * std::abs(pivotWeight)) {
+                return false;
+            }
+        }
+    }
+
+    row.resize(kernelWidth);
+    column.resize(kernelHeight);
+
+    for (int x = 0; x < kernelWidth; ++x) {
+        row[x] = static_cast<float>(rowWeights[x] / rowSum);
+    }
+
+    for (int y = 0; y < kernelHeight; ++y) {
+        column[y] = static_cast<float>(columnWeights[y] * rowSum);
+    }
+
+    return true;
+}
+
+///
+/// \brief Convolution::convolve - Функция сворачивает изображение с ядром.
+/// Если сумма весов не равна 1 (контуры), альфа канал не сворачивается и берется из исходного пикселя.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param kernel - Ядро.
+/// \param border - Чем продолжается изображение за краем.
+/// \return Новое изображение в том же формате.
+///
+QImage Convolution::convolve(const QImage& image, const Kernel& kernel, const Border border)
+{
+    if (image.isNull() || kernel.isNull()) {
+        return image;
+    }
+
+    const QImage::Format format = image.format();
+    const QImage source = workingImage(image);
+    QImage result = filter(source, kernel, border);
+
+    if (result.isNull()) {
+        return QImage();
+    }
+
+    /* У изображения без альфы она всегда непрозрачна, даже если край прозрачный */
+    finishRows(source, result, std::abs(kernel.sum() - 1.0) > sumTolerance || !image.hasAlphaChannel());
+
+    return Tiling::isCancelled() ? QImage() : result.convertToFormat(format);
+}
+
+///
+/// \brief Convolution::unsharpMask - Функция повышает резкость нерезким маскированием: image + amount * (image - gaussian(image)).
+/// Гауссиан разделим, поэтому даже большой радиус считается двумя одномерными проходами.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param sigma - Стандартное отклонение гауссиана в пикселях.
+/// \param amount - Сила резкости.
+/// \param border - Чем продолжается изображение за краем.
+/// \return Новое изображение в том же формате.
+///
+QImage Convolution::unsharpMask(const QImage& image, const double sigma, const double amount, const Border border)
+{
+    if (image.isNull() || sigma <= 0.0) {
+        return image;
+    }
+
+    const QImage::Format format = image.format();
+    const QImage source = workingImage(image);
+    QImage result = filter(source, Kernel::gaussian(sigma), border);
+
+    if (result.isNull()) {
+        return QImage();
+    }
+
+    /* Сила в фиксированной точке с 8 битами дробной части */
+    const int factor = static_cast<int>(std::lround(amount * 256.0));
+
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows resultRows(result);
+
+    Tiling::forEachStripe(result, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            const uchar* original = reinterpret_cast<const uchar*>(sourceRows.constRow(y));
+            uchar* blurred = reinterpret_cast<uchar*>(resultRows.row(y));
+
+            for (int i = 0; i < resultRows.width() * lanesPerPixel; ++i) {
+                const int difference = original[i] - blurred[i];
+
+                blurred[i] = static_cast<uchar>(qBound(0, original[i] + ((difference * factor + 128) >> 8), 255));
+            }
+        }
+    });
+
+    if (Tiling::isCancelled()) {
+        return QImage();
+    }
+
+    /* Маска меняет и альфу на краях прозрачных областей, поэтому альфа берется из исходного пикселя */
+    finishRows(source, result, true);
+
+    return Tiling::isCancelled() ? QImage() : result.convertToFormat(format);
+}
+
+///
+/// \brief Convolution::haloRows - Функция возвращает количество соседних рядов, которые ядро читает сверху и снизу.
+///
+int Convolution::haloRows(const Kernel& kernel)
+{
+    return kernel.height() / 2;
+}
@@ -0,0 +1,417 @@
+#include "include/PhotoProcessing/EditStack.h"
+#include "include/PhotoProcessing/Geometry.h"
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/Pyramid.h"
+#include "include/PhotoProcessing/Resample.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <cstring>
+#include <utility>
+
+namespace {
+using Operation = EditStack::Operation;
+
+///
+/// \brief The Sampling struct - Свернутые повороты и отражения стека.
+/// Пиксель результата (x, y) берется из исходного изображения по координатам (columns[x], rows[y]),
+/// а при transposed - по координатам (rows[y], columns[x]) с переставленными осями: columns задает ряд, rows - столбец.
+///
+struct Sampling {
+    QVector<int> columns;
+    QVector<int> rows;
+    bool transposed = false;
+    bool identity = true;
+};
+
+///
+/// \brief The Scaling struct - Изменение размера участка стека.
+/// Масштабирование бывает только первой операцией участка, поэтому повороты и отражения после него применяются уже к изображению нового размера.
+///
+struct Scaling {
+    QSize size;
+    Resample::Filter filter = Resample::Filter::Area;
+};
+
+///
+/// \brief reversed - Функция возвращает таблицу в обратном порядке.
+///
+QVector<int> reversed(const QVector<int>& map)
+{
+    QVector<int> result(map.size());
+
+    for (int i = 0; i < map.size(); ++i) {
+        result[i] = map[map.size() - 1 - i];
+    }
+
+    return result;
+}
+
+///
+/// \brief isMirrored - Функция проверяет, что таблица без масштабирования идет в обратном порядке.
+///
+bool isMirrored(const QVector<int>& map)
+{
+    return map.size() > 1 && map.first() > map.last();
+}
+
+///
+/// \brief The Stage struct - Поточечная операция, которая применяется к ряду результата.
+///
+struct Stage {
+    Operation::Type type = Operation::Type::Gray;
+    PointOperations::Lut lut;
+    PointOperations::PixelCondition condition = PointOperations::PixelCondition::NotTransparent;
+    PointOperations::HueLut hueLut;
+};
+
+///
+/// \brief isScaling - Функция проверяет, что операция меняет размер изображения.
+///
+bool isScaling(const Operation& operation)
+{
+    return operation.type == Operation::Type::IncreaseScaling || operation.type == Operation::Type::DecreaseScaling;
+}
+
+///
+/// \brief identityMap - Функция возвращает таблицу 0, 1, ..., count - 1.
+///
+QVector<int> identityMap(const int count)
+{
+    QVector<int> map(count);
+
+    for (int i = 0; i < count; ++i) {
+        map[i] = i;
+    }
+
+    return map;
+}
+
+///
+/// \brief compileScaling - Функция возвращает изменение размера участка стека, масштабированием может быть только его первая операция.
+/// \param size - Размер исходного изображения.
+///
+Scaling compileScaling(const QSize& size, const QVector<Operation>& operations)
+{
+    Scaling scaling;
+    scaling.size = EditStack::outputSize(size, operations);
+
+    bool swapAxes = false;
+
+    for (const Operation& operation : operations) {
+        if (isScaling(operation)) {
+            scaling.filter = static_cast<Resample::Filter>(static_cast<int>(operation.value));
+        } else if (operation.type == Operation::Type::Rotate || operation.type == Operation::Type::RotateClockwise) {
+            swapAxes = !swapAxes;
+        }
+    }
+
+    /* Размер результата переводится в оси исходного изображения */
+    if (swapAxes) {
+        scaling.size.transpose();
+    }
+
+    return scaling;
+}
+
+///
+/// \brief compileSampling - Функция сворачивает повороты и отражения в таблицы выборки.
+/// \param size - Размер изображения после масштабирования.
+///
+Sampling compileSampling(const QSize& size, const QVector<Operation>& operations)
+{
+    Sampling sampling;
+    sampling.columns = identityMap(size.width());
+    sampling.rows = identityMap(size.height());
+
+    for (const Operation& operation : operations) {
+        const QVector<int> columns = sampling.columns;
+        const QVector<int> rows = sampling.rows;
+
+        switch (operation.type) {
+        case Operation::Type::RotateClockwise:
+            /* Ряд y результата - это столбец y предыдущего шага, столбец x - его ряд (height - 1 - x) */
+            sampling.columns = reversed(rows);
+            sampling.rows = columns;
+
+            sampling.transposed = !sampling.transposed;
+            break;
+        case Operation::Type::Rotate180:
+            sampling.columns = reversed(columns);
+            sampling.rows = reversed(rows);
+            break;
+        case Operation::Type::FlipHorizontal:
+            sampling.columns = reversed(columns);
+            break;
+        case Operation::Type::FlipVertical:
+            sampling.rows = reversed(rows);
+            break;
+        case Operation::Type::Rotate:
+            /* Ряд y результата - это столбец (width - 1 - y) предыдущего шага, столбец x - его ряд x */
+            sampling.columns = rows;
+            sampling.rows.resize(columns.size());
+
+            for (int y = 0; y < sampling.rows.size(); ++y) {
+                sampling.rows[y] = columns[columns.size() - 1 - y];
+            }
+
+            sampling.transposed = !sampling.transposed;
+            break;
+        default:
+            continue;
+        }
+
+        sampling.identity = false;
+    }
+
+    return sampling;
+}
+
+///
+/// \brief isLutStage - Функция проверяет, что стадия применяет таблицу Lut.
+///
+bool isLutStage(const Operation::Type type)
+{
+    return type == Operation::Type::Brightness || type == Operation::Type::Contrast || type == Operation::Type::Levels;
+}
+
+///
+/// \brief compileStages - Функция собирает поточечные операции в список стадий.
+/// Соседние таблицы с условием NotTransparent объединяются в одну: альфа ими не меняется, поэтому условие второй таблицы не зависит от первой.
+///
+QVector<Stage> compileStages(const QVector<Operation>& operations)
+{
+    QVector<Stage> stages;
+
+    for (const Operation& operation : operations) {
+        Stage stage;
+        stage.type = operation.type;
+
+        switch (operation.type) {
+        case Operation::Type::Gray:
+        case Operation::Type::Sepia:
+            break;
+        case Operation::Type::Hue:
+            stage.hueLut = PointOperations::hueLut(static_cast<quint8>(operation.value));
+            break;
+        case Operation::Type::Brightness:
+            stage.lut = PointOperations::brightnessLut(operation.value);
+            stage.condition = PointOperations::PixelCondition::AllChannelsNonZero;
+            break;
+        case Operation::Type::Contrast:
+            stage.lut = PointOperations::contrastLut(static_cast<qint8>(operation.value));
+            stage.condition = PointOperations::PixelCondition::NotTransparent;
+            break;
+        case Operation::Type::Levels:
+            stage.lut = PointOperations::levelsLut(operation.levels);
+            stage.condition = PointOperations::PixelCondition::NotTransparent;
+            break;
+        default:
+            continue;
+        }
+
+        const bool isLut = isLutStage(stage.type);
+
+        if (isLut && !stages.isEmpty() && stage.condition == PointOperations::PixelCondition::NotTransparent) {
+            Stage& previous = stages.last();
+
+            if (isLutStage(previous.type) && previous.condition == PointOperations::PixelCondition::NotTransparent) {
+                previous.lut = PointOperations::composeLuts(previous.lut, stage.lut);
+
+                continue;
+            }
+        }
+
+        stages.append(stage);
+    }
+
+    return stages;
+}
+
+///
+/// \brief applyStages - Функция применяет стадии к ряду, пока он находится в кэше.
+///
+void applyStages(QRgb* row, const int width, const QVector<Stage>& stages)
+{
+    for (const Stage& stage : stages) {
+        switch (stage.type) {
+        case Operation::Type::Gray:
+            PointOperations::grayRow(row, width);
+            break;
+        case Operation::Type::Sepia:
+            PointOperations::sepiaRow(row, width);
+            break;
+        case Operation::Type::Hue:
+            PointOperations::hueRow(row, width, stage.hueLut);
+            break;
+        default:
+            PointOperations::lutRow(row, width, stage.lut, stage.condition);
+            break;
+        }
+    }
+}
+}
+
+///
+/// \brief EditStack::isGeometry - Функция проверяет, что операция переставляет или масштабирует пиксели, а не меняет их цвет.
+///
+bool EditStack::isGeometry(const Operation& operation)
+{
+    using Type = Operation::Type;
+
+    return operation.type == Type::Rotate || operation.type == Type::RotateClockwise || operation.type == Type::Rotate180
+        || operation.type == Type::FlipHorizontal || operation.type == Type::FlipVertical || operation.type == Type::IncreaseScaling
+        || operation.type == Type::DecreaseScaling;
+}
+
+///
+/// \brief EditStack::isPointwise - Функция проверяет, что в стеке только поточечные операции: стек можно считать по любому прямоугольнику изображения.
+/// \param operations - Операции стека.
+///
+bool EditStack::isPointwise(const QVector<Operation>& operations)
+{
+    for (const Operation& operation : operations) {
+        if (isGeometry(operation)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///
+/// \brief EditStack::outputSize - Функция возвращает размер результата стека.
+/// \param size - Размер исходного изображения.
+/// \param operations - Операции стека.
+///
+QSize EditStack::outputSize(const QSize& size, const QVector<Operation>& operations)
+{
+    QSize result = size;
+
+    for (const Operation& operation : operations) {
+        if (operation.type == Operation::Type::IncreaseScaling) {
+            result = QSize(result.width() * 2, result.height() * 2);
+        } else if (operation.type == Operation::Type::DecreaseScaling) {
+            result = QSize(result.width() / 2, result.height() / 2);
+        } else if (operation.type == Operation::Type::Rotate || operation.type == Operation::Type::RotateClockwise) {
+            result = QSize(result.height(), result.width());
+        }
+    }
+
+    return result;
+}
+
+///
+/// \brief EditStack::render - Функция считает стек правок: один проход на каждое масштабирование и на операции до первого из них.
+/// Результат совпадает с последовательным применением операций.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param operations - Операции стека.
+/// \return Новое изображение. Если операций нет, возвращается исходное изображение без копирования.
+///
+QImage EditStack::render(const QImage& image, const QVector<Operation>& operations)
+{
+    if (image.isNull() || operations.isEmpty()) {
+        return image;
+    }
+
+    /* Фильтр не перестановочен с поточечными операциями и с другим фильтром: каждое масштабирование начинает новый участок */
+    for (int i = 1; i < operations.size(); ++i) {
+        if (isScaling(operations.at(i))) {
+            return render(render(image, operations.mid(0, i)), operations.mid(i));
+        }
+    }
+
+    const Scaling scaling = compileScaling(image.size(), operations);
+
+    /* Масштабирование - первая операция участка, поворотам и поточечным операциям после уменьшения достается меньшее изображение */
+    QImage resized = Resample::resize(image, scaling.size, scaling.filter);
+
+    if (resized.isNull()) {
+        return resized;
+    }
+
+    const bool ownsPixels = (scaling.size != image.size());
+
+    const Sampling sampling = compileSampling(resized.size(), operations);
+    const QVector<Stage> stages = compileStages(operations);
+
+    /* Поворот - это транспонирование с отражением, его считает блочное ядро. Новое изображение после изменения размера меняется на месте */
+    if (sampling.transposed || (sampling.identity && ownsPixels)) {
+        QImage result = sampling.transposed ? Geometry::transpose(resized, isMirrored(sampling.columns), isMirrored(sampling.rows)) : std::move(resized);
+
+        if (!stages.isEmpty()) {
+            Tiling::forEachRow(result, [&stages](QRgb* row, const int width) {
+                applyStages(row, width, stages);
+            });
+        }
+
+        return result;
+    }
+
+    const QImage& source = resized;
+
+    QImage result(sampling.columns.size(), sampling.rows.size(), source.format());
+
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows resultRows(result);
+
+    Tiling::forEachStripe(result, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            QRgb* row = resultRows.row(y);
+
+            if (sampling.identity) {
+                std::memcpy(row, sourceRows.constRow(y), resultRows.width() * sizeof(QRgb));
+            } else {
+                const QRgb* sourceRow = sourceRows.constRow(sampling.rows[y]);
+
+                for (int x = 0; x < resultRows.width(); ++x) {
+                    row[x] = sourceRow[sampling.columns[x]];
+                }
+            }
+
+            applyStages(row, resultRows.width(), stages);
+        }
+    });
+
+    return result;
+}
+
+///
+/// \brief EditStack::renderView - Функция считает стек правок для экрана по наименьшему уровню пирамиды, которого хватает для target.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param levels - Уровни пирамиды изображения (Pyramid::build()).
+/// \param operations - Операции стека.
+/// \param target - Размер области, в которую вписывается результат на экране.
+///
+QImage EditStack::renderView(const QImage& image, const QVector<QImage>& levels, const QVector<Operation>& operations, const QSize& target)
+{
+    if (image.isNull() || target.isEmpty()) {
+        return render(image, operations);
+    }
+
+    /* Переводим размер на экране в размер исходного изображения: во сколько раз стек меняет масштаб и переставляет ли оси */
+    QSize required = outputSize(image.size(), operations).scaled(target, Qt::KeepAspectRatio);
+    int scaleShift = 0;
+    bool swapAxes = false;
+
+    for (const Operation& operation : operations) {
+        if (operation.type == Operation::Type::IncreaseScaling) {
+            ++scaleShift;
+        } else if (operation.type == Operation::Type::DecreaseScaling) {
+            --scaleShift;
+        } else if (operation.type == Operation::Type::Rotate || operation.type == Operation::Type::RotateClockwise) {
+            swapAxes = !swapAxes;
+        }
+    }
+
+    if (swapAxes) {
+        required.transpose();
+    }
+
+    if (scaleShift > 0) {
+        required = QSize(qMax(1, required.width() >> scaleShift), qMax(1, required.height() >> scaleShift));
+    } else if (scaleShift < 0) {
+        required = QSize(required.width() << -scaleShift, required.height() << -scaleShift);
+    }
+
+    return render(Pyramid::level(image, levels, required), operations);
+}
@@ -0,0 +1,323 @@
+#include "include/PhotoProcessing/Exporter.h"
+#include "include/PhotoProcessing/Trace.h"
+
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QSaveFile>
+#include <QtConcurrent>
+
+namespace {
+/* Доля записи, которая приходится на расчет стека правок, остальное - кодирование */
+constexpr qreal renderShare = 0.5;
+
+///
+/// \brief The CancellableDevice class - Передает запись в файл и прерывает ее, когда запрос отменен.
+/// Кодировщик получает ошибку записи и останавливается, не дописывая файл.
+///
+class CancellableDevice : public QIODevice {
+public:
+    CancellableDevice(QIODevice* target, const Tiling::CancellationToken& token)
+        : target { target }
+        , token { token }
+    {
+    }
+
+    /* Кодировщики, которые дописывают заголовки и смещения (TIFF), переходят назад: позиция должна двигаться в самом файле */
+    bool isSequential() const override
+    {
+        return target->isSequential();
+    }
+
+    bool seek(qint64 position) override
+    {
+        return target->seek(position) && QIODevice::seek(position);
+    }
+
+    qint64 pos() const override
+    {
+        return target->pos();
+    }
+
+    qint64 size() const override
+    {
+        return target->size();
+    }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+
+        return -1;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize) override
+    {
+        if (token.isCancelled()) {
+            return -1;
+        }
+
+        return target->write(data, maxSize);
+    }
+
+private:
+    QIODevice* target;
+    Tiling::CancellationToken token;
+};
+
+///
+/// \brief encoderFormat - Функция возвращает формат кодировщика: из параметров или из расширения файла.
+///
+QString encoderFormat(const QString& filePath, const Exporter::Options& options)
+{
+    return options.format.isEmpty() ? QFileInfo(filePath).suffix().toLower() : options.format.toLower();
+}
+
+///
+/// \brief unsupportedFormatError - Функция возвращает описание ошибки, если формат нельзя записать.
+///
+QString unsupportedFormatError(const QString& format)
+{
+    if (QImageWriter::supportedImageFormats().contains(format.toLatin1())) {
+        return QString();
+    }
+
+    return Exporter::tr("Формат \"%1\" не поддерживается").arg(format);
+}
+}
+
+Exporter::Exporter(QObject* parent)
+    : QObject { parent }
+    , generation { QSharedPointer<QAtomicInteger<quint64>>::create(0) }
+{
+}
+
+///
+/// \brief Exporter::~Exporter - Деструктор отменяет запись и ждет ее остановки, так как она ссылается на объект.
+///
+Exporter::~Exporter()
+{
+    cancel();
+
+    future.waitForFinished();
+}
+
+///
+/// \brief Exporter::start - Функция запускает запись. Выполняемая запись отменяется, новая начнется после ее остановки.
+/// \param filePath - Путь файла.
+/// \param image - Материализованное изображение ревизии.
+/// \param operations - Ленивые операции поверх него.
+/// \param options - Параметры кодировщика.
+///
+void Exporter::start(const QString& filePath, const QImage& image, const QVector<EditStack::Operation>& operations, const Options& options)
+{
+    const Request request { filePath, image, operations, options, generation->fetchAndAddOrdered(1) + 1 };
+
+    if (running) {
+        pending = request;
+    } else {
+        launch(request);
+    }
+}
+
+///
+/// \brief Exporter::cancel - Функция отменяет выполняемую и ожидающую запись.
+///
+void Exporter::cancel()
+{
+    generation->fetchAndAddOrdered(1);
+
+    pending.reset();
+}
+
+///
+/// \brief Exporter::isRunning - Функция проверяет, идет ли запись.
+///
+bool Exporter::isRunning() const
+{
+    return running;
+}
+
+///
+/// \brief Exporter::progress - Функция возвращает долю выполненной записи от 0.0 до 1.0.
+///
+qreal Exporter::progress() const
+{
+    return currentProgress;
+}
+
+///
+/// \brief Exporter::supportedFormats - Функция возвращает форматы, которые можно записать.
+///
+QStringList Exporter::supportedFormats()
+{
+    QStringList formats;
+
+    for (const QByteArray& format : QImageWriter::supportedImageFormats()) {
+        formats.append(QString::fromLatin1(format));
+    }
+
+    return formats;
+}
+
+///
+/// \brief Exporter::encode - Функция кодирует изображение и записывает файл через QSaveFile. Вызывается из любого потока.
+/// \param image - Готовое изображение.
+/// \param filePath - Путь файла.
+/// \param options - Параметры кодировщика.
+/// \param token - Признак отмены: кодирование прерывается на следующей записи в файл, существующий файл не изменяется.
+/// \return Пустая строка, если файл записан или запись отменена, иначе описание ошибки.
+///
+QString Exporter::encode(const QImage& image, const QString& filePath, const Options& options, const Tiling::CancellationToken& token)
+{
+    const QString format = encoderFormat(filePath, options);
+    const QString formatError = unsupportedFormatError(format);
+
+    if (!formatError.isEmpty()) {
+        return formatError;
+    }
+
+    const Trace::Scope trace("encode", "io");
+
+    QSaveFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly)) {
+        return file.errorString();
+    }
+
+    CancellableDevice device(&file, token);
+    device.open(QIODevice::WriteOnly);
+
+    QImageWriter writer(&device, format.toLatin1());
+
+    if (options.quality >= 0) {
+        writer.setQuality(qBound(0, options.quality, 100));
+    }
+
+    if (options.compression >= 0) {
+        writer.setCompression(options.compression);
+    }
+
+    if (!writer.write(image)) {
+        file.cancelWriting();
+
+        return token.isCancelled() ? QString() : writer.errorString();
+    }
+
+    if (token.isCancelled()) {
+        file.cancelWriting();
+
+        return QString();
+    }
+
+    /* Файл заменяется только после успешного кодирования */
+    if (!file.commit()) {
+        return file.errorString();
+    }
+
+    return QString();
+}
+
+///
+/// \brief Exporter::write - Функция считает стек правок и кодирует результат. Выполняется в рабочем потоке.
+/// \param request - Запрос.
+/// \param token - Признак отмены запроса.
+///
+Exporter::Result Exporter::write(const Request& request, const Tiling::CancellationToken& token)
+{
+    /* Неподдерживаемый формат проверяется до расчета стека */
+    const QString formatError = unsupportedFormatError(encoderFormat(request.filePath, request.options));
+
+    if (!formatError.isEmpty()) {
+        return { false, formatError };
+    }
+
+    QImage image;
+
+    {
+        /* Полосы стека пропускаются, как только запрос отменен */
+        const Tiling::CancellationScope scope(token);
+        const Trace::Scope trace("render", "export");
+
+        image = EditStack::render(request.image, request.operations);
+    }
+
+    if (token.isCancelled()) {
+        return {};
+    }
+
+    reportProgress(request.generation, renderShare);
+
+    const QString error = encode(image, request.filePath, request.options, token);
+
+    if (token.isCancelled() || !error.isEmpty()) {
+        return { false, error };
+    }
+
+    reportProgress(request.generation, 1.0);
+
+    return { true, QString() };
+}
+
+///
+/// \brief Exporter::launch - Функция запускает запрос в рабочем потоке.
+///
+void Exporter::launch(const Request& request)
+{
+    running = true;
+    currentProgress = 0.0;
+
+    emit runningChanged();
+    emit progressChanged();
+
+    const Tiling::CancellationToken token(generation, request.generation);
+
+    future = QtConcurrent::run([this, request, token]() {
+        const Result result = token.isCancelled() ? Result() : write(request, token);
+
+        QMetaObject::invokeMethod(
+            this, [this, request, result]() {
+                finish(request, result);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+///
+/// \brief Exporter::finish - Функция обрабатывает завершение записи в главном потоке и запускает ожидающий запрос.
+///
+void Exporter::finish(const Request& request, const Result& result)
+{
+    running = false;
+
+    /* Об отмененной записи не сообщается */
+    if (request.generation == generation->loadAcquire()) {
+        emit finished(result.success, request.filePath, result.error);
+    }
+
+    if (pending.has_value()) {
+        const Request next = *pending;
+        pending.reset();
+
+        launch(next);
+    } else {
+        emit runningChanged();
+    }
+}
+
+///
+/// \brief Exporter::reportProgress - Функция передает долю выполненной записи в главный поток, если запрос не устарел.
+///
+void Exporter::reportProgress(const quint64 requestGeneration, const qreal value)
+{
+    QMetaObject::invokeMethod(
+        this, [this, requestGeneration, value]() {
+            if (requestGeneration == generation->loadAcquire()) {
+                currentProgress = value;
+
+                emit progressChanged();
+            }
+        },
+        Qt::QueuedConnection);
+}
@@ -0,0 +1,276 @@
+#include "include/PhotoProcessing/Geometry.h"
+#include "include/PhotoProcessing/Simd.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <algorithm>
+
+namespace {
+/* Сторона блока: 64 ряда по 64 пикселя чтения и записи вместе занимают 32 КБ и помещаются в L1/L2 */
+constexpr int blockSize = 64;
+
+///
+/// \brief The Transpose struct - Отображение пикселей результата на исходное изображение.
+///
+struct Transpose {
+    int sourceWidth = 0;
+    int sourceHeight = 0;
+    bool mirrorColumns = false;
+    bool mirrorRows = false;
+
+    /* Ряд исходного изображения для столбца результата x */
+    [[nodiscard]] inline int sourceRow(const int x) const
+    {
+        return mirrorColumns ? sourceHeight - 1 - x : x;
+    }
+
+    /* Столбец исходного изображения для ряда результата y */
+    [[nodiscard]] inline int sourceColumn(const int y) const
+    {
+        return mirrorRows ? sourceWidth - 1 - y : y;
+    }
+};
+
+///
+/// \brief transposeScalar - Функция транспонирует прямоугольник результата [x0, x1) x [y0, y1) попиксельно.
+///
+void transposeScalar(const Tiling::ImageRows& source, const Tiling::ImageRows& result, const Transpose& transpose, const int x0, const int x1, const int y0, const int y1)
+{
+    for (int y = y0; y < y1; ++y) {
+        QRgb* row = result.row(y);
+        const int column = transpose.sourceColumn(y);
+
+        for (int x = x0; x < x1; ++x) {
+            row[x] = source.constRow(transpose.sourceRow(x))[column];
+        }
+    }
+}
+
+#if defined(PHOTOPROCESSING_SSE2)
+///
+/// \brief reverse - Функция переставляет 4 пикселя в обратном порядке.
+///
+inline __m128i reverse(const __m128i pixels)
+{
+    return _mm_shuffle_epi32(pixels, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+///
+/// \brief transposeBlockSse2 - Функция транспонирует блок результата квадратами 4x4 в регистрах.
+///
+void transposeBlockSse2(const Tiling::ImageRows& source, const Tiling::ImageRows& result, const Transpose& transpose, const int x0, const int x1, const int y0, const int y1)
+{
+    int y = y0;
+
+    for (; y + 4 <= y1; y += 4) {
+        /* Четыре соседних столбца исходного изображения для рядов y..y+3, при отражении они идут в обратном порядке */
+        const int column = transpose.mirrorRows ? transpose.sourceColumn(y + 3) : transpose.sourceColumn(y);
+
+        int x = x0;
+
+        for (; x + 4 <= x1; x += 4) {
+            __m128i rows[4];
+
+            for (int i = 0; i < 4; ++i) {
+                rows[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.constRow(transpose.sourceRow(x + i)) + column));
+
+                if (transpose.mirrorRows) {
+                    rows[i] = reverse(rows[i]);
+                }
+            }
+
+            /* rows[i][j] - пиксель результата (x + i, y + j) */
+            const __m128i low01 = _mm_unpacklo_epi32(rows[0], rows[1]);
+            const __m128i low23 = _mm_unpacklo_epi32(rows[2], rows[3]);
+            const __m128i high01 = _mm_unpackhi_epi32(rows[0], rows[1]);
+            const __m128i high23 = _mm_unpackhi_epi32(rows[2], rows[3]);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result.row(y) + x), _mm_unpacklo_epi64(low01, low23));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result.row(y + 1) + x), _mm_unpackhi_epi64(low01, low23));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result.row(y + 2) + x), _mm_unpacklo_epi64(high01, high23));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(result.row(y + 3) + x), _mm_unpackhi_epi64(high01, high23));
+        }
+
+        transposeScalar(source, result, transpose, x, x1, y, y + 4);
+    }
+
+    transposeScalar(source, result, transpose, x0, x1, y, y1);
+}
+#endif
+
+///
+/// \brief transposeBlock - Функция транспонирует блок результата [x0, x1) x [y0, y1).
+///
+void transposeBlock(const Tiling::ImageRows& source, const Tiling::ImageRows& result, const Transpose& transpose, const int x0, const int x1, const int y0, const int y1)
+{
+#if defined(PHOTOPROCESSING_SSE2)
+    transposeBlockSse2(source, result, transpose, x0, x1, y0, y1);
+#else
+    transposeScalar(source, result, transpose, x0, x1, y0, y1);
+#endif
+}
+
+///
+/// \brief reverseRow - Функция переставляет пиксели ряда в обратном порядке.
+///
+void reverseRow(QRgb* row, const int width)
+{
+    int left = 0;
+    int right = width;
+
+#if defined(PHOTOPROCESSING_SSE2)
+    for (; right - left >= 8; left += 4, right -= 4) {
+        const __m128i leftPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + left));
+        const __m128i rightPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + right - 4));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + left), reverse(rightPixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + right - 4), reverse(leftPixels));
+    }
+#endif
+
+    std::reverse(row + left, row + right);
+}
+
+///
+/// \brief reverseSwapRows - Функция меняет местами два разных ряда, переставляя пиксели каждого в обратном порядке.
+///
+void reverseSwapRows(QRgb* first, QRgb* second, const int width)
+{
+    int x = 0;
+
+#if defined(PHOTOPROCESSING_SSE2)
+    for (; x + 4 <= width; x += 4) {
+        QRgb* mirrored = second + width - 4 - x;
+
+        const __m128i firstPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + x));
+        const __m128i secondPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mirrored));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(first + x), reverse(secondPixels));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mirrored), reverse(firstPixels));
+    }
+#endif
+
+    for (; x < width; ++x) {
+        std::swap(first[x], second[width - 1 - x]);
+    }
+}
+
+///
+/// \brief forEachRowPair - Функция выполняет function(top, bottom) для пар рядов y и h - 1 - y параллельно.
+/// Для среднего ряда изображения нечетной высоты top и bottom совпадают.
+///
+template <typename Function>
+void forEachRowPair(QImage& image, Function function)
+{
+    const Tiling::ImageRows rows(image);
+    const int pairs = (rows.height() + 1) / 2;
+
+    Tiling::forEachRange(pairs, Tiling::stripeHeight(pairs, image.bytesPerLine() * 2), [&](const int first, const int last) {
+        for (int y = first; y < last; ++y) {
+            function(rows.row(y), rows.row(rows.height() - 1 - y));
+        }
+    });
+}
+}
+
+///
+/// \brief Geometry::transpose - Функция транспонирует изображение с отражением: result(x, y) = image(mirrorRows ? w - 1 - y : y, mirrorColumns ? h - 1 - x : x).
+/// \param image - 32-битное изображение размером w x h.
+/// \param mirrorColumns - Отразить столбцы результата.
+/// \param mirrorRows - Отразить ряды результата.
+/// \return Изображение размером h x w.
+///
+QImage Geometry::transpose(const QImage& image, const bool mirrorColumns, const bool mirrorRows)
+{
+    if (image.isNull()) {
+        return image;
+    }
+
+    QImage result(image.height(), image.width(), image.format());
+
+    const Transpose transpose { image.width(), image.height(), mirrorColumns, mirrorRows };
+
+    const Tiling::ImageRows sourceRows(image);
+    const Tiling::ImageRows resultRows(result);
+
+    /* Каждая порция - полоса из blockSize рядов результата, внутри нее блоки идут по столбцам */
+    Tiling::forEachRange(resultRows.height(), blockSize, [&](const int firstRow, const int lastRow) {
+        for (int x = 0; x < resultRows.width(); x += blockSize) {
+            transposeBlock(sourceRows, resultRows, transpose, x, qMin(x + blockSize, resultRows.width()), firstRow, lastRow);
+        }
+    });
+
+    return result;
+}
+
+///
+/// \brief Geometry::rotate90 - Функция поворачивает изображение на 90 градусов по часовой стрелке.
+/// \param image - 32-битное изображение.
+///
+QImage Geometry::rotate90(const QImage& image)
+{
+    return transpose(image, true, false);
+}
+
+///
+/// \brief Geometry::rotate270 - Функция поворачивает изображение на 90 градусов против часовой стрелки.
+/// \param image - 32-битное изображение.
+///
+QImage Geometry::rotate270(const QImage& image)
+{
+    return transpose(image, false, true);
+}
+
+///
+/// \brief Geometry::rotate180 - Функция поворачивает изображение на 180 градусов на месте.
+/// \param image - 32-битное изображение.
+///
+void Geometry::rotate180(QImage& image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    const int width = image.width();
+
+    forEachRowPair(image, [width](QRgb* top, QRgb* bottom) {
+        if (top == bottom) {
+            reverseRow(top, width);
+        } else {
+            reverseSwapRows(top, bottom, width);
+        }
+    });
+}
+
+///
+/// \brief Geometry::flipHorizontal - Функция отражает изображение слева направо на месте.
+/// \param image - 32-битное изображение.
+///
+void Geometry::flipHorizontal(QImage& image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    Tiling::forEachRow(image, [](QRgb* row, const int width) {
+        reverseRow(row, width);
+    });
+}
+
+///
+/// \brief Geometry::flipVertical - Функция отражает изображение сверху вниз на месте.
+/// \param image - 32-битное изображение.
+///
+void Geometry::flipVertical(QImage& image)
+{
+    if (image.isNull()) {
+        return;
+    }
+
+    const int width = image.width();
+
+    forEachRowPair(image, [width](QRgb* top, QRgb* bottom) {
+        if (top != bottom) {
+            std::swap_ranges(top, top + width, bottom);
+        }
+    });
+}
@@ -0,0 +1,270 @@
+#include "include/PhotoProcessing/Histogram.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <cmath>
+
+namespace {
+/* Тайл - 64К пикселей, порции по несколько тайлов окупают запуск задачи */
+constexpr int tilesPerTask = 4;
+
+///
+/// \brief channelBins - Функция возвращает гистограмму канала.
+///
+const std::array<qint64, 256>& channelBins(const Histogram::Statistics& statistics, const Histogram::Channel channel)
+{
+    return statistics.bins[static_cast<int>(channel)];
+}
+}
+
+///
+/// \brief Histogram::Statistics::merge - Функция добавляет гистограммы other к этим.
+///
+void Histogram::Statistics::merge(const Statistics& other)
+{
+    for (int channel = 0; channel < channelCount; ++channel) {
+        for (int level = 0; level < 256; ++level) {
+            bins[channel][level] += other.bins[channel][level];
+        }
+    }
+
+    count += other.count;
+}
+
+///
+/// \brief Histogram::Statistics::minimum - Функция возвращает наименьший уровень канала, 0 для пустой гистограммы.
+///
+int Histogram::Statistics::minimum(const Channel channel) const
+{
+    const std::array<qint64, 256>& levels = channelBins(*this, channel);
+
+    for (int level = 0; level < 256; ++level) {
+        if (levels[level] != 0) {
+            return level;
+        }
+    }
+
+    return 0;
+}
+
+///
+/// \brief Histogram::Statistics::maximum - Функция возвращает наибольший уровень канала, 0 для пустой гистограммы.
+///
+int Histogram::Statistics::maximum(const Channel channel) const
+{
+    const std::array<qint64, 256>& levels = channelBins(*this, channel);
+
+    for (int level = 255; level >= 0; --level) {
+        if (levels[level] != 0) {
+            return level;
+        }
+    }
+
+    return 0;
+}
+
+///
+/// \brief Histogram::Statistics::percentile - Функция возвращает наименьший уровень канала, не выше которого лежит доля fraction пикселей.
+/// \param channel - Канал.
+/// \param fraction - Доля от 0.0 до 1.0.
+///
+int Histogram::Statistics::percentile(const Channel channel, const qreal fraction) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    const std::array<qint64, 256>& levels = channelBins(*this, channel);
+
+    /* Нужен хотя бы один пиксель, иначе нулевая доля попадает на уровень 0 даже без таких пикселей */
+    const qint64 target = qBound<qint64>(1, static_cast<qint64>(std::ceil(qBound(0.0, fraction, 1.0) * count)), count);
+    qint64 accumulated = 0;
+
+    for (int level = 0; level < 256; ++level) {
+        accumulated += levels[level];
+
+        if (accumulated >= target) {
+            return level;
+        }
+    }
+
+    return 255;
+}
+
+///
+/// \brief Histogram::Statistics::mean - Функция возвращает средний уровень канала.
+///
+qreal Histogram::Statistics::mean(const Channel channel) const
+{
+    if (count == 0) {
+        return 0.0;
+    }
+
+    const std::array<qint64, 256>& levels = channelBins(*this, channel);
+    qreal sum = 0.0;
+
+    for (int level = 0; level < 256; ++level) {
+        sum += static_cast<qreal>(levels[level]) * level;
+    }
+
+    return sum / count;
+}
+
+///
+/// \brief Histogram::TileCache::compute - Функция считает гистограммы изображения по тайлам, пересчитывая только измененные тайлы.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param tiles - Тайлы image.
+///
+Histogram::Statistics Histogram::TileCache::compute(const QImage& image, const TiledImage& tiles)
+{
+    QMutexLocker locker(&mutex);
+
+    QVector<Statistics> tileStatistics(tiles.tileCount());
+    QVector<int> changed;
+
+    for (int index = 0; index < tileStatistics.size(); ++index) {
+        if (tiles.isTileSharedWith(index, cachedTiles)) {
+            tileStatistics[index] = cachedStatistics.at(index);
+        } else {
+            changed.append(index);
+        }
+    }
+
+    Statistics* results = tileStatistics.data();
+
+    Tiling::forEachRange(changed.size(), tilesPerTask, [&](const int first, const int last) {
+        for (int i = first; i < last; ++i) {
+            results[changed[i]] = Histogram::compute(image, tiles.tileRect(changed[i]));
+        }
+    });
+
+    /* Часть тайлов отмененного расчета пропущена, такой результат не запоминается */
+    if (Tiling::isCancelled()) {
+        return Statistics();
+    }
+
+    cachedTiles = tiles;
+    cachedStatistics = tileStatistics;
+
+    Statistics statistics;
+
+    for (const Statistics& tile : tileStatistics) {
+        statistics.merge(tile);
+    }
+
+    return statistics;
+}
+
+///
+/// \brief Histogram::compute - Функция считает гистограммы изображения за один параллельный проход.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+///
+Histogram::Statistics Histogram::compute(const QImage& image)
+{
+    if (image.isNull()) {
+        return Statistics();
+    }
+
+    /* Каждая полоса пишет только свою гистограмму, поэтому потокам не нужны ни мьютекс, ни атомарные счетчики */
+    const int rowsPerTask = Tiling::stripeHeight(image.height(), image.bytesPerLine());
+    QVector<Statistics> partial((image.height() + rowsPerTask - 1) / rowsPerTask);
+    Statistics* results = partial.data();
+
+    Tiling::forEachRange(image.height(), rowsPerTask, [&](const int first, const int last) {
+        results[first / rowsPerTask] = compute(image, QRect(0, first, image.width(), last - first));
+    });
+
+    Statistics statistics;
+
+    for (const Statistics& stripe : partial) {
+        statistics.merge(stripe);
+    }
+
+    return statistics;
+}
+
+///
+/// \brief Histogram::compute - Функция считает гистограммы прямоугольника изображения в текущем потоке.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param rect - Прямоугольник внутри изображения.
+///
+Histogram::Statistics Histogram::compute(const QImage& image, const QRect& rect)
+{
+    Statistics statistics;
+
+    std::array<qint64, 256>& red = statistics.bins[static_cast<int>(Channel::Red)];
+    std::array<qint64, 256>& green = statistics.bins[static_cast<int>(Channel::Green)];
+    std::array<qint64, 256>& blue = statistics.bins[static_cast<int>(Channel::Blue)];
+    std::array<qint64, 256>& luma = statistics.bins[static_cast<int>(Channel::Luma)];
+
+    const Tiling::ImageRows rows(image);
+    const QRect bounded = rect.intersected(image.rect());
+
+    for (int y = bounded.top(); y <= bounded.bottom(); ++y) {
+        const QRgb* row = rows.constRow(y);
+
+        for (int x = bounded.left(); x <= bounded.right(); ++x) {
+            const QRgb pixel = row[x];
+
+            /* Проверяем на прозрачный пиксель */
+            if (qAlpha(pixel) == 0) {
+                continue;
+            }
+
+            const int r = qRed(pixel);
+            const int g = qGreen(pixel);
+            const int b = qBlue(pixel);
+
+            ++red[r];
+            ++green[g];
+            ++blue[b];
+            ++luma[(r * 11 + g * 16 + b * 5) >> 5];
+            ++statistics.count;
+        }
+    }
+
+    return statistics;
+}
+
+///
+/// \brief Histogram::autoLevels - Функция выбирает черную и белую точки каждого канала отдельно: каждый канал растягивается на весь диапазон.
+/// Убирает цветовой оттенок вместе с недостатком контраста.
+/// \param statistics - Гистограммы изображения.
+/// \param clip - Доля самых темных и самых светлых пикселей канала, которые обрезаются.
+///
+PointOperations::Levels Histogram::autoLevels(const Statistics& statistics, const qreal clip)
+{
+    PointOperations::Levels levels;
+
+    if (statistics.count == 0) {
+        return levels;
+    }
+
+    for (int channel = 0; channel < 3; ++channel) {
+        levels.black[channel] = static_cast<quint8>(statistics.percentile(static_cast<Channel>(channel), clip));
+        levels.white[channel] = static_cast<quint8>(statistics.percentile(static_cast<Channel>(channel), 1.0 - clip));
+    }
+
+    return levels;
+}
+
+///
+/// \brief Histogram::autoContrast - Функция выбирает общие черную и белую точки по яркости: все каналы растягиваются одинаково, поэтому цветовой баланс сохраняется.
+/// \param statistics - Гистограммы изображения.
+/// \param clip - Доля самых темных и самых светлых пикселей, которые обрезаются.
+///
+PointOperations::Levels Histogram::autoContrast(const Statistics& statistics, const qreal clip)
+{
+    PointOperations::Levels levels;
+
+    if (statistics.count == 0) {
+        return levels;
+    }
+
+    const quint8 black = static_cast<quint8>(statistics.percentile(Channel::Luma, clip));
+    const quint8 white = static_cast<quint8>(statistics.percentile(Channel::Luma, 1.0 - clip));
+
+    levels.black.fill(black);
+    levels.white.fill(white);
+
+    return levels;
+}
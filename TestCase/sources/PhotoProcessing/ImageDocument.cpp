@@ -0,0 +1,422 @@
+#include "include/PhotoProcessing/ImageDocument.h"
+
+#include <QStringBuilder>
+
+///
+/// \brief ImageDocument::reset - Функция открывает новое изображение и очищает историю.
+/// \param revision - Исходная ревизия. Версия назначается документом.
+/// \return Версия исходного изображения.
+///
+quint64 ImageDocument::reset(Revision revision)
+{
+    QMutexLocker locker(&mutex);
+
+    clearPreview();
+
+    revision.version = ++lastVersion;
+
+    revisions.clear();
+    revisions.append(revision);
+    currentRevision = 0;
+
+    return lastVersion;
+}
+
+///
+/// \brief ImageDocument::restore - Функция возвращает документ к исходному изображению и очищает историю.
+/// \return Версия исходного изображения.
+///
+quint64 ImageDocument::restore()
+{
+    QMutexLocker locker(&mutex);
+
+    clearPreview();
+
+    if (revisions.isEmpty()) {
+        return 0;
+    }
+
+    const Revision previous = revisions.at(currentRevision);
+
+    revisions.resize(1);
+    currentRevision = 0;
+
+    activate(0, previous);
+
+    return revisions.first().version;
+}
+
+///
+/// \brief ImageDocument::addRevision - Функция добавляет новую ревизию после текущей, ревизии для redo удаляются.
+/// \param revision - Новая ревизия. Версия назначается документом.
+/// \return Версия новой ревизии.
+///
+quint64 ImageDocument::addRevision(Revision revision)
+{
+    QMutexLocker locker(&mutex);
+
+    clearPreview();
+
+    revision.version = ++lastVersion;
+
+    const Revision previous = (currentRevision >= 0) ? revisions.at(currentRevision) : Revision();
+
+    revisions.resize(currentRevision + 1);
+    revisions.append(revision);
+    currentRevision = revisions.size() - 1;
+
+    activate(currentRevision, previous);
+
+    return lastVersion;
+}
+
+///
+/// \brief ImageDocument::setPreview - Функция устанавливает изображение предпросмотра поверх текущей ревизии.
+/// \param image - Изображение предпросмотра для экрана, в историю оно не попадает.
+/// \return Версия предпросмотра.
+///
+quint64 ImageDocument::setPreview(const QImage& image)
+{
+    QMutexLocker locker(&mutex);
+
+    preview = {};
+    preview.version = ++lastVersion;
+    preview.view = image;
+
+    return lastVersion;
+}
+
+///
+/// \brief ImageDocument::undo - Функция делает текущей предыдущую ревизию.
+/// \return Возвращает 'true' в случае успеха, в ином случае 'false'.
+///
+bool ImageDocument::undo()
+{
+    QMutexLocker locker(&mutex);
+
+    if (currentRevision <= 0) {
+        return false;
+    }
+
+    clearPreview();
+    --currentRevision;
+
+    activate(currentRevision, revisions.at(currentRevision + 1));
+
+    return true;
+}
+
+///
+/// \brief ImageDocument::redo - Функция делает текущей следующую ревизию.
+/// \return Возвращает 'true' в случае успеха, в ином случае 'false'.
+///
+bool ImageDocument::redo()
+{
+    QMutexLocker locker(&mutex);
+
+    if (currentRevision + 1 >= revisions.size()) {
+        return false;
+    }
+
+    clearPreview();
+    ++currentRevision;
+
+    activate(currentRevision, revisions.at(currentRevision - 1));
+
+    return true;
+}
+
+///
+/// \brief ImageDocument::canUndo - Функция проверяет, есть ли ревизия для undo.
+///
+bool ImageDocument::canUndo() const
+{
+    QMutexLocker locker(&mutex);
+
+    return currentRevision > 0;
+}
+
+///
+/// \brief ImageDocument::canRedo - Функция проверяет, есть ли ревизия для redo.
+///
+bool ImageDocument::canRedo() const
+{
+    QMutexLocker locker(&mutex);
+
+    return currentRevision + 1 < revisions.size();
+}
+
+///
+/// \brief ImageDocument::current - Функция возвращает текущую ревизию без предпросмотра.
+///
+ImageDocument::Revision ImageDocument::current() const
+{
+    QMutexLocker locker(&mutex);
+
+    if (currentRevision < 0) {
+        return {};
+    }
+
+    return revisions.at(currentRevision);
+}
+
+///
+/// \brief ImageDocument::displayed - Функция возвращает то, что видит пользователь: предпросмотр, если он есть, иначе текущую ревизию.
+///
+ImageDocument::Revision ImageDocument::displayed() const
+{
+    QMutexLocker locker(&mutex);
+
+    if (!preview.view.isNull()) {
+        return preview;
+    }
+
+    if (currentRevision < 0) {
+        return {};
+    }
+
+    return revisions.at(currentRevision);
+}
+
+///
+/// \brief ImageDocument::image - Функция ищет изображение для экрана по версии.
+/// \param version - Версия изображения.
+/// \return Найденное изображение или пустое изображение, если версия уже удалена.
+///
+QImage ImageDocument::image(const quint64 version) const
+{
+    QMutexLocker locker(&mutex);
+
+    if (preview.version == version) {
+        return preview.viewImage();
+    }
+
+    for (const Revision& revision : revisions) {
+        if (revision.version == version) {
+            return revision.viewImage();
+        }
+    }
+
+    return {};
+}
+
+///
+/// \brief ImageDocument::setLevels - Функция задает пирамиду всем ревизиям с материализованным изображением base.
+/// \param base - Тайлы материализованного изображения.
+/// \param levels - Уровни пирамиды (Pyramid::build()).
+///
+void ImageDocument::setLevels(const TiledImage& base, const QVector<QImage>& levels)
+{
+    QMutexLocker locker(&mutex);
+
+    for (Revision& revision : revisions) {
+        if (revision.tiles.isSharedWith(base)) {
+            revision.levels = levels;
+        }
+    }
+}
+
+///
+/// \brief ImageDocument::setMemoryBudget - Функция задает бюджет памяти истории: тайлы и пирамиды всех ревизий.
+/// \param bytes - Бюджет в байтах.
+///
+void ImageDocument::setMemoryBudget(const qsizetype bytes)
+{
+    QMutexLocker locker(&mutex);
+
+    memoryBudget = bytes;
+}
+
+///
+/// \brief ImageDocument::memoryUsage - Функция возвращает, сколько байт занимают тайлы и пирамиды всех ревизий.
+///
+qsizetype ImageDocument::memoryUsage() const
+{
+    QMutexLocker locker(&mutex);
+
+    return usage();
+}
+
+///
+/// \brief ImageDocument::compress - Функция сжимает тайлы старых ревизий, пока история не уложится в бюджет. Тайлы текущей ревизии не сжимаются.
+/// Сжатие долгое, поэтому функция вызывается из рабочего потока, мьютекс на время сжатия не удерживается.
+///
+void ImageDocument::compress()
+{
+    TiledImage currentBase;
+    QVector<TiledImage> bases;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (currentRevision < 0 || usage() <= memoryBudget) {
+            return;
+        }
+
+        bases = oldBases(currentBase);
+    }
+
+    /* Копии TiledImage держат тайлы, даже если ревизию удалят во время сжатия */
+    for (const TiledImage& base : bases) {
+        if (base.compress(currentBase) > 0 && memoryUsage() <= memoryBudget) {
+            return;
+        }
+    }
+}
+
+///
+/// \brief ImageDocument::spill - Функция вытесняет тайлы старых ревизий в рабочие файлы, пока история не уложится в бюджет. Тайлы текущей ревизии остаются в памяти.
+/// Запись долгая, поэтому функция вызывается из рабочего потока, мьютекс на время записи не удерживается.
+///
+void ImageDocument::spill()
+{
+    if (!scratchDir.isValid()) {
+        return;
+    }
+
+    TiledImage currentBase;
+    QVector<TiledImage> bases;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (currentRevision < 0 || usage() <= memoryBudget) {
+            return;
+        }
+
+        bases = oldBases(currentBase);
+    }
+
+    for (const TiledImage& base : bases) {
+        const QString filePath = scratchDir.filePath(QString::number(scratchCounter.fetchAndAddRelaxed(1)) % QStringLiteral(".raw"));
+
+        if (base.spill(filePath, currentBase) > 0 && memoryUsage() <= memoryBudget) {
+            return;
+        }
+    }
+}
+
+///
+/// \brief ImageDocument::trim - Функция удаляет пирамиды старых ревизий, а затем сами старые ревизии, пока история не уложится в бюджет.
+/// Исходная и текущая ревизии не удаляются.
+/// \return Возвращает 'true', если история изменилась.
+///
+bool ImageDocument::trim()
+{
+    QMutexLocker locker(&mutex);
+
+    if (currentRevision < 0) {
+        return false;
+    }
+
+    const TiledImage currentBase = revisions.at(currentRevision).tiles;
+
+    /* Пирамида нужна только для предпросмотра и перестраивается при переходе к ревизии */
+    for (int i = 0; i < revisions.size() && usage() > memoryBudget; ++i) {
+        if (!revisions.at(i).tiles.isSharedWith(currentBase) && !revisions.at(i).levels.isEmpty()) {
+            const TiledImage base = revisions.at(i).tiles;
+
+            for (Revision& revision : revisions) {
+                if (revision.tiles.isSharedWith(base)) {
+                    revision.levels.clear();
+                }
+            }
+        }
+    }
+
+    bool changed = false;
+
+    /* Затем удаляются самые старые ревизии после исходной, а за ними самые дальние ревизии для redo */
+    while (currentRevision > 1 && usage() > memoryBudget) {
+        revisions.removeAt(1);
+        --currentRevision;
+
+        changed = true;
+    }
+
+    while (currentRevision + 1 < revisions.size() && usage() > memoryBudget) {
+        revisions.removeLast();
+
+        changed = true;
+    }
+
+    return changed;
+}
+
+///
+/// \brief ImageDocument::clearPreview - Функция удаляет предпросмотр. Вызывается под мьютексом.
+///
+void ImageDocument::clearPreview()
+{
+    preview = {};
+}
+
+///
+/// \brief ImageDocument::activate - Функция делает ревизию текущей: собирает ее изображение из изображения предыдущей текущей ревизии
+/// и отличающихся тайлов и освобождает изображения остальных ревизий. Вызывается под мьютексом.
+/// \param index - Номер новой текущей ревизии.
+/// \param previous - Предыдущая текущая ревизия. Ее изображение переиспользуется, поэтому она передается по значению.
+///
+void ImageDocument::activate(const int index, Revision previous)
+{
+    const TiledImage base = revisions.at(index).tiles;
+    QImage image = revisions.at(index).image;
+
+    if (image.isNull()) {
+        image = std::move(previous.image);
+
+        /* Пока на изображение ссылаются другие ревизии, patch() скопировал бы его целиком вместо записи отличающихся тайлов */
+        for (Revision& revision : revisions) {
+            revision.image = QImage();
+        }
+
+        base.patch(image, previous.tiles);
+    }
+
+    for (int i = 0; i < revisions.size(); ++i) {
+        revisions[i].image = (i == index || revisions.at(i).tiles.isSharedWith(base)) ? image : QImage();
+    }
+}
+
+///
+/// \brief ImageDocument::usage - Функция считает память истории. Вызывается под мьютексом.
+///
+qsizetype ImageDocument::usage() const
+{
+    /* Общие тайлы и общие пирамиды ленивых ревизий считаются один раз */
+    QSet<const void*> counted;
+    qsizetype bytes = 0;
+
+    for (const Revision& revision : revisions) {
+        bytes += revision.tiles.byteCount(counted);
+
+        if (!revision.levels.isEmpty() && !counted.contains(revision.levels.constData())) {
+            counted.insert(revision.levels.constData());
+
+            for (const QImage& level : revision.levels) {
+                bytes += level.sizeInBytes();
+            }
+        }
+    }
+
+    return bytes;
+}
+
+///
+/// \brief ImageDocument::oldBases - Функция возвращает тайлы всех ревизий от старых к новым и тайлы текущей ревизии. Вызывается под мьютексом.
+/// \param currentBase - Тайлы текущей ревизии.
+///
+QVector<TiledImage> ImageDocument::oldBases(TiledImage& currentBase) const
+{
+    currentBase = revisions.at(currentRevision).tiles;
+
+    QVector<TiledImage> bases;
+
+    for (const Revision& revision : revisions) {
+        if (!revision.tiles.isSharedWith(currentBase) && (bases.isEmpty() || !bases.last().isSharedWith(revision.tiles))) {
+            bases.append(revision.tiles);
+        }
+    }
+
+    return bases;
+}
@@ -0,0 +1,145 @@
+#include "include/PhotoProcessing/ImageLoader.h"
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <QFile>
+#include <QIODevice>
+#include <QImageReader>
+
+namespace {
+/* Уменьшенная копия строится, только если декодер уменьшает хотя бы вдвое, иначе быстрее сразу декодировать целиком */
+constexpr int minimumScaleFactor = 2;
+
+///
+/// \brief The ProgressDevice class - Передает чтение файла декодеру, сообщает долю прочитанного и прерывает чтение,
+/// когда операция текущего потока отменена. Декодер получает ошибку чтения и останавливается.
+///
+class ProgressDevice : public QIODevice {
+public:
+    ProgressDevice(QIODevice* source, const std::function<void(qreal)>& progress)
+        : source { source }
+        , progress { progress }
+        , token { Tiling::currentCancellation() }
+    {
+    }
+
+    bool isSequential() const override
+    {
+        return source->isSequential();
+    }
+
+    qint64 size() const override
+    {
+        return source->size();
+    }
+
+    bool seek(qint64 position) override
+    {
+        return QIODevice::seek(position) && source->seek(position);
+    }
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override
+    {
+        if (token.isCancelled()) {
+            return -1;
+        }
+
+        const qint64 read = source->read(data, maxSize);
+
+        if (read > 0 && progress && source->size() > 0) {
+            progress(qMin<qreal>(1.0, static_cast<qreal>(source->pos()) / source->size()));
+        }
+
+        return read;
+    }
+
+    qint64 writeData(const char* data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+
+        return -1;
+    }
+
+private:
+    QIODevice* source;
+    std::function<void(qreal)> progress;
+    Tiling::CancellationToken token;
+};
+}
+
+///
+/// \brief ImageLoader::probe - Функция читает сведения из заголовка файла без декодирования пикселей.
+/// \param filePath - Путь к изображению.
+///
+ImageLoader::Info ImageLoader::probe(const QString& filePath)
+{
+    QImageReader reader(filePath);
+
+    Info info;
+    info.size = reader.size();
+    info.format = reader.imageFormat();
+    info.type = reader.format();
+
+    return info;
+}
+
+///
+/// \brief ImageLoader::decodeScaled - Функция декодирует уменьшенную копию изображения, которая вписывается в target.
+/// \param filePath - Путь к изображению.
+/// \param target - Размер области на экране.
+/// \return Изображение в формате ядер или пустое изображение, если декодер не умеет уменьшать сам или изображение не больше target.
+///
+QImage ImageLoader::decodeScaled(const QString& filePath, const QSize& target)
+{
+    QImageReader reader(filePath);
+    const QSize size = reader.size();
+
+    if (target.isEmpty() || !size.isValid() || !reader.supportsOption(QImageIOHandler::ScaledSize)
+        || (size.width() < target.width() * minimumScaleFactor && size.height() < target.height() * minimumScaleFactor)) {
+        return QImage();
+    }
+
+    /* Для JPEG уменьшение выполняется масштабированием DCT: декодируется только часть коэффициентов */
+    reader.setScaledSize(size.scaled(target, Qt::KeepAspectRatio));
+
+    return PointOperations::normalized(reader.read());
+}
+
+///
+/// \brief ImageLoader::decode - Функция декодирует изображение целиком и приводит его к формату ядер.
+/// \param filePath - Путь к изображению.
+/// \param progress - Обработчик доли прочитанного файла от 0.0 до 1.0, вызывается в потоке декодирования.
+/// \return Изображение в формате ядер или пустое изображение при ошибке и отмене.
+///
+QImage ImageLoader::decode(const QString& filePath, const std::function<void(qreal)>& progress)
+{
+    QFile file(filePath);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    ProgressDevice device(&file, progress);
+    device.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+    /* У устройства нет имени файла, поэтому формат определяется по содержимому */
+    QImageReader reader(&device);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    /* Размер ограничен памятью, а не предупреждением Qt о больших изображениях */
+    reader.setAllocationLimit(0);
+#endif
+
+    const QImage image = reader.read();
+
+    if (image.isNull() || Tiling::isCancelled()) {
+        return QImage();
+    }
+
+    /* Отмененное приведение формата пропускает полосы, такое изображение не возвращается */
+    const QImage normalized = PointOperations::normalized(image);
+
+    return Tiling::isCancelled() ? QImage() : normalized;
+}
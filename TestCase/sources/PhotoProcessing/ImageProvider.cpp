@@ -0,0 +1,36 @@
+#include "include/PhotoProcessing/ImageProvider.h"
+#include "include/PhotoProcessing/Trace.h"
+
+ImageProvider::ImageProvider(const QSharedPointer<ImageDocument>& document)
+    : QQuickImageProvider { QQuickImageProvider::Image }
+    , document { document }
+{
+}
+
+///
+/// \brief ImageProvider::requestImage - Функция возвращает изображение по версии из id.
+/// \param id - Версия изображения.
+/// \param size - Исходный размер изображения.
+/// \param requestedSize - Размер, заданный через sourceSize в qml.
+///
+QImage ImageProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    const Trace::Scope trace("provide", "qml");
+
+    QImage image = document->image(id.toULongLong());
+
+    /* Версия могла быть удалена из истории, пока qml ее запрашивал */
+    if (image.isNull()) {
+        image = document->displayed().viewImage();
+    }
+
+    if (size != nullptr) {
+        *size = image.size();
+    }
+
+    if (requestedSize.width() > 0 && requestedSize.height() > 0 && (image.width() > requestedSize.width() || image.height() > requestedSize.height())) {
+        return image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+
+    return image;
+}
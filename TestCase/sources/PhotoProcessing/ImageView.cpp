@@ -0,0 +1,514 @@
+#include "include/PhotoProcessing/ImageView.h"
+#include "include/PhotoProcessing/TiledImage.h"
+#include "include/PhotoProcessing/Trace.h"
+
+#include <cmath>
+
+#include <QQuickWindow>
+#include <QSGSimpleTextureNode>
+#include <QSet>
+
+namespace {
+/* Наибольший масштаб: пикселей элемента на пиксель изображения */
+constexpr qreal maximumZoom = 32.0;
+
+/* Сторона тайла совпадает с тайлами истории */
+constexpr int tileSize = TiledImage::tileSize;
+
+///
+/// \brief tileKey - Функция возвращает ключ тайла: уровень, ряд и столбец.
+/// \param level - Уровень пирамиды, -1 - изображение для экрана.
+///
+quint64 tileKey(const int level, const int row, const int column)
+{
+    return (static_cast<quint64>(level + 1) << 48) | (static_cast<quint64>(row) << 24) | static_cast<quint64>(column);
+}
+}
+
+ImageView::ImageView(QQuickItem* parent)
+    : QQuickItem { parent }
+{
+    setFlag(ItemHasContents, true);
+
+    /* Тайлы вокруг видимой области загружаются заранее и не должны выходить за элемент */
+    setClip(true);
+}
+
+///
+/// \brief ImageView::processing - Функция возвращает объект, изображение которого показывается.
+///
+PhotoProcessing* ImageView::processing() const
+{
+    return source;
+}
+
+///
+/// \brief ImageView::setProcessing - Функция задает объект, изображение которого показывается.
+/// \param processing - Объект PhotoProcessing.
+///
+void ImageView::setProcessing(PhotoProcessing* processing)
+{
+    if (source == processing) {
+        return;
+    }
+
+    if (!source.isNull()) {
+        disconnect(source, nullptr, this, nullptr);
+    }
+
+    source = processing;
+
+    if (!source.isNull()) {
+        /* Правки и undo сообщают измененный прямоугольник, уменьшенная копия при открытии заменяет все изображение */
+        connect(source, &PhotoProcessing::imageEditChanged, this, [this]() {
+            refresh(source->dirtyRect());
+        });
+        connect(source, &PhotoProcessing::imageEditWithoutQueueChanged, this, [this]() {
+            refresh(source->dirtyRect());
+        });
+        connect(source, &PhotoProcessing::loadPreviewChanged, this, [this]() {
+            refresh(QRectF(0.0, 0.0, 1.0, 1.0));
+        });
+    }
+
+    emit processingChanged();
+
+    refresh(QRectF(0.0, 0.0, 1.0, 1.0));
+}
+
+///
+/// \brief ImageView::zoom - Функция возвращает масштаб: пикселей элемента на пиксель изображения. 0 - изображение вписано в элемент.
+///
+qreal ImageView::zoom() const
+{
+    return zoomFactor;
+}
+
+///
+/// \brief ImageView::setZoom - Функция задает масштаб. Значение не больше 0 вписывает изображение в элемент.
+/// \param zoom - Пикселей элемента на пиксель изображения.
+///
+void ImageView::setZoom(const qreal zoom)
+{
+    const qreal value = zoom > 0.0 ? qMin(zoom, maximumZoom) : 0.0;
+
+    if (qFuzzyCompare(value + 1.0, zoomFactor + 1.0)) {
+        return;
+    }
+
+    zoomFactor = value;
+
+    emit zoomChanged();
+
+    /* Вписанное изображение всегда стоит по центру */
+    if (zoomFactor == 0.0) {
+        setCenter(QPointF(0.5, 0.5));
+    }
+
+    updatePaintedRect();
+    update();
+}
+
+///
+/// \brief ImageView::center - Функция возвращает точку изображения в центре элемента в долях от 0.0 до 1.0.
+///
+QPointF ImageView::center() const
+{
+    return viewCenter;
+}
+
+///
+/// \brief ImageView::setCenter - Функция задает точку изображения в центре элемента.
+/// \param center - Точка в долях изображения от 0.0 до 1.0.
+///
+void ImageView::setCenter(const QPointF& center)
+{
+    const QPointF value(qBound(0.0, center.x(), 1.0), qBound(0.0, center.y(), 1.0));
+
+    if (value == viewCenter) {
+        return;
+    }
+
+    viewCenter = value;
+
+    emit centerChanged();
+
+    updatePaintedRect();
+    update();
+}
+
+///
+/// \brief ImageView::paintedRect - Функция возвращает прямоугольник изображения в координатах элемента.
+///
+QRectF ImageView::paintedRect() const
+{
+    return currentPaintedRect;
+}
+
+///
+/// \brief ImageView::hasImage - Функция проверяет, что есть изображение для показа.
+///
+bool ImageView::hasImage() const
+{
+    return !outputSize.isEmpty();
+}
+
+///
+/// \brief ImageView::zoomAt - Функция меняет масштаб так, что точка элемента point остается над той же точкой изображения.
+/// \param factor - Во сколько раз меняется масштаб.
+/// \param point - Точка в координатах элемента.
+///
+void ImageView::zoomAt(const qreal factor, const QPointF& point)
+{
+    if (!hasImage() || currentPaintedRect.isEmpty() || factor <= 0.0) {
+        return;
+    }
+
+    const qreal previous = currentScale();
+    const qreal next = qMin(previous * factor, maximumZoom);
+
+    /* Меньше вписанного изображение не уменьшается */
+    if (next <= fitScale()) {
+        setZoom(0.0);
+
+        return;
+    }
+
+    const QPointF imagePoint = (point - currentPaintedRect.topLeft()) / previous;
+    const QPointF topLeft = point - imagePoint * next;
+
+    zoomFactor = next;
+
+    emit zoomChanged();
+
+    setCenter(QPointF((width() / 2 - topLeft.x()) / (outputSize.width() * next), (height() / 2 - topLeft.y()) / (outputSize.height() * next)));
+
+    updatePaintedRect();
+    update();
+}
+
+///
+/// \brief ImageView::pan - Функция сдвигает изображение.
+/// \param delta - Сдвиг в пикселях элемента.
+///
+void ImageView::pan(const QPointF& delta)
+{
+    /* Вписанное изображение не сдвигается */
+    if (!hasImage() || zoomFactor == 0.0) {
+        return;
+    }
+
+    setCenter(viewCenter - QPointF(delta.x() / (outputSize.width() * zoomFactor), delta.y() / (outputSize.height() * zoomFactor)));
+}
+
+///
+/// \brief ImageView::updatePaintNode - Функция в потоке отрисовки загружает недостающие и устаревшие видимые тайлы и расставляет узлы тайлов.
+/// Главный поток в это время заблокирован, поэтому состояние, записанное в нем, читается без мьютекса.
+///
+QSGNode* ImageView::updatePaintNode(QSGNode* node, UpdatePaintNodeData* data)
+{
+    Q_UNUSED(data)
+
+    QSGNode* root = node;
+
+    /* Граф сцены мог быть пересоздан вместе с узлами тайлов */
+    if (root == nullptr) {
+        root = new QSGNode();
+        tiles.clear();
+    }
+
+    const auto removeTile = [root](const Tile& tile) {
+        root->removeChildNode(tile.node);
+
+        delete tile.node;
+    };
+
+    /* Размер изображения изменился: старые тайлы лежат не на своих местах */
+    if (resetTiles) {
+        for (const Tile& tile : tiles) {
+            removeTile(tile);
+        }
+
+        tiles.clear();
+        resetTiles = false;
+    }
+
+    for (Tile& tile : tiles) {
+        for (const QRectF& dirty : pendingDirty) {
+            if (tile.rect.intersects(dirty)) {
+                tile.stale = true;
+            }
+        }
+    }
+
+    pendingDirty.clear();
+
+    const QVector<QImage> sources = levels();
+    QQuickWindow* quickWindow = window();
+
+    if (sources.isEmpty() || currentPaintedRect.isEmpty() || quickWindow == nullptr) {
+        for (const Tile& tile : tiles) {
+            removeTile(tile);
+        }
+
+        tiles.clear();
+
+        return root;
+    }
+
+    const Trace::Scope trace("tiles", "qml");
+
+    /* Выбирается наименьший уровень, у которого на пиксель экрана приходится не меньше пикселя уровня */
+    const qreal devicePixels = currentPaintedRect.width() * quickWindow->effectiveDevicePixelRatio();
+
+    int levelIndex = 0;
+    for (int index = sources.size() - 1; index >= 0; --index) {
+        if (sources.at(index).width() >= devicePixels) {
+            levelIndex = index;
+
+            break;
+        }
+    }
+
+    const QImage& level = sources.at(levelIndex);
+    const int levelKey = tiled ? levelIndex : -1;
+
+    const QRectF visible = QRectF(0.0, 0.0, width(), height()).intersected(currentPaintedRect);
+    const QRectF normalizedVisible((visible.x() - currentPaintedRect.x()) / currentPaintedRect.width(),
+        (visible.y() - currentPaintedRect.y()) / currentPaintedRect.height(), visible.width() / currentPaintedRect.width(),
+        visible.height() / currentPaintedRect.height());
+    const QRectF levelVisible(normalizedVisible.x() * level.width(), normalizedVisible.y() * level.height(), normalizedVisible.width() * level.width(),
+        normalizedVisible.height() * level.height());
+
+    /* Кольцо тайлов вокруг видимой области загружается после видимых, чтобы прокрутка не открывала пустые места */
+    const int columns = (level.width() + tileSize - 1) / tileSize;
+    const int rows = (level.height() + tileSize - 1) / tileSize;
+    const int firstColumn = qMax(0, static_cast<int>(std::floor(levelVisible.left() / tileSize)) - 1);
+    const int lastColumn = qMin(columns - 1, static_cast<int>(std::floor(levelVisible.right() / tileSize)) + 1);
+    const int firstRow = qMax(0, static_cast<int>(std::floor(levelVisible.top() / tileSize)) - 1);
+    const int lastRow = qMin(rows - 1, static_cast<int>(std::floor(levelVisible.bottom() / tileSize)) + 1);
+
+    QSet<quint64> wanted;
+    int uploads = 0;
+    bool complete = true;
+
+    for (int pass = 0; pass < 2; ++pass) {
+        for (int row = firstRow; row <= lastRow; ++row) {
+            for (int column = firstColumn; column <= lastColumn; ++column) {
+                const QRect tileRect = QRect(column * tileSize, row * tileSize, tileSize, tileSize).intersected(level.rect());
+                const bool visibleTile = QRectF(tileRect).intersects(levelVisible);
+
+                if ((pass == 0) != visibleTile) {
+                    continue;
+                }
+
+                const quint64 key = tileKey(levelKey, row, column);
+                wanted.insert(key);
+
+                const auto found = tiles.find(key);
+
+                if (found != tiles.end() && !found->stale) {
+                    continue;
+                }
+
+                /* Остальные тайлы загружаются в следующих кадрах, до тех пор на их месте остается старое содержимое */
+                if (uploads >= tilesPerFrame) {
+                    complete = false;
+
+                    continue;
+                }
+
+                ++uploads;
+
+                const QImage pixels = renderTile(level, tileRect);
+
+                auto* tileNode = new QSGSimpleTextureNode();
+                tileNode->setTexture(quickWindow->createTextureFromImage(
+                    pixels, pixels.hasAlphaChannel() ? QQuickWindow::CreateTextureOptions() : QQuickWindow::TextureIsOpaque));
+                tileNode->setOwnsTexture(true);
+                tileNode->setFiltering(QSGTexture::Linear);
+
+                if (found != tiles.end()) {
+                    /* Замененный тайл остается на своем месте в порядке отрисовки */
+                    root->insertChildNodeAfter(tileNode, found->node);
+                    removeTile(*found);
+
+                    found->node = tileNode;
+                    found->stale = false;
+                } else {
+                    root->appendChildNode(tileNode);
+
+                    tiles.insert(key,
+                        { tileNode,
+                            QRectF(static_cast<qreal>(tileRect.x()) / level.width(), static_cast<qreal>(tileRect.y()) / level.height(),
+                                static_cast<qreal>(tileRect.width()) / level.width(), static_cast<qreal>(tileRect.height()) / level.height()),
+                            levelKey, false });
+                }
+            }
+        }
+    }
+
+    for (auto it = tiles.begin(); it != tiles.end();) {
+        const bool current = it->level == levelKey && wanted.contains(it.key());
+
+        /* Тайлы прежнего уровня закрывают видимую область, пока ее тайлы текущего уровня не загружены */
+        const bool backdrop = it->level != levelKey && !complete && it->rect.intersects(normalizedVisible);
+
+        if (current || backdrop) {
+            ++it;
+
+            continue;
+        }
+
+        removeTile(*it);
+        it = tiles.erase(it);
+    }
+
+    for (const Tile& tile : tiles) {
+        tile.node->setRect(QRectF(currentPaintedRect.x() + tile.rect.x() * currentPaintedRect.width(),
+            currentPaintedRect.y() + tile.rect.y() * currentPaintedRect.height(), tile.rect.width() * currentPaintedRect.width(),
+            tile.rect.height() * currentPaintedRect.height()));
+    }
+
+    /* update() вызывается только из главного потока */
+    if (!complete) {
+        QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection);
+    } else if (reportedVersion != revision.version) {
+        reportedVersion = revision.version;
+
+        QMetaObject::invokeMethod(this, "frameReady", Qt::QueuedConnection);
+    }
+
+    return root;
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+void ImageView::geometryChange(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+
+    updatePaintedRect();
+    update();
+}
+#else
+void ImageView::geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry)
+{
+    QQuickItem::geometryChanged(newGeometry, oldGeometry);
+
+    updatePaintedRect();
+    update();
+}
+#endif
+
+///
+/// \brief ImageView::refresh - Функция забирает у PhotoProcessing новое показанное изображение и помечает тайлы под измененным прямоугольником.
+/// \param dirty - Измененный прямоугольник в долях изображения.
+///
+void ImageView::refresh(const QRectF& dirty)
+{
+    const bool hadImage = hasImage();
+
+    revision = source.isNull() ? ImageDocument::Revision() : source->displayedRevision();
+    tiled = !revision.image.isNull() && EditStack::isPointwise(revision.operations);
+
+    QSize size;
+
+    if (!revision.image.isNull()) {
+        size = EditStack::outputSize(revision.image.size(), revision.operations);
+    } else {
+        const QImage view = revision.viewImage();
+        size = view.size();
+
+        /* Предпросмотр приходит в размере экрана: пока его пропорции совпадают с изображением, масштаб считается от полного размера */
+        if (!outputSize.isEmpty() && !view.isNull()) {
+            const QSize fitted = outputSize.scaled(view.size(), Qt::KeepAspectRatio);
+
+            if (qAbs(fitted.width() - view.width()) <= 1 && qAbs(fitted.height() - view.height()) <= 1) {
+                size = outputSize;
+            }
+        }
+    }
+
+    if (size != outputSize) {
+        outputSize = size;
+        resetTiles = true;
+        pendingDirty.clear();
+    } else {
+        pendingDirty.append(dirty);
+    }
+
+    updatePaintedRect();
+    update();
+
+    if (hadImage != hasImage()) {
+        emit hasImageChanged();
+    }
+}
+
+///
+/// \brief ImageView::updatePaintedRect - Функция пересчитывает прямоугольник изображения в координатах элемента.
+///
+void ImageView::updatePaintedRect()
+{
+    QRectF rect;
+
+    if (hasImage() && width() > 0.0 && height() > 0.0) {
+        const qreal scale = currentScale();
+        const QSizeF size(outputSize.width() * scale, outputSize.height() * scale);
+
+        rect = QRectF(QPointF(width() / 2 - viewCenter.x() * size.width(), height() / 2 - viewCenter.y() * size.height()), size);
+    }
+
+    if (rect != currentPaintedRect) {
+        currentPaintedRect = rect;
+
+        emit paintedRectChanged();
+    }
+}
+
+///
+/// \brief ImageView::currentScale - Функция возвращает текущий масштаб, для вписанного изображения - масштаб вписывания.
+///
+qreal ImageView::currentScale() const
+{
+    return zoomFactor > 0.0 ? zoomFactor : fitScale();
+}
+
+///
+/// \brief ImageView::fitScale - Функция возвращает масштаб, при котором изображение вписано в элемент.
+///
+qreal ImageView::fitScale() const
+{
+    if (!hasImage()) {
+        return 1.0;
+    }
+
+    return qMin(width() / outputSize.width(), height() / outputSize.height());
+}
+
+///
+/// \brief ImageView::levels - Функция возвращает уровни, из которых режутся тайлы: полное изображение и пирамиду или только изображение для экрана.
+///
+QVector<QImage> ImageView::levels() const
+{
+    if (tiled) {
+        return QVector<QImage> { revision.image } + revision.levels;
+    }
+
+    /* Геометрические правки еще не материализованы, их результат есть только в размере экрана */
+    const QImage view = revision.viewImage();
+
+    return view.isNull() ? QVector<QImage>() : QVector<QImage> { view };
+}
+
+///
+/// \brief ImageView::renderTile - Функция вырезает тайл из уровня и применяет к нему поточечный стек правок.
+/// \param level - Уровень.
+/// \param rect - Прямоугольник тайла в пикселях уровня.
+///
+QImage ImageView::renderTile(const QImage& level, const QRect& rect) const
+{
+    const QImage tile = level.copy(rect);
+
+    return tiled ? EditStack::render(tile, revision.operations) : tile;
+}
@@ -0,0 +1,138 @@
+#include "include/PhotoProcessing/JobScheduler.h"
+#include "include/PhotoProcessing/Trace.h"
+
+#include <QtConcurrent>
+
+JobScheduler::JobScheduler(QObject* parent)
+    : QObject { parent }
+    , generation { QSharedPointer<QAtomicInteger<quint64>>::create(0) }
+{
+}
+
+///
+/// \brief JobScheduler::~JobScheduler - Деструктор отменяет операцию и ждет ее остановки, так как она ссылается на планировщик.
+///
+JobScheduler::~JobScheduler()
+{
+    /* Обработчики отмены не вызываются: объект, которому они сообщают, уже разрушается */
+    generation->fetchAndAddOrdered(1);
+    pending.reset();
+
+    future.waitForFinished();
+}
+
+///
+/// \brief JobScheduler::scheduleTask - Функция ставит запрос в очередь вместо всех предыдущих запросов.
+/// \param name - Имя операции для Trace.
+/// \param job - Операция, которая выполняется в рабочем потоке.
+/// \param handler - Обработчик, вызывается в главном потоке, если запрос не устарел.
+/// \param dropped - Обработчик отмены, вызывается в главном потоке, если запрос устарел.
+///
+void JobScheduler::scheduleTask(const char* name, const std::function<void()>& job, const std::function<void()>& handler,
+    const std::function<void()>& dropped)
+{
+    /* Новое поколение отменяет выполняемую операцию, она остановится на следующей полосе */
+    const Request request { name, job, handler, dropped, generation->fetchAndAddOrdered(1) + 1, Trace::now() };
+
+    if (running) {
+        const std::optional<Request> replaced = pending;
+
+        /* Операция запускается после остановки предыдущей, чтобы не делить с ней потоки */
+        pending = request;
+
+        drop(replaced);
+    } else {
+        start(request);
+    }
+}
+
+///
+/// \brief JobScheduler::cancel - Функция отменяет выполняемую операцию и удаляет ожидающий запрос.
+///
+void JobScheduler::cancel()
+{
+    generation->fetchAndAddOrdered(1);
+
+    const std::optional<Request> removed = pending;
+    pending.reset();
+
+    drop(removed);
+}
+
+///
+/// \brief JobScheduler::drop - Функция вызывает обработчик отмены запроса, который удален из очереди.
+/// \param request - Удаленный запрос.
+///
+void JobScheduler::drop(const std::optional<Request>& request)
+{
+    if (request.has_value() && request->dropped) {
+        request->dropped();
+    }
+}
+
+///
+/// \brief JobScheduler::isIdle - Функция проверяет, что нет ни выполняемой операции, ни ожидающего запроса.
+///
+bool JobScheduler::isIdle() const
+{
+    return !running && !pending.has_value();
+}
+
+///
+/// \brief JobScheduler::start - Функция запускает запрос в рабочем потоке.
+/// \param request - Запрос.
+///
+void JobScheduler::start(const Request& request)
+{
+    running = true;
+
+    const Tiling::CancellationToken token(generation, request.generation);
+
+    future = QtConcurrent::run([this, request, token]() {
+        /* Ожидание включает и выполнение предыдущей операции, и ожидание свободного потока */
+        Trace::record("queue", "scheduler", request.queued, Trace::now());
+
+        /* Запрос мог устареть, пока ждал своей очереди */
+        if (!token.isCancelled()) {
+            const Tiling::CancellationScope scope(token);
+            const Trace::Scope trace(request.name, "operation");
+
+            request.job();
+        }
+
+        QMetaObject::invokeMethod(
+            this, [this, request]() {
+                finish(request);
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+///
+/// \brief JobScheduler::finish - Функция обрабатывает завершение операции в главном потоке и запускает ожидающий запрос.
+/// \param request - Завершенный запрос.
+///
+void JobScheduler::finish(const Request& request)
+{
+    running = false;
+
+    /* Результат передается, только если после запроса не было новых запросов и отмен */
+    if (request.generation == generation->loadAcquire() && request.handler) {
+        {
+            const Trace::Scope trace("handle", "scheduler");
+
+            request.handler();
+        }
+
+        emit handled(request.queued);
+    } else if (request.dropped) {
+        request.dropped();
+    }
+
+    if (pending.has_value()) {
+        const Request next = *pending;
+        pending.reset();
+
+        start(next);
+    }
+}
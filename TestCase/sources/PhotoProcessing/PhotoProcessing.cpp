@@ -1,368 +1,1667 @@
 #include "include/PhotoProcessing/PhotoProcessing.h"
 
+#include <QDataStream>
+
+/* Фильтр передается в стек правок числом */
+static_assert(static_cast<int>(Resample::Filter::Area) == PhotoProcessing::Area && static_cast<int>(Resample::Filter::Lanczos) == PhotoProcessing::Lanczos,
+    "ScalingFilter must match Resample::Filter");
+static_assert(static_cast<int>(Convolution::Border::Clamp) == PhotoProcessing::Clamp
+        && static_cast<int>(Convolution::Border::Transparent) == PhotoProcessing::Transparent,
+    "BorderMode must match Convolution::Border");
+
+namespace {
+/* Автоуровни обрезают 0.1% самых темных и самых светлых пикселей, чтобы единичные выбросы не задавали точки */
+constexpr qreal levelsClip = 0.001;
+
+/* Поточечный стек для гистограмм автоуровней считается полосами по столько рядов, чтобы не держать полный результат */
+constexpr int levelsBandRows = 256;
+
+///
+/// \brief preservesHistogram - Функция проверяет, что операции только переставляют пиксели и не меняют гистограммы.
+///
+bool preservesHistogram(const QVector<EditStack::Operation>& operations)
+{
+    using Type = EditStack::Operation::Type;
+
+    for (const EditStack::Operation& operation : operations) {
+        if (operation.type != Type::Rotate && operation.type != Type::RotateClockwise && operation.type != Type::Rotate180
+            && operation.type != Type::FlipHorizontal && operation.type != Type::FlipVertical) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+///
+/// \brief resultKey - Функция описывает результат для ResultCache: исходное изображение, стек правок, операцию и ее параметры.
+/// \param operation - Имя операции, строковый литерал.
+/// \param revision - Ревизия, из изображения которой считается результат.
+/// \param operations - Стек правок, результат которого используется.
+/// \param parameters - Параметры операции.
+///
+QByteArray resultKey(const char* operation, const ImageDocument::Revision& revision, const QVector<EditStack::Operation>& operations,
+    const QVariantList& parameters)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+
+    /* Номер тайлов не меняется при undo и redo, в отличие от версии ревизии */
+    stream << QByteArray(operation) << revision.tiles.id() << parameters << static_cast<qint32>(operations.size());
+
+    for (const EditStack::Operation& editOperation : operations) {
+        stream << static_cast<qint32>(editOperation.type) << editOperation.value;
+
+        for (int channel = 0; channel < 3; ++channel) {
+            stream << editOperation.levels.black[channel] << editOperation.levels.white[channel];
+        }
+    }
+
+    return key;
+}
+
+///
+/// \brief histogramMap - Функция переводит гистограммы в формат qml: высоты уровней относительно самого частого уровня всех каналов.
+///
+QVariantMap histogramMap(const Histogram::Statistics& statistics)
+{
+    qint64 peak = 1;
+
+    for (const std::array<qint64, 256>& bins : statistics.bins) {
+        for (const qint64 bin : bins) {
+            peak = qMax(peak, bin);
+        }
+    }
+
+    QVariantMap result;
+
+    const QStringList names { QStringLiteral("red"), QStringLiteral("green"), QStringLiteral("blue"), QStringLiteral("luma") };
+
+    for (int channel = 0; channel < Histogram::channelCount; ++channel) {
+        QVariantList heights;
+        heights.reserve(256);
+
+        for (const qint64 bin : statistics.bins[channel]) {
+            heights.append(static_cast<qreal>(bin) / peak);
+        }
+
+        result.insert(names.at(channel), heights);
+    }
+
+    result.insert(QStringLiteral("minimum"), statistics.minimum(Histogram::Channel::Luma));
+    result.insert(QStringLiteral("maximum"), statistics.maximum(Histogram::Channel::Luma));
+    result.insert(QStringLiteral("mean"), statistics.mean(Histogram::Channel::Luma));
+    result.insert(QStringLiteral("count"), statistics.count);
+
+    return result;
+}
+}
+
 PhotoProcessing::PhotoProcessing(QObject* parent)
     : QObject { parent }
+    , document { QSharedPointer<ImageDocument>::create() }
+    , scheduler { new JobScheduler(this) }
+    , exporter { new Exporter(this) }
+    , prefetchGeneration { QSharedPointer<QAtomicInteger<quint64>>::create(0) }
+    , statisticsCache { QSharedPointer<Histogram::TileCache>::create() }
+    , resultCache { QSharedPointer<ResultCache>::create(0) }
+{
+    static QAtomicInt instanceCounter;
+
+    providerId = QStringLiteral("photoprocessing") % QString::number(instanceCounter.fetchAndAddRelaxed(1));
+
+    document->setMemoryBudget(static_cast<qsizetype>(historyMegabytes) * 1024 * 1024);
+    resultCache->setBudget(static_cast<qsizetype>(cacheMegabytes) * 1024 * 1024);
+
+    connect(exporter, &Exporter::runningChanged, this, &PhotoProcessing::exportingChanged);
+    connect(exporter, &Exporter::progressChanged, this, &PhotoProcessing::exportProgressChanged);
+    connect(exporter, &Exporter::finished, this, &PhotoProcessing::exportFinished);
+
+    /* Гистограммы пересчитываются для каждого нового показанного изображения */
+    connect(this, &PhotoProcessing::imageEditChanged, this, &PhotoProcessing::updateHistogram);
+    connect(this, &PhotoProcessing::imageEditWithoutQueueChanged, this, &PhotoProcessing::updateHistogram);
+
+    connect(scheduler, &JobScheduler::handled, this, [this](const qint64 queued) {
+        operationQueued = queued;
+        operationHandled = Trace::now();
+
+        updateTimings();
+
+        emit cacheStatisticsChanged();
+    });
+}
+
+///
+/// \brief PhotoProcessing::~PhotoProcessing - Деструктор ждет сжатия истории, расчета гистограмм и загрузки, так как они сообщают о результате объекту.
+///
+PhotoProcessing::~PhotoProcessing()
+{
+    compaction.waitForFinished();
+    histogramUpdate.waitForFinished();
+
+    /* Открытие передает объекту уменьшенную копию и долю прочитанного, поэтому планировщик останавливается раньше членов объекта */
+    delete scheduler;
+
+    cancelPrefetch();
+
+    for (QFuture<QImage>& cancelled : cancelledPrefetches) {
+        cancelled.waitForFinished();
+    }
+}
+
+///
+/// \brief PhotoProcessing::classBegin - Функция пустая: ее требует QQmlParserStatus, а движок qml доступен только в componentComplete().
+///
+void PhotoProcessing::classBegin()
+{
+}
+
+///
+/// \brief PhotoProcessing::componentComplete - Функция регистрирует ImageProvider документа в движке qml, который создал объект.
+///
+void PhotoProcessing::componentComplete()
+{
+    if (QQmlEngine* engine = qmlEngine(this)) {
+        /* Движок забирает владение провайдером, документ остается общим */
+        engine->addImageProvider(providerId, new ImageProvider(document));
+    }
+}
+
+///
+/// \brief PhotoProcessing::canUndo - Функция проверяет, есть ли ревизия для undo.
+///
+bool PhotoProcessing::canUndo() const
+{
+    return document->canUndo();
+}
+
+///
+/// \brief PhotoProcessing::canRedo - Функция проверяет, есть ли ревизия для redo.
+///
+bool PhotoProcessing::canRedo() const
+{
+    return document->canRedo();
+}
+
+///
+/// \brief PhotoProcessing::threadCount - Функция возвращает количество потоков, на которые делится одна операция.
+///
+int PhotoProcessing::threadCount() const
+{
+    return Tiling::threadCount();
+}
+
+///
+/// \brief PhotoProcessing::setThreadCount - Функция задает количество потоков. Значение меньше 1 возвращает количество ядер.
+/// \param count - Количество потоков.
+///
+void PhotoProcessing::setThreadCount(const int count)
+{
+    const int previousCount = Tiling::threadCount();
+
+    Tiling::setThreadCount(count);
+
+    if (Tiling::threadCount() != previousCount) {
+        emit threadCountChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::previewSize - Функция возвращает размер области, в которую вписывается изображение на экране.
+///
+QSize PhotoProcessing::previewSize() const
+{
+    return displaySize;
+}
+
+///
+/// \brief PhotoProcessing::setPreviewSize - Функция задает размер области, в которую вписывается изображение на экране.
+/// По нему выбирается уровень пирамиды для предпросмотра.
+/// \param size - Размер в пикселях.
+///
+void PhotoProcessing::setPreviewSize(const QSize& size)
+{
+    if (displaySize != size) {
+        displaySize = size;
+
+        emit previewSizeChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::historyBudget - Функция возвращает бюджет памяти истории в мегабайтах.
+///
+int PhotoProcessing::historyBudget() const
+{
+    return historyMegabytes;
+}
+
+///
+/// \brief PhotoProcessing::setHistoryBudget - Функция задает бюджет памяти истории. При превышении старые ревизии сжимаются, вытесняются на диск, а затем удаляются.
+/// \param megabytes - Бюджет в мегабайтах.
+///
+void PhotoProcessing::setHistoryBudget(const int megabytes)
+{
+    if (historyMegabytes != megabytes && megabytes >= 0) {
+        historyMegabytes = megabytes;
+        document->setMemoryBudget(static_cast<qsizetype>(megabytes) * 1024 * 1024);
+
+        emit historyBudgetChanged();
+
+        compactHistory();
+    }
+}
+
+///
+/// \brief PhotoProcessing::historyCompression - Функция проверяет, сжимаются ли тайлы старых ревизий при превышении бюджета.
+///
+bool PhotoProcessing::historyCompression() const
+{
+    return compressHistory;
+}
+
+///
+/// \brief PhotoProcessing::setHistoryCompression - Функция включает сжатие тайлов старых ревизий. Без сжатия тайлы сразу вытесняются на диск.
+/// \param enabled - Включено ли сжатие.
+///
+void PhotoProcessing::setHistoryCompression(const bool enabled)
+{
+    if (compressHistory != enabled) {
+        compressHistory = enabled;
+
+        emit historyCompressionChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::exporting - Функция проверяет, идет ли запись файла.
+///
+bool PhotoProcessing::exporting() const
+{
+    return exporter->isRunning();
+}
+
+///
+/// \brief PhotoProcessing::exportProgress - Функция возвращает долю выполненной записи файла от 0.0 до 1.0.
+///
+qreal PhotoProcessing::exportProgress() const
+{
+    return exporter->progress();
+}
+
+///
+/// \brief PhotoProcessing::loadProgress - Функция возвращает долю прочитанного файла открываемого изображения от 0.0 до 1.0.
+///
+qreal PhotoProcessing::loadProgress() const
+{
+    return currentLoadProgress;
+}
+
+///
+/// \brief PhotoProcessing::tracing - Функция проверяет, включены ли замеры фаз операций.
+///
+bool PhotoProcessing::tracing() const
+{
+    return Trace::isEnabled();
+}
+
+///
+/// \brief PhotoProcessing::setTracing - Функция включает замеры фаз операций. Выключенные замеры почти ничего не стоят.
+/// \param enabled - Включены ли замеры.
+///
+void PhotoProcessing::setTracing(const bool enabled)
+{
+    if (Trace::isEnabled() != enabled) {
+        Trace::setEnabled(enabled);
+
+        emit tracingChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::timings - Функция возвращает фазы последней операции: name, category, start и duration в миллисекундах от постановки в очередь, thread.
+///
+QVariantList PhotoProcessing::timings() const
+{
+    return operationTimings;
+}
+
+///
+/// \brief PhotoProcessing::histogram - Функция возвращает гистограммы показанного изображения: red, green, blue и luma - по 256 высот от 0.0 до 1.0
+/// относительно самого частого уровня, minimum, maximum и mean - яркость, count - количество учтенных пикселей.
+///
+QVariantMap PhotoProcessing::histogram() const
+{
+    return currentHistogram;
+}
+
+///
+/// \brief PhotoProcessing::selection - Функция возвращает прямоугольник выделения в долях показанного изображения от 0.0 до 1.0.
+/// Пустой прямоугольник - выделено все изображение.
+///
+QRectF PhotoProcessing::selection() const
+{
+    return selectionArea;
+}
+
+///
+/// \brief PhotoProcessing::setSelection - Функция задает прямоугольник выделения. Поточечные правки, размытие и свертка меняют только его.
+/// \param rect - Прямоугольник в долях показанного изображения от 0.0 до 1.0. Пустой прямоугольник снимает выделение.
+///
+void PhotoProcessing::setSelection(const QRectF& rect)
+{
+    const QRectF area = rect.normalized().intersected(QRectF(0.0, 0.0, 1.0, 1.0));
+
+    if (selectionArea != area || !customSelection.isNull()) {
+        selectionArea = area;
+        customSelection = Region::Mask();
+
+        emit selectionChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::selectionFeather - Функция возвращает ширину мягкого края выделения в пикселях изображения.
+///
+int PhotoProcessing::selectionFeather() const
+{
+    return selectionSoftness;
+}
+
+///
+/// \brief PhotoProcessing::setSelectionFeather - Функция задает ширину мягкого края выделения.
+/// \param feather - Ширина в пикселях изображения, 0 - жесткий край.
+///
+void PhotoProcessing::setSelectionFeather(const int feather)
+{
+    if (selectionSoftness != feather && feather >= 0) {
+        selectionSoftness = feather;
+
+        emit selectionFeatherChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::setSelectionMask - Функция задает выделение произвольной формы вместо прямоугольника.
+/// \param mask - Маска в пикселях показанного изображения (EditStack::outputSize()).
+///
+void PhotoProcessing::setSelectionMask(const Region::Mask& mask)
+{
+    selectionArea = QRectF();
+    customSelection = mask;
+
+    emit selectionChanged();
+}
+
+///
+/// \brief PhotoProcessing::dirtyRect - Функция возвращает прямоугольник, который изменился в последнем показанном изображении, в долях от 0.0 до 1.0.
+///
+QRectF PhotoProcessing::dirtyRect() const
+{
+    return currentDirtyRect;
+}
+
+///
+/// \brief PhotoProcessing::cacheBudget - Функция возвращает бюджет памяти кэша результатов в мегабайтах.
+///
+int PhotoProcessing::cacheBudget() const
+{
+    return cacheMegabytes;
+}
+
+///
+/// \brief PhotoProcessing::setCacheBudget - Функция задает бюджет памяти кэша результатов. 0 выключает кэш.
+/// \param megabytes - Бюджет в мегабайтах.
+///
+void PhotoProcessing::setCacheBudget(const int megabytes)
+{
+    if (cacheMegabytes != megabytes && megabytes >= 0) {
+        cacheMegabytes = megabytes;
+        resultCache->setBudget(static_cast<qsizetype>(megabytes) * 1024 * 1024);
+
+        emit cacheBudgetChanged();
+        emit cacheStatisticsChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::cacheStatistics - Функция возвращает счетчики кэша результатов: hits, misses, bytes и entries.
+///
+QVariantMap PhotoProcessing::cacheStatistics() const
+{
+    const ResultCache::Statistics statistics = resultCache->statistics();
+
+    return QVariantMap {
+        { QStringLiteral("hits"), statistics.hits },
+        { QStringLiteral("misses"), statistics.misses },
+        { QStringLiteral("bytes"), static_cast<qint64>(statistics.bytes) },
+        { QStringLiteral("entries"), statistics.entries } };
+}
+
+///
+/// \brief PhotoProcessing::displayedRevision - Функция возвращает то, что видит пользователь, для ImageView.
+/// Предпросмотр поточечной операции без выделения возвращается как текущая ревизия с этой операцией в стеке,
+/// чтобы ImageView мог считать его по тайлам полного изображения, а не растягивать изображение для экрана.
+///
+ImageDocument::Revision PhotoProcessing::displayedRevision() const
+{
+    const ImageDocument::Revision displayed = document->displayed();
+
+    /* Уменьшенная копия при открытии - тоже предпросмотр, но без операции */
+    if (!displayed.image.isNull() || !previewOperation.has_value() || !loadingPath.isEmpty()) {
+        return displayed;
+    }
+
+    ImageDocument::Revision revision = document->current();
+
+    if (revision.image.isNull() || !selectionMask(revision).isNull()) {
+        return displayed;
+    }
+
+    revision.version = displayed.version;
+    revision.operations.append(*previewOperation);
+    revision.view = displayed.view;
+
+    return revision;
+}
+
+///
+/// \brief PhotoProcessing::supportedExportFormats - Функция возвращает форматы, в которые можно сохранить изображение.
+///
+QStringList PhotoProcessing::supportedExportFormats() const
+{
+    return Exporter::supportedFormats();
+}
+
+///
+/// \brief PhotoProcessing::openImage - Функция загружает изображение с диска в рабочий документ.
+/// \param imagePath - Путь к изображению.
+///
+void PhotoProcessing::openImage(const QString& imagePath)
+{
+    const QString localFilePath = QUrl(imagePath).toLocalFile();
+
+    if (!localFilePath.isEmpty()) {
+        /* Передаем сигнал о начале операции в qml */
+        emit loadingStartedChanged();
+
+        sourceSuffix = QFileInfo(localFilePath).suffix();
+        previewOperation.reset();
+
+        clearSelection();
+
+        /* Результаты прежнего изображения больше не понадобятся */
+        resultCache->clear();
+
+        loadingPath = localFilePath;
+        currentLoadProgress = 0.0;
+
+        emit loadProgressChanged();
+
+        /* Отмена прежнего открытия приходит позже, она не должна сбросить состояние этого */
+        const quint64 load = ++loadId;
+
+        /* Файл, выбранный в диалоге, уже декодируется в фоне: ждем его, а не декодируем заново */
+        const bool prefetched = prefetchPath == localFilePath;
+
+        if (!prefetched) {
+            cancelPrefetch();
+        }
+
+        const QFuture<QImage> decoded = prefetched ? prefetch : QFuture<QImage>();
+        const std::function<void(qreal)> progress = loadProgressReporter(localFilePath);
+        const QSize targetSize = displaySize;
+
+        scheduler->schedule(
+            "open",
+            [this, localFilePath, prefetched, decoded, progress, targetSize]() {
+                if (!prefetched || !decoded.isFinished()) {
+                    /* Пока изображение декодируется целиком, показываем копию, которую декодер уменьшил сам */
+                    QImage preview;
+
+                    {
+                        const Trace::Scope trace("decode preview", "io");
+
+                        preview = ImageLoader::decodeScaled(localFilePath, targetSize);
+                    }
+
+                    if (!preview.isNull() && !Tiling::isCancelled()) {
+                        QMetaObject::invokeMethod(
+                            this, [this, localFilePath, preview]() {
+                                if (loadingPath == localFilePath) {
+                                    emit loadPreviewChanged(imageUrl(document->setPreview(preview)));
+                                }
+                            },
+                            Qt::QueuedConnection);
+                    }
+                }
+
+                /* Декодируем один раз и сразу в формат ядер, дальше все операции работают с изображением в памяти */
+                QImage image;
+
+                if (prefetched) {
+                    const Trace::Scope trace("wait prefetch", "io");
+
+                    image = decoded.result();
+                } else {
+                    const Trace::Scope trace("decode", "io");
+
+                    image = ImageLoader::decode(localFilePath, progress);
+                }
+
+                return materialize(image, TiledImage(), targetSize);
+            },
+            [this, localFilePath](const ImageDocument::Revision& revision) {
+                finishLoading();
+
+                /* Декодированное изображение теперь хранится в документе */
+                if (prefetchPath == localFilePath) {
+                    prefetchPath.clear();
+                    prefetch = QFuture<QImage>();
+                }
+
+                /* Файл не декодирован: прежнее изображение и история остаются, уменьшенная копия нового файла убирается */
+                if (revision.image.isNull()) {
+                    const ImageDocument::Revision current = document->current();
+
+                    setDirtyRect(QRect(), EditStack::outputSize(current.image.size(), current.operations));
+
+                    emit imageEditWithoutQueueChanged(imageUrl(document->setPreview(QImage())));
+                    emit loadFailed(localFilePath);
+
+                    return;
+                }
+
+                setDirtyRect(QRect(), revision.image.size());
+
+                emit imageEditChanged(imageUrl(document->reset(revision)));
+                emit historyChanged();
+
+                compactHistory();
+            },
+            [this, load]() {
+                if (load == loadId) {
+                    finishLoading();
+                }
+            });
+    }
+}
+
+///
+/// \brief PhotoProcessing::prefetchImage - Функция начинает декодировать изображение в фоне, пока пользователь выбирает файл.
+/// Если затем открывается этот же файл, то openImage дожидается уже начатого декодирования. Предыдущее фоновое декодирование отменяется.
+/// \param imagePath - Путь к изображению.
+///
+void PhotoProcessing::prefetchImage(const QString& imagePath)
+{
+    const QString localFilePath = QUrl(imagePath).toLocalFile();
+
+    /* Пока файл открывается, его декодирование не отменяется */
+    if (localFilePath.isEmpty() || localFilePath == prefetchPath || !loadingPath.isEmpty()) {
+        return;
+    }
+
+    cancelPrefetch();
+
+    const Tiling::CancellationToken token(prefetchGeneration, prefetchGeneration->loadAcquire());
+    const std::function<void(qreal)> progress = loadProgressReporter(localFilePath);
+
+    prefetchPath = localFilePath;
+    prefetch = QtConcurrent::run([localFilePath, token, progress]() {
+        const Tiling::CancellationScope scope(token);
+        const Trace::Scope trace("prefetch", "io");
+
+        return ImageLoader::decode(localFilePath, progress);
+    });
+}
+
+///
+/// \brief PhotoProcessing::processIncreaseScaling - Функция увеличивает изображение в 2 раза.
+/// \param filter - Фильтр масштабирования.
+///
+void PhotoProcessing::processIncreaseScaling(const ScalingFilter filter)
+{
+    appendOperation({ EditStack::Operation::Type::IncreaseScaling, static_cast<float>(filter) });
+}
+
+///
+/// \brief PhotoProcessing::processDecreaseScaling - Функция уменьшает изображение в 2 раза.
+/// \param filter - Фильтр масштабирования. Area - среднее по площади, самое быстрое уменьшение.
+///
+void PhotoProcessing::processDecreaseScaling(const ScalingFilter filter)
+{
+    appendOperation({ EditStack::Operation::Type::DecreaseScaling, static_cast<float>(filter) });
+}
+
+///
+/// \brief PhotoProcessing::processBoxBlur - Функция блюрит изображение с помощью BoxBlur или быстрого гауссиана из трех BoxBlur.
+/// \param samples - Количество проходов.
+/// \param radius - Радиус окна для Box, стандартное отклонение для FastGaussian.
+/// \param mode - Тип размытия.
+///
+void PhotoProcessing::processBoxBlur(const int samples, const int radius, const BlurMode mode)
+{
+    const ImageDocument::Revision revision = document->current();
+
+    if (!revision.image.isNull() && samples > 0 && radius >= 0) {
+        /* Передаем сигнал о начале операции в qml */
+        emit loadingStartedChanged();
+
+        previewOperation.reset();
+
+        const QSize targetSize = displaySize;
+        const Region::Mask mask = selectionMask(revision);
+
+        /* Выделению нужны соседние пиксели на всю ширину окна размытия */
+        int halo = radius * samples;
+
+        if (mode == FastGaussian) {
+            halo = 0;
+
+            for (const int passRadius : Blur::gaussianRadii(radius)) {
+                halo += qMax(passRadius, 0) * samples;
+            }
+        }
+
+        const QSharedPointer<ResultCache> cache = resultCache;
+        const QByteArray key = regionKey("blur", revision, revision.operations, { samples, radius, static_cast<int>(mode) });
+
+        /* Размытию нужны соседние пиксели, поэтому ленивые операции считаются полностью и результат материализуется */
+        scheduler->schedule(
+            "blur",
+            [revision, samples, radius, mode, targetSize, mask, halo, cache, key]() {
+                /* Тайлы, которые размытие не изменило (например, однотонный фон или все вне выделения), берутся из текущей ревизии */
+                return processRegion(
+                    revision, mask, halo,
+                    [samples, radius, mode](const QImage& image) {
+                        const Trace::Scope trace("blur", "pixels");
+
+                        return (mode == FastGaussian) ? Blur::fastGaussianBlur(image, radius, samples) : Blur::boxBlur(image, radius, samples);
+                    },
+                    targetSize, *cache, key);
+            },
+            [this](const ImageDocument::Revision& newRevision) {
+                addRevision(newRevision);
+            });
+    }
+}
+
+///
+/// \brief PhotoProcessing::processConvolution - Функция сворачивает изображение с ядром фильтра.
+/// \param filter - Фильтр свертки.
+/// \param radius - Стандартное отклонение для Gaussian и UnsharpMask.
+/// \param amount - Сила для Sharpen и UnsharpMask.
+/// \param border - Чем продолжается изображение за краем.
+///
+void PhotoProcessing::processConvolution(const ConvolutionFilter filter, const double radius, const double amount, const BorderMode border)
+{
+    const ImageDocument::Revision revision = document->current();
+
+    if (!revision.image.isNull() && radius >= 0.0) {
+        /* Передаем сигнал о начале операции в qml */
+        emit loadingStartedChanged();
+
+        previewOperation.reset();
+
+        const QSize targetSize = displaySize;
+        const Convolution::Border edges = static_cast<Convolution::Border>(border);
+        const Region::Mask mask = selectionMask(revision);
+
+        /* Остальные ядра - 3x3 */
+        int halo = (filter == Gaussian || filter == UnsharpMask) ? Convolution::haloRows(Convolution::Kernel::gaussian(radius))
+                                                                 : Convolution::haloRows(Convolution::Kernel::edgeDetect());
+
+        /* Wrap читает противоположный край изображения, поэтому операции нужно все изображение, а не выделение с ореолом */
+        if (edges == Convolution::Border::Wrap) {
+            const QSize outputSize = EditStack::outputSize(revision.image.size(), revision.operations);
+
+            halo = qMax(outputSize.width(), outputSize.height());
+        }
+
+        const QSharedPointer<ResultCache> cache = resultCache;
+        const QByteArray key
+            = regionKey("convolution", revision, revision.operations, { static_cast<int>(filter), radius, amount, static_cast<int>(border) });
+
+        /* Свертке нужны соседние пиксели, поэтому, как и размытие, она материализует изображение */
+        scheduler->schedule(
+            "convolution",
+            [revision, filter, radius, amount, edges, targetSize, mask, halo, cache, key]() {
+                return processRegion(
+                    revision, mask, halo,
+                    [filter, radius, amount, edges](const QImage& source) {
+                        const Trace::Scope trace("convolution", "pixels");
+
+                        QImage image;
+
+                        switch (filter) {
+                        case Sharpen:
+                            image = Convolution::convolve(source, Convolution::Kernel::sharpen(amount), edges);
+                            break;
+                        case UnsharpMask:
+                            image = Convolution::unsharpMask(source, radius, amount, edges);
+                            break;
+                        case Gaussian:
+                            image = Convolution::convolve(source, Convolution::Kernel::gaussian(radius), edges);
+                            break;
+                        case EdgeDetect:
+                            image = Convolution::convolve(source, Convolution::Kernel::edgeDetect(), edges);
+                            break;
+                        case Emboss:
+                            image = Convolution::convolve(source, Convolution::Kernel::emboss(), edges);
+                            break;
+                        }
+
+                        return image;
+                    },
+                    targetSize, *cache, key);
+            },
+            [this](const ImageDocument::Revision& newRevision) {
+                addRevision(newRevision);
+            });
+    }
+}
+
+///
+/// \brief PhotoProcessing::procesRgbToGray - Функция переводит изображение в grayScale.
+///
+void PhotoProcessing::processRgbToGray()
+{
+    appendOperation({ EditStack::Operation::Type::Gray, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::processToSepia - Функция накладывает филтр сепии.
+///
+void PhotoProcessing::processToSepia()
+{
+    appendOperation({ EditStack::Operation::Type::Sepia, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::processHue - Устанавливает новый тон изображению. Результат становится предпросмотром.
+/// \param hue - Ноывй тон изображения.
+///
+void PhotoProcessing::processHue(const quint8 hue)
+{
+    schedulePreview({ EditStack::Operation::Type::Hue, static_cast<float>(hue) });
+}
+
+///
+/// \brief PhotoProcessing::processContrast - Функция изменяет контраст изображение. Результат становится предпросмотром.
+/// \param contrast - Параметр контрастности, на которое будет увеличена сама яркость. От -127 до 127.
+///
+void PhotoProcessing::processContrast(const qint8 contrast)
+{
+    schedulePreview({ EditStack::Operation::Type::Contrast, static_cast<float>(contrast) });
+}
+
+///
+/// \brief PhotoProcessing::processAutoLevels - Функция растягивает каждый канал по его гистограмме: черная и белая точки выбираются отдельно для каждого канала.
+///
+void PhotoProcessing::processAutoLevels()
+{
+    appendLevels(true);
+}
+
+///
+/// \brief PhotoProcessing::processAutoContrast - Функция растягивает контраст по гистограмме яркости одинаково для всех каналов.
+///
+void PhotoProcessing::processAutoContrast()
+{
+    appendLevels(false);
+}
+
+///
+/// \brief PhotoProcessing::processBrightness - Функция изменяет яркость изображение. Результат становится предпросмотром.
+/// \param brightness - Параметр яркости, на которое будет увеличена сама яркость. От 0.0 до 2.0.
+///
+void PhotoProcessing::processBrightness(const float brightness)
+{
+    /* Пиксели, у которых хотя бы один канал равен нулю, не изменяются */
+    schedulePreview({ EditStack::Operation::Type::Brightness, brightness });
+}
+
+///
+/// \brief PhotoProcessing::processRotate - Функция делает разворот изображения на 90 градусов против часовой стрелки.
+///
+void PhotoProcessing::processRotate()
+{
+    appendOperation({ EditStack::Operation::Type::Rotate, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::processRotateClockwise - Функция делает разворот изображения на 90 градусов по часовой стрелке.
+///
+void PhotoProcessing::processRotateClockwise()
+{
+    appendOperation({ EditStack::Operation::Type::RotateClockwise, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::processRotate180 - Функция делает разворот изображения на 180 градусов.
+///
+void PhotoProcessing::processRotate180()
+{
+    appendOperation({ EditStack::Operation::Type::Rotate180, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::processFlipHorizontal - Функция отражает изображение слева направо.
+///
+void PhotoProcessing::processFlipHorizontal()
+{
+    appendOperation({ EditStack::Operation::Type::FlipHorizontal, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::processFlipVertical - Функция отражает изображение сверху вниз.
+///
+void PhotoProcessing::processFlipVertical()
+{
+    appendOperation({ EditStack::Operation::Type::FlipVertical, 0.0f });
+}
+
+///
+/// \brief PhotoProcessing::clearSelection - Функция снимает выделение: операции снова меняют все изображение.
+///
+void PhotoProcessing::clearSelection()
+{
+    if (!selectionArea.isEmpty() || !customSelection.isNull()) {
+        selectionArea = QRectF();
+        customSelection = Region::Mask();
+
+        emit selectionChanged();
+    }
+}
+
+///
+/// \brief PhotoProcessing::commitPreview - Функция добавляет последнюю операцию предпросмотра в стек правок текущей ревизии.
+///
+void PhotoProcessing::commitPreview()
+{
+    if (previewOperation.has_value()) {
+        const EditStack::Operation operation = *previewOperation;
+
+        appendOperation(operation);
+    }
+}
+
+///
+/// \brief PhotoProcessing::undo - Функция показывает предыдущую ревизию.
+///
+void PhotoProcessing::undo()
 {
+    cancelJobs();
+
+    const ImageDocument::Revision previous = document->current();
+
+    if (document->undo()) {
+        const ImageDocument::Revision revision = document->current();
+
+        /* Без ленивых операций показанное изображение - это тайлы, поэтому изменилось только то, что покрывают разные тайлы */
+        const bool tiled = previous.operations.isEmpty() && revision.operations.isEmpty();
+
+        setDirtyRect(tiled ? revision.tiles.changedRect(previous.tiles) : QRect(), EditStack::outputSize(revision.image.size(), revision.operations));
+
+        emit imageEditWithoutQueueChanged(imageUrl(document->current().version));
+        emit historyChanged();
+
+        restoreLevels();
+    }
 }
 
 ///
-/// \brief PhotoProcessing::processIncreaseScaling - Функция увеличивает изображение в 2 раза используя метод ближайшего соседа.
-/// \param imagePath - Путь к изображению.
+/// \brief PhotoProcessing::redo - Функция показывает следующую ревизию.
 ///
-void PhotoProcessing::processIncreaseScaling(const QString& imagePath)
+void PhotoProcessing::redo()
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    cancelJobs();
 
-    if (!localFilePath.isEmpty()) {
-        /* Так как scale трудоемкая операция, запускаем ее в другом потоке. */
-        QtConcurrent::run([=]() {
-            /* Передаем сигнал о начале операции в qml */
-            emit loadingStartedChanged();
+    const ImageDocument::Revision previous = document->current();
 
-            QImage image(localFilePath);
-            QImage newImage(image.width() * 2, image.height() * 2, image.format());
+    if (document->redo()) {
+        const ImageDocument::Revision revision = document->current();
 
-            int newImagePixelY = 0;
-            for (int y = 0; y < image.height(); ++y) {
-                int newImagePixelX = 0;
+        /* Без ленивых операций показанное изображение - это тайлы, поэтому изменилось только то, что покрывают разные тайлы */
+        const bool tiled = previous.operations.isEmpty() && revision.operations.isEmpty();
 
-                for (int x = 0; x < image.width(); ++x) {
-                    /* Дублируем пиксель через один */
-                    newImage.setPixelColor(newImagePixelX, newImagePixelY, image.pixelColor(x, y));
-                    newImage.setPixelColor(newImagePixelX + 1, newImagePixelY, image.pixelColor(x, y));
+        setDirtyRect(tiled ? revision.tiles.changedRect(previous.tiles) : QRect(), EditStack::outputSize(revision.image.size(), revision.operations));
 
-                    /* Доблируем предыдущий ряд пискелей */
-                    newImage.setPixelColor(newImagePixelX, newImagePixelY + 1, image.pixelColor(x, y));
-                    newImage.setPixelColor(newImagePixelX + 1, newImagePixelY + 1, image.pixelColor(x, y));
+        emit imageEditWithoutQueueChanged(imageUrl(document->current().version));
+        emit historyChanged();
 
-                    newImagePixelX += 2;
-                }
+        restoreLevels();
+    }
+}
 
-                /* Пропускаем однин ряд в матрице исходного изображения */
-                newImagePixelY += 2;
-            }
+///
+/// \brief PhotoProcessing::restore - Функция возвращает исходное изображение и очищает историю.
+///
+void PhotoProcessing::restore()
+{
+    cancelJobs();
 
-            /* Отправляем новое изображение в qml */
-            setUpNewImage(newImage, imagePath, AddWithHistory);
-        });
+    const quint64 version = document->restore();
+
+    if (version != 0) {
+        setDirtyRect(QRect(), document->current().image.size());
+
+        emit imageEditWithoutQueueChanged(imageUrl(version));
+        emit historyChanged();
+
+        restoreLevels();
     }
 }
 
 ///
-/// \brief PhotoProcessing::processDecreaseScaling - Функция уменьшает изображение в 2 раза используя метод ближайшего соседа.
-/// \param imagePath - Путь к изображению.
+/// \brief PhotoProcessing::exportImage - Функция в фоне сохраняет изображение вместе с предпросмотром по новому пути. Только здесь изображение кодируется и пишется на диск.
+/// Результат передается сигналом exportFinished.
+/// \param newImagePath - Новый путь файла. Если у него нет расширения, то берется расширение исходного файла.
+/// \param format - Формат (png, jpg, webp...). Пустой формат берется из расширения файла.
+/// \param quality - Качество от 0 до 100 для форматов с потерями, -1 - по умолчанию.
+/// \param compression - Уровень сжатия без потерь (для PNG от 0 до 9, 1 - быстрое сжатие для черновиков), -1 - по умолчанию.
 ///
-void PhotoProcessing::processDecreaseScaling(const QString& imagePath)
+void PhotoProcessing::exportImage(const QString& newImagePath, const QString& format, const int quality, const int compression)
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    const ImageDocument::Revision revision = document->current();
+    QString newFilePath = QUrl(newImagePath).toLocalFile();
 
-    if (!localFilePath.isEmpty()) {
-        /* Так как scale трудоемкая операция, запускаем ее в другом потоке. */
-        QtConcurrent::run([=]() {
-            /* Передаем сигнал о начале операции в qml */
-            emit loadingStartedChanged();
-
-            QImage image(localFilePath);
-            QImage newImage(image.width() / 2, image.height() / 2, image.format());
-
-            /* Удаляем не масштабированную копию изображения */
-            for (int y = 0; y < newImage.height(); ++y) {
-                for (int x = 0; x < newImage.width(); ++x) {
-                    newImage.setPixelColor(x, y, QColor(0, 0, 0, 0));
-                }
-            }
+    if (revision.image.isNull() || newFilePath.isEmpty()) {
+        emit exportFinished(false, newFilePath, tr("Нет изображения или пути файла"));
 
-            /* Вставляем каждый третий пиксель (начиная с 0) в новое изображение  */
-            int newImagePixelY = 0;
-            for (int y = 0; y < newImage.height(); ++y) {
-                int newImagePixelX = 0;
+        return;
+    }
 
-                for (int x = 0; x < newImage.width(); ++x) {
-                    newImage.setPixelColor(x, y, image.pixelColor(newImagePixelX, newImagePixelY));
-                    newImagePixelX += 2;
-                }
+    if (QFileInfo(newFilePath).suffix().isEmpty()) {
+        newFilePath = newFilePath % "." % (format.isEmpty() ? sourceSuffix : format);
+    }
 
-                /* Пропускаем однин ряд в матрице исходного изображения */
-                newImagePixelY += 2;
-            }
+    /* Полное изображение считается только здесь: весь стек правок и несохраненный предпросмотр за один проход */
+    exporter->start(newFilePath, revision.image, operationsWithPreview(revision), { format, quality, compression });
+}
+
+///
+/// \brief PhotoProcessing::cancelExport - Функция отменяет запись файла. Существующий файл не изменяется.
+///
+void PhotoProcessing::cancelExport()
+{
+    exporter->cancel();
+}
+
+///
+/// \brief PhotoProcessing::saveTrace - Функция записывает все замеренные фазы в файл формата Chrome trace event (chrome://tracing, Perfetto).
+/// \param tracePath - Путь файла.
+/// \return Возвращает 'true', если файл записан.
+///
+bool PhotoProcessing::saveTrace(const QString& tracePath)
+{
+    const QString localFilePath = QUrl(tracePath).isLocalFile() ? QUrl(tracePath).toLocalFile() : tracePath;
+
+    return Trace::writeChromeTrace(localFilePath).isEmpty();
+}
+
+///
+/// \brief PhotoProcessing::reportImageReady - Функция вызывается из qml по сигналу ImageView::frameReady, когда все видимые тайлы нового изображения загружены. Замеряет фазу reload.
+///
+void PhotoProcessing::reportImageReady()
+{
+    /* reload - от обработки результата операции до кадра ImageView, в котором загружены все видимые тайлы */
+    if (operationHandled >= 0) {
+        Trace::record("reload", "qml", operationHandled, Trace::now());
 
-            /* Отправляем новое изображение в qml */
-            setUpNewImage(newImage, imagePath, AddWithHistory);
-        });
+        operationHandled = -1;
+
+        updateTimings();
     }
 }
 
 ///
-/// \brief PhotoProcessing::processBoxBlur - Функция обрабатывает блюрит изображение с помощью BoxBlur.
-/// \param imagePath - Путь к изображению.
+/// \brief PhotoProcessing::materialize - Функция создает ревизию из готового изображения: разбивает его на тайлы, строит пирамиду и изображение для экрана.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param previous - Тайлы предыдущей ревизии, неизмененные тайлы берутся из нее.
+/// \param targetSize - Размер области на экране.
+/// \param changed - Прямоугольник, вне которого image совпадает с previous. Пустой прямоугольник - изменилось все изображение.
+/// \param previousLevels - Пирамида previous. Если changed задан, на уровнях пересчитывается только он.
 ///
-void PhotoProcessing::processBoxBlur(const QString& imagePath, const int samples)
+ImageDocument::Revision PhotoProcessing::materialize(const QImage& image, const TiledImage& previous, const QSize& targetSize, const QRect& changed,
+    const QVector<QImage>& previousLevels)
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    ImageDocument::Revision revision;
+    revision.image = image;
 
-    if (!localFilePath.isEmpty()) {
-        /* Так как BoxBlur трудоемкая операция, запускаем ее в другом потоке. */
-        QtConcurrent::run([=]() {
-            /* Передаем сигнал о начале операции в qml */
-            emit loadingStartedChanged();
-
-            QImage image(localFilePath);
-            QImage newImage = image;
-
-            /* Прогоняем операцию столько раз, сколько захотел пользователь */
-            for (int k = 0; k < samples; k++) {
-                for (int y = 0; y < newImage.height(); ++y) {
-                    for (int x = 0; x < newImage.width(); ++x) {
-                        /* Проверяем на прозрачный пиксель */
-                        if (newImage.pixelColor(x, y).red() != 0 && newImage.pixelColor(x, y).green() != 0 && newImage.pixelColor(x, y).blue() != 0 && newImage.pixelColor(x, y).alpha() != 0) {
-                            int redTotal = 0;
-                            int greenTotal = 0;
-                            int blueTotal = 0;
-                            int alphaTotal = 0;
-
-                            /* Подсчитываем общее кол-во RGB пикселей вокруг x, y */
-                            for (int i = -1; i <= 1; i++) {
-                                for (int j = -1; j <= 1; j++) {
-                                    int currentX = x + j;
-                                    int currentY = y + j;
-
-                                    if (currentX >= 0 && currentY >= 0 && currentX < newImage.width() && currentY < newImage.height()) {
-                                        QColor pixel = newImage.pixel(currentX, currentY);
-
-                                        redTotal += pixel.red();
-                                        greenTotal += pixel.green();
-                                        blueTotal += pixel.blue();
-                                        alphaTotal += pixel.alpha();
-                                    }
-                                }
-                            }
+    {
+        const Trace::Scope trace("tiles", "pixels");
 
-                            /* Применяем эффект блюра на пиксель */
-                            newImage.setPixelColor(x, y, QColor(redTotal / blurMatrixLength, greenTotal / blurMatrixLength, blueTotal / blurMatrixLength, alphaTotal / blurMatrixLength));
-                        }
-                    }
-                }
-            }
+        revision.tiles = TiledImage::fromImage(image, previous, changed);
+    }
+
+    /* Пирамида строится один раз для каждого материализованного изображения */
+    const Trace::Scope trace("pyramid", "pixels");
+
+    revision.levels = Pyramid::update(image, previousLevels, changed);
+    revision.view = Pyramid::level(image, revision.levels, targetSize);
+
+    return revision;
+}
+
+///
+/// \brief PhotoProcessing::processRegion - Функция считает результат ревизии и применяет к нему операцию внутри маски.
+/// Если у ревизии нет ленивых операций, тайлы и пирамида пересчитываются только под измененным прямоугольником.
+/// \param revision - Текущая ревизия.
+/// \param mask - Выделение в пикселях результата ревизии.
+/// \param halo - Сколько соседних пикселей читает операция.
+/// \param operation - Операция, которая не меняет размер изображения.
+/// \param targetSize - Размер области на экране.
+/// \param cache - Кэш результатов.
+/// \param key - Ключ результата в кэше (regionKey()). Пустой ключ - результат не кэшируется.
+///
+ImageDocument::Revision PhotoProcessing::processRegion(const ImageDocument::Revision& revision, const Region::Mask& mask, const int halo,
+    const std::function<QImage(const QImage&)>& operation, const QSize& targetSize, ResultCache& cache, const QByteArray& key)
+{
+    QImage image = cache.find(key);
+    QRect changed;
+
+    if (!image.isNull()) {
+        /* Найденный результат меняет тот же прямоугольник, что и посчитанный */
+        changed = mask.bounds(image.size());
+    } else {
+        {
+            const Trace::Scope trace("render", "pixels");
 
-            /* Отправляем новое изображение в qml */
-            setUpNewImage(newImage, imagePath, AddWithHistory);
-        });
+            image = EditStack::render(revision.image, revision.operations);
+        }
+
+        image = Region::apply(image, mask, halo, operation, changed);
+
+        if (!Tiling::isCancelled()) {
+            cache.insert(key, image);
+        }
     }
+
+    /* Тайлы и пирамида ревизии относятся к revision.image, с результатом стека их можно сравнивать по прямоугольнику, только если стек пустой */
+    const bool incremental = !mask.isNull() && revision.operations.isEmpty();
+
+    ImageDocument::Revision newRevision = incremental ? materialize(image, revision.tiles, targetSize, changed, revision.levels)
+                                                      : materialize(image, revision.tiles, targetSize);
+    newRevision.dirty = mask.isNull() ? QRect() : changed;
+
+    return newRevision;
 }
 
 ///
-/// \brief PhotoProcessing::procesRgbToGray - Функция переводит изображение в grayScale.
-/// \param imagePath - Путь к изображению.
+/// \brief PhotoProcessing::appendOperation - Функция добавляет ревизию с новой ленивой операцией. Полное изображение не считается, только изображение для экрана.
+/// \param operation - Новая операция.
 ///
-void PhotoProcessing::processRgbToGray(const QString& imagePath)
+void PhotoProcessing::appendOperation(const EditStack::Operation& operation)
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    ImageDocument::Revision revision = document->current();
 
-    if (!localFilePath.isEmpty()) {
-        QtConcurrent::run([=]() {
-            /* Передаем сигнал о начале операции в qml */
-            emit loadingStartedChanged();
+    if (!revision.image.isNull()) {
+        /* Передаем сигнал о начале операции в qml */
+        emit loadingStartedChanged();
+
+        previewOperation.reset();
 
-            QImage image(localFilePath);
+        /* Геометрия сдвигает пиксели под выделением, поэтому она применяется ко всему изображению и снимает выделение */
+        if (EditStack::isGeometry(operation)) {
+            clearSelection();
+        }
+
+        const QSize targetSize = displaySize;
+        const Region::Mask mask = selectionMask(revision);
+
+        const QSharedPointer<ResultCache> cache = resultCache;
+
+        /* Поточечная правка внутри выделения не ложится в ленивый стек, поэтому она материализуется только под выделением */
+        if (!mask.isNull()) {
+            const QByteArray key = regionKey("edit", revision, revision.operations + QVector<EditStack::Operation> { operation }, {});
+
+            scheduler->schedule(
+                "edit",
+                [revision, operation, mask, targetSize, cache, key]() {
+                    return processRegion(
+                        revision, mask, 0,
+                        [operation](const QImage& image) {
+                            const Trace::Scope trace("edit", "pixels");
+
+                            return EditStack::render(image, { operation });
+                        },
+                        targetSize, *cache, key);
+                },
+                [this](const ImageDocument::Revision& newRevision) {
+                    addRevision(newRevision);
+                });
+
+            return;
+        }
 
-            for (int i = 0; i < image.width(); i++) {
-                for (int j = 0; j < image.height(); j++) {
-                    QColor pixelColor = image.pixelColor(i, j);
+        revision.operations.append(operation);
+        revision.dirty = QRect();
 
-                    /* Проверяем на прозрачный пиксель */
-                    if (pixelColor.alpha() != 0) {
-                        int gray = (pixelColor.red() * 11 + pixelColor.green() * 16 + pixelColor.blue() * 5) / 32;
+        /* Тот же ключ, что у предпросмотра: после commitPreview изображение для экрана уже посчитано */
+        const QByteArray key = resultKey("view", revision, revision.operations, { targetSize });
 
-                        image.setPixel(i, j, QColor(gray, gray, gray, pixelColor.alpha()).rgb());
+        scheduler->schedule(
+            "edit",
+            [revision, targetSize, cache, key]() {
+                const Trace::Scope trace("render view", "pixels");
+
+                ImageDocument::Revision newRevision = revision;
+                newRevision.view = cache->find(key);
+
+                if (newRevision.view.isNull()) {
+                    newRevision.view = EditStack::renderView(revision.image, revision.levels, revision.operations, targetSize);
+
+                    if (!Tiling::isCancelled()) {
+                        cache->insert(key, newRevision.view);
                     }
                 }
-            }
 
-            setUpNewImage(image, localFilePath, AddWithHistory);
-        });
+                return newRevision;
+            },
+            [this](const ImageDocument::Revision& newRevision) {
+                addRevision(newRevision);
+            });
     }
 }
 
 ///
-/// \brief PhotoProcessing::processToSepia - Функция накладывает филтр сепии.
-/// \param imagePath - Путь к изображению.
+/// \brief PhotoProcessing::appendLevels - Функция добавляет ревизию с уровнями, посчитанными по гистограммам текущей ревизии.
+/// \param perChannel - 'true' - автоуровни по каждому каналу, 'false' - автоконтраст по яркости.
 ///
-void PhotoProcessing::processToSepia(const QString& imagePath)
+void PhotoProcessing::appendLevels(const bool perChannel)
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    const ImageDocument::Revision revision = document->current();
 
-    if (!localFilePath.isEmpty()) {
-        QtConcurrent::run([=]() {
-            /* Передаем сигнал о начале операции в qml */
-            emit loadingStartedChanged();
+    if (!revision.image.isNull()) {
+        /* Передаем сигнал о начале операции в qml */
+        emit loadingStartedChanged();
 
-            QImage image(localFilePath);
+        previewOperation.reset();
 
-            for (int i = 0; i < image.width(); i++) {
-                for (int j = 0; j < image.height(); j++) {
-                    QColor pixelColor = image.pixelColor(i, j);
+        const QSize targetSize = displaySize;
+        const QSharedPointer<Histogram::TileCache> cache = statisticsCache;
+        const Region::Mask mask = selectionMask(revision);
 
-                    /* Проверяем на прозрачный пиксель */
-                    if (pixelColor.alpha() != 0) {
-                        int red = (pixelColor.red() * .393) + (pixelColor.green() * .769) + (pixelColor.blue() * .189);
-                        int green = (pixelColor.red() * .349) + (pixelColor.green() * .686) + (pixelColor.blue() * .168);
-                        int blue = (pixelColor.red() * .272) + (pixelColor.green() * .534) + (pixelColor.blue() * .131);
+        const QSharedPointer<ResultCache> results = resultCache;
 
-                        image.setPixel(i, j, QColor(red, green, blue, pixelColor.alpha()).rgb());
+        /* Внутри выделения точки уровней выбираются по гистограммам самого выделения */
+        if (!mask.isNull()) {
+            const QByteArray key = regionKey("levels", revision, revision.operations, { perChannel });
+
+            scheduler->schedule(
+                "levels",
+                [revision, mask, targetSize, perChannel, results, key]() {
+                    return processRegion(
+                        revision, mask, 0,
+                        [perChannel](const QImage& image) {
+                            EditStack::Operation levels { EditStack::Operation::Type::Levels, 0.0f };
+
+                            {
+                                const Trace::Scope trace("histogram", "pixels");
+
+                                const Histogram::Statistics imageStatistics = Histogram::compute(image);
+
+                                levels.levels = perChannel ? Histogram::autoLevels(imageStatistics, levelsClip)
+                                                           : Histogram::autoContrast(imageStatistics, levelsClip);
+                            }
+
+                            const Trace::Scope trace("levels", "pixels");
+
+                            return EditStack::render(image, { levels });
+                        },
+                        targetSize, *results, key);
+                },
+                [this](const ImageDocument::Revision& newRevision) {
+                    addRevision(newRevision);
+                });
+
+            return;
+        }
+
+        scheduler->schedule(
+            "levels",
+            [revision, targetSize, cache, perChannel, results]() {
+                /* Уровни - обычная ленивая операция стека, гистограммы нужны только чтобы выбрать ее точки */
+                EditStack::Operation levels { EditStack::Operation::Type::Levels, 0.0f };
+
+                {
+                    const Trace::Scope trace("histogram", "pixels");
+
+                    const Histogram::Statistics imageStatistics = levelsStatistics(revision, *cache);
+
+                    levels.levels = perChannel ? Histogram::autoLevels(imageStatistics, levelsClip) : Histogram::autoContrast(imageStatistics, levelsClip);
+                }
+
+                const Trace::Scope trace("render view", "pixels");
+
+                ImageDocument::Revision newRevision = revision;
+                newRevision.operations.append(levels);
+                newRevision.dirty = QRect();
+
+                /* Гистограммы считаются всегда, а изображение для экрана с теми же уровнями берется из кэша */
+                const QByteArray key = resultKey("view", newRevision, newRevision.operations, { targetSize });
+
+                newRevision.view = results->find(key);
+
+                if (newRevision.view.isNull()) {
+                    newRevision.view = EditStack::renderView(revision.image, revision.levels, newRevision.operations, targetSize);
+
+                    if (!Tiling::isCancelled()) {
+                        results->insert(key, newRevision.view);
                     }
                 }
-            }
 
-            setUpNewImage(image, localFilePath, AddWithHistory);
-        });
+                return newRevision;
+            },
+            [this](const ImageDocument::Revision& newRevision) {
+                addRevision(newRevision);
+            });
     }
 }
 
 ///
-/// \brief PhotoProcessing::processHue - Устанавливает новый тон изображению.
-/// \param imagePath - Путь к изображению.
-/// \param hue - Ноывй тон изображения.
+/// \brief PhotoProcessing::schedulePreview - Функция запоминает операцию предпросмотра и считает ее поверх текущей ревизии в размере экрана.
+/// \param operation - Операция предпросмотра.
 ///
-void PhotoProcessing::processHue(const QString& imagePath, const quint8 hue)
+void PhotoProcessing::schedulePreview(const EditStack::Operation& operation)
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    const ImageDocument::Revision revision = document->current();
+
+    if (!revision.image.isNull()) {
+        previewOperation = operation;
+
+        const QVector<EditStack::Operation> operations = operationsWithPreview(revision);
+        const QSize targetSize = displaySize;
+        const QSize outputSize = EditStack::outputSize(revision.image.size(), revision.operations);
+        const Region::Mask mask = selectionMask(revision);
+
+        /* Ползунок, вернувшийся к прежнему значению, получает предпросмотр из кэша */
+        const QSharedPointer<ResultCache> cache = resultCache;
+        const QByteArray key = mask.isNull() ? resultKey("view", revision, operations, { targetSize })
+                                             : regionKey("preview", revision, operations, { targetSize });
+
+        scheduler->schedule(
+            "preview",
+            [revision, operations, operation, targetSize, outputSize, mask, cache, key]() {
+                const Trace::Scope trace("render view", "pixels");
+
+                QImage image = cache->find(key);
+
+                if (image.isNull()) {
+                    if (mask.isNull()) {
+                        image = EditStack::renderView(revision.image, revision.levels, operations, targetSize);
+                    } else {
+                        /* Выделение задано в пикселях полного результата, а предпросмотр считается по уменьшенной копии */
+                        const QImage view = EditStack::renderView(revision.image, revision.levels, revision.operations, targetSize);
+
+                        QRect changed;
+                        image = Region::apply(view,
+                            mask.scaled(static_cast<qreal>(view.width()) / outputSize.width(), static_cast<qreal>(view.height()) / outputSize.height()), 0,
+                            [operation](const QImage& image) { return EditStack::render(image, { operation }); }, changed);
+                    }
 
-    if (!localFilePath.isEmpty()) {
-        QtConcurrent::run([=]() {
-            QImage image(localFilePath);
+                    if (!Tiling::isCancelled()) {
+                        cache->insert(key, image);
+                    }
+                }
 
-            for (int i = 0; i < image.width(); i++) {
-                for (int j = 0; j < image.height(); j++) {
-                    QColor pixelColor = image.pixelColor(i, j);
+                return image;
+            },
+            [this, outputSize, mask](const QImage& image) {
+                setDirtyRect(mask.bounds(outputSize), outputSize);
 
-                    pixelColor.setHsv(hue, pixelColor.saturation(), pixelColor.value(), pixelColor.alpha());
-                    image.setPixelColor(i, j, pixelColor);
-                }
-            }
+                emit imageEditWithoutQueueChanged(imageUrl(document->setPreview(image)));
+            });
+    }
+}
 
-            setUpNewImage(image, localFilePath, AddWithoutHistory);
-        });
+///
+/// \brief PhotoProcessing::operationsWithPreview - Функция возвращает стек правок ревизии вместе с несохраненной операцией предпросмотра.
+/// \param revision - Ревизия.
+///
+QVector<EditStack::Operation> PhotoProcessing::operationsWithPreview(const ImageDocument::Revision& revision) const
+{
+    QVector<EditStack::Operation> operations = revision.operations;
+
+    if (previewOperation.has_value()) {
+        operations.append(*previewOperation);
     }
+
+    return operations;
 }
 
 ///
-/// \brief PhotoProcessing::processContrast - Функция изменяет контраст изображение.
-/// \param tmpImagePath - Путь к изображению, которое будет изменено.
-/// \param savePath - Путь по которому будет сохранено изменное изображение
-/// \param contrast - Параметр контрастности, на которое будет увеличена сама яркость. От -127 до 127.
+/// \brief PhotoProcessing::regionKey - Функция возвращает ключ результата операции над ревизией с учетом выделения.
+/// \param operation - Имя операции, строковый литерал.
+/// \param revision - Ревизия.
+/// \param operations - Стек правок, результат которого используется.
+/// \param parameters - Параметры операции.
+/// \return Ключ или пустой ключ, если выделение задано маской произвольной формы и результат не кэшируется.
 ///
-void PhotoProcessing::processContrast(const QString& tmpImagePath, const QString& savePath, const qint8 contrast)
-{
-    if (!tmpImagePath.isEmpty()) {
-        QtConcurrent::run([=]() {
-            QImage image(tmpImagePath);
-
-            /*
-             * Высчитываем коэффициент коррекции контраста по формуле: (259 * (C + 255)) / (255 * (259 - C))
-             * Где C - введеное пользователем значение.
-             */
-            float factor = (259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast));
-
-            for (int i = 0; i < image.width(); i++) {
-                for (int j = 0; j < image.height(); j++) {
-                    QColor pixelColor = image.pixelColor(i, j);
-
-                    /* Проверяем на прозрачный пиксель */
-                    if (pixelColor.alpha() != 0) {
-                        /*
-                         * Высчитываем новый цвет по формуле: C' = F * (C - 128) + 128
-                         * Где C - цвет, а F - коэффициент коррекции контраста.
-                         */
-                        QRgb red = truncatePixelValue(factor * (pixelColor.red() - 128) + 128);
-                        QRgb green = truncatePixelValue(factor * (pixelColor.green() - 128) + 128);
-                        QRgb blue = truncatePixelValue(factor * (pixelColor.blue() - 128) + 128);
-
-                        image.setPixel(i, j, QColor(red, green, blue, pixelColor.alpha()).rgba());
-                    }
+QByteArray PhotoProcessing::regionKey(const char* operation, const ImageDocument::Revision& revision, const QVector<EditStack::Operation>& operations,
+    const QVariantList& parameters) const
+{
+    /* Сравнивать маски попиксельно дороже, чем пересчитать результат */
+    if (!customSelection.isNull()) {
+        return QByteArray();
+    }
+
+    return resultKey(operation, revision, operations, QVariantList(parameters) << selectionArea << selectionSoftness);
+}
+
+///
+/// \brief PhotoProcessing::selectionMask - Функция возвращает выделение в пикселях результата ревизии. Пустая маска - выделено все изображение.
+/// \param revision - Ревизия.
+///
+Region::Mask PhotoProcessing::selectionMask(const ImageDocument::Revision& revision) const
+{
+    if (!customSelection.isNull() || selectionArea.isEmpty()) {
+        return customSelection;
+    }
+
+    const QSize outputSize = EditStack::outputSize(revision.image.size(), revision.operations);
+    const QRect rect = QRectF(selectionArea.x() * outputSize.width(), selectionArea.y() * outputSize.height(), selectionArea.width() * outputSize.width(),
+        selectionArea.height() * outputSize.height())
+                           .toAlignedRect()
+                           .intersected(QRect(QPoint(0, 0), outputSize));
+
+    return Region::Mask::fromRegion(QRegion(rect), selectionSoftness);
+}
+
+///
+/// \brief PhotoProcessing::setDirtyRect - Функция запоминает измененный прямоугольник нового показанного изображения и передает его в qml.
+/// \param rect - Прямоугольник в пикселях. Пустой прямоугольник - изменилось все изображение.
+/// \param size - Размер изображения.
+///
+void PhotoProcessing::setDirtyRect(const QRect& rect, const QSize& size)
+{
+    if (rect.isEmpty() || size.isEmpty()) {
+        currentDirtyRect = QRectF(0.0, 0.0, 1.0, 1.0);
+    } else {
+        currentDirtyRect = QRectF(static_cast<qreal>(rect.x()) / size.width(), static_cast<qreal>(rect.y()) / size.height(),
+            static_cast<qreal>(rect.width()) / size.width(), static_cast<qreal>(rect.height()) / size.height());
+    }
+
+    /* Сигнал передается и при том же прямоугольнике: пиксели внутри него все равно новые */
+    emit dirtyRectChanged();
+}
+
+///
+/// \brief PhotoProcessing::cancelJobs - Функция отменяет выполняемую и ожидающую операции и сбрасывает предпросмотр.
+///
+void PhotoProcessing::cancelJobs()
+{
+    scheduler->cancel();
+
+    previewOperation.reset();
+}
+
+///
+/// \brief PhotoProcessing::addRevision - Функция добавляет ревизию в документ и устанавливает ее в UI. Вызывается в главном потоке.
+/// \param revision - Новая ревизия.
+///
+void PhotoProcessing::addRevision(const ImageDocument::Revision& revision)
+{
+    setDirtyRect(revision.dirty, EditStack::outputSize(revision.image.size(), revision.operations));
+
+    emit imageEditChanged(imageUrl(document->addRevision(revision)));
+    emit historyChanged();
+
+    compactHistory();
+}
+
+///
+/// \brief PhotoProcessing::compactHistory - Функция укладывает историю в бюджет: в фоне сжимает старые тайлы, вытесняет их на диск, затем удаляет лишние ревизии.
+///
+void PhotoProcessing::compactHistory()
+{
+    /* Одновременно идет только одно сжатие, запрос во время него повторяет проверку после его завершения */
+    if (compactionRunning) {
+        compactionPending = true;
+
+        return;
+    }
+
+    compactionRunning = true;
+
+    const QSharedPointer<ImageDocument> history = document;
+    const bool compressed = compressHistory;
+
+    compaction = QtConcurrent::run([this, history, compressed]() {
+        if (compressed) {
+            history->compress();
+        }
+
+        history->spill();
+
+        const bool trimmed = history->trim();
+
+        QMetaObject::invokeMethod(
+            this, [this, trimmed]() {
+                compactionRunning = false;
+
+                if (trimmed) {
+                    emit historyChanged();
                 }
-            }
 
-            setUpNewImage(image, savePath, AddWithoutHistory);
-        });
+                if (compactionPending) {
+                    compactionPending = false;
+
+                    compactHistory();
+                }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+///
+/// \brief PhotoProcessing::restoreLevels - Функция в фоне перестраивает пирамиду текущей ревизии, если она была удалена ради бюджета.
+///
+void PhotoProcessing::restoreLevels()
+{
+    const ImageDocument::Revision revision = document->current();
+
+    if (revision.image.isNull() || !revision.levels.isEmpty()) {
+        return;
+    }
+
+    /* Пока пирамиды нет, предпросмотр считается по полному изображению */
+    const QSharedPointer<ImageDocument> history = document;
+
+    QThreadPool::globalInstance()->start([history, revision]() {
+        history->setLevels(revision.tiles, Pyramid::build(revision.image));
+    });
+}
+
+///
+/// \brief PhotoProcessing::statistics - Функция считает гистограммы того, что показывает ревизия.
+/// Если стек правок только переставляет пиксели, гистограммы считаются по тайлам полного изображения и пересчитываются только для измененных тайлов,
+/// иначе - по изображению для экрана с уже примененным стеком.
+/// \param revision - Ревизия или предпросмотр.
+/// \param cache - Гистограммы тайлов предыдущего расчета.
+///
+Histogram::Statistics PhotoProcessing::statistics(const ImageDocument::Revision& revision, Histogram::TileCache& cache)
+{
+    if (!revision.image.isNull() && !revision.tiles.isNull() && preservesHistogram(revision.operations)) {
+        return cache.compute(revision.image, revision.tiles);
     }
+
+    return Histogram::compute(revision.viewImage());
 }
 
 ///
-/// \brief PhotoProcessing::processBrightness - Функция изменяет яркость изображение.
-/// \param tmpImagePath - Путь к изображению, которое будет изменено.
-/// \param savePath - Путь по которому будет сохранено изменное изображение
-/// \param brightness - Параметр яркости, на которое будет увеличена сама яркость. От 0.0 до 2.0.
+/// \brief PhotoProcessing::levelsStatistics - Функция считает гистограммы результата стека правок в полном размере, по ним выбираются точки автоуровней.
+/// Уровни применяются к полному изображению, поэтому, как и в пакетном режиме, точки не зависят от размера окна.
+/// \param revision - Ревизия.
+/// \param cache - Гистограммы тайлов предыдущего расчета.
 ///
-void PhotoProcessing::processBrightness(const QString& tmpImagePath, const QString& savePath, const float brightness)
+Histogram::Statistics PhotoProcessing::levelsStatistics(const ImageDocument::Revision& revision, Histogram::TileCache& cache)
 {
-    if (!tmpImagePath.isEmpty()) {
-        QtConcurrent::run([=]() {
-            QImage image(tmpImagePath);
+    if (!revision.tiles.isNull() && preservesHistogram(revision.operations)) {
+        return cache.compute(revision.image, revision.tiles);
+    }
+
+    if (!EditStack::isPointwise(revision.operations)) {
+        return Histogram::compute(EditStack::render(revision.image, revision.operations));
+    }
 
-            for (int i = 0; i < image.width(); i++) {
-                for (int j = 0; j < image.height(); j++) {
-                    QColor pixelColor = image.pixelColor(i, j);
+    Histogram::Statistics result;
 
-                    /* Проверяем на прозрачный пиксель */
-                    if (pixelColor.red() != 0 && pixelColor.green() != 0 && pixelColor.blue() != 0 && pixelColor.alpha() != 0) {
-                        QRgb red = truncatePixelValue(pixelColor.red() * brightness);
-                        QRgb green = truncatePixelValue(pixelColor.green() * brightness);
-                        QRgb blue = truncatePixelValue(pixelColor.blue() * brightness);
+    for (int y = 0; y < revision.image.height() && !Tiling::isCancelled(); y += levelsBandRows) {
+        const QImage band = revision.image.copy(0, y, revision.image.width(), qMin(levelsBandRows, revision.image.height() - y));
 
-                        image.setPixel(i, j, QColor(red, green, blue, pixelColor.alpha()).rgba());
-                    }
+        result.merge(Histogram::compute(EditStack::render(band, revision.operations)));
+    }
+
+    return result;
+}
+
+///
+/// \brief PhotoProcessing::updateHistogram - Функция в фоне считает гистограммы показанного изображения. Одновременно идет только один расчет.
+///
+void PhotoProcessing::updateHistogram()
+{
+    /* Запрос во время расчета повторяет его после завершения для последнего показанного изображения */
+    if (histogramRunning) {
+        histogramPending = true;
+
+        return;
+    }
+
+    const ImageDocument::Revision revision = document->displayed();
+
+    if (revision.viewImage().isNull()) {
+        return;
+    }
+
+    histogramRunning = true;
+
+    const QSharedPointer<Histogram::TileCache> cache = statisticsCache;
+
+    histogramUpdate = QtConcurrent::run([this, revision, cache]() {
+        QVariantMap histogram;
+
+        {
+            const Trace::Scope trace("histogram", "pixels");
+
+            histogram = histogramMap(statistics(revision, *cache));
+        }
+
+        QMetaObject::invokeMethod(
+            this, [this, histogram]() {
+                histogramRunning = false;
+                currentHistogram = histogram;
+
+                emit histogramChanged();
+
+                if (histogramPending) {
+                    histogramPending = false;
+
+                    updateHistogram();
                 }
-            }
+            },
+            Qt::QueuedConnection);
+    });
+}
+
+///
+/// \brief PhotoProcessing::updateTimings - Функция собирает фазы, которые начались после постановки последней операции в очередь.
+///
+void PhotoProcessing::updateTimings()
+{
+    if (!Trace::isEnabled() || operationQueued < 0) {
+        return;
+    }
+
+    operationTimings.clear();
 
-            setUpNewImage(image, savePath, AddWithoutHistory);
-        });
+    for (const Trace::Event& event : Trace::events(operationQueued)) {
+        operationTimings.append(QVariantMap {
+            { QStringLiteral("name"), QString::fromLatin1(event.name) },
+            { QStringLiteral("category"), QString::fromLatin1(event.category) },
+            { QStringLiteral("start"), (event.start - operationQueued) / 1000.0 },
+            { QStringLiteral("duration"), event.duration / 1000.0 },
+            { QStringLiteral("thread"), event.thread } });
     }
+
+    emit timingsChanged();
 }
 
 ///
-/// \brief PhotoProcessing::processRotate - Функция делает разворот изображения на 90 градусов.
-/// \param imagePath - Путь к изображению.
+/// \brief PhotoProcessing::loadProgressReporter - Функция возвращает обработчик доли прочитанного файла для ImageLoader::decode().
+/// Обработчик вызывается в рабочем потоке и передает в главный поток только изменения на целый процент.
+/// \param filePath - Путь к изображению. Доля показывается, только если этот файл сейчас открывается.
 ///
-void PhotoProcessing::processRotate(const QString& imagePath)
+std::function<void(qreal)> PhotoProcessing::loadProgressReporter(const QString& filePath)
 {
-    const QString localFilePath = QUrl(imagePath).toLocalFile();
+    return [this, filePath, reported = -1](const qreal value) mutable {
+        const int percent = static_cast<int>(value * 100);
 
-    if (!localFilePath.isEmpty()) {
-        QtConcurrent::run([=]() {
-            /* Передаем сигнал о начале операции в qml */
-            emit loadingStartedChanged();
+        if (percent == reported) {
+            return;
+        }
+
+        reported = percent;
 
-            QImage image(localFilePath);
-            QImage newImage(image.height(), image.width(), image.format());
+        QMetaObject::invokeMethod(
+            this, [this, filePath, value]() {
+                if (loadingPath == filePath) {
+                    currentLoadProgress = value;
 
-            for (int i = 0; i < image.width(); i++) {
-                for (int j = 0; j < image.height(); j++) {
-                    QRgb pixel = image.pixel(i, j);
-                    newImage.setPixel(j, image.width() - i - 1, pixel);
+                    emit loadProgressChanged();
                 }
-            }
+            },
+            Qt::QueuedConnection);
+    };
+}
+
+///
+/// \brief PhotoProcessing::finishLoading - Функция сбрасывает состояние открытия: путь открываемого файла и долю прочитанного.
+///
+void PhotoProcessing::finishLoading()
+{
+    loadingPath.clear();
 
-            setUpNewImage(newImage, localFilePath, AddWithHistory);
-        });
+    if (currentLoadProgress != 0.0) {
+        currentLoadProgress = 0.0;
+
+        emit loadProgressChanged();
     }
 }
 
 ///
-/// \brief PhotoProcessing::setUpNewImage - Функция сохранять новое изображение в tmp папке и устанавливает новое изображение в UI.
-/// \param image - Новое изображение.
-/// \param imagePath - Путь к новому изображению.
+/// \brief PhotoProcessing::cancelPrefetch - Функция отменяет фоновое декодирование. Отмененное декодирование останавливается на следующем чтении файла.
 ///
-void PhotoProcessing::setUpNewImage(const QImage& image, const QString& imagePath, const ImageEditType imageEditType)
+void PhotoProcessing::cancelPrefetch()
 {
-    if (temporaryDir.isValid()) {
-        const QString fileName = temporaryDir.path() % "/" % QString::number(QRandomGenerator::global()->bounded(100000, 999999)) % "." % QFileInfo(imagePath).suffix();
+    if (prefetchPath.isEmpty()) {
+        return;
+    }
 
-        image.save(fileName);
+    prefetchGeneration->fetchAndAddOrdered(1);
 
-        if (imageEditType == AddWithHistory) {
-            emit imageEditChanged(QUrl::fromLocalFile(fileName).toString());
-        } else if (imageEditType == AddWithoutHistory) {
-            emit imageEditWithoutQueueChanged(QUrl::fromLocalFile(fileName).toString());
+    /* Отмененные декодирования не ждем, деструктор дождется оставшихся */
+    QVector<QFuture<QImage>> running;
+
+    for (const QFuture<QImage>& cancelled : cancelledPrefetches) {
+        if (!cancelled.isFinished()) {
+            running.append(cancelled);
         }
     }
+
+    running.append(prefetch);
+    cancelledPrefetches = running;
+
+    prefetchPath.clear();
+    prefetch = QFuture<QImage>();
+}
+
+///
+/// \brief PhotoProcessing::imageUrl - Функция возвращает image:// адрес версии изображения.
+/// \param version - Версия изображения в документе.
+///
+QString PhotoProcessing::imageUrl(const quint64 version) const
+{
+    return QStringLiteral("image://") % providerId % "/" % QString::number(version);
 }
@@ -0,0 +1,601 @@
+#include "include/PhotoProcessing/PointOperations.h"
+#include "include/PhotoProcessing/Simd.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <QColor>
+#include <QMutex>
+
+namespace {
+/*
+ * Коэффициенты сепии в тысячных долях. Целочисленная сумма делится на 1000 без ошибок округления,
+ * поэтому результат совпадает с формулой (R * .393) + (G * .769) + (B * .189) с отбрасыванием дробной части.
+ */
+constexpr int sepiaMatrix[3][3] = {
+    { 393, 769, 189 },
+    { 349, 686, 168 },
+    { 272, 534, 131 }
+};
+
+///
+/// \brief isPixelMatching - Функция проверяет, нужно ли обрабатывать пиксель.
+/// \param pixel - Пиксель.
+/// \param condition - Условие обработки.
+///
+inline bool isPixelMatching(const QRgb pixel, const PointOperations::PixelCondition condition)
+{
+    if (condition == PointOperations::PixelCondition::NotTransparent) {
+        return qAlpha(pixel) != 0;
+    }
+
+    return qRed(pixel) != 0 && qGreen(pixel) != 0 && qBlue(pixel) != 0 && qAlpha(pixel) != 0;
+}
+
+///
+/// \brief sepiaChannel - Функция высчитывает один канал сепии.
+/// \param pixel - Исходный пиксель.
+/// \param channel - Номер канала (0 - красный, 1 - зеленый, 2 - синий).
+///
+inline int sepiaChannel(const QRgb pixel, const int channel)
+{
+    const int value = (qRed(pixel) * sepiaMatrix[channel][0] + qGreen(pixel) * sepiaMatrix[channel][1] + qBlue(pixel) * sepiaMatrix[channel][2]) / 1000;
+
+    return qMin(value, 255);
+}
+
+void grayScalar(QRgb* pixels, const int count)
+{
+    for (int x = 0; x < count; ++x) {
+        const QRgb pixel = pixels[x];
+
+        /* Проверяем на прозрачный пиксель */
+        if (qAlpha(pixel) != 0) {
+            const int gray = (qRed(pixel) * 11 + qGreen(pixel) * 16 + qBlue(pixel) * 5) >> 5;
+
+            pixels[x] = qRgb(gray, gray, gray);
+        }
+    }
+}
+
+void sepiaScalar(QRgb* pixels, const int count)
+{
+    for (int x = 0; x < count; ++x) {
+        const QRgb pixel = pixels[x];
+
+        /* Проверяем на прозрачный пиксель */
+        if (qAlpha(pixel) != 0) {
+            pixels[x] = qRgb(sepiaChannel(pixel, 0), sepiaChannel(pixel, 1), sepiaChannel(pixel, 2));
+        }
+    }
+}
+
+///
+/// \brief saturationTable - Функция возвращает насыщенность из QColor::saturation() для пары (максимум, минимум) каналов: table[max * 256 + min].
+/// В QColor::toHsv() насыщенность зависит только от максимума и минимума, значение равно максимуму.
+/// В конце таблицы 3 байта запаса, чтобы 32-битный gather по последнему индексу не выходил за границу.
+///
+const QVector<quint8>& saturationTable()
+{
+    static const QVector<quint8> table = []() {
+        QVector<quint8> result(256 * 256 + 3, 0);
+
+        for (int maximum = 0; maximum < 256; ++maximum) {
+            for (int minimum = 0; minimum <= maximum; ++minimum) {
+                result[maximum * 256 + minimum] = static_cast<quint8>(QColor(maximum, minimum, minimum).saturation());
+            }
+        }
+
+        return result;
+    }();
+
+    return table;
+}
+
+void hueScalar(QRgb* pixels, const int count, const QRgb* colors, const quint8* saturations)
+{
+    for (int x = 0; x < count; ++x) {
+        const QRgb pixel = pixels[x];
+
+        const int maximum = qMax(qMax(qRed(pixel), qGreen(pixel)), qBlue(pixel));
+        const int minimum = qMin(qMin(qRed(pixel), qGreen(pixel)), qBlue(pixel));
+        const int saturation = saturations[maximum * 256 + minimum];
+
+        pixels[x] = (pixel & 0xff000000) | colors[saturation * 256 + maximum];
+    }
+}
+
+void lutScalar(QRgb* pixels, const int count, const PointOperations::Lut& lut, const PointOperations::PixelCondition condition)
+{
+    for (int x = 0; x < count; ++x) {
+        const QRgb pixel = pixels[x];
+
+        if (isPixelMatching(pixel, condition)) {
+            pixels[x] = (pixel & 0xff000000) | lut.red[qRed(pixel)] | lut.green[qGreen(pixel)] | lut.blue[qBlue(pixel)];
+        }
+    }
+}
+
+#if defined(PHOTOPROCESSING_SSE2)
+///
+/// \brief sepiaChannelSse2 - SSE2 версия sepiaChannel для четырех пикселей.
+/// \param blueRed - Пары (B, R) в 16-битных половинах каждого пикселя.
+/// \param greenAlpha - Пары (G, A) в 16-битных половинах каждого пикселя.
+///
+inline __m128i sepiaChannelSse2(const __m128i blueRed, const __m128i greenAlpha, const int channel)
+{
+    const __m128i blueRedFactors = _mm_set1_epi32((sepiaMatrix[channel][0] << 16) | sepiaMatrix[channel][2]);
+    const __m128i greenFactors = _mm_set1_epi32(sepiaMatrix[channel][1]);
+
+    const __m128i sum = _mm_add_epi32(_mm_madd_epi16(blueRed, blueRedFactors), _mm_madd_epi16(greenAlpha, greenFactors));
+
+    /* Сумма меньше 2^24 и представима во float точно, деление IEEE не переходит через целое значение */
+    const __m128i value = _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(sum), _mm_set1_ps(1000.0f)));
+
+    return _mm_min_epi16(value, _mm_set1_epi32(255));
+}
+
+int graySse2(QRgb* pixels, const int count)
+{
+    const __m128i byteMask = _mm_set1_epi32(0xff);
+    const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000));
+    const __m128i redFactor = _mm_set1_epi32(11);
+    const __m128i blueFactor = _mm_set1_epi32(5);
+
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i* address = reinterpret_cast<__m128i*>(pixels + x);
+        const __m128i pixel = _mm_loadu_si128(address);
+
+        const __m128i blue = _mm_and_si128(pixel, byteMask);
+        const __m128i green = _mm_and_si128(_mm_srli_epi32(pixel, 8), byteMask);
+        const __m128i red = _mm_and_si128(_mm_srli_epi32(pixel, 16), byteMask);
+
+        /* Сумма не превышает 16 бит, поэтому хватает 16-битного умножения */
+        const __m128i sum = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi16(red, redFactor), _mm_slli_epi32(green, 4)), _mm_mullo_epi16(blue, blueFactor));
+        const __m128i gray = _mm_srli_epi32(sum, 5);
+        const __m128i result = _mm_or_si128(_mm_or_si128(opaque, gray), _mm_or_si128(_mm_slli_epi32(gray, 8), _mm_slli_epi32(gray, 16)));
+
+        /* Прозрачные пиксели оставляем без изменений */
+        const __m128i transparent = _mm_cmpeq_epi32(_mm_srli_epi32(pixel, 24), _mm_setzero_si128());
+
+        _mm_storeu_si128(address, _mm_or_si128(_mm_and_si128(transparent, pixel), _mm_andnot_si128(transparent, result)));
+    }
+
+    return x;
+}
+
+int sepiaSse2(QRgb* pixels, const int count)
+{
+    const __m128i pairMask = _mm_set1_epi32(0x00ff00ff);
+    const __m128i opaque = _mm_set1_epi32(static_cast<int>(0xff000000));
+
+    int x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128i* address = reinterpret_cast<__m128i*>(pixels + x);
+        const __m128i pixel = _mm_loadu_si128(address);
+
+        const __m128i blueRed = _mm_and_si128(pixel, pairMask);
+        const __m128i greenAlpha = _mm_and_si128(_mm_srli_epi32(pixel, 8), pairMask);
+
+        const __m128i red = sepiaChannelSse2(blueRed, greenAlpha, 0);
+        const __m128i green = sepiaChannelSse2(blueRed, greenAlpha, 1);
+        const __m128i blue = sepiaChannelSse2(blueRed, greenAlpha, 2);
+
+        const __m128i result = _mm_or_si128(_mm_or_si128(opaque, blue), _mm_or_si128(_mm_slli_epi32(green, 8), _mm_slli_epi32(red, 16)));
+
+        /* Прозрачные пиксели оставляем без изменений */
+        const __m128i transparent = _mm_cmpeq_epi32(_mm_srli_epi32(pixel, 24), _mm_setzero_si128());
+
+        _mm_storeu_si128(address, _mm_or_si128(_mm_and_si128(transparent, pixel), _mm_andnot_si128(transparent, result)));
+    }
+
+    return x;
+}
+#endif
+
+#if defined(PHOTOPROCESSING_AVX2)
+PHOTOPROCESSING_TARGET_AVX2 inline __m256i sepiaChannelAvx2(const __m256i blueRed, const __m256i greenAlpha, const int channel)
+{
+    const __m256i blueRedFactors = _mm256_set1_epi32((sepiaMatrix[channel][0] << 16) | sepiaMatrix[channel][2]);
+    const __m256i greenFactors = _mm256_set1_epi32(sepiaMatrix[channel][1]);
+
+    const __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(blueRed, blueRedFactors), _mm256_madd_epi16(greenAlpha, greenFactors));
+    const __m256i value = _mm256_cvttps_epi32(_mm256_div_ps(_mm256_cvtepi32_ps(sum), _mm256_set1_ps(1000.0f)));
+
+    return _mm256_min_epi16(value, _mm256_set1_epi32(255));
+}
+
+///
+/// \brief processMaskAvx2 - Функция возвращает маску пикселей, которые удовлетворяют условию обработки.
+///
+PHOTOPROCESSING_TARGET_AVX2 inline __m256i processMaskAvx2(const __m256i pixel, const PointOperations::PixelCondition condition)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    if (condition == PointOperations::PixelCondition::NotTransparent) {
+        return _mm256_xor_si256(_mm256_cmpeq_epi32(_mm256_srli_epi32(pixel, 24), zero), _mm256_set1_epi32(-1));
+    }
+
+    /* Пиксель обрабатывается, только если в нем нет ни одного нулевого байта */
+    return _mm256_cmpeq_epi32(_mm256_cmpeq_epi8(pixel, zero), zero);
+}
+
+PHOTOPROCESSING_TARGET_AVX2 int grayAvx2(QRgb* pixels, const int count)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xff000000));
+    const __m256i redFactor = _mm256_set1_epi32(11);
+    const __m256i blueFactor = _mm256_set1_epi32(5);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i* address = reinterpret_cast<__m256i*>(pixels + x);
+        const __m256i pixel = _mm256_loadu_si256(address);
+
+        const __m256i blue = _mm256_and_si256(pixel, byteMask);
+        const __m256i green = _mm256_and_si256(_mm256_srli_epi32(pixel, 8), byteMask);
+        const __m256i red = _mm256_and_si256(_mm256_srli_epi32(pixel, 16), byteMask);
+
+        const __m256i sum = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi16(red, redFactor), _mm256_slli_epi32(green, 4)), _mm256_mullo_epi16(blue, blueFactor));
+        const __m256i gray = _mm256_srli_epi32(sum, 5);
+        const __m256i result = _mm256_or_si256(_mm256_or_si256(opaque, gray), _mm256_or_si256(_mm256_slli_epi32(gray, 8), _mm256_slli_epi32(gray, 16)));
+
+        _mm256_storeu_si256(address, _mm256_blendv_epi8(pixel, result, processMaskAvx2(pixel, PointOperations::PixelCondition::NotTransparent)));
+    }
+
+    return x;
+}
+
+PHOTOPROCESSING_TARGET_AVX2 int sepiaAvx2(QRgb* pixels, const int count)
+{
+    const __m256i pairMask = _mm256_set1_epi32(0x00ff00ff);
+    const __m256i opaque = _mm256_set1_epi32(static_cast<int>(0xff000000));
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i* address = reinterpret_cast<__m256i*>(pixels + x);
+        const __m256i pixel = _mm256_loadu_si256(address);
+
+        const __m256i blueRed = _mm256_and_si256(pixel, pairMask);
+        const __m256i greenAlpha = _mm256_and_si256(_mm256_srli_epi32(pixel, 8), pairMask);
+
+        const __m256i red = sepiaChannelAvx2(blueRed, greenAlpha, 0);
+        const __m256i green = sepiaChannelAvx2(blueRed, greenAlpha, 1);
+        const __m256i blue = sepiaChannelAvx2(blueRed, greenAlpha, 2);
+
+        const __m256i result = _mm256_or_si256(_mm256_or_si256(opaque, blue), _mm256_or_si256(_mm256_slli_epi32(green, 8), _mm256_slli_epi32(red, 16)));
+
+        _mm256_storeu_si256(address, _mm256_blendv_epi8(pixel, result, processMaskAvx2(pixel, PointOperations::PixelCondition::NotTransparent)));
+    }
+
+    return x;
+}
+
+PHOTOPROCESSING_TARGET_AVX2 int hueAvx2(QRgb* pixels, const int count, const QRgb* colors, const quint8* saturations)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+
+    const int* colorTable = reinterpret_cast<const int*>(colors);
+    const int* saturationTable = reinterpret_cast<const int*>(saturations);
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i* address = reinterpret_cast<__m256i*>(pixels + x);
+        const __m256i pixel = _mm256_loadu_si256(address);
+
+        const __m256i red = _mm256_and_si256(_mm256_srli_epi32(pixel, 16), byteMask);
+        const __m256i green = _mm256_and_si256(_mm256_srli_epi32(pixel, 8), byteMask);
+        const __m256i blue = _mm256_and_si256(pixel, byteMask);
+
+        const __m256i maximum = _mm256_max_epi32(_mm256_max_epi32(red, green), blue);
+        const __m256i minimum = _mm256_min_epi32(_mm256_min_epi32(red, green), blue);
+
+        /* Таблица насыщенности байтовая: gather с шагом 1 читает 4 байта, нужен только младший */
+        const __m256i saturation = _mm256_and_si256(_mm256_i32gather_epi32(saturationTable, _mm256_or_si256(_mm256_slli_epi32(maximum, 8), minimum), 1), byteMask);
+        const __m256i color = _mm256_i32gather_epi32(colorTable, _mm256_or_si256(_mm256_slli_epi32(saturation, 8), maximum), 4);
+
+        _mm256_storeu_si256(address, _mm256_or_si256(_mm256_and_si256(pixel, alphaMask), color));
+    }
+
+    return x;
+}
+
+PHOTOPROCESSING_TARGET_AVX2 int lutAvx2(QRgb* pixels, const int count, const PointOperations::Lut& lut, const PointOperations::PixelCondition condition)
+{
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i alphaMask = _mm256_set1_epi32(static_cast<int>(0xff000000));
+
+    const int* red = reinterpret_cast<const int*>(lut.red.data());
+    const int* green = reinterpret_cast<const int*>(lut.green.data());
+    const int* blue = reinterpret_cast<const int*>(lut.blue.data());
+
+    int x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256i* address = reinterpret_cast<__m256i*>(pixels + x);
+        const __m256i pixel = _mm256_loadu_si256(address);
+
+        const __m256i newRed = _mm256_i32gather_epi32(red, _mm256_and_si256(_mm256_srli_epi32(pixel, 16), byteMask), 4);
+        const __m256i newGreen = _mm256_i32gather_epi32(green, _mm256_and_si256(_mm256_srli_epi32(pixel, 8), byteMask), 4);
+        const __m256i newBlue = _mm256_i32gather_epi32(blue, _mm256_and_si256(pixel, byteMask), 4);
+
+        const __m256i result = _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(pixel, alphaMask), newRed), _mm256_or_si256(newGreen, newBlue));
+
+        _mm256_storeu_si256(address, _mm256_blendv_epi8(pixel, result, processMaskAvx2(pixel, condition)));
+    }
+
+    return x;
+}
+#endif
+}
+
+///
+/// \brief PointOperations::normalized - Функция приводит изображение к 32-битному формату, с которым работают ядра.
+/// \param image - Исходное изображение.
+/// \return Изображение в Format_ARGB32, если у исходного есть альфа канал, иначе в Format_RGB32.
+///
+QImage PointOperations::normalized(const QImage& image)
+{
+    return image.convertToFormat(image.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+}
+
+///
+/// \brief PointOperations::brightnessLut - Функция строит таблицу для изменения яркости.
+/// \param brightness - Параметр яркости. От 0.0 до 2.0.
+///
+PointOperations::Lut PointOperations::brightnessLut(const float brightness)
+{
+    Lut lut;
+
+    for (int value = 0; value < 256; ++value) {
+        lut.set(value, static_cast<quint8>(qBound(0.0f, value * brightness, 255.0f)));
+    }
+
+    return lut;
+}
+
+///
+/// \brief PointOperations::contrastLut - Функция строит таблицу для изменения контраста.
+/// \param contrast - Параметр контрастности. От -127 до 127.
+///
+PointOperations::Lut PointOperations::contrastLut(const qint8 contrast)
+{
+    /*
+     * Высчитываем коэффициент коррекции контраста по формуле: (259 * (C + 255)) / (255 * (259 - C))
+     * Где C - введеное пользователем значение.
+     */
+    const float factor = (259.0 * (contrast + 255.0)) / (255.0 * (259.0 - contrast));
+
+    Lut lut;
+
+    for (int value = 0; value < 256; ++value) {
+        /*
+         * Высчитываем новый цвет по формуле: C' = F * (C - 128) + 128
+         * Где C - цвет, а F - коэффициент коррекции контраста.
+         */
+        lut.set(value, static_cast<quint8>(qBound(0.0f, factor * (value - 128) + 128, 255.0f)));
+    }
+
+    return lut;
+}
+
+///
+/// \brief PointOperations::levelsLut - Функция строит таблицу уровней.
+/// \param levels - Черная и белая точки каналов. Канал, у которого белая точка не выше черной, не меняется.
+///
+PointOperations::Lut PointOperations::levelsLut(const Levels& levels)
+{
+    std::array<std::array<quint8, 256>, 3> channels;
+
+    for (int channel = 0; channel < 3; ++channel) {
+        const int black = levels.black[channel];
+        const int white = levels.white[channel];
+
+        for (int value = 0; value < 256; ++value) {
+            if (white <= black) {
+                channels[channel][value] = static_cast<quint8>(value);
+            } else {
+                /* C' = (C - B) * 255 / (W - B) с округлением */
+                const int stretched = ((value - black) * 255 + (white - black) / 2) / (white - black);
+
+                channels[channel][value] = static_cast<quint8>(qBound(0, stretched, 255));
+            }
+        }
+    }
+
+    Lut lut;
+
+    for (int value = 0; value < 256; ++value) {
+        lut.red[value] = static_cast<QRgb>(channels[0][value]) << 16;
+        lut.green[value] = static_cast<QRgb>(channels[1][value]) << 8;
+        lut.blue[value] = channels[2][value];
+    }
+
+    return lut;
+}
+
+///
+/// \brief PointOperations::hueLut - Функция строит таблицу нового тона. Значения берутся из QColor, поэтому результат совпадает с QColor::setHsv().
+/// Последняя построенная таблица запоминается: предпросмотр, применение и сохранение используют один тон.
+/// \param hue - Новый тон.
+///
+PointOperations::HueLut PointOperations::hueLut(const quint8 hue)
+{
+    static QMutex mutex;
+    static HueLut cachedLut;
+    static int cachedHue = -1;
+
+    QMutexLocker locker(&mutex);
+
+    if (cachedHue == hue) {
+        return cachedLut;
+    }
+
+    HueLut lut;
+    lut.colors.resize(256 * 256);
+
+    for (int saturation = 0; saturation < 256; ++saturation) {
+        for (int value = 0; value < 256; ++value) {
+            lut.colors[saturation * 256 + value] = QColor::fromHsv(hue, saturation, value).rgb() & 0x00ffffff;
+        }
+    }
+
+    cachedLut = lut;
+    cachedHue = hue;
+
+    return lut;
+}
+
+///
+/// \brief PointOperations::composeLuts - Функция объединяет две таблицы в одну: результат равен применению first, а затем second.
+/// Объединение корректно, только если условие second не зависит от результата first (например, PixelCondition::NotTransparent).
+/// \param first - Таблица, которая применяется первой.
+/// \param second - Таблица, которая применяется второй.
+///
+PointOperations::Lut PointOperations::composeLuts(const Lut& first, const Lut& second)
+{
+    Lut lut;
+
+    for (int value = 0; value < 256; ++value) {
+        lut.red[value] = second.red[first.red[value] >> 16];
+        lut.green[value] = second.green[first.green[value] >> 8];
+        lut.blue[value] = second.blue[first.blue[value]];
+    }
+
+    return lut;
+}
+
+///
+/// \brief PointOperations::grayRow - Функция переводит ряд пикселей в grayScale.
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+///
+void PointOperations::grayRow(QRgb* pixels, const int count)
+{
+    int x = 0;
+
+#if defined(PHOTOPROCESSING_AVX2)
+    if (Simd::hasAvx2()) {
+        x = grayAvx2(pixels, count);
+    }
+#endif
+#if defined(PHOTOPROCESSING_SSE2)
+    x += graySse2(pixels + x, count - x);
+#endif
+
+    grayScalar(pixels + x, count - x);
+}
+
+///
+/// \brief PointOperations::sepiaRow - Функция накладывает фильтр сепии на ряд пикселей.
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+///
+void PointOperations::sepiaRow(QRgb* pixels, const int count)
+{
+    int x = 0;
+
+#if defined(PHOTOPROCESSING_AVX2)
+    if (Simd::hasAvx2()) {
+        x = sepiaAvx2(pixels, count);
+    }
+#endif
+#if defined(PHOTOPROCESSING_SSE2)
+    x += sepiaSse2(pixels + x, count - x);
+#endif
+
+    sepiaScalar(pixels + x, count - x);
+}
+
+///
+/// \brief PointOperations::hueRow - Функция устанавливает новый тон ряду пикселей так же, как QColor::setHsv().
+/// Насыщенность берется из таблицы по максимуму и минимуму каналов, цвет - из таблицы тона по насыщенности и максимуму.
+/// В SSE2 нет gather инструкций, поэтому без AVX2 используется скалярный путь.
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+/// \param lut - Таблица нового тона (hueLut()).
+///
+void PointOperations::hueRow(QRgb* pixels, const int count, const HueLut& lut)
+{
+    const QRgb* colors = lut.colors.constData();
+    const quint8* saturations = saturationTable().constData();
+
+    int x = 0;
+
+#if defined(PHOTOPROCESSING_AVX2)
+    if (Simd::hasAvx2()) {
+        x = hueAvx2(pixels, count, colors, saturations);
+    }
+#endif
+
+    hueScalar(pixels + x, count - x, colors, saturations);
+}
+
+///
+/// \brief PointOperations::lutRow - Функция применяет таблицу преобразования к ряду пикселей.
+/// В SSE2 нет gather инструкций, поэтому без AVX2 используется скалярный путь (таблицы помещаются в L1).
+/// \param pixels - Указатель на начало ряда.
+/// \param count - Количество пикселей в ряду.
+/// \param lut - Таблица преобразования.
+/// \param condition - Условие, при котором пиксель будет обработан.
+///
+void PointOperations::lutRow(QRgb* pixels, const int count, const Lut& lut, const PixelCondition condition)
+{
+    int x = 0;
+
+#if defined(PHOTOPROCESSING_AVX2)
+    if (Simd::hasAvx2()) {
+        x = lutAvx2(pixels, count, lut, condition);
+    }
+#endif
+
+    lutScalar(pixels + x, count - x, lut, condition);
+}
+
+///
+/// \brief PointOperations::toGray - Функция переводит изображение в grayScale.
+/// \param image - Изображение в формате, полученном из normalized().
+///
+void PointOperations::toGray(QImage& image)
+{
+    Tiling::forEachRow(image, [](QRgb* row, const int width) {
+        grayRow(row, width);
+    });
+}
+
+///
+/// \brief PointOperations::toSepia - Функция накладывает фильтр сепии.
+/// \param image - Изображение в формате, полученном из normalized().
+///
+void PointOperations::toSepia(QImage& image)
+{
+    Tiling::forEachRow(image, [](QRgb* row, const int width) {
+        sepiaRow(row, width);
+    });
+}
+
+///
+/// \brief PointOperations::setHue - Функция устанавливает новый тон изображению.
+/// \param image - Изображение в формате, полученном из normalized().
+/// \param hue - Новый тон.
+///
+void PointOperations::setHue(QImage& image, const quint8 hue)
+{
+    const HueLut lut = hueLut(hue);
+
+    Tiling::forEachRow(image, [&lut](QRgb* row, const int width) {
+        hueRow(row, width, lut);
+    });
+}
+
+///
+/// \brief PointOperations::applyLut - Функция применяет таблицу преобразования ко всему изображению.
+/// \param image - Изображение в формате, полученном из normalized().
+/// \param lut - Таблица преобразования.
+/// \param condition - Условие, при котором пиксель будет обработан.
+///
+void PointOperations::applyLut(QImage& image, const Lut& lut, const PixelCondition condition)
+{
+    Tiling::forEachRow(image, [&](QRgb* row, const int width) {
+        lutRow(row, width, lut, condition);
+    });
+}
@@ -0,0 +1,171 @@
+#include "include/PhotoProcessing/Pyramid.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+namespace {
+/* Уровни меньше этой стороны не строятся: предпросмотр на экране все равно больше */
+constexpr int minimumLevelSide = 256;
+
+///
+/// \brief downsampleRow - Функция усредняет блоки 2x2 из двух рядов в один ряд в 2 раза уже.
+/// \param top - Верхний ряд источника.
+/// \param bottom - Нижний ряд источника.
+/// \param destination - Ряд результата.
+/// \param width - Ширина результата.
+///
+void downsampleRow(const QRgb* top, const QRgb* bottom, QRgb* destination, const int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb pixels[4] = { top[2 * x], top[2 * x + 1], bottom[2 * x], bottom[2 * x + 1] };
+
+        destination[x] = qRgb((qRed(pixels[0]) + qRed(pixels[1]) + qRed(pixels[2]) + qRed(pixels[3]) + 2) >> 2,
+            (qGreen(pixels[0]) + qGreen(pixels[1]) + qGreen(pixels[2]) + qGreen(pixels[3]) + 2) >> 2,
+            (qBlue(pixels[0]) + qBlue(pixels[1]) + qBlue(pixels[2]) + qBlue(pixels[3]) + 2) >> 2);
+    }
+}
+
+///
+/// \brief downsampleAlphaRow - Версия downsampleRow для изображений с альфа каналом.
+/// Цвет усредняется с весом альфы, чтобы цвет прозрачных пикселей не проступал на краях.
+///
+void downsampleAlphaRow(const QRgb* top, const QRgb* bottom, QRgb* destination, const int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb pixels[4] = { top[2 * x], top[2 * x + 1], bottom[2 * x], bottom[2 * x + 1] };
+
+        int alpha = 0;
+        int red = 0;
+        int green = 0;
+        int blue = 0;
+
+        for (const QRgb pixel : pixels) {
+            alpha += qAlpha(pixel);
+            red += qRed(pixel) * qAlpha(pixel);
+            green += qGreen(pixel) * qAlpha(pixel);
+            blue += qBlue(pixel) * qAlpha(pixel);
+        }
+
+        if (alpha == 0) {
+            destination[x] = 0;
+        } else {
+            destination[x] = qRgba((red + alpha / 2) / alpha, (green + alpha / 2) / alpha, (blue + alpha / 2) / alpha, (alpha + 2) >> 2);
+        }
+    }
+}
+
+///
+/// \brief downsampleInto - Функция пересчитывает прямоугольник уровня, уменьшая source в 2 раза.
+/// \param source - Предыдущий уровень.
+/// \param result - Уровень в 2 раза меньше source. Изменяется на месте.
+/// \param rect - Прямоугольник в пикселях result.
+///
+void downsampleInto(const QImage& source, QImage& result, const QRect& rect)
+{
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows resultRows(result);
+    const bool hasAlpha = source.hasAlphaChannel();
+
+    Tiling::forEachStripe(rect.height(), Tiling::stripeHeight(rect.height(), result.bytesPerLine()), 0, [&](const Tiling::Stripe& stripe) {
+        for (int y = rect.top() + stripe.firstRow; y < rect.top() + stripe.lastRow; ++y) {
+            const QRgb* top = sourceRows.constRow(2 * y) + 2 * rect.left();
+            const QRgb* bottom = sourceRows.constRow(2 * y + 1) + 2 * rect.left();
+            QRgb* destination = resultRows.row(y) + rect.left();
+
+            if (hasAlpha) {
+                downsampleAlphaRow(top, bottom, destination, rect.width());
+            } else {
+                downsampleRow(top, bottom, destination, rect.width());
+            }
+        }
+    });
+}
+
+///
+/// \brief downsample - Функция уменьшает изображение в 2 раза. Последний нечетный ряд и столбец отбрасываются.
+///
+QImage downsample(const QImage& image)
+{
+    QImage result(image.width() / 2, image.height() / 2, image.format());
+
+    downsampleInto(image, result, result.rect());
+
+    return result;
+}
+}
+
+///
+/// \brief Pyramid::build - Функция строит уменьшенные копии изображения.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \return Уровни в 2, 4, 8... раз меньше исходного. Сам исходный уровень в список не входит.
+///
+QVector<QImage> Pyramid::build(const QImage& image)
+{
+    QVector<QImage> levels;
+
+    QImage level = image;
+    while (!level.isNull() && qMin(level.width(), level.height()) >= 2 && qMax(level.width(), level.height()) / 2 >= minimumLevelSide) {
+        level = downsample(level);
+
+        levels.append(level);
+    }
+
+    return levels;
+}
+
+///
+/// \brief Pyramid::update - Функция обновляет уменьшенные копии после изменения прямоугольника изображения.
+/// На каждом уровне пересчитывается только прямоугольник под измененными пикселями, остальное копируется из levels.
+/// \param image - Новое изображение в формате, полученном из PointOperations::normalized().
+/// \param levels - Уровни предыдущего изображения того же размера и формата, полученные из build().
+/// \param changed - Прямоугольник, вне которого image совпадает с предыдущим изображением. Если он пустой, уровни строятся заново.
+///
+QVector<QImage> Pyramid::update(const QImage& image, const QVector<QImage>& levels, const QRect& changed)
+{
+    if (changed.isNull() || levels.isEmpty() || levels.first().size() != image.size() / 2 || levels.first().format() != image.format()) {
+        return build(image);
+    }
+
+    QVector<QImage> result = levels;
+    QRect rect = changed;
+
+    for (int index = 0; index < result.size(); ++index) {
+        const QImage& source = index == 0 ? image : result.at(index - 1);
+        QImage& level = result[index];
+
+        /* Пиксель уровня зависит от блока 2x2, поэтому края прямоугольника делятся на 2 с округлением наружу */
+        rect = QRect(QPoint(rect.left() / 2, rect.top() / 2), QPoint(rect.right() / 2, rect.bottom() / 2)).intersected(level.rect());
+
+        if (rect.isEmpty()) {
+            break;
+        }
+
+        downsampleInto(source, level, rect);
+    }
+
+    return result;
+}
+
+///
+/// \brief Pyramid::level - Функция выбирает наименьший уровень, который при вписывании в target не будет растягиваться.
+/// \param image - Исходное изображение.
+/// \param levels - Уровни, полученные из build().
+/// \param target - Размер области, в которую вписывается изображение на экране. Если размер пустой, возвращается исходное изображение.
+///
+QImage Pyramid::level(const QImage& image, const QVector<QImage>& levels, const QSize& target)
+{
+    if (image.isNull() || target.isEmpty()) {
+        return image;
+    }
+
+    const QSize fitted = image.size().scaled(target, Qt::KeepAspectRatio);
+
+    QImage result = image;
+    for (const QImage& level : levels) {
+        if (level.width() < fitted.width() || level.height() < fitted.height()) {
+            break;
+        }
+
+        result = level;
+    }
+
+    return result;
+}
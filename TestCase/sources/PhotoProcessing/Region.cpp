@@ -0,0 +1,289 @@
+#include "include/PhotoProcessing/Region.h"
+#include "include/PhotoProcessing/Blur.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <algorithm>
+
+#include <QPainter>
+#include <QTransform>
+
+namespace {
+///
+/// \brief featherRadius - Функция возвращает радиус box размытия мягкого края: два прохода дают край шириной около feather.
+///
+int featherRadius(const int feather)
+{
+    return (feather + 1) / 2;
+}
+
+///
+/// \brief featherMargin - Функция возвращает, на сколько пикселей мягкий край выходит за область.
+///
+int featherMargin(const int feather)
+{
+    return 2 * featherRadius(feather);
+}
+
+///
+/// \brief nonZeroBounds - Функция возвращает прямоугольник ненулевых пикселей 8-битной маски.
+///
+QRect nonZeroBounds(const QImage& alpha)
+{
+    QRect bounds;
+
+    for (int y = 0; y < alpha.height(); ++y) {
+        const uchar* row = alpha.constScanLine(y);
+
+        for (int x = 0; x < alpha.width(); ++x) {
+            if (row[x] != 0) {
+                bounds |= QRect(x, y, 1, 1);
+            }
+        }
+    }
+
+    return bounds;
+}
+
+///
+/// \brief divide255 - Функция делит на 255 с округлением без деления, value от 0 до 255 * 255.
+///
+inline int divide255(const int value)
+{
+    const int rounded = value + 128;
+
+    return (rounded + (rounded >> 8)) >> 8;
+}
+
+///
+/// \brief blendPixel - Функция смешивает каналы исходного пикселя и результата: coverage - доля результата от 0 до 255.
+///
+inline QRgb blendPixel(const QRgb original, const QRgb processed, const int coverage)
+{
+    const int rest = 255 - coverage;
+
+    return qRgba(divide255(qRed(original) * rest + qRed(processed) * coverage), divide255(qGreen(original) * rest + qGreen(processed) * coverage),
+        divide255(qBlue(original) * rest + qBlue(processed) * coverage), divide255(qAlpha(original) * rest + qAlpha(processed) * coverage));
+}
+}
+
+///
+/// \brief Region::Mask::fromRegion - Функция создает маску из области.
+/// \param region - Область в пикселях изображения.
+/// \param feather - Ширина мягкого края в пикселях, 0 - жесткий край.
+///
+Region::Mask Region::Mask::fromRegion(const QRegion& region, const int feather)
+{
+    Mask mask;
+    mask.area = region;
+    mask.featherWidth = qMax(0, feather);
+
+    /* Пустая область ничего не выделяет, а пустая маска выделяет все изображение, поэтому область хранится как нулевая маска */
+    if (region.isEmpty()) {
+        mask.alpha = QImage(1, 1, QImage::Format_Alpha8);
+        mask.alpha.fill(0);
+    }
+
+    return mask;
+}
+
+///
+/// \brief Region::Mask::fromAlpha - Функция создает маску из 8-битного изображения: 0 - пиксель не меняется, 255 - заменяется результатом.
+/// \param alpha - Маска в пикселях изображения. Цветное изображение переводится в оттенки серого.
+///
+Region::Mask Region::Mask::fromAlpha(const QImage& alpha)
+{
+    Mask mask;
+
+    if (alpha.isNull()) {
+        return mask;
+    }
+
+    const QImage gray = (alpha.format() == QImage::Format_Alpha8 || alpha.format() == QImage::Format_Grayscale8)
+        ? alpha
+        : alpha.convertToFormat(QImage::Format_Grayscale8);
+
+    /* У обоих 8-битных форматов один байт на пиксель, поэтому ряды копируются как есть */
+    mask.alpha = QImage(gray.size(), QImage::Format_Alpha8);
+
+    for (int y = 0; y < gray.height(); ++y) {
+        std::copy(gray.constScanLine(y), gray.constScanLine(y) + gray.width(), mask.alpha.scanLine(y));
+    }
+
+    mask.alphaBounds = nonZeroBounds(mask.alpha);
+
+    return mask;
+}
+
+///
+/// \brief Region::Mask::isNull - Функция проверяет, что маска выделяет все изображение.
+///
+bool Region::Mask::isNull() const
+{
+    return area.isEmpty() && alpha.isNull();
+}
+
+///
+/// \brief Region::Mask::bounds - Функция возвращает прямоугольник пикселей, которые меняет маска, вместе с мягким краем.
+/// \param size - Размер изображения.
+///
+QRect Region::Mask::bounds(const QSize& size) const
+{
+    const QRect imageRect(QPoint(0, 0), size);
+
+    if (isNull()) {
+        return imageRect;
+    }
+
+    if (!alpha.isNull()) {
+        return alphaBounds.intersected(imageRect);
+    }
+
+    const int margin = featherMargin(featherWidth);
+
+    return area.boundingRect().adjusted(-margin, -margin, margin, margin).intersected(imageRect);
+}
+
+///
+/// \brief Region::Mask::scaled - Функция возвращает маску для изображения, уменьшенного или увеличенного в sx и sy раз (изображение для экрана).
+///
+Region::Mask Region::Mask::scaled(const qreal sx, const qreal sy) const
+{
+    Mask mask;
+
+    if (isNull()) {
+        return mask;
+    }
+
+    if (!alpha.isNull()) {
+        const QSize size(qMax(1, qRound(alpha.width() * sx)), qMax(1, qRound(alpha.height() * sy)));
+
+        mask.alpha = alpha.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        mask.alphaBounds = nonZeroBounds(mask.alpha);
+
+        return mask;
+    }
+
+    mask.area = QTransform::fromScale(sx, sy).map(area);
+    mask.featherWidth = qRound(featherWidth * qMin(sx, sy));
+
+    return mask;
+}
+
+///
+/// \brief Region::Mask::coverage - Функция возвращает доли результата для прямоугольника изображения.
+/// \param rect - Прямоугольник в пикселях изображения.
+/// \return Изображение QImage::Format_Alpha8 размера rect или пустое изображение при отмене.
+///
+QImage Region::Mask::coverage(const QRect& rect) const
+{
+    if (isNull()) {
+        QImage full(rect.size(), QImage::Format_Alpha8);
+        full.fill(255);
+
+        return full;
+    }
+
+    /* Пиксели за пределами маски получают 0 */
+    if (!alpha.isNull()) {
+        return alpha.copy(rect);
+    }
+
+    /* Область рисуется с запасом под мягкий край, чтобы размытие у края rect видело пиксели области за ним */
+    const int margin = featherMargin(featherWidth);
+    const QRect canvas = rect.adjusted(-margin, -margin, margin, margin);
+
+    QImage painted(canvas.size(), QImage::Format_RGB32);
+    painted.fill(Qt::black);
+
+    {
+        QPainter painter(&painted);
+        painter.translate(-canvas.topLeft());
+
+        for (const QRect& part : area) {
+            painter.fillRect(part, Qt::white);
+        }
+    }
+
+    if (featherWidth > 0) {
+        /* Два box прохода дают гладкий переход, стоимость не зависит от ширины края */
+        painted = Blur::boxBlur(painted, featherRadius(featherWidth), 2);
+
+        if (painted.isNull()) {
+            return QImage();
+        }
+    }
+
+    QImage result(rect.size(), QImage::Format_Alpha8);
+
+    for (int y = 0; y < rect.height(); ++y) {
+        const QRgb* source = reinterpret_cast<const QRgb*>(painted.constScanLine(y + margin)) + margin;
+        uchar* destination = result.scanLine(y);
+
+        for (int x = 0; x < rect.width(); ++x) {
+            destination[x] = static_cast<uchar>(qBlue(source[x]));
+        }
+    }
+
+    return result;
+}
+
+///
+/// \brief Region::apply - Функция применяет операцию внутри маски и смешивает результат с исходным изображением.
+/// Операция получает только прямоугольник маски с ореолом: время зависит от размера выделения, а не изображения.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param mask - Маска в пикселях image.
+/// \param halo - Сколько соседних пикселей читает операция вокруг каждого пикселя (радиус размытия, половина ядра).
+/// \param operation - Операция, которая не меняет размер изображения.
+/// \param dirty - Прямоугольник измененных пикселей.
+/// \return Новое изображение или пустое изображение при отмене.
+///
+QImage Region::apply(const QImage& image, const Mask& mask, const int halo, const std::function<QImage(const QImage&)>& operation, QRect& dirty)
+{
+    dirty = mask.bounds(image.size());
+
+    if (mask.isNull()) {
+        return operation(image);
+    }
+
+    if (dirty.isEmpty()) {
+        return image;
+    }
+
+    /* Ореол дает операции настоящих соседей у края выделения, а не продолжение края */
+    const QRect source = dirty.adjusted(-halo, -halo, halo, halo).intersected(image.rect());
+    const QImage processed = operation(image.copy(source));
+    const QImage coverage = mask.coverage(dirty);
+
+    if (processed.isNull() || coverage.isNull() || Tiling::isCancelled()) {
+        return QImage();
+    }
+
+    Q_ASSERT(processed.size() == source.size());
+
+    /* Копия делит пиксели с image только до первой записи, вне dirty они не пересчитываются */
+    QImage result = image;
+
+    const Tiling::ImageRows resultRows(result);
+    const Tiling::ImageRows processedRows(processed);
+    const QPoint offset = dirty.topLeft() - source.topLeft();
+
+    Tiling::forEachStripe(dirty.height(), Tiling::stripeHeight(dirty.height(), result.bytesPerLine()), 0, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            QRgb* row = resultRows.row(dirty.top() + y) + dirty.left();
+            const QRgb* processedRow = processedRows.constRow(offset.y() + y) + offset.x();
+            const uchar* coverageRow = coverage.constScanLine(y);
+
+            for (int x = 0; x < dirty.width(); ++x) {
+                const int weight = coverageRow[x];
+
+                if (weight == 255) {
+                    row[x] = processedRow[x];
+                } else if (weight != 0) {
+                    row[x] = blendPixel(row[x], processedRow[x], weight);
+                }
+            }
+        }
+    });
+
+    return Tiling::isCancelled() ? QImage() : result;
+}
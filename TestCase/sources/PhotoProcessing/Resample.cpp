@@ -0,0 +1,462 @@
+#include "include/PhotoProcessing/Resample.h"
+#include "include/PhotoProcessing/Simd.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <cmath>
+
+#include <QVector>
+
+namespace {
+/* Веса хранятся в фиксированной точке с 14 битами дробной части: произведение на канал и сумма пары помещаются в int32 */
+constexpr int precisionBits = 14;
+constexpr int precisionHalf = 1 << (precisionBits - 1);
+
+constexpr double pi = 3.14159265358979323846;
+
+///
+/// \brief The Kernel struct - Функция фильтра и ее носитель при масштабе 1.
+///
+struct Kernel {
+    double (*function)(double) = nullptr;
+    double support = 0.0;
+};
+
+///
+/// \brief The Weights struct - Веса фильтра для одной оси.
+/// Пиксель результата i - это сумма count[i] пикселей источника, начиная с first[i], с весами coefficients[i * taps + k].
+///
+struct Weights {
+    QVector<int> first;
+    QVector<int> count;
+    QVector<qint16> coefficients;
+    int taps = 0;
+};
+
+double areaKernel(const double x)
+{
+    return (x > -0.5 && x <= 0.5) ? 1.0 : 0.0;
+}
+
+double bilinearKernel(const double x)
+{
+    const double distance = std::abs(x);
+
+    return distance < 1.0 ? 1.0 - distance : 0.0;
+}
+
+double bicubicKernel(const double x)
+{
+    constexpr double a = -0.5;
+
+    const double distance = std::abs(x);
+
+    if (distance < 1.0) {
+        return ((a + 2.0) * distance - (a + 3.0)) * distance * distance + 1.0;
+    }
+
+    if (distance < 2.0) {
+        return ((a * distance - 5.0 * a) * distance + 8.0 * a) * distance - 4.0 * a;
+    }
+
+    return 0.0;
+}
+
+double sinc(const double x)
+{
+    if (x == 0.0) {
+        return 1.0;
+    }
+
+    const double angle = x * pi;
+
+    return std::sin(angle) / angle;
+}
+
+double lanczosKernel(const double x)
+{
+    return (x > -3.0 && x < 3.0) ? sinc(x) * sinc(x / 3.0) : 0.0;
+}
+
+///
+/// \brief kernel - Функция возвращает функцию и носитель фильтра.
+///
+Kernel kernel(const Resample::Filter filter)
+{
+    switch (filter) {
+    case Resample::Filter::Area:
+        return { areaKernel, 0.5 };
+    case Resample::Filter::Bilinear:
+        return { bilinearKernel, 1.0 };
+    case Resample::Filter::Bicubic:
+        return { bicubicKernel, 2.0 };
+    case Resample::Filter::Lanczos:
+        return { lanczosKernel, 3.0 };
+    }
+
+    return { bilinearKernel, 1.0 };
+}
+
+///
+/// \brief computeWeights - Функция считает веса фильтра для оси.
+/// Центр пикселя результата i переходит в точку (i + 0.5) * scale источника. При уменьшении носитель растягивается в scale раз.
+/// Веса нормируются так, чтобы их сумма была ровно 1 << precisionBits: однотонное изображение остается однотонным.
+/// \param sourceSize - Размер оси источника.
+/// \param resultSize - Размер оси результата.
+///
+Weights computeWeights(const int sourceSize, const int resultSize, const Kernel& kernel)
+{
+    const double scale = static_cast<double>(sourceSize) / resultSize;
+    const double filterScale = qMax(scale, 1.0);
+    const double support = kernel.support * filterScale;
+
+    Weights weights;
+    weights.first.resize(resultSize);
+    weights.count.resize(resultSize);
+    weights.taps = static_cast<int>(std::ceil(support)) * 2 + 1;
+    weights.coefficients.fill(0, resultSize * weights.taps);
+
+    QVector<double> values(weights.taps);
+    QVector<int> quantized(weights.taps);
+
+    for (int i = 0; i < resultSize; ++i) {
+        const double center = (i + 0.5) * scale;
+
+        int first = qMax(static_cast<int>(center - support + 0.5), 0);
+        const int last = qMin(static_cast<int>(center + support + 0.5), sourceSize);
+        int count = qMin(last - first, weights.taps);
+
+        double total = 0.0;
+        for (int k = 0; k < count; ++k) {
+            values[k] = kernel.function((first + k - center + 0.5) / filterScale);
+            total += values[k];
+        }
+
+        /* Носитель не попал ни в один центр пикселя: берем ближайший пиксель */
+        if (count <= 0 || total == 0.0) {
+            first = qBound(0, static_cast<int>(center), sourceSize - 1);
+            count = 1;
+            values[0] = 1.0;
+            total = 1.0;
+        }
+
+        /* Ошибку округления отдаем наибольшему весу */
+        int sum = 0;
+        int largest = 0;
+        for (int k = 0; k < count; ++k) {
+            quantized[k] = static_cast<int>(std::lround(values[k] / total * (1 << precisionBits)));
+            sum += quantized[k];
+
+            if (quantized[k] > quantized[largest]) {
+                largest = k;
+            }
+        }
+
+        quantized[largest] += (1 << precisionBits) - sum;
+
+        /* Нулевые веса по краям не читаются */
+        int begin = 0;
+        int end = count;
+        while (begin < end - 1 && quantized[begin] == 0) {
+            ++begin;
+        }
+
+        while (end - 1 > begin && quantized[end - 1] == 0) {
+            --end;
+        }
+
+        weights.first[i] = first + begin;
+        weights.count[i] = end - begin;
+
+        for (int k = begin; k < end; ++k) {
+            weights.coefficients[i * weights.taps + k - begin] = static_cast<qint16>(quantized[k]);
+        }
+    }
+
+    return weights;
+}
+
+///
+/// \brief packPixel - Функция переводит суммы каналов в пиксель с ограничением 0..255.
+///
+inline QRgb packPixel(const int blue, const int green, const int red, const int alpha)
+{
+    return qRgba(qBound(0, red >> precisionBits, 255), qBound(0, green >> precisionBits, 255), qBound(0, blue >> precisionBits, 255),
+        qBound(0, alpha >> precisionBits, 255));
+}
+
+///
+/// \brief verticalRowScalar - Функция считает пиксели [firstColumn, width) ряда результата по рядам источника.
+///
+void verticalRowScalar(const Tiling::ImageRows& source, const int first, const int count, const qint16* coefficients, QRgb* destination,
+    const int firstColumn, const int width)
+{
+    for (int x = firstColumn; x < width; ++x) {
+        int blue = precisionHalf;
+        int green = precisionHalf;
+        int red = precisionHalf;
+        int alpha = precisionHalf;
+
+        for (int k = 0; k < count; ++k) {
+            const QRgb pixel = source.constRow(first + k)[x];
+
+            blue += qBlue(pixel) * coefficients[k];
+            green += qGreen(pixel) * coefficients[k];
+            red += qRed(pixel) * coefficients[k];
+            alpha += qAlpha(pixel) * coefficients[k];
+        }
+
+        destination[x] = packPixel(blue, green, red, alpha);
+    }
+}
+
+#if !defined(PHOTOPROCESSING_SSE2)
+///
+/// \brief horizontalRowScalar - Функция считает ряд результата по ряду источника.
+///
+void horizontalRowScalar(const QRgb* source, QRgb* destination, const Weights& weights, const int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const QRgb* pixels = source + weights.first[x];
+        const qint16* coefficients = weights.coefficients.constData() + x * weights.taps;
+
+        int blue = precisionHalf;
+        int green = precisionHalf;
+        int red = precisionHalf;
+        int alpha = precisionHalf;
+
+        for (int k = 0; k < weights.count[x]; ++k) {
+            blue += qBlue(pixels[k]) * coefficients[k];
+            green += qGreen(pixels[k]) * coefficients[k];
+            red += qRed(pixels[k]) * coefficients[k];
+            alpha += qAlpha(pixels[k]) * coefficients[k];
+        }
+
+        destination[x] = packPixel(blue, green, red, alpha);
+    }
+}
+#endif
+
+#if defined(PHOTOPROCESSING_SSE2)
+///
+/// \brief coefficientPair - Функция повторяет пару весов во всех 32-битных ячейках для _mm_madd_epi16.
+///
+inline __m128i coefficientPair(const qint16 first, const qint16 second)
+{
+    return _mm_set1_epi32(static_cast<int>(static_cast<quint16>(first) | (static_cast<quint32>(static_cast<quint16>(second)) << 16)));
+}
+
+///
+/// \brief packSums - Функция переводит суммы каналов четырех пикселей в пиксели с ограничением 0..255.
+///
+inline __m128i packSums(const __m128i first, const __m128i second, const __m128i third, const __m128i fourth)
+{
+    const __m128i low = _mm_packs_epi32(_mm_srai_epi32(first, precisionBits), _mm_srai_epi32(second, precisionBits));
+    const __m128i high = _mm_packs_epi32(_mm_srai_epi32(third, precisionBits), _mm_srai_epi32(fourth, precisionBits));
+
+    return _mm_packus_epi16(low, high);
+}
+
+///
+/// \brief horizontalRowSse2 - Функция считает ряд результата по ряду источника, по два веса за одно умножение.
+/// Каналы двух соседних пикселей чередуются, и _mm_madd_epi16 сразу складывает оба произведения.
+///
+void horizontalRowSse2(const QRgb* source, QRgb* destination, const Weights& weights, const int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int x = 0; x < width; ++x) {
+        const QRgb* pixels = source + weights.first[x];
+        const qint16* coefficients = weights.coefficients.constData() + x * weights.taps;
+        const int count = weights.count[x];
+
+        __m128i sum = _mm_set1_epi32(precisionHalf);
+
+        int k = 0;
+        for (; k + 2 <= count; k += 2) {
+            const __m128i pair = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pixels + k));
+            const __m128i interleaved = _mm_unpacklo_epi8(_mm_unpacklo_epi8(pair, _mm_srli_si128(pair, 4)), zero);
+
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(interleaved, coefficientPair(coefficients[k], coefficients[k + 1])));
+        }
+
+        if (k < count) {
+            const __m128i pixel = _mm_unpacklo_epi8(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(pixels[k])), zero), zero);
+
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(pixel, coefficientPair(coefficients[k], 0)));
+        }
+
+        destination[x] = static_cast<QRgb>(_mm_cvtsi128_si32(packSums(sum, sum, sum, sum)));
+    }
+}
+
+///
+/// \brief accumulateRows - Функция добавляет к суммам четырех пикселей два ряда источника с парой весов.
+///
+inline void accumulateRows(__m128i sums[4], const __m128i top, const __m128i bottom, const __m128i coefficients)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    const __m128i low = _mm_unpacklo_epi8(top, bottom);
+    const __m128i high = _mm_unpackhi_epi8(top, bottom);
+
+    sums[0] = _mm_add_epi32(sums[0], _mm_madd_epi16(_mm_unpacklo_epi8(low, zero), coefficients));
+    sums[1] = _mm_add_epi32(sums[1], _mm_madd_epi16(_mm_unpackhi_epi8(low, zero), coefficients));
+    sums[2] = _mm_add_epi32(sums[2], _mm_madd_epi16(_mm_unpacklo_epi8(high, zero), coefficients));
+    sums[3] = _mm_add_epi32(sums[3], _mm_madd_epi16(_mm_unpackhi_epi8(high, zero), coefficients));
+}
+
+///
+/// \brief verticalRowSse2 - Функция считает ряд результата по рядам источника: четыре пикселя и два ряда за шаг.
+///
+void verticalRowSse2(const Tiling::ImageRows& source, const int first, const int count, const qint16* coefficients, QRgb* destination,
+    const int width)
+{
+    int x = 0;
+
+    for (; x + 4 <= width; x += 4) {
+        __m128i sums[4] = { _mm_set1_epi32(precisionHalf), _mm_set1_epi32(precisionHalf), _mm_set1_epi32(precisionHalf),
+            _mm_set1_epi32(precisionHalf) };
+
+        int k = 0;
+        for (; k + 2 <= count; k += 2) {
+            const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.constRow(first + k) + x));
+            const __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.constRow(first + k + 1) + x));
+
+            accumulateRows(sums, top, bottom, coefficientPair(coefficients[k], coefficients[k + 1]));
+        }
+
+        if (k < count) {
+            const __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source.constRow(first + k) + x));
+
+            accumulateRows(sums, top, _mm_setzero_si128(), coefficientPair(coefficients[k], 0));
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), packSums(sums[0], sums[1], sums[2], sums[3]));
+    }
+
+    verticalRowScalar(source, first, count, coefficients, destination, x, width);
+}
+#endif
+
+///
+/// \brief horizontalRow - Функция считает ряд результата горизонтального прохода.
+///
+void horizontalRow(const QRgb* source, QRgb* destination, const Weights& weights, const int width)
+{
+#if defined(PHOTOPROCESSING_SSE2)
+    horizontalRowSse2(source, destination, weights, width);
+#else
+    horizontalRowScalar(source, destination, weights, width);
+#endif
+}
+
+///
+/// \brief verticalRow - Функция считает ряд результата вертикального прохода.
+///
+void verticalRow(const Tiling::ImageRows& source, const int first, const int count, const qint16* coefficients, QRgb* destination, const int width)
+{
+#if defined(PHOTOPROCESSING_SSE2)
+    verticalRowSse2(source, first, count, coefficients, destination, width);
+#else
+    verticalRowScalar(source, first, count, coefficients, destination, 0, width);
+#endif
+}
+
+///
+/// \brief clampPremultipliedRow - Функция ограничивает каналы цвета альфой.
+/// Отрицательные лепестки бикубического фильтра и фильтра Ланцоша дают цвет ярче альфы, а такой пиксель нельзя вернуть из премультипликации.
+///
+void clampPremultipliedRow(QRgb* row, const int width)
+{
+    for (int x = 0; x < width; ++x) {
+        const int alpha = qAlpha(row[x]);
+
+        row[x] = qRgba(qMin(qRed(row[x]), alpha), qMin(qGreen(row[x]), alpha), qMin(qBlue(row[x]), alpha), alpha);
+    }
+}
+
+///
+/// \brief horizontalPass - Функция меняет ширину изображения: source -> destination той же высоты.
+///
+void horizontalPass(const QImage& source, QImage& destination, const Weights& weights, const bool clamp)
+{
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows destinationRows(destination);
+
+    Tiling::forEachStripe(destination, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            horizontalRow(sourceRows.constRow(y), destinationRows.row(y), weights, destinationRows.width());
+
+            if (clamp) {
+                clampPremultipliedRow(destinationRows.row(y), destinationRows.width());
+            }
+        }
+    });
+}
+
+///
+/// \brief verticalPass - Функция меняет высоту изображения: source -> destination той же ширины.
+///
+void verticalPass(const QImage& source, QImage& destination, const Weights& weights, const bool clamp)
+{
+    const Tiling::ImageRows sourceRows(source);
+    const Tiling::ImageRows destinationRows(destination);
+
+    Tiling::forEachStripe(destination, [&](const Tiling::Stripe& stripe) {
+        for (int y = stripe.firstRow; y < stripe.lastRow; ++y) {
+            const qint16* coefficients = weights.coefficients.constData() + y * weights.taps;
+
+            verticalRow(sourceRows, weights.first[y], weights.count[y], coefficients, destinationRows.row(y), destinationRows.width());
+
+            if (clamp) {
+                clampPremultipliedRow(destinationRows.row(y), destinationRows.width());
+            }
+        }
+    });
+}
+}
+
+///
+/// \brief Resample::resize - Функция изменяет размер изображения.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param size - Новый размер. Пропорции не сохраняются.
+/// \param filter - Фильтр.
+/// \return Новое изображение в том же формате. Если размер не меняется, возвращается исходное изображение без копирования.
+///
+QImage Resample::resize(const QImage& image, const QSize& size, const Filter filter)
+{
+    if (image.isNull() || size.isEmpty()) {
+        return {};
+    }
+
+    if (size == image.size()) {
+        return image;
+    }
+
+    const bool premultiply = (image.format() == QImage::Format_ARGB32);
+    const bool clamp = premultiply && (filter == Filter::Bicubic || filter == Filter::Lanczos);
+    const Kernel resampleKernel = kernel(filter);
+
+    /* Горизонтальный проход пишет только size.width() столбцов, поэтому при уменьшении вертикальный проход читает уже узкие ряды */
+    QImage result = premultiply ? image.convertToFormat(QImage::Format_ARGB32_Premultiplied) : image;
+
+    if (size.width() != result.width()) {
+        QImage horizontal(size.width(), result.height(), result.format());
+        horizontalPass(result, horizontal, computeWeights(result.width(), size.width(), resampleKernel), clamp && size.height() == result.height());
+
+        result = horizontal;
+    }
+
+    if (size.height() != result.height()) {
+        QImage vertical(result.width(), size.height(), result.format());
+        verticalPass(result, vertical, computeWeights(result.height(), size.height(), resampleKernel), clamp);
+
+        result = vertical;
+    }
+
+    if (Tiling::isCancelled()) {
+        return {};
+    }
+
+    return premultiply ? result.convertToFormat(QImage::Format_ARGB32) : result;
+}
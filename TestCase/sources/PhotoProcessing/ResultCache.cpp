@@ -0,0 +1,105 @@
+#include "include/PhotoProcessing/ResultCache.h"
+
+#include <limits>
+
+#include <QMutexLocker>
+
+namespace {
+///
+/// \brief kilobytes - Функция переводит байты в стоимость записи кэша с округлением вверх.
+///
+int kilobytes(const qsizetype bytes)
+{
+    return static_cast<int>(qMin<qsizetype>((bytes + 1023) / 1024, std::numeric_limits<int>::max()));
+}
+}
+
+///
+/// \brief ResultCache::ResultCache - Конструктор создает пустой кэш.
+/// \param budget - Бюджет памяти в байтах.
+///
+ResultCache::ResultCache(const qsizetype budget)
+    : images { kilobytes(budget) }
+{
+}
+
+///
+/// \brief ResultCache::find - Функция ищет результат и делает его последним использованным.
+/// \param key - Ключ результата. Пустой ключ ничего не находит и не считается промахом.
+/// \return Найденное изображение или пустое изображение при промахе.
+///
+QImage ResultCache::find(const QByteArray& key)
+{
+    if (key.isEmpty()) {
+        return QImage();
+    }
+
+    QMutexLocker locker(&mutex);
+
+    /* QCache::object() переносит запись в конец очереди вытеснения */
+    const QImage* image = images.object(key);
+
+    if (image == nullptr) {
+        ++misses;
+
+        return QImage();
+    }
+
+    ++hits;
+
+    return *image;
+}
+
+///
+/// \brief ResultCache::insert - Функция добавляет результат, вытесняя давно не использованные. Результат больше бюджета не добавляется.
+/// \param key - Ключ результата. С пустым ключом результат не добавляется.
+/// \param image - Результат.
+///
+void ResultCache::insert(const QByteArray& key, const QImage& image)
+{
+    if (key.isEmpty() || image.isNull()) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+
+    /* Копия изображения делит пиксели с результатом, пока никто из них не пишет */
+    images.insert(key, new QImage(image), kilobytes(image.sizeInBytes()));
+}
+
+///
+/// \brief ResultCache::setBudget - Функция задает бюджет памяти, лишние результаты вытесняются сразу.
+/// \param budget - Бюджет в байтах.
+///
+void ResultCache::setBudget(const qsizetype budget)
+{
+    QMutexLocker locker(&mutex);
+
+    images.setMaxCost(kilobytes(budget));
+}
+
+///
+/// \brief ResultCache::clear - Функция удаляет все результаты. Счетчики попаданий и промахов сохраняются.
+///
+void ResultCache::clear()
+{
+    QMutexLocker locker(&mutex);
+
+    images.clear();
+}
+
+///
+/// \brief ResultCache::statistics - Функция возвращает счетчики кэша.
+///
+ResultCache::Statistics ResultCache::statistics() const
+{
+    QMutexLocker locker(&mutex);
+
+    Statistics result;
+    result.hits = hits;
+    result.misses = misses;
+    result.bytes = static_cast<qsizetype>(images.totalCost()) * 1024;
+    result.entries = static_cast<int>(images.count());
+
+    return result;
+}
@@ -0,0 +1,173 @@
+#include "include/PhotoProcessing/ScratchImage.h"
+
+#include <cstring>
+
+#include <QFile>
+
+namespace {
+/* Сигнатура "PPRW" и версия формата */
+constexpr quint32 scratchMagic = 0x57525050;
+constexpr quint32 scratchVersion = 1;
+
+/* Ряды начинаются после заголовка с выравниванием на 64 байта */
+constexpr qint64 headerSize = 64;
+
+///
+/// \brief The Header struct - Заголовок рабочего файла.
+///
+struct Header {
+    quint32 magic = scratchMagic;
+    quint32 version = scratchVersion;
+    qint32 width = 0;
+    qint32 height = 0;
+    qint32 format = QImage::Format_Invalid;
+    qint32 reserved = 0;
+    qint64 bytesPerLine = 0;
+};
+
+static_assert(sizeof(Header) <= headerSize, "Header must fit before the first row");
+
+///
+/// \brief The Mapping struct - Отображенный файл. Живет, пока живет изображение поверх него.
+///
+struct Mapping {
+    QFile file;
+    uchar* data = nullptr;
+};
+
+///
+/// \brief releaseMapping - Функция снимает отображение и удаляет рабочий файл, когда удаляется последняя копия изображения.
+///
+void releaseMapping(void* info)
+{
+    auto* mapping = static_cast<Mapping*>(info);
+
+    mapping->file.unmap(mapping->data);
+    mapping->file.remove();
+
+    delete mapping;
+}
+
+///
+/// \brief wrap - Функция проверяет заголовок и оборачивает ряды отображенного файла изображением. Забирает владение mapping.
+/// \param mapping - Отображенный файл.
+/// \param size - Размер отображенной области.
+///
+QImage wrap(Mapping* mapping, const qint64 size)
+{
+    Header header;
+    std::memcpy(&header, mapping->data, sizeof(Header));
+
+    const bool valid = header.magic == scratchMagic && header.version == scratchVersion && header.width > 0 && header.height > 0
+        && header.bytesPerLine >= header.width * static_cast<qint64>(sizeof(QRgb)) && headerSize + header.bytesPerLine * header.height <= size;
+
+    if (!valid) {
+        releaseMapping(mapping);
+
+        return {};
+    }
+
+    /* Конструктор с константными данными не копирует их и не дает изменить: запись в изображение создаст копию в памяти */
+    const uchar* rows = mapping->data + headerSize;
+
+    return QImage(rows, header.width, header.height, header.bytesPerLine, static_cast<QImage::Format>(header.format), releaseMapping, mapping);
+}
+
+///
+/// \brief mappingSize - Функция возвращает размер рабочего файла для изображения.
+///
+qint64 mappingSize(const QSize& size)
+{
+    return headerSize + size.width() * static_cast<qint64>(sizeof(QRgb)) * size.height();
+}
+
+///
+/// \brief createMapping - Функция создает рабочий файл с заголовком и отображает его в память.
+/// \return Отображенный файл или nullptr при ошибке.
+///
+Mapping* createMapping(const QString& filePath, const QSize& size, const QImage::Format format)
+{
+    Header header;
+    header.width = size.width();
+    header.height = size.height();
+    header.format = format;
+    header.bytesPerLine = size.width() * static_cast<qint64>(sizeof(QRgb));
+
+    const qint64 bytes = mappingSize(size);
+
+    auto* mapping = new Mapping;
+    mapping->file.setFileName(filePath);
+
+    if (!mapping->file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !mapping->file.resize(bytes)) {
+        mapping->file.remove();
+        delete mapping;
+
+        return nullptr;
+    }
+
+    mapping->data = mapping->file.map(0, bytes);
+
+    if (mapping->data == nullptr) {
+        mapping->file.remove();
+        delete mapping;
+
+        return nullptr;
+    }
+
+    std::memset(mapping->data, 0, headerSize);
+    std::memcpy(mapping->data, &header, sizeof(Header));
+
+    return mapping;
+}
+}
+
+///
+/// \brief ScratchImage::write - Функция записывает изображение в рабочий файл и возвращает изображение, которое читает ряды прямо из файла.
+/// \param image - 32-битное изображение.
+/// \param filePath - Путь рабочего файла.
+/// \return Изображение только для чтения поверх отображенного файла или пустое изображение при ошибке.
+///
+QImage ScratchImage::write(const QImage& image, const QString& filePath)
+{
+    if (image.isNull() || image.depth() != 32) {
+        return {};
+    }
+
+    const qint64 bytesPerLine = image.width() * static_cast<qint64>(sizeof(QRgb));
+
+    Mapping* mapping = createMapping(filePath, image.size(), image.format());
+
+    if (mapping == nullptr) {
+        return {};
+    }
+
+    /* Ряды пишутся прямо в отображение, страницы уходят на диск по решению ОС */
+    for (int y = 0; y < image.height(); ++y) {
+        std::memcpy(mapping->data + headerSize + y * bytesPerLine, image.constScanLine(y), bytesPerLine);
+    }
+
+    return wrap(mapping, mappingSize(image.size()));
+}
+
+///
+/// \brief ScratchImage::create - Функция создает рабочий файл под изображение и возвращает изображение, которое пишет ряды прямо в файл.
+/// \param size - Размер изображения.
+/// \param format - 32-битный формат.
+/// \param filePath - Путь рабочего файла.
+/// \return Изображение поверх отображенного файла или пустое изображение при ошибке. Ряды заполнены нулями.
+///
+QImage ScratchImage::create(const QSize& size, const QImage::Format format, const QString& filePath)
+{
+    if (size.isEmpty() || QImage::toPixelFormat(format).bitsPerPixel() != 32) {
+        return {};
+    }
+
+    Mapping* mapping = createMapping(filePath, size, format);
+
+    if (mapping == nullptr) {
+        return {};
+    }
+
+    /* Конструктор с изменяемыми данными не копирует их: пока изображение не разделено, запись идет в отображенный файл */
+    return QImage(mapping->data + headerSize, size.width(), size.height(), size.width() * static_cast<qsizetype>(sizeof(QRgb)), format, releaseMapping, mapping);
+}
@@ -0,0 +1,442 @@
+#include "include/PhotoProcessing/TiledImage.h"
+#include "include/PhotoProcessing/ScratchImage.h"
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <cstring>
+
+#include <QAtomicInteger>
+
+namespace {
+/* Тайлы обрабатываются параллельно такими порциями */
+constexpr int tilesPerTask = 16;
+
+/* Быстрый уровень сжатия: тайлы сжимаются в фоне, а распаковываются при undo */
+constexpr int compressionLevel = 1;
+
+///
+/// \brief readTile - Функция копирует прямоугольник изображения в непрерывный буфер тайла.
+///
+QByteArray readTile(const Tiling::ImageRows& rows, const QRect& rect)
+{
+    const int rowBytes = rect.width() * static_cast<int>(sizeof(QRgb));
+
+    QByteArray pixels(rowBytes * rect.height(), Qt::Uninitialized);
+
+    for (int y = 0; y < rect.height(); ++y) {
+        std::memcpy(pixels.data() + y * rowBytes, rows.constRow(rect.y() + y) + rect.x(), rowBytes);
+    }
+
+    return pixels;
+}
+}
+
+TiledImage::Tile::Tile(const QByteArray& pixels)
+    : data { pixels }
+{
+}
+
+///
+/// \brief TiledImage::Tile::pixels - Функция возвращает несжатые пиксели тайла.
+///
+QByteArray TiledImage::Tile::pixels() const
+{
+    QMutexLocker locker(&mutex);
+
+    switch (storage) {
+    case Storage::Compressed:
+        return qUncompress(data);
+    case Storage::Spilled:
+        /* Ряды читаются прямо из отображенного файла */
+        return readTile(Tiling::ImageRows(scratch), scratchRect);
+    default:
+        return data;
+    }
+}
+
+///
+/// \brief TiledImage::Tile::isRaw - Функция проверяет, что тайл несжатый и находится в памяти.
+///
+bool TiledImage::Tile::isRaw() const
+{
+    QMutexLocker locker(&mutex);
+
+    return storage == Storage::Raw;
+}
+
+///
+/// \brief TiledImage::Tile::byteCount - Функция возвращает, сколько байт тайл занимает в памяти. Вытесненный тайл памяти не занимает.
+///
+qsizetype TiledImage::Tile::byteCount() const
+{
+    QMutexLocker locker(&mutex);
+
+    return data.size();
+}
+
+///
+/// \brief TiledImage::Tile::compress - Функция сжимает тайл, если он еще не сжат.
+/// \return Сколько байт освобождено.
+///
+qsizetype TiledImage::Tile::compress()
+{
+    QByteArray pixels;
+
+    {
+        QMutexLocker locker(&mutex);
+
+        if (storage != Storage::Raw) {
+            return 0;
+        }
+
+        pixels = data;
+    }
+
+    /* Сжимаем без блокировки, чтобы чтение тайла не ждало сжатия */
+    const QByteArray packed = qCompress(pixels, compressionLevel);
+
+    QMutexLocker locker(&mutex);
+
+    /* Несжимаемые тайлы (шум) остаются как есть */
+    if (storage != Storage::Raw || packed.size() >= data.size()) {
+        return 0;
+    }
+
+    const qsizetype released = data.size() - packed.size();
+
+    data = packed;
+    storage = Storage::Compressed;
+
+    return released;
+}
+
+///
+/// \brief TiledImage::Tile::spill - Функция заменяет пиксели тайла прямоугольником изображения из рабочего файла.
+/// \param scratchImage - Изображение поверх отображенного рабочего файла (ScratchImage::write()).
+/// \param rect - Прямоугольник тайла.
+/// \return Сколько байт освобождено.
+///
+qsizetype TiledImage::Tile::spill(const QImage& scratchImage, const QRect& rect)
+{
+    QMutexLocker locker(&mutex);
+
+    if (storage == Storage::Spilled) {
+        return 0;
+    }
+
+    const qsizetype released = data.size();
+
+    data = QByteArray();
+    storage = Storage::Spilled;
+
+    scratch = scratchImage;
+    scratchRect = rect;
+
+    return released;
+}
+
+///
+/// \brief TiledImage::fromImage - Функция разбивает изображение на тайлы. Тайлы, совпадающие с тайлами previous, берутся из previous.
+/// \param image - Изображение в формате, полученном из PointOperations::normalized().
+/// \param previous - Предыдущая ревизия. Сравниваются только несжатые тайлы того же размера.
+/// \param changed - Прямоугольник, вне которого image совпадает с previous. Тайлы вне него берутся из previous без чтения.
+/// Пустой прямоугольник - измененная область неизвестна.
+///
+TiledImage TiledImage::fromImage(const QImage& image, const TiledImage& previous, const QRect& changed)
+{
+    if (image.isNull()) {
+        return {};
+    }
+
+    static QAtomicInteger<quint64> lastId;
+
+    auto data = QSharedPointer<Data>::create();
+    data->id = lastId.fetchAndAddRelaxed(1) + 1;
+    data->size = image.size();
+    data->format = image.format();
+    data->columns = (image.width() + tileSize - 1) / tileSize;
+    data->rows = (image.height() + tileSize - 1) / tileSize;
+    data->tiles.resize(data->columns * data->rows);
+
+    TiledImage result;
+    result.d = data;
+
+    const bool comparable = !previous.isNull() && previous.d->size == data->size && previous.d->format == data->format;
+
+    const Tiling::ImageRows rows(image);
+    QSharedPointer<Tile>* tiles = data->tiles.data();
+
+    Tiling::forEachRange(data->tiles.size(), tilesPerTask, [&](const int first, const int last) {
+        for (int index = first; index < last; ++index) {
+            /* Тайл вне измененной области переходит из previous в любом виде, даже сжатый или вытесненный */
+            if (comparable && !changed.isNull() && !result.tileRect(index).intersects(changed)) {
+                tiles[index] = previous.d->tiles.at(index);
+
+                continue;
+            }
+
+            const QByteArray pixels = readTile(rows, result.tileRect(index));
+
+            /* Сжатый или вытесненный тайл пришлось бы прочитать ради сравнения, поэтому он считается измененным */
+            if (comparable) {
+                const QSharedPointer<Tile>& previousTile = previous.d->tiles.at(index);
+
+                if (previousTile->isRaw() && previousTile->pixels() == pixels) {
+                    tiles[index] = previousTile;
+
+                    continue;
+                }
+            }
+
+            tiles[index] = QSharedPointer<Tile>::create(pixels);
+        }
+    });
+
+    return result;
+}
+
+///
+/// \brief TiledImage::isNull - Функция проверяет, что в объекте нет изображения.
+///
+bool TiledImage::isNull() const
+{
+    return d.isNull();
+}
+
+///
+/// \brief TiledImage::id - Функция возвращает номер копии изображения, уникальный на время работы программы. У пустого объекта 0.
+/// Копии объекта, в том числе в разных ревизиях, имеют один номер, поэтому по нему можно искать посчитанные из изображения результаты.
+///
+quint64 TiledImage::id() const
+{
+    return d.isNull() ? 0 : d->id;
+}
+
+///
+/// \brief TiledImage::isSharedWith - Функция проверяет, что оба объекта - одна и та же копия изображения.
+///
+bool TiledImage::isSharedWith(const TiledImage& other) const
+{
+    return !d.isNull() && d == other.d;
+}
+
+///
+/// \brief TiledImage::tileCount - Функция возвращает количество тайлов.
+///
+int TiledImage::tileCount() const
+{
+    return d.isNull() ? 0 : d->tiles.size();
+}
+
+///
+/// \brief TiledImage::isTileSharedWith - Функция проверяет, что тайл index один и тот же в обоих изображениях, то есть не изменился между ревизиями.
+/// \param index - Номер тайла.
+/// \param other - Другая ревизия.
+///
+bool TiledImage::isTileSharedWith(const int index, const TiledImage& other) const
+{
+    if (d.isNull() || other.d.isNull() || d->size != other.d->size || index < 0 || index >= d->tiles.size()) {
+        return false;
+    }
+
+    return d->tiles.at(index) == other.d->tiles.at(index);
+}
+
+///
+/// \brief TiledImage::changedRect - Функция возвращает прямоугольник тайлов, которые отличаются от тайлов other.
+/// Если размеры не совпадают, возвращается все изображение.
+/// \param other - Другая ревизия.
+///
+QRect TiledImage::changedRect(const TiledImage& other) const
+{
+    if (d.isNull()) {
+        return {};
+    }
+
+    if (other.d.isNull() || d->size != other.d->size || d->format != other.d->format) {
+        return QRect(QPoint(0, 0), d->size);
+    }
+
+    QRect changed;
+
+    for (int index = 0; index < d->tiles.size(); ++index) {
+        if (d->tiles.at(index) != other.d->tiles.at(index)) {
+            changed |= tileRect(index);
+        }
+    }
+
+    return changed;
+}
+
+///
+/// \brief TiledImage::size - Функция возвращает размер изображения.
+///
+QSize TiledImage::size() const
+{
+    return d.isNull() ? QSize() : d->size;
+}
+
+///
+/// \brief TiledImage::toImage - Функция собирает изображение из всех тайлов.
+///
+QImage TiledImage::toImage() const
+{
+    QImage image;
+
+    patch(image, {});
+
+    return image;
+}
+
+///
+/// \brief TiledImage::patch - Функция превращает image, собранное из from, в это изображение, записывая только отличающиеся тайлы.
+/// Если размеры не совпадают, изображение собирается заново.
+/// \param image - Изображение, которое было собрано из from. Изменяется на месте.
+/// \param from - Копия, из которой было собрано image.
+///
+void TiledImage::patch(QImage& image, const TiledImage& from) const
+{
+    if (d.isNull()) {
+        image = QImage();
+
+        return;
+    }
+
+    const bool comparable = !from.isNull() && from.d->size == d->size && from.d->format == d->format && image.size() == d->size && image.format() == d->format;
+
+    if (!comparable) {
+        image = QImage(d->size, d->format);
+    }
+
+    /* Если изображение ни с кем не разделено, bits() не копирует его, и записываются только отличающиеся тайлы */
+    uchar* bits = image.bits();
+    const qsizetype bytesPerLine = image.bytesPerLine();
+
+    Tiling::forEachRange(d->tiles.size(), tilesPerTask, [&](const int first, const int last) {
+        for (int index = first; index < last; ++index) {
+            if (!comparable || from.d->tiles.at(index) != d->tiles.at(index)) {
+                writeTile(index, bits, bytesPerLine);
+            }
+        }
+    });
+}
+
+///
+/// \brief TiledImage::compress - Функция сжимает тайлы, которых нет в except. Вызывается из любого потока.
+/// \param except - Копия, тайлы которой должны остаться несжатыми.
+/// \return Сколько байт освобождено.
+///
+qsizetype TiledImage::compress(const TiledImage& except) const
+{
+    if (d.isNull() || isSharedWith(except)) {
+        return 0;
+    }
+
+    QSet<const Tile*> kept;
+    if (!except.isNull()) {
+        for (const QSharedPointer<Tile>& tile : except.d->tiles) {
+            kept.insert(tile.data());
+        }
+    }
+
+    QAtomicInteger<qsizetype> released(0);
+
+    Tiling::forEachRange(d->tiles.size(), tilesPerTask, [&](const int first, const int last) {
+        for (int index = first; index < last; ++index) {
+            const QSharedPointer<Tile>& tile = d->tiles.at(index);
+
+            if (!kept.contains(tile.data())) {
+                released.fetchAndAddRelaxed(tile->compress());
+            }
+        }
+    });
+
+    return released.loadAcquire();
+}
+
+///
+/// \brief TiledImage::spill - Функция вытесняет тайлы, которых нет в except, в рабочий файл. Тайлы читаются из отображенного файла без декодирования.
+/// Вызывается из любого потока.
+/// \param filePath - Путь рабочего файла.
+/// \param except - Копия, тайлы которой должны остаться в памяти.
+/// \return Сколько байт освобождено.
+///
+qsizetype TiledImage::spill(const QString& filePath, const TiledImage& except) const
+{
+    if (d.isNull() || isSharedWith(except)) {
+        return 0;
+    }
+
+    /* Файл живет, пока на него ссылается хотя бы один тайл */
+    const QImage scratch = ScratchImage::write(toImage(), filePath);
+
+    if (scratch.isNull()) {
+        return 0;
+    }
+
+    QSet<const Tile*> kept;
+    if (!except.isNull()) {
+        for (const QSharedPointer<Tile>& tile : except.d->tiles) {
+            kept.insert(tile.data());
+        }
+    }
+
+    qsizetype released = 0;
+
+    for (int index = 0; index < d->tiles.size(); ++index) {
+        const QSharedPointer<Tile>& tile = d->tiles.at(index);
+
+        if (!kept.contains(tile.data())) {
+            released += tile->spill(scratch, tileRect(index));
+        }
+    }
+
+    return released;
+}
+
+///
+/// \brief TiledImage::byteCount - Функция возвращает размер тайлов, которые еще не посчитаны в counted.
+/// \param counted - Уже посчитанные тайлы. Дополняется тайлами этого изображения.
+///
+qsizetype TiledImage::byteCount(QSet<const void*>& counted) const
+{
+    if (d.isNull()) {
+        return 0;
+    }
+
+    qsizetype bytes = 0;
+
+    for (const QSharedPointer<Tile>& tile : d->tiles) {
+        if (!counted.contains(tile.data())) {
+            counted.insert(tile.data());
+            bytes += tile->byteCount();
+        }
+    }
+
+    return bytes;
+}
+
+///
+/// \brief TiledImage::tileRect - Функция возвращает прямоугольник тайла в пикселях.
+/// \param index - Номер тайла.
+///
+QRect TiledImage::tileRect(const int index) const
+{
+    const int x = (index % d->columns) * tileSize;
+    const int y = (index / d->columns) * tileSize;
+
+    return QRect(x, y, qMin(tileSize, d->size.width() - x), qMin(tileSize, d->size.height() - y));
+}
+
+///
+/// \brief TiledImage::writeTile - Функция копирует пиксели тайла в изображение.
+///
+void TiledImage::writeTile(const int index, uchar* bits, const qsizetype bytesPerLine) const
+{
+    const QRect rect = tileRect(index);
+    const QByteArray pixels = d->tiles.at(index)->pixels();
+    const int rowBytes = rect.width() * static_cast<int>(sizeof(QRgb));
+
+    for (int y = 0; y < rect.height(); ++y) {
+        std::memcpy(bits + (rect.y() + y) * bytesPerLine + rect.x() * sizeof(QRgb), pixels.constData() + y * rowBytes, rowBytes);
+    }
+}
@@ -0,0 +1,120 @@
+#include "include/PhotoProcessing/Tiling.h"
+
+#include <QThread>
+
+namespace {
+/* Полоса читается и пишется целиком, поэтому берется половина типичного L2 кэша одного ядра */
+constexpr qsizetype stripeBytes = 128 * 1024;
+
+/* Полос должно быть в несколько раз больше потоков, чтобы неравномерные полосы не простаивали в конце */
+constexpr int stripesPerThread = 4;
+
+/* Токен отмены операции, которая выполняется в этом потоке */
+thread_local const Tiling::CancellationToken* threadToken = nullptr;
+}
+
+///
+/// \brief Tiling::CancellationScope::CancellationScope - Устанавливает токен отмены для операций, запущенных из текущего потока, на время жизни объекта.
+/// \param token - Токен отмены. Должен жить дольше объекта.
+///
+Tiling::CancellationScope::CancellationScope(const CancellationToken& token)
+    : previousToken { threadToken }
+{
+    threadToken = &token;
+}
+
+Tiling::CancellationScope::~CancellationScope()
+{
+    threadToken = previousToken;
+}
+
+///
+/// \brief Tiling::currentCancellation - Функция возвращает токен отмены текущего потока.
+///
+Tiling::CancellationToken Tiling::currentCancellation()
+{
+    return (threadToken != nullptr) ? *threadToken : CancellationToken();
+}
+
+///
+/// \brief Tiling::isCancelled - Функция проверяет, отменена ли операция текущего потока.
+///
+bool Tiling::isCancelled()
+{
+    return threadToken != nullptr && threadToken->isCancelled();
+}
+
+///
+/// \brief Tiling::threadCount - Функция возвращает количество потоков, на которые делится одна операция.
+///
+int Tiling::threadCount()
+{
+    return threadPool()->maxThreadCount();
+}
+
+///
+/// \brief Tiling::setThreadCount - Функция задает количество потоков. Значение меньше 1 возвращает QThread::idealThreadCount().
+/// \param count - Количество потоков.
+///
+void Tiling::setThreadCount(const int count)
+{
+    threadPool()->setMaxThreadCount(count < 1 ? QThread::idealThreadCount() : count);
+}
+
+///
+/// \brief Tiling::threadPool - Функция возвращает пул, в котором выполняются полосы.
+/// В Qt 5 blockingMap не принимает пул, поэтому используется глобальный.
+///
+QThreadPool* Tiling::threadPool()
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    /* Отдельный пул, чтобы задачи QtConcurrent::run не занимали потоки для полос */
+    static QThreadPool pool;
+
+    return &pool;
+#else
+    return QThreadPool::globalInstance();
+#endif
+}
+
+///
+/// \brief Tiling::stripeHeight - Функция подбирает высоту полосы: полоса помещается в кэш, и полос хватает на все потоки.
+/// \param height - Высота изображения.
+/// \param bytesPerLine - Размер одного ряда в байтах.
+///
+int Tiling::stripeHeight(const int height, const qsizetype bytesPerLine)
+{
+    const int cacheRows = static_cast<int>(qMax<qsizetype>(1, stripeBytes / qMax<qsizetype>(1, bytesPerLine)));
+    const int stripes = threadCount() * stripesPerThread;
+    const int balancedRows = (height + stripes - 1) / stripes;
+
+    return qMax(1, qMin(cacheRows, balancedRows));
+}
+
+///
+/// \brief Tiling::stripes - Функция делит ряды изображения на полосы.
+/// \param height - Высота изображения.
+/// \param rowsPerStripe - Высота одной полосы.
+/// \param halo - Количество дополнительных рядов сверху и снизу, которые нужны фильтру для расчета полосы.
+///
+QVector<Tiling::Stripe> Tiling::stripes(const int height, const int rowsPerStripe, const int halo)
+{
+    const int step = qMax(1, rowsPerStripe);
+
+    QVector<Stripe> result;
+    result.reserve((height + step - 1) / step);
+
+    for (int firstRow = 0; firstRow < height; firstRow += step) {
+        Stripe stripe;
+        stripe.firstRow = firstRow;
+        stripe.lastRow = qMin(firstRow + step, height);
+
+        /* Ореол обрезается границами изображения, за границей фильтры сами повторяют крайние ряды */
+        stripe.haloFirstRow = qMax(0, stripe.firstRow - halo);
+        stripe.haloLastRow = qMin(height, stripe.lastRow + halo);
+
+        result.append(stripe);
+    }
+
+    return result;
+}
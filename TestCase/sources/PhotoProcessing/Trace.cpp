@@ -0,0 +1,256 @@
+#include "include/PhotoProcessing/Trace.h"
+
+#include <QAtomicInteger>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThread>
+
+namespace {
+/* Фаз на операцию единицы, поэтому буфера хватает на тысячи последних операций */
+constexpr int capacity = 16384;
+
+QAtomicInt enabledFlag;
+QAtomicInt threadCounter;
+
+///
+/// \brief The Buffer struct - Кольцевой буфер фаз и имена потоков.
+///
+struct Buffer {
+    QMutex mutex;
+    QVector<Trace::Event> events;
+    int next = 0;
+    QHash<int, QString> threadNames;
+};
+
+///
+/// \brief buffer - Функция возвращает общий буфер фаз.
+///
+Buffer& buffer()
+{
+    static Buffer instance;
+
+    return instance;
+}
+
+///
+/// \brief clock - Функция возвращает часы замеров, они запускаются при первом обращении.
+///
+const QElapsedTimer& clock()
+{
+    static const QElapsedTimer timer = []() {
+        QElapsedTimer started;
+        started.start();
+
+        return started;
+    }();
+
+    return timer;
+}
+
+///
+/// \brief registerThread - Функция назначает номер текущему потоку и запоминает его имя для трассы.
+///
+int registerThread()
+{
+    const int index = threadCounter.fetchAndAddRelaxed(1) + 1;
+
+    const QThread* thread = QThread::currentThread();
+    const QCoreApplication* application = QCoreApplication::instance();
+
+    QString name = thread->objectName();
+
+    if (application != nullptr && thread == application->thread()) {
+        name = QStringLiteral("main");
+    } else if (name.isEmpty()) {
+        name = QStringLiteral("thread");
+    }
+
+    Buffer& events = buffer();
+    QMutexLocker locker(&events.mutex);
+
+    events.threadNames.insert(index, QStringLiteral("%1 #%2").arg(name).arg(index));
+
+    return index;
+}
+
+///
+/// \brief currentThread - Функция возвращает номер текущего потока.
+///
+int currentThread()
+{
+    thread_local const int index = registerThread();
+
+    return index;
+}
+}
+
+///
+/// \brief Trace::Scope::Scope - Начинает фазу, если замеры включены.
+/// \param name - Имя фазы, строковый литерал.
+/// \param category - Категория фазы, строковый литерал.
+///
+Trace::Scope::Scope(const char* name, const char* category)
+    : name { name }
+    , category { category }
+    , start { isEnabled() ? now() : -1 }
+{
+}
+
+Trace::Scope::~Scope()
+{
+    if (start >= 0) {
+        record(name, category, start, now());
+    }
+}
+
+///
+/// \brief Trace::isEnabled - Функция проверяет, включены ли замеры.
+///
+bool Trace::isEnabled()
+{
+    return enabledFlag.loadAcquire() != 0;
+}
+
+///
+/// \brief Trace::setEnabled - Функция включает или выключает замеры. Записанные события сохраняются.
+/// \param enabled - Включены ли замеры.
+///
+void Trace::setEnabled(const bool enabled)
+{
+    /* Часы и номер потока назначаются сразу, чтобы первая фаза не включала их создание */
+    static_cast<void>(clock());
+    static_cast<void>(currentThread());
+
+    enabledFlag.storeRelease(enabled ? 1 : 0);
+}
+
+///
+/// \brief Trace::now - Функция возвращает время в микросекундах от первого замера.
+///
+qint64 Trace::now()
+{
+    return clock().nsecsElapsed() / 1000;
+}
+
+///
+/// \brief Trace::record - Функция записывает фазу текущего потока, если замеры включены.
+/// \param name - Имя фазы, строковый литерал.
+/// \param category - Категория фазы, строковый литерал.
+/// \param start - Начало, полученное из now().
+/// \param end - Конец, полученный из now().
+///
+void Trace::record(const char* name, const char* category, const qint64 start, const qint64 end)
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    const Event event { name, category, start, qMax<qint64>(end - start, 0), currentThread() };
+
+    Buffer& events = buffer();
+    QMutexLocker locker(&events.mutex);
+
+    if (events.events.size() < capacity) {
+        events.events.append(event);
+    } else {
+        events.events[events.next] = event;
+        events.next = (events.next + 1) % capacity;
+    }
+}
+
+///
+/// \brief Trace::events - Функция возвращает записанные фазы, которые начались не раньше since, в порядке записи.
+/// \param since - Время из now().
+///
+QVector<Trace::Event> Trace::events(const qint64 since)
+{
+    Buffer& events = buffer();
+    QMutexLocker locker(&events.mutex);
+
+    QVector<Event> result;
+
+    /* После заполнения буфера самое старое событие лежит в next */
+    for (int i = 0; i < events.events.size(); ++i) {
+        const Event& event = events.events.at((events.next + i) % events.events.size());
+
+        if (event.start >= since) {
+            result.append(event);
+        }
+    }
+
+    return result;
+}
+
+///
+/// \brief Trace::clear - Функция удаляет записанные фазы.
+///
+void Trace::clear()
+{
+    Buffer& events = buffer();
+    QMutexLocker locker(&events.mutex);
+
+    events.events.clear();
+    events.next = 0;
+}
+
+///
+/// \brief Trace::writeChromeTrace - Функция записывает фазы в JSON файл формата Chrome trace event.
+/// \param filePath - Путь файла.
+/// \return Пустая строка при успехе, иначе описание ошибки.
+///
+QString Trace::writeChromeTrace(const QString& filePath)
+{
+    QHash<int, QString> threadNames;
+
+    {
+        Buffer& events = buffer();
+        QMutexLocker locker(&events.mutex);
+
+        threadNames = events.threadNames;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray traceEvents;
+
+    /* Метаданные: имена потоков в просмотрщике */
+    for (auto it = threadNames.cbegin(); it != threadNames.cend(); ++it) {
+        traceEvents.append(QJsonObject {
+            { QStringLiteral("name"), QStringLiteral("thread_name") },
+            { QStringLiteral("ph"), QStringLiteral("M") },
+            { QStringLiteral("pid"), pid },
+            { QStringLiteral("tid"), it.key() },
+            { QStringLiteral("args"), QJsonObject { { QStringLiteral("name"), it.value() } } } });
+    }
+
+    /* Завершенные фазы: ph = X, время в микросекундах */
+    for (const Event& event : events()) {
+        traceEvents.append(QJsonObject {
+            { QStringLiteral("name"), QString::fromLatin1(event.name) },
+            { QStringLiteral("cat"), QString::fromLatin1(event.category) },
+            { QStringLiteral("ph"), QStringLiteral("X") },
+            { QStringLiteral("ts"), event.start },
+            { QStringLiteral("dur"), event.duration },
+            { QStringLiteral("pid"), pid },
+            { QStringLiteral("tid"), event.thread } });
+    }
+
+    const QJsonObject trace {
+        { QStringLiteral("traceEvents"), traceEvents },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ms") }
+    };
+
+    QSaveFile file(filePath);
+
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) < 0 || !file.commit()) {
+        return file.errorString();
+    }
+
+    return QString();
+}
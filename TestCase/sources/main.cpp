@@ -1,10 +1,23 @@
 #include <QApplication>
 #include <QQmlApplicationEngine>
 
+#include "include/PhotoProcessing/Batch.h"
+#include "include/PhotoProcessing/ImageView.h"
 #include "include/PhotoProcessing/PhotoProcessing.h"
 
 int main(int argc, char* argv[])
 {
+    /* Пакетный режим работает без QML и без окон */
+    if (Batch::isBatchMode(argc, argv)) {
+        if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+            qputenv("QT_QPA_PLATFORM", "offscreen");
+        }
+
+        QCoreApplication app(argc, argv);
+
+        return Batch::exec(app.arguments());
+    }
+
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     QCoreApplication::setAttribute(Qt::AA_EnableHighDpiScaling);
 #endif
@@ -12,6 +25,7 @@ int main(int argc, char* argv[])
     QApplication app(argc, argv);
 
     qmlRegisterType<PhotoProcessing>("PhotoProcessing", 1, 0, "PhotoProcessing");
+    qmlRegisterType<ImageView>("PhotoProcessing", 1, 0, "ImageView");
 
     QQmlApplicationEngine engine;
     const QUrl url(QStringLiteral("qrc:/main.qml"));
@@ -19,58 +19,26 @@ ApplicationWindow {
     Material.theme: Material.Dark
     Material.accent: Material.Indigo
 
-    property var imageOperationsHistory: []
-    property int currentOperationInHistory: 0
-
-    property var threadQueue: []
-
-    Timer {
-        id: threadQueueTimer
-
-        interval: 450
-
-        onTriggered: {
-            let i = (threadQueue.length - 1 < 0) ? 0 : threadQueue.length - 1
-
-            if (threadQueue[i][3] === 0) {
-                photoProcessing.processHue(threadQueue[i][1], threadQueue[i][2])
-            } else if (threadQueue[i][3] === 1) {
-                photoProcessing.processBrightness(threadQueue[i][0], threadQueue[i][1], threadQueue[i][2])
-            } else if (threadQueue[i][3] === 2) {
-                photoProcessing.processContrast(threadQueue[i][0], threadQueue[i][1], threadQueue[i][2])
-            }
-        }
-    }
-
     PhotoProcessing {
         id: photoProcessing
 
+        /* Предпросмотр считается по уровню пирамиды, который не меньше области изображения на экране */
+        previewSize: Qt.size(image.width, image.height)
+
         property string sourceImage: ""
-        property int sourceWidth: 0
-        property int sourceHeight: 0
 
         property bool isHueProcessingStarted: false
 
         property bool isBrightnessProcessingStarted: false
-        property string newBrightnessImage: ""
 
         property bool isContrastProcessingStarted: false
-        property string newContrastImage: ""
     }
 
     /* Функция сбрасывает все значения UI страницы */
     function resetUi() {
-        imageOperationsHistory = []
-        imageOperationsHistory.push(photoProcessing.sourceImage)
-        currentOperationInHistory = 0
-
-        threadQueue = []
-
         photoProcessing.isHueProcessingStarted = false
         photoProcessing.isBrightnessProcessingStarted = false
         photoProcessing.isContrastProcessingStarted = false
-        photoProcessing.newBrightnessImage = ""
-        photoProcessing.newContrastImage = ""
 
         hueSlider.value = 0
         brightnessSlider.value = 1.0
@@ -85,8 +53,29 @@ ApplicationWindow {
         fileMode: FileDialog.SaveFile
         folder: StandardPaths.writableLocation(StandardPaths.DocumentsLocation)
 
+        nameFilters: [ "PNG (*.png)", "JPEG (*.jpg)", "WebP (*.webp)" ]
+
+        /* Имя без расширения получает расширение выбранного фильтра, а не исходного файла */
+        defaultSuffix: selectedNameFilter.extensions[0]
+
+        onAccepted: {
+            /* Формат берется из расширения файла, запись идет в фоне */
+            photoProcessing.exportImage(saveFileDialog.file, "", exportQualitySlider.value, exportCompressionSlider.value)
+        }
+    }
+
+    FileDialog {
+        id: saveTraceDialog
+
+        acceptLabel: "Save"
+
+        fileMode: FileDialog.SaveFile
+        folder: StandardPaths.writableLocation(StandardPaths.DocumentsLocation)
+
+        nameFilters: [ "Chrome trace (*.json)" ]
+
         onAccepted: {
-            photoProcessing.saveFile(image.source, saveFileDialog.file)
+            photoProcessing.saveTrace(saveTraceDialog.file)
         }
     }
 
@@ -97,19 +86,18 @@ ApplicationWindow {
 
         nameFilters: [ "Image files (*.jpg *.png)" ]
 
+        /* Выбранный файл декодируется в фоне, пока диалог открыт */
+        onCurrentFileChanged: {
+            photoProcessing.prefetchImage(openDialog.currentFile)
+        }
+
         onAccepted: {
             if (photoProcessing.sourceImage !== "") {
                 resetUi()
             }
 
             photoProcessing.sourceImage = openDialog.file
-            image.source = openDialog.file
-
-            photoProcessing.sourceWidth = photoProcessing.getSourceImageSize(openDialog.file)[0]
-            photoProcessing.sourceHeight = photoProcessing.getSourceImageSize(openDialog.file)[1]
-
-            imageOperationsHistory = []
-            imageOperationsHistory.push(openDialog.file)
+            photoProcessing.openImage(openDialog.file)
         }
     }
 
@@ -163,7 +151,7 @@ ApplicationWindow {
                 height: width
                 width: parent.width
 
-                enabled: (image.source == "") ? false : true
+                enabled: (!image.hasImage || photoProcessing.exporting) ? false : true
 
                 flat: true
 
@@ -189,12 +177,12 @@ ApplicationWindow {
                 height: width
                 width: parent.width
 
-                enabled: (image.source == "") ? false : true
+                enabled: (!image.hasImage) ? false : true
 
                 flat: true
 
                 onClicked: {
-                    photoProcessing.processRotate(image.source)
+                    photoProcessing.processRotate()
                 }
 
                 SvgImage {
@@ -215,12 +203,12 @@ ApplicationWindow {
                 height: width
                 width: parent.width
 
-                enabled: (image.source == "") ? false : true
+                enabled: (!image.hasImage) ? false : true
 
                 flat: true
 
                 onClicked: {
-                    photoProcessing.processIncreaseScaling(image.source)
+                    photoProcessing.processIncreaseScaling(scalingFilterBox.currentIndex)
                 }
 
                 SvgImage {
@@ -241,12 +229,12 @@ ApplicationWindow {
                 height: width
                 width: parent.width
 
-                enabled: (image.source == "") ? false : true
+                enabled: (!image.hasImage) ? false : true
 
                 flat: true
 
                 onClicked: {
-                    photoProcessing.processDecreaseScaling(image.source)
+                    photoProcessing.processDecreaseScaling(scalingFilterBox.currentIndex)
                 }
 
                 SvgImage {
@@ -267,17 +255,14 @@ ApplicationWindow {
                 height: width
                 width: parent.width
 
-                enabled: (currentOperationInHistory + 1 < imageOperationsHistory.length) ? true : false
+                enabled: photoProcessing.canRedo
 
                 flat: true
 
                 onClicked: {
-                    if (currentOperationInHistory + 1 < imageOperationsHistory.length) {
-                        currentOperationInHistory += 1
+                    resetUi()
 
-                        image.source = ""
-                        image.source = imageOperationsHistory[currentOperationInHistory]
-                    }
+                    photoProcessing.redo()
                 }
 
                 SvgImage {
@@ -298,17 +283,14 @@ ApplicationWindow {
                 height: width
                 width: parent.width
 
-                enabled: (currentOperationInHistory > 0) ? true : false
+                enabled: photoProcessing.canUndo
 
                 flat: true
 
                 onClicked: {
-                    if (currentOperationInHistory !== 0) {
-                        currentOperationInHistory -= 1
+                    resetUi()
 
-                        image.source = ""
-                        image.source = imageOperationsHistory[currentOperationInHistory]
-                    }
+                    photoProcessing.undo()
                 }
 
                 SvgImage {
@@ -334,7 +316,7 @@ ApplicationWindow {
                 onClicked: {
                     resetUi()
 
-                    image.source = photoProcessing.sourceImage
+                    photoProcessing.restore()
                 }
 
                 SvgImage {
@@ -351,15 +333,11 @@ ApplicationWindow {
         }
     }
 
-    Image {
+    /* Изображение показывается тайлами: колесо мыши масштабирует, перетаскивание сдвигает, двойной щелчок вписывает в окно */
+    ImageView {
         id: image
 
-        cache: false
-
-        fillMode: Image.PreserveAspectFit
-
-        sourceSize.height: 350
-        sourceSize.width: 350
+        processing: photoProcessing
 
         anchors {
             top: parent.top
@@ -370,6 +348,91 @@ ApplicationWindow {
             margins: 10
         }
 
+        /* Фаза reload замеряется до загрузки всех видимых тайлов */
+        onFrameReady: {
+            photoProcessing.reportImageReady()
+        }
+
+        MouseArea {
+            property point lastPoint
+
+            enabled: !selectionSwitch.checked
+
+            anchors {
+                fill: parent
+            }
+
+            onPressed: {
+                lastPoint = Qt.point(mouse.x, mouse.y)
+            }
+
+            onPositionChanged: {
+                image.pan(Qt.point(mouse.x - lastPoint.x, mouse.y - lastPoint.y))
+
+                lastPoint = Qt.point(mouse.x, mouse.y)
+            }
+
+            onDoubleClicked: {
+                image.zoom = 0
+            }
+
+            onWheel: {
+                image.zoomAt(wheel.angleDelta.y > 0 ? 1.25 : 0.8, Qt.point(wheel.x, wheel.y))
+            }
+        }
+
+        /* Выделение рисуется поверх вписанного изображения, координаты - доли показанного изображения */
+        Rectangle {
+            id: selectionOverlay
+
+            x: image.paintedRect.x + photoProcessing.selection.x * image.paintedRect.width
+            y: image.paintedRect.y + photoProcessing.selection.y * image.paintedRect.height
+            width: photoProcessing.selection.width * image.paintedRect.width
+            height: photoProcessing.selection.height * image.paintedRect.height
+
+            color: "#2200aaff"
+            border.color: "#00aaff"
+            border.width: 1
+
+            visible: width > 0 && height > 0
+        }
+
+        MouseArea {
+            id: selectionMouseArea
+
+            property point pressPoint
+
+            enabled: selectionSwitch.checked
+
+            anchors {
+                fill: parent
+            }
+
+            function normalized(point) {
+                return Qt.point(Math.min(Math.max((point.x - image.paintedRect.x) / image.paintedRect.width, 0), 1),
+                                Math.min(Math.max((point.y - image.paintedRect.y) / image.paintedRect.height, 0), 1))
+            }
+
+            function select(mouse) {
+                const end = normalized(Qt.point(mouse.x, mouse.y))
+
+                photoProcessing.selection = Qt.rect(Math.min(pressPoint.x, end.x), Math.min(pressPoint.y, end.y),
+                                                    Math.abs(end.x - pressPoint.x), Math.abs(end.y - pressPoint.y))
+            }
+
+            onPressed: {
+                pressPoint = normalized(Qt.point(mouse.x, mouse.y))
+            }
+
+            onPositionChanged: {
+                select(mouse)
+            }
+
+            onReleased: {
+                select(mouse)
+            }
+        }
+
         Rectangle {
             color: "#333333"
 
@@ -396,6 +459,120 @@ ApplicationWindow {
 
             sourceComponent: BusyIndicator { }
         }
+
+        ProgressBar {
+            id: loadProgressBar
+
+            width: parent.width / 2
+
+            value: photoProcessing.loadProgress
+
+            visible: imageBusyIndicatorLoader.active && photoProcessing.loadProgress > 0
+
+            anchors {
+                top: imageBusyIndicatorLoader.bottom
+                horizontalCenter: parent.horizontalCenter
+
+                topMargin: 10
+            }
+        }
+
+        Row {
+            id: exportProgressRow
+
+            height: 40
+
+            spacing: 10
+
+            visible: photoProcessing.exporting
+
+            anchors {
+                left: parent.left
+                right: parent.right
+                bottom: parent.bottom
+            }
+
+            ProgressBar {
+                width: parent.width - parent.children[1].width - 10
+
+                value: photoProcessing.exportProgress
+
+                anchors {
+                    verticalCenter: parent.verticalCenter
+                }
+            }
+
+            Button {
+                height: parent.height
+
+                text: qsTr("Отмена")
+
+                flat: true
+
+                onClicked: {
+                    photoProcessing.cancelExport()
+                }
+            }
+        }
+
+        /* Фазы последней операции при включенных замерах */
+        Rectangle {
+            id: timingsOverlay
+
+            width: timingsColumn.implicitWidth + 20
+            height: timingsColumn.implicitHeight + 20
+
+            color: "#cc000000"
+
+            visible: photoProcessing.tracing && photoProcessing.timings.length > 0
+
+            anchors {
+                top: parent.top
+                left: parent.left
+            }
+
+            Column {
+                id: timingsColumn
+
+                anchors {
+                    fill: parent
+
+                    margins: 10
+                }
+
+                Repeater {
+                    model: photoProcessing.timings
+
+                    Text {
+                        text: modelData.name + ": " + modelData.duration.toFixed(1) + qsTr(" мс, начало ") + modelData.start.toFixed(1) + qsTr(" мс, поток ") + modelData.thread
+                        color: modelData.category === "scheduler" ? "#bbbbbb" : "white"
+
+                        font.pointSize: 9
+                    }
+                }
+
+                Text {
+                    text: qsTr("Кэш: попаданий ") + photoProcessing.cacheStatistics.hits + qsTr(", промахов ") + photoProcessing.cacheStatistics.misses
+                          + ", " + (photoProcessing.cacheStatistics.bytes / (1024 * 1024)).toFixed(1) + qsTr(" МБ")
+                    color: "#bbbbbb"
+
+                    font.pointSize: 9
+                }
+            }
+        }
+
+        Text {
+            id: errorText
+
+            color: "white"
+
+            visible: text !== "" && !photoProcessing.exporting
+
+            anchors {
+                left: parent.left
+                bottom: parent.bottom
+            }
+        }
     }
 
     Rectangle {
@@ -429,7 +606,7 @@ ApplicationWindow {
 
             spacing: 0
 
-            enabled: image.source != ""
+            enabled: image.hasImage
 
             anchors {
                 top: parent.top
@@ -443,7 +620,7 @@ ApplicationWindow {
                 text: "Эффект сепии"
 
                 onClicked: {
-                    photoProcessing.processToSepia(image.source)
+                    photoProcessing.processToSepia()
                 }
             }
 
@@ -453,7 +630,127 @@ ApplicationWindow {
                 text: "Эффект серого"
 
                 onClicked: {
-                    photoProcessing.processRgbToGray(image.source)
+                    photoProcessing.processRgbToGray()
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: "Поворот по часовой"
+
+                onClicked: {
+                    photoProcessing.processRotateClockwise()
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: "Поворот на 180°"
+
+                onClicked: {
+                    photoProcessing.processRotate180()
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: "Отразить по горизонтали"
+
+                onClicked: {
+                    photoProcessing.processFlipHorizontal()
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: "Отразить по вертикали"
+
+                onClicked: {
+                    photoProcessing.processFlipVertical()
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: "Автоуровни"
+
+                onClicked: {
+                    photoProcessing.processAutoLevels()
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: "Автоконтраст"
+
+                onClicked: {
+                    photoProcessing.processAutoContrast()
+                }
+            }
+
+            /* Гистограммы показанного изображения: каналы и яркость */
+            Canvas {
+                id: histogramCanvas
+
+                width: parent.width
+                height: 80
+
+                visible: photoProcessing.histogram.luma !== undefined
+
+                onPaint: {
+                    var context = getContext("2d")
+                    var histogram = photoProcessing.histogram
+
+                    context.reset()
+
+                    if (histogram.luma === undefined) {
+                        return
+                    }
+
+                    var channels = [
+                        { name: "red", color: "#c0ff4040" },
+                        { name: "green", color: "#c040ff40" },
+                        { name: "blue", color: "#c04080ff" },
+                        { name: "luma", color: "#e0ffffff" }
+                    ]
+
+                    var left = 16
+                    var step = (width - 2 * left) / 255
+
+                    for (var i = 0; i < channels.length; ++i) {
+                        var heights = histogram[channels[i].name]
+
+                        context.strokeStyle = channels[i].color
+                        context.lineWidth = 1
+                        context.beginPath()
+
+                        for (var level = 0; level < heights.length; ++level) {
+                            var x = left + level * step
+                            var y = height - heights[level] * (height - 4)
+
+                            if (level === 0) {
+                                context.moveTo(x, y)
+                            } else {
+                                context.lineTo(x, y)
+                            }
+                        }
+
+                        context.stroke()
+                    }
+                }
+
+                Connections {
+                    target: photoProcessing
+
+                    function onHistogramChanged() {
+                        histogramCanvas.requestPaint()
+                    }
                 }
             }
 
@@ -509,17 +806,8 @@ ApplicationWindow {
                             photoProcessing.isHueProcessingStarted = true
                         }
 
-                        if (photoProcessing.sourceWidth <= 800 || photoProcessing.sourceHeight <= 800) {
-                            threadQueue.push(["", image.source, hueSlider.value, 0])
-                            photoProcessing.processHue(image.source, hueSlider.value)
-                        } else {
-                            if (threadQueueTimer.running === false) {
-                                threadQueue.push(["", image.source, hueSlider.value, 0])
-                                threadQueueTimer.running = true
-                            } else {
-                                threadQueue.push(["", image.source, hueSlider.value, 0])
-                            }
-                        }
+                        /* Устаревшие запросы отменяются в PhotoProcessing, показывается только последний результат */
+                        photoProcessing.processHue(hueSlider.value)
                     }
                 }
 
@@ -538,8 +826,7 @@ ApplicationWindow {
                     onClicked: {
                         photoProcessing.isHueProcessingStarted = false
 
-                        imageOperationsHistory.push(image.source)
-                        currentOperationInHistory = imageOperationsHistory.length - 1
+                        photoProcessing.commitPreview()
                     }
 
                     SvgImage {
@@ -586,21 +873,11 @@ ApplicationWindow {
 
                     onMoved: {
                         if (photoProcessing.isBrightnessProcessingStarted === false) {
-                            photoProcessing.newBrightnessImage = photoProcessing.createTempImage(image.source)
                             photoProcessing.isBrightnessProcessingStarted = true
                         }
 
-                        if (photoProcessing.sourceWidth <= 800 || photoProcessing.sourceHeight <= 800) {
-                            threadQueue.push([photoProcessing.newBrightnessImage, image.source, brightnessSlider.value, 1])
-                            photoProcessing.processBrightness(photoProcessing.newBrightnessImage, image.source, brightnessSlider.value)
-                        } else {
-                            if (threadQueueTimer.running === false) {
-                                threadQueue.push([photoProcessing.newBrightnessImage, image.source, brightnessSlider.value, 1])
-                                threadQueueTimer.running = true
-                            } else {
-                                threadQueue.push([photoProcessing.newBrightnessImage, image.source, brightnessSlider.value, 1])
-                            }
-                        }
+                        /* Устаревшие запросы отменяются в PhotoProcessing, показывается только последний результат */
+                        photoProcessing.processBrightness(brightnessSlider.value)
                     }
                 }
 
@@ -617,12 +894,9 @@ ApplicationWindow {
                     }
 
                     onClicked: {
-                        threadQueue = []
-
                         photoProcessing.isBrightnessProcessingStarted = false
 
-                        imageOperationsHistory.push(image.source)
-                        currentOperationInHistory = imageOperationsHistory.length - 1
+                        photoProcessing.commitPreview()
                     }
 
                     SvgImage {
@@ -669,21 +943,11 @@ ApplicationWindow {
 
                     onMoved: {
                         if (photoProcessing.isContrastProcessingStarted === false) {
-                            photoProcessing.newContrastImage = photoProcessing.createTempImage(image.source)
                             photoProcessing.isContrastProcessingStarted = true
                         }
 
-                        if (photoProcessing.sourceWidth <= 800 || photoProcessing.sourceHeight <= 800) {
-                            threadQueue.push([photoProcessing.newContrastImage, image.source, contrastSlider.value, 2])
-                            photoProcessing.processContrast(photoProcessing.newContrastImage, image.source, contrastSlider.value)
-                        } else {
-                            if (threadQueueTimer.running === false) {
-                                threadQueue.push([photoProcessing.newContrastImage, image.source, contrastSlider.value, 2])
-                                threadQueueTimer.running = true
-                            } else {
-                                threadQueue.push([photoProcessing.newContrastImage, image.source, contrastSlider.value, 2])
-                            }
-                        }
+                        /* Устаревшие запросы отменяются в PhotoProcessing, показывается только последний результат */
+                        photoProcessing.processContrast(contrastSlider.value)
                     }
                 }
 
@@ -702,8 +966,7 @@ ApplicationWindow {
                     onClicked: {
                         photoProcessing.isContrastProcessingStarted = false
 
-                        imageOperationsHistory.push(image.source)
-                        currentOperationInHistory = imageOperationsHistory.length - 1
+                        photoProcessing.commitPreview()
                     }
 
                     SvgImage {
@@ -761,7 +1024,7 @@ ApplicationWindow {
                     width: parent.height
                     height: parent.height
 
-                    enabled: (boxBlurSamples.displayText.length > 0 && image.source != "")
+                    enabled: (boxBlurSamples.displayText.length > 0 && boxBlurRadius.displayText.length > 0 && image.hasImage)
 
                     flat: true
 
@@ -770,7 +1033,7 @@ ApplicationWindow {
                     }
 
                     onClicked: {
-                        photoProcessing.processBoxBlur(image.source, boxBlurSamples.text)
+                        photoProcessing.processBoxBlur(boxBlurSamples.text, boxBlurRadius.text, (boxBlurGaussian.checked === true) ? PhotoProcessing.FastGaussian : PhotoProcessing.Box)
                     }
 
                     SvgImage {
@@ -785,47 +1048,426 @@ ApplicationWindow {
                     }
                 }
             }
-        }
-    }
 
-    Connections {
-        target: photoProcessing
+            Row {
+                height: children[1].height
+                width: parent.width
 
-        function onImageEditChanged(filePath) {
-            imageBusyIndicatorLoader.active = false
+                spacing: 10
 
-            imageOperationsHistory.push(filePath)
-            currentOperationInHistory = imageOperationsHistory.length - 1
+                Text {
+                    height: parent.height
 
-            image.source = ""
-            image.source = filePath
-        }
+                    text: qsTr("Радиус")
+                    color: "white"
 
-        function onImageEditWithoutQueueChanged(filePath) {
-            imageBusyIndicatorLoader.active = false
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
 
-            image.source = ""
-            image.source = filePath
+                TextField {
+                    id: boxBlurRadius
 
-            if (threadQueue.length > 0 && (photoProcessing.sourceWidth <= 800 || photoProcessing.sourceHeight <= 800)) {
-                threadQueue.pop()
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
 
-                if (threadQueue.length !== 0) {
-                    let i = (threadQueue.length - 1 < 0) ? 0 : threadQueue.length - 1
+                    text: "1"
+                    placeholderText: "Радиус"
 
-                    if (threadQueue[i][3] === 0) {
-                        photoProcessing.processHue(threadQueue[i][1], threadQueue[i][2])
-                    } else if (threadQueue[i][3] === 1) {
-                        photoProcessing.processBrightness(threadQueue[i][0], threadQueue[i][1], threadQueue[i][2])
-                    } else if (threadQueue[i][3] === 2) {
-                        photoProcessing.processContrast(threadQueue[i][0], threadQueue[i][1], threadQueue[i][2])
-                    }
+                    selectByMouse: true
+
+                    leftPadding: 4
+                    rightPadding: 4
                 }
             }
-        }
+
+            CheckDelegate {
+                id: boxBlurGaussian
+
+                width: parent.width
+
+                text: qsTr("Быстрый гауссиан")
+            }
+
+            ToolSeparator {
+                width: parent.width
+
+                orientation: "Horizontal"
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Фильтр")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Порядок совпадает с PhotoProcessing.ConvolutionFilter */
+                ComboBox {
+                    id: convolutionFilterBox
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - parent.children[2].width - 10
+
+                    model: [qsTr("Резкость"), qsTr("Нерезкая маска"), qsTr("Гауссиан"), qsTr("Контуры"), qsTr("Тиснение")]
+                    currentIndex: PhotoProcessing.Sharpen
+                }
+
+                RoundButton {
+                    width: parent.height
+                    height: parent.height
+
+                    enabled: (image.hasImage)
+
+                    flat: true
+
+                    anchors {
+                        verticalCenter: parent.verticalCenter
+                    }
+
+                    onClicked: {
+                        photoProcessing.processConvolution(convolutionFilterBox.currentIndex, convolutionRadiusSlider.value, convolutionAmountSlider.value, convolutionBorderBox.currentIndex)
+                    }
+
+                    SvgImage {
+                        imageSource: "qrc:/mainMenu/tick.svg"
+                        imageColor: (parent.enabled === true) ? "white" : "gray"
+
+                        anchors {
+                            fill: parent
+
+                            margins: 10
+                        }
+                    }
+                }
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Сигма")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Стандартное отклонение гауссиана и нерезкой маски: ядро раскладывается на два прохода, поэтому большой радиус остается быстрым */
+                Slider {
+                    id: convolutionRadiusSlider
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    from: 0.5
+                    value: 2
+                    to: 50
+
+                    stepSize: 0.5
+                }
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Сила")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Сила резкости и нерезкой маски */
+                Slider {
+                    id: convolutionAmountSlider
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    from: 0
+                    value: 1
+                    to: 3
+
+                    stepSize: 0.1
+                }
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Края")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Порядок совпадает с PhotoProcessing.BorderMode */
+                ComboBox {
+                    id: convolutionBorderBox
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    model: [qsTr("Крайний пиксель"), qsTr("Отражение"), qsTr("Повтор"), qsTr("Прозрачные")]
+                    currentIndex: PhotoProcessing.Clamp
+                }
+            }
+
+            ToolSeparator {
+                width: parent.width
+
+                orientation: "Horizontal"
+            }
+
+            /* Пока включено, прямоугольник на изображении задает выделение, которое меняют правки, размытие и свертка */
+            SwitchDelegate {
+                id: selectionSwitch
+
+                width: parent.width
+
+                text: qsTr("Выделение")
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Мягкий край")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Ширина мягкого края в пикселях изображения */
+                Slider {
+                    id: selectionFeatherSlider
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    from: 0
+                    value: photoProcessing.selectionFeather
+                    to: 100
+
+                    stepSize: 1
+
+                    onMoved: {
+                        photoProcessing.selectionFeather = value
+                    }
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: qsTr("Сбросить выделение")
+
+                enabled: photoProcessing.selection.width > 0 && photoProcessing.selection.height > 0
+
+                onClicked: {
+                    photoProcessing.clearSelection()
+                }
+            }
+
+            ToolSeparator {
+                width: parent.width
+
+                orientation: "Horizontal"
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Масштаб")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Порядок совпадает с PhotoProcessing.ScalingFilter */
+                ComboBox {
+                    id: scalingFilterBox
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    model: [qsTr("По площади"), qsTr("Билинейный"), qsTr("Бикубический"), qsTr("Ланцош")]
+                    currentIndex: PhotoProcessing.Bicubic
+                }
+            }
+
+            ToolSeparator {
+                width: parent.width
+
+                orientation: "Horizontal"
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Качество")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Качество JPEG и WebP при сохранении */
+                Slider {
+                    id: exportQualitySlider
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    from: 0
+                    value: 90
+                    to: 100
+
+                    stepSize: 1
+                }
+            }
+
+            Row {
+                height: children[1].height
+                width: parent.width
+
+                spacing: 10
+
+                Text {
+                    height: parent.height
+
+                    text: qsTr("Сжатие")
+                    color: "white"
+
+                    font.pointSize: 10
+                    verticalAlignment: Text.AlignVCenter
+
+                    leftPadding: 16
+                }
+
+                /* Уровень сжатия PNG при сохранении: 1 - быстро для черновиков, 9 - минимальный размер */
+                Slider {
+                    id: exportCompressionSlider
+
+                    width: parent.width - parent.children[0].width - parent.children[0].leftPadding - 10
+
+                    from: 0
+                    value: 6
+                    to: 9
+
+                    stepSize: 1
+                }
+            }
+
+            ToolSeparator {
+                width: parent.width
+
+                orientation: "Horizontal"
+            }
+
+            SwitchDelegate {
+                width: parent.width
+
+                text: qsTr("Замеры операций")
+
+                checked: photoProcessing.tracing
+
+                onToggled: {
+                    photoProcessing.tracing = checked
+                }
+            }
+
+            ItemDelegate {
+                width: parent.width
+
+                text: qsTr("Сохранить трассу")
+
+                enabled: photoProcessing.tracing
+
+                onClicked: {
+                    saveTraceDialog.open()
+                }
+            }
+        }
+    }
+
+    Connections {
+        target: photoProcessing
+
+        /* ImageView сам забирает новое изображение у photoProcessing */
+        function onImageEditChanged(filePath) {
+            imageBusyIndicatorLoader.active = false
+        }
+
+        function onImageEditWithoutQueueChanged(filePath) {
+            imageBusyIndicatorLoader.active = false
+        }
 
         function onLoadingStartedChanged() {
             imageBusyIndicatorLoader.active = true
         }
+
+        function onLoadFailed(filePath) {
+            errorText.text = qsTr("Не удалось открыть: ") + filePath
+        }
+
+        function onExportFinished(success, filePath, error) {
+            errorText.text = success ? "" : qsTr("Не удалось сохранить: ") + error
+        }
     }
 }